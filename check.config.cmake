@@ -5,7 +5,7 @@ include (CheckCXXCompilerFlag)
 # just as an idea
 check_include_files(pthread.h HAS_PTHREAD_H)
 
-check_include_files(sys/eventfd.h HAS_EVENTFD)
+check_include_files(sys/eventfd.h HAS_EVENTFD_H)
 check_include_files(sys/epoll.h HAS_EPOLL)
 #check_include_files("unordered_map" HAVE_UNORDERED_MAP)
 check_cxx_compiler_flag(-std=c++0x HAS_CPP11FLAG)
@@ -22,6 +22,14 @@ file (READ "${CMAKE_CURRENT_SOURCE_DIR}/check/kqueue.cpp" source_code)
 
 CHECK_CXX_SOURCE_RUNS("${source_code}" HAS_KQUEUE)
 
+file (READ "${CMAKE_CURRENT_SOURCE_DIR}/check/iouring.cpp" source_code)
+
+CHECK_CXX_SOURCE_RUNS("${source_code}" HAS_IO_URING)
+
+file (READ "${CMAKE_CURRENT_SOURCE_DIR}/check/zerocopy.cpp" source_code)
+
+CHECK_CXX_SOURCE_RUNS("${source_code}" HAS_ZEROCOPY)
+
 
 file (READ "${CMAKE_CURRENT_SOURCE_DIR}/check/cpp11.cpp" source_code)
 
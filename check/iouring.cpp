@@ -0,0 +1,17 @@
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+
+int main(){
+	io_uring_params	params;
+	memset(&params, 0, sizeof(params));
+	int fd = syscall(__NR_io_uring_setup, 4, &params);
+	printf("io_uring = %d", fd);
+	if(fd < 0 || !(params.features & IORING_FEAT_NODROP)){
+		return 1;
+	}
+	close(fd);
+	return 0;
+}
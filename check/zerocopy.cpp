@@ -0,0 +1,14 @@
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <unistd.h>
+#include <cstdio>
+
+int main(){
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+	int rv = setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one));
+	printf("zerocopy = %d origin = %d flag = %d", rv, SO_EE_ORIGIN_ZEROCOPY, MSG_ZEROCOPY);
+	close(fd);
+	return rv == 0 ? 0 : 1;
+}
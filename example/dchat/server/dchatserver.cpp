@@ -111,8 +111,8 @@ struct InitMessage: Dynamic<InitMessage, BaseMessage>{
 //------------------------------------------------------------------------------------
 
 struct TextMessage: TextMessageBase, solid::Dynamic<TextMessage, BaseMessage>{
-	TextMessage(const std::string &_txt):TextMessageBase(_txt){}
-	TextMessage(){}
+	TextMessage(const std::string &_txt):TextMessageBase(_txt), produceruid(frame::invalid_uid()){}
+	TextMessage():produceruid(frame::invalid_uid()){}
 	
 	/*virtual*/ void ipcOnReceive(
 		solid::frame::ipc::ConnectionContext const &_rctx,
@@ -131,6 +131,8 @@ struct TextMessage: TextMessageBase, solid::Dynamic<TextMessage, BaseMessage>{
 	void serialize(S &_s, solid::frame::ipc::ConnectionContext const &_rctx){
 		_s.push(text, "text").push(user, "user");
 	}
+	
+	frame::ObjectUidT	produceruid;//the local connection the message came from - not serialized
 };
 
 //------------------------------------------------------------------------------------
@@ -272,6 +274,8 @@ public:
 	void onNodeDisconnect(SocketAddressInet4 &_raddr);
 	
 	void notifyNodes(DynamicPointer<frame::ipc::Message> &_rmsgptr, NotifyChoice _choice = NotifyAll);
+	//! Notify all the local connections but the producer, with one notifyMany
+	void notifyConnections(frame::MessageSharedPointerT &_rmsgptr, const frame::ObjectUidT &_rproduceruid);
 private:
 	friend class Listener;
 	friend class Connection;
@@ -280,12 +284,17 @@ private:
 		solid::frame::aio::openssl::Context *_pctx = NULL,
 		bool _secure = false
 	);
+	void eraseConnection(const frame::ObjectUidT &_ruid);
 private:
+	typedef std::vector<frame::ObjectUidT>	ObjectUidVectorT;
+	
 	AioSchedulerT						&rsched;
 	const serialization::TypeMapperBase &rtm;
 	NodeVectorT							nodevec;
 	frame::ipc::Service					*pipc;
 	mutable SharedMutex					shrmtx;
+	ObjectUidVectorT					conuidvec;
+	Mutex								conmtx;
 };
 
 //------------------------------------------------------------------------------------
@@ -592,7 +601,12 @@ class Connection: public solid::Dynamic<Connection, solid::frame::aio::SingleObj
 	typedef std::vector<MessageDynamicPointerT>					MessageVectorT;
 	typedef Queue<MessageDynamicPointerT>						MessageQueueT;
 	//typedef protocol::binary::BasicBufferController<2048>		BufferControllerT;
-	typedef protocol::binary::SpecificBufferController<2048>	BufferControllerT;
+	//a burst of chat messages goes in a single gather send of up to 4 buffers
+	typedef protocol::binary::SpecificBufferController<2048, 4096, 4096, 4>	BufferControllerT;
+	enum{
+		SendLowWatermark = 256 * 1024,
+		SendHighWatermark = 1024 * 1024,
+	};
 	enum States{
 		StateNotAuth,
 		StateAuth,
@@ -614,8 +628,9 @@ public:
 	Connection(
 		const SocketDevice &_rsd,
 		const serialization::TypeMapperBase &_rtm
-	):BaseT(_rsd), ser(_rtm), des(_rtm), stt(StateNotAuth){
+	):BaseT(_rsd), ser(_rtm), des(_rtm), stt(StateNotAuth), sndsz(0), pausecnt(0){
 		vdbg((void*)this);
+		sendWatermarks(SendLowWatermark, SendHighWatermark);
 		des.limits().containerlimit = 0;
 		des.limits().streamlimit = 0;
 		des.limits().stringlimit = 16;
@@ -646,7 +661,11 @@ public:
 	}
 private:
 	void onDoneSend(const size_t _msgidx);
+	void onSendWatermark(const frame::aio::SendWatermarkMessage &_rmsg);
+	void doSendNotification(MessageDynamicPointerT &_rmsgptr);
 	void done(){
+		//still registered - the selector unregisters it on close
+		service().eraseConnection(frame::Manager::specific().id(*this));
 		bufctl.clear();
 	}
 	/*virtual*/ void execute(ExecuteContext &_rexectx);
@@ -660,6 +679,8 @@ private:
 	std::string				usr;
 	MessageVectorT			msgvec;
 	MessageQueueT			msgq;
+	size_t					sndsz;//the backlog size of the notification being sent
+	size_t					pausecnt;//the connections asking us to stop reading
 };
 //------------------------------------------------------------------------------------
 void Service::insertConnection(
@@ -669,8 +690,38 @@ void Service::insertConnection(
 ){
 	DynamicPointer<frame::aio::Object>	conptr(new Connection(_rsd, rtm));
 	frame::ObjectUidT rv = this->registerObject(*conptr);
+	{
+		Locker<Mutex>	lock(conmtx);
+		conuidvec.push_back(rv);
+	}
 	rsched.schedule(conptr);
 }
+void Service::eraseConnection(const frame::ObjectUidT &_ruid){
+	Locker<Mutex>	lock(conmtx);
+	for(ObjectUidVectorT::iterator it(conuidvec.begin()); it != conuidvec.end(); ++it){
+		if(*it == _ruid){
+			*it = conuidvec.back();
+			conuidvec.pop_back();
+			break;
+		}
+	}
+}
+void Service::notifyConnections(frame::MessageSharedPointerT &_rmsgptr, const frame::ObjectUidT &_rproduceruid){
+	ObjectUidVectorT	uidvec;
+	{
+		//do not hold conmtx while the objects' mutexes are locked
+		Locker<Mutex>	lock(conmtx);
+		uidvec.reserve(conuidvec.size());
+		for(ObjectUidVectorT::const_iterator it(conuidvec.begin()); it != conuidvec.end(); ++it){
+			if(*it != _rproduceruid){
+				uidvec.push_back(*it);
+			}
+		}
+	}
+	if(uidvec.size()){
+		frame::Manager::specific().notifyMany(_rmsgptr, &uidvec.front(), uidvec.size());
+	}
+}
 void Service::onReceiveMessage(DynamicPointer<InitMessage> &_rmsgptr, frame::ipc::ConnectionContext const &_rctx){
 	if(_rmsgptr->type == InitMessage::RequestNodes){
 		_rmsgptr->type = InitMessage::ResponseNodes;
@@ -715,7 +766,7 @@ void Service::onReceiveMessage(DynamicPointer<InitMessage> &_rmsgptr, frame::ipc
 void Service::onReceiveMessage(DynamicPointer<TextMessage> &_rmsgptr, frame::ipc::ConnectionContext const &_rctx){
 	idbg(_rmsgptr->text);
 	frame::MessageSharedPointerT	msgptr(_rmsgptr);
-	this->notifyAll(msgptr);
+	notifyConnections(msgptr, frame::invalid_uid());
 }
 void Service::onNodeDisconnect(SocketAddressInet4 &_raddr){
 	idbg(_raddr);
@@ -800,6 +851,11 @@ bool Service::addNode(std::string &_rname, NodeTypes _type){
 	return true;
 }
 //--------------------------------------------------------------------------
+//! The amount a notification adds to the send backlog of a connection
+static size_t backlog_size(const TextMessage &_rmsg){
+	return _rmsg.text.size() + _rmsg.user.size();
+}
+
 /*virtual*/ void Connection::execute(ExecuteContext &_rexectx){
 	static Compressor 		compressor(BufferControllerT::DataCapacity);
 	
@@ -812,15 +868,27 @@ bool Service::addNode(std::string &_rname, NodeTypes _type){
 			return;
 		}
 		if(sm & frame::S_SIG){
-			Locker<Mutex>	lock(frame::Manager::specific().mutex(*this));
-			for(MessageVectorT::iterator it(msgvec.begin()); it != msgvec.end(); ++it){
+			MessageVectorT	tmpvec;
+			{
+				Locker<Mutex>	lock(frame::Manager::specific().mutex(*this));
+				tmpvec.swap(msgvec);
+			}
+			//the send backlog may notify other connections, so not under lock
+			for(MessageVectorT::iterator it(tmpvec.begin()); it != tmpvec.end(); ++it){
+				if((*it)->dynamicTypeId() == frame::aio::SendWatermarkMessage::staticTypeId()){
+					onSendWatermark(static_cast<frame::aio::SendWatermarkMessage&>(**it));
+					continue;
+				}
+				if((*it)->dynamicTypeId() == TextMessage::staticTypeId()){
+					const TextMessage	&rmsg(static_cast<const TextMessage&>(**it));
+					sendBacklogPush(backlog_size(rmsg), rmsg.produceruid);
+				}
 				if(msgq.size() || !session().isFreeSend(0)){
 					msgq.push(*it);
 				}else{
-					session().send(0, *it);
+					doSendNotification(*it);
 				}
 			}
-			msgvec.clear();
 		}
 	}
 	
@@ -834,7 +902,8 @@ bool Service::addNode(std::string &_rname, NodeTypes _type){
 	switch(stt){
 		case StateAuth:
 		case StateNotAuth:
-			rv = sess.execute(*this, _rexectx.eventMask(), ctx, ser, des, bufctl, compressor);
+			//stop reading from the client while other connections are congested
+			rv = sess.execute(*this, _rexectx.eventMask(), ctx, ser, des, bufctl, compressor, pausecnt == 0);
 			if(rv == solid::AsyncWait){
 				_rexectx.waitFor(TimeSpec(60 * 10));
 				return;
@@ -863,6 +932,7 @@ bool Service::addNode(std::string &_rname, NodeTypes _type){
 	if(rv == solid::AsyncSuccess){
 		_rexectx.reschedule();
 	}else if(rv == solid::AsyncError){
+		done();
 		_rexectx.close();
 	}
 	return;
@@ -871,13 +941,31 @@ bool Service::addNode(std::string &_rname, NodeTypes _type){
 void Connection::onDoneSend(const size_t _msgidx){
 	idbg(_msgidx);
 	if(!_msgidx){
+		sendBacklogPop(sndsz);
+		sndsz = 0;
 		if(msgq.size()){
-			session().send(0, msgq.front());
+			doSendNotification(msgq.front());
 			msgq.pop();
 		}
 	}
 }
 
+void Connection::onSendWatermark(const frame::aio::SendWatermarkMessage &_rmsg){
+	idbg("high = "<<_rmsg.high<<" pausecnt = "<<pausecnt);
+	if(_rmsg.high){
+		++pausecnt;
+	}else if(pausecnt){
+		--pausecnt;
+	}
+}
+
+void Connection::doSendNotification(MessageDynamicPointerT &_rmsgptr){
+	if(_rmsgptr->dynamicTypeId() == TextMessage::staticTypeId()){
+		sndsz = backlog_size(static_cast<const TextMessage&>(*_rmsgptr));
+	}
+	session().send(0, _rmsgptr);
+}
+
 void Connection::onAuthenticate(const std::string &_user){
 	stt = StateAuth;
 	des.limits().stringlimit = 1024 * 1024 * 10;
@@ -913,30 +1001,16 @@ void Handle::afterSerialization(BinDeserializerT &_rs, LoginRequest *_pm, Connec
 
 typedef DynamicSharedPointer<TextMessage>	TextMessageSharedPointerT;
 
-struct Notifier{
-
-	const frame::IndexT				objid;
-	TextMessageSharedPointerT		msgshrptr;
-	
-	Notifier(const frame::IndexT &_rid, TextMessage *_pm):objid(_rid), msgshrptr(_pm){}
-		
-	void operator()(frame::Object &_robj){
-		frame::Manager &rm = frame::Manager::specific();
-		if(_robj.id() != objid){
-			DynamicPointer<frame::Message>	msgptr(msgshrptr);
-			if(_robj.notify(msgptr)){
-				rm.raise(_robj);
-			}
-		}
-	}
-};
-
 void Handle::afterSerialization(BinDeserializerT &_rs, TextMessage *_pm, ConnectionContext &_rctx){
 	idbg("des::TextMessage("<<_pm->text<<')'<<' '<<_rctx.rcvmsgidx);
-	Notifier		notifier(_rctx.rcon.id(), _pm);
+	TextMessageSharedPointerT		msgshrptr(_pm);
 	_pm->user = _rctx.rcon.user();
-	_rctx.rcon.service().forEachObject(notifier);
-	DynamicPointer<frame::ipc::Message>	msgptr(notifier.msgshrptr);
+	_pm->produceruid = frame::Manager::specific().id(_rctx.rcon);
+	{
+		frame::MessageSharedPointerT	msgptr(msgshrptr);
+		_rctx.rcon.service().notifyConnections(msgptr, _pm->produceruid);
+	}
+	DynamicPointer<frame::ipc::Message>	msgptr(msgshrptr);
 	_rctx.rcon.service().notifyNodes(msgptr);
 }
 
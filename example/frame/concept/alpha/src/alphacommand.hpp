@@ -18,6 +18,9 @@
 namespace solid{
 class InputStream;
 class OutputStream;
+namespace frame{
+struct ResolveMessage;
+}//namespace frame
 }
 
 using solid::int64;
@@ -53,6 +56,7 @@ public:
 	);
 	virtual int receiveMessage(solid::DynamicPointer<FetchSlaveMessage> &_rmsgptr);
 	virtual int receiveMessage(solid::DynamicPointer<RemoteListMessage> &_rmsgptr);
+	virtual int receiveMessage(solid::DynamicPointer<solid::frame::ResolveMessage> &_rmsgptr);
 
 };
 
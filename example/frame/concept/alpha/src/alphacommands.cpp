@@ -21,6 +21,7 @@
 #include "frame/ipc/ipcservice.hpp"
 #include "frame/ipc/ipcservice.hpp"
 #include "frame/requestuid.hpp"
+#include "frame/resolver.hpp"
 
 #include "core/common.hpp"
 #include "core/tstring.hpp"
@@ -294,32 +295,37 @@ void RemoteList::execute(Connection &_rc){
 		hostvec.pop_back();
 	}
 	
-	DynamicSharedPointer<RemoteListMessage>	sig_sp(new RemoteListMessage(pausems, hostvec.size()));
+	if(hostvec.empty()){
+		return;
+	}
+	
+	msgptr = new RemoteListMessage(pausems, hostvec.size());
+	
+	msgptr->strpth = strpth;
+	msgptr->requid = _rc.newRequestId();
+	msgptr->fromv.first = _rc.id();
+	msgptr->fromv.second = Manager::the().id(_rc).second;
 	
-	sig_sp->strpth = strpth;
-	sig_sp->requid = _rc.newRequestId();
-	sig_sp->fromv.first = _rc.id();
-	sig_sp->fromv.second = Manager::the().id(_rc).second;
+	//the resolves must not block the connection's thread
+	state = WaitResolve;
+	waitcnt = hostvec.size();
+	sendcnt = 0;
+	_rc.writer().push(&Writer::reinit<RemoteList>, protocol::text::Parameter(this));
 	
 	for(HostAddrVectorT::const_iterator it(hostvec.begin()); it != hostvec.end(); ++it){
-		const String &straddr(it->addr);
-		const String &port(it->port);
-		idbg("addr"<<straddr<<" port = "<<port);
-		ResolveData rd = synchronous_resolve(straddr.c_str(), port.c_str(), 0, SocketInfo::Inet4, SocketInfo::Stream);
-		if(!rd.empty()){
-			state = Wait;
-			DynamicPointer<frame::ipc::Message> msgptr(sig_sp);
-			Manager::the().ipc().sendMessage(msgptr, rd.begin(), it->netid/*, frame::ipc::Service::SameConnectorFlag*/);
-			_rc.writer().push(&Writer::reinit<RemoteList>, protocol::text::Parameter(this));
-		}else{
-			*pp = protocol::text::Parameter(StrDef(" NO REMOTELIST: no such peer address@"));
-		}
+		idbg("addr"<<it->addr<<" port = "<<it->port);
+		Manager::the().resolver().resolve(
+			Manager::the().id(_rc), it->addr.c_str(), it->port.c_str(), 0, SocketInfo::Inet4, SocketInfo::Stream
+		);
 	}
 }
 int RemoteList::reinitWriter(Writer &_rw, protocol::text::Parameter &_rp){
 	switch(state){
+		case WaitResolve:
 		case Wait:
 			return Writer::Wait;
+		case ResolveError:
+			return Writer::Success;
 		case SendListContinue:
 			++it;
 		case SendList:
@@ -354,6 +360,40 @@ int RemoteList::reinitWriter(Writer &_rw, protocol::text::Parameter &_rp){
 	}
 	return AsyncSuccess;
 }
+
+/*virtual*/ int RemoteList::receiveMessage(solid::DynamicPointer<frame::ResolveMessage> &_rmsgptr){
+	idbg("");
+	if(state != WaitResolve){
+		return AsyncError;
+	}
+	HostAddrVectorT::iterator it(hostvec.begin());
+	for(; it != hostvec.end(); ++it){
+		if(!it->resolved && _rmsgptr->node == it->addr.c_str() && _rmsgptr->service == it->port.c_str()){
+			break;
+		}
+	}
+	if(it == hostvec.end()){
+		return AsyncError;
+	}
+	it->resolved = true;
+	if(!_rmsgptr->data.empty()){
+		DynamicPointer<frame::ipc::Message> ipcmsgptr(msgptr);
+		Manager::the().ipc().sendMessage(ipcmsgptr, _rmsgptr->data.begin(), it->netid/*, frame::ipc::Service::SameConnectorFlag*/);
+		++sendcnt;
+	}else{
+		*pp = protocol::text::Parameter(StrDef(" NO REMOTELIST: no such peer address@"));
+	}
+	if(--waitcnt){
+		return AsyncSuccess;
+	}
+	msgptr.clear();
+	if(sendcnt){
+		state = Wait;
+	}else{
+		state = ResolveError;
+	}
+	return AsyncSuccess;
+}
 //---------------------------------------------------------------
 // Fetch command
 //---------------------------------------------------------------
@@ -429,11 +469,18 @@ int Fetch::doGetTempStream(uint32 _sz){
 	return Writer::Wait;
 }
 
-void Fetch::doSendMaster(const solid::frame::UidT &_ruid){
-	idbg(""<<(void*)this);
-	ResolveData rd = synchronous_resolve(straddr.c_str(), port.c_str(), 0, SocketInfo::Inet4, SocketInfo::Stream);
+void Fetch::doResolveMaster(){
 	idbg("addr"<<straddr<<" port = "<<port);
-	if(!rd.empty()){
+	//the resolve must not block the connection's thread
+	state = WaitResolve;
+	Manager::the().resolver().resolve(
+		Manager::the().id(rc), straddr.c_str(), port.c_str(), 0, SocketInfo::Inet4, SocketInfo::Stream
+	);
+}
+
+void Fetch::doSendMaster(const ResolveData &_rrd){
+	idbg(""<<(void*)this);
+	if(!_rrd.empty()){
 		//send the master remote command
 		FetchMasterMessage						*pmsg(new FetchMasterMessage);
 		DynamicPointer<frame::ipc::Message>		msgptr(pmsg);
@@ -441,11 +488,11 @@ void Fetch::doSendMaster(const solid::frame::UidT &_ruid){
 		pmsg->fname = strpth;
 		pmsg->requid = rc.newRequestId();
 		pmsg->fromv = Manager::the().id(rc);
-		pmsg->tmpfuid = _ruid;
+		pmsg->tmpfuid = tmpfuid;
 		pmsg->streamsz = streamcp;
 		state = WaitFirstRemoteStream;
 		
-		Manager::the().ipc().sendMessage(msgptr, rd.begin());
+		Manager::the().ipc().sendMessage(msgptr, _rrd.begin());
 	}else{
 		*pp = protocol::text::Parameter(StrDef(" NO FETCH: no such peer address@"));
 		state = ReturnOk;
@@ -531,6 +578,7 @@ int Fetch::reinitWriter(Writer &_rw, protocol::text::Parameter &_rp){
 			return doSendNextData(_rw);
 		case WaitLocalStream:
 		case WaitTempStream:
+		case WaitResolve:
 		case WaitFirstRemoteStream:
 		case WaitRemoteStream:
 			return Writer::Wait;
@@ -569,8 +617,8 @@ int Fetch::receiveFilePointer(FilePointerMessage &_rmsg){
 	}else if(state == WaitTempStream){
 		if(!ios.device().empty()){
 			Manager::the().fileStore().uniqueToShared(ios.device());
-			state = WaitFirstRemoteStream;
-			doSendMaster(ios.device().id());
+			tmpfuid = ios.device().id();
+			doResolveMaster();
 		}else{
 			state = SendTempError;
 		}
@@ -602,6 +650,14 @@ int Fetch::receiveFilePointer(FilePointerMessage &_rmsg){
 	}
 	return AsyncSuccess;
 }
+/*virtual*/ int Fetch::receiveMessage(solid::DynamicPointer<frame::ResolveMessage> &_rmsgptr){
+	idbg("");
+	if(state != WaitResolve || _rmsgptr->node != straddr.c_str() || _rmsgptr->service != port.c_str()){
+		return AsyncError;
+	}
+	doSendMaster(_rmsgptr->data);
+	return AsyncSuccess;
+}
 //---------------------------------------------------------------
 // Store Command
 //---------------------------------------------------------------
@@ -803,6 +859,9 @@ int Command::receiveMessage(solid::DynamicPointer<FetchSlaveMessage> &_rmsgptr){
 int Command::receiveMessage(solid::DynamicPointer<RemoteListMessage> &_rmsgptr){
 	return AsyncError;
 }
+int Command::receiveMessage(solid::DynamicPointer<solid::frame::ResolveMessage> &_rmsgptr){
+	return AsyncError;
+}
 
 }//namespace alpha
 }//namespace concept
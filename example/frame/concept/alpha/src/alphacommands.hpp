@@ -116,6 +116,7 @@ public:
 		FilePointerMessage &_rmsg
 	);
 	/*virtual*/ int receiveMessage(solid::DynamicPointer<FetchSlaveMessage> &_rmsgptr);
+	/*virtual*/ int receiveMessage(solid::DynamicPointer<solid::frame::ResolveMessage> &_rmsgptr);
 private:
 	enum State{
 		InitLocal,
@@ -125,6 +126,7 @@ private:
 		SendNextData,
 		WaitLocalStream,
 		WaitTempStream,
+		WaitResolve,
 		WaitFirstRemoteStream,
 		WaitRemoteStream,
 		SendRemoteError,
@@ -134,7 +136,8 @@ private:
 		ReturnOk,
 		ReturnCrlf,
 	};
-	void doSendMaster(const solid::frame::UidT &_ruid);
+	void doResolveMaster();
+	void doSendMaster(const solid::ResolveData &_rrd);
 	int doInitLocal();
 	int doSendLiteral(Writer &_rw, bool _local);
 	int doGetTempStream(uint32 _sz);
@@ -153,6 +156,7 @@ private:
 	FileIOStreamT								ios;
 	
 	solid::frame::UidT							mastermsguid;
+	solid::frame::UidT							tmpfuid;//the temp stream, waiting for the master address
 	uint32										tmpstreamcp;//temp stream capacity
 	uint64										streamsz;
 	uint32										streamcp;
@@ -216,7 +220,7 @@ private:
 */
 class RemoteList: public Command{
 public:
-	enum {Wait, SendList, SendError, SendListContinue};
+	enum {WaitResolve, ResolveError, Wait, SendList, SendError, SendListContinue};
 	//typedef std::list<std::pair<String,int64> > PathListT;
 	struct PathListT: std::list<std::pair<solid::String,int64> >{
 		PathListT();
@@ -233,11 +237,14 @@ public:
 	
 private:
 	/*virtual*/ int receiveMessage(solid::DynamicPointer<RemoteListMessage> &_rmsgptr);
+	/*virtual*/ int receiveMessage(solid::DynamicPointer<solid::frame::ResolveMessage> &_rmsgptr);
 private:
 	struct HostAddr{
+		HostAddr():netid(0), resolved(false){}
 		solid::String	addr;
 		solid::String	port;
 		uint32			netid;
+		bool			resolved;
 	};
 	typedef std::vector<HostAddr>				HostAddrVectorT;
 	typedef solid::protocol::text::Parameter	ParameterT;
@@ -248,6 +255,9 @@ private:
 	PathListT::const_iterator	it;
 	int							state;
 	ParameterT					*pp;
+	size_t						waitcnt;
+	size_t						sendcnt;
+	solid::DynamicSharedPointer<RemoteListMessage>	msgptr;
 };
 
 //! Wait for internal server events
@@ -18,6 +18,7 @@
 
 #include "frame/ipc/ipcservice.hpp"
 #include "frame/requestuid.hpp"
+#include "frame/resolver.hpp"
 
 
 #include "core/manager.hpp"
@@ -62,6 +63,7 @@ void Logger::doOutFlush(const char *_pb, unsigned _bl){
 	dm.insert<FilePointerMessage, Connection>();
 	dm.insert<RemoteListMessage, Connection>();
 	dm.insert<FetchSlaveMessage, Connection>();
+	dm.insert<frame::ResolveMessage, Connection>();
 }
 
 #ifdef UDEBUG
@@ -451,6 +453,30 @@ void Connection::dynamicHandle(DynamicPointer<FetchSlaveMessage> &_rmsgptr){
 		}
 	}
 }
+void Connection::dynamicHandle(DynamicPointer<frame::ResolveMessage> &_rmsgptr){
+	idbg("");
+	if(pcmd){
+		int rv = pcmd->receiveMessage(_rmsgptr);
+		switch(rv){
+			case AsyncError:
+				idbg("");
+				break;
+			case AsyncSuccess:
+				idbg("");
+				if(state() == ParseTout){
+					state(Parse);
+				}
+				if(state() == ExecuteTout){
+					state(Execute);
+				}
+				break;
+			case AsyncWait:
+				idbg("");
+				state(IdleExecute);
+				break;
+		}
+	}
+}
 void Connection::dynamicHandle(DynamicPointer<FilePointerMessage> &_rmsgptr){
 	idbg("");
 	if(_rmsgptr->reqidx && _rmsgptr->reqidx != reqid){
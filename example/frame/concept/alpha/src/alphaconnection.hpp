@@ -12,6 +12,7 @@
 
 #include "utility/dynamictype.hpp"
 #include "frame/aio/aiosingleobject.hpp"
+#include "frame/resolver.hpp"
 
 #include "core/tstring.hpp"
 #include "core/common.hpp"
@@ -99,6 +100,7 @@ public:
 	void dynamicHandle(solid::DynamicPointer<RemoteListMessage> &_rmsgptr);
 	void dynamicHandle(solid::DynamicPointer<FetchSlaveMessage> &_rmsgptr);
 	void dynamicHandle(solid::DynamicPointer<FilePointerMessage> &_rmsgptr);
+	void dynamicHandle(solid::DynamicPointer<solid::frame::ResolveMessage> &_rmsgptr);
 private:
 	/*virtual*/ void execute(ExecuteContext &_rexectx);
 	void prepareReader();
@@ -81,7 +81,12 @@ ObjectUidT Service::insertConnection(
 	solid::frame::aio::openssl::Context *_pctx,
 	bool _secure
 ){
-	DynamicPointer<frame::aio::Object>	conptr(new Connection(_rsd));
+	Connection							*pcon(new Connection(_rsd));
+	if(_pctx){
+		//the connection does the hand-shake in its Init state
+		pcon->socketSecureSocket(_pctx->createSocket());
+	}
+	DynamicPointer<frame::aio::Object>	conptr(pcon);
 	ObjectUidT rv = this->registerObject(*conptr);
 	Manager::the().scheduleAioObject(conptr);
 	return rv;
@@ -105,6 +105,12 @@ int Writer::write(char *_pb, uint32 _bl){
 	return Connection::the().socketSend(_pb, _bl);
 }
 
+int Writer::write(char *_pb1, uint32 _bl1, char *_pb2, uint32 _bl2){
+	iobufs[0] = frame::aio::IoBuffer(_pb1, _bl1);
+	iobufs[1] = frame::aio::IoBuffer(_pb2, _bl2);
+	return Connection::the().socketSendv(iobufs, 2);
+}
+
 }//namespace alpha
 }//namespace concept
 
@@ -28,6 +28,8 @@ class Service;
 namespace file{
 class Manager;
 }//namespace file
+
+class Resolver;
 }//namespace frame
 }//namespace solid
 
@@ -64,6 +66,7 @@ public:
 	
 	solid::frame::ipc::Service 	&ipc()const;
 	FileStoreT&	fileStore()const;
+	solid::frame::Resolver& resolver()const;
 private:
 	struct Data;
 	Data	&d;
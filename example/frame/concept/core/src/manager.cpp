@@ -22,10 +22,12 @@
 
 #include "frame/aio/aioselector.hpp"
 #include "frame/aio/aioobject.hpp"
+#include "frame/aio/aiohandshakepool.hpp"
 
 #include "frame/objectselector.hpp"
 #include "frame/message.hpp"
 #include "frame/requestuid.hpp"
+#include "frame/resolver.hpp"
 
 #include "frame/ipc/ipcservice.hpp"
 
@@ -108,15 +110,22 @@ private:
 
 struct Manager::Data{
 	Data(Manager &_rm):
-		mainaiosched(_rm), scndaiosched(_rm), objsched(_rm),
-		ipcsvc(_rm, new IpcServiceController){
+		hspool(_rm), mainaiosched(_rm, -1), scndaiosched(_rm, -1), objsched(_rm),
+		ipcsvc(_rm, new IpcServiceController), resolver(_rm){
+		//the ssl hand-shakes of the secure alpha connections do not stall the selectors
+		mainaiosched.handshakePool(&hspool);
+		scndaiosched.handshakePool(&hspool);
+		mainaiosched.start();
+		scndaiosched.start();
 	}
 	
+	frame::aio::HandshakePool	hspool;//must outlive the aio schedulers
 	AioSchedulerT				mainaiosched;
 	AioSchedulerT				scndaiosched;
 	SchedulerT					objsched;
 	frame::ipc::Service			ipcsvc;
 	FileStoreSharedPointerT		filestoreptr;
+	frame::Resolver				resolver;
 };
 
 //--------------------------------------------------------------------------
@@ -138,6 +147,7 @@ Manager::~Manager(){
 	d.mainaiosched.stop(true);
 	d.scndaiosched.stop(true);
 	d.objsched.stop(true);
+	d.hspool.stop();
 	delete &d;
 }
 
@@ -189,6 +199,9 @@ frame::ipc::Service&	Manager::ipc()const{
 FileStoreT&	Manager::fileStore()const{
 	return *d.filestoreptr;
 }
+frame::Resolver& Manager::resolver()const{
+	return d.resolver;
+}
 
 void Manager::scheduleListener(solid::DynamicPointer<solid::frame::aio::Object> &_objptr){
 	d.scndaiosched.schedule(_objptr);
@@ -92,6 +92,12 @@ int Writer::write(char *_pb, uint32 _bl){
 	return Connection::the().socketSend(sid, _pb, _bl);
 }
 
+int Writer::write(char *_pb1, uint32 _bl1, char *_pb2, uint32 _bl2){
+	iobufs[0] = frame::aio::IoBuffer(_pb1, _bl1);
+	iobufs[1] = frame::aio::IoBuffer(_pb2, _bl2);
+	return Connection::the().socketSendv(sid, iobufs, 2);
+}
+
 }//namespace gamma
 }//namespace concept
 
@@ -2,6 +2,7 @@
 #define CONCEPT_GAMMA_WRITER_HPP
 
 #include "protocol/text/writer.hpp"
+#include "frame/aio/aiocommon.hpp"
 #include "core/tstring.hpp"
 
 using solid::uint;
@@ -45,11 +46,13 @@ private:
 	//! Asynchrounously writes a quoted string
 	static int putQString(solid::protocol::text::Writer &_rw, solid::protocol::text::Parameter &_rp);
 	/*virtual*/ int write(char *_pb, uint32 _bl);
+	/*virtual*/ int write(char *_pb1, uint32 _bl1, char *_pb2, uint32 _bl2);
 	//virtual int doManage(int _mo);
 private:
 	uint				sid;
 	solid::String		msgs;
 	solid::String		tags;
+	solid::frame::aio::IoBuffer	iobufs[2];//must live until the send completes
 };
 
 }//namespace gamma
@@ -0,0 +1,415 @@
+// echobench.cpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#include "frame/manager.hpp"
+#include "frame/scheduler.hpp"
+
+#include "frame/aio/aioselector.hpp"
+#include "frame/aio/aiosingleobject.hpp"
+#include "frame/aio/aioshardlistener.hpp"
+
+#include "system/thread.hpp"
+#include "system/mutex.hpp"
+#include "system/condition.hpp"
+#include "system/socketaddress.hpp"
+#include "system/socketdevice.hpp"
+
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+using namespace solid;
+
+///\cond 0
+/*
+	Counts the system calls the server side of an echo service issues
+	per echoed message, with and without the persistent (register once,
+	edge triggered) socket registration of the aio::Selector.
+	The clients run in a child process, one blocking connection per
+	thread, so only the server calls are counted.
+
+	The last two runs use more selectors, first with a single listener
+	scheduling the connections through the shared queue, then with one
+	SO_REUSEPORT listener per selector (aio::ShardListener) keeping every
+	connection on the selector which accepted it, without waking another
+	selector (the wake ups are counted as write calls on the eventfd).
+
+	The counted calls are interposed below and forwarded with syscall(2).
+
+	Usage: example_echobench [connections] [messages per connection] [message size] [port] [selectors]
+*/
+enum SysCallE{
+	SysEpollWait = 0,
+	SysEpollCtl,
+	SysRecv,
+	SysSend,
+	SysRead,
+	SysWrite,
+	SysAccept,
+	SysCount
+};
+
+static const char *sysnames[SysCount] = {
+	"epoll_wait", "epoll_ctl", "recv", "send", "read", "write", "accept"
+};
+
+static ATOMIC_NS::atomic<bool>		counting(ATOMIC_VAR_INIT(false));
+static ATOMIC_NS::atomic<uint64>	syscnt[SysCount];
+
+static inline void count(const SysCallE _sys){
+	if(counting.load(ATOMIC_NS::memory_order_relaxed)){
+		syscnt[_sys].fetch_add(1, ATOMIC_NS::memory_order_relaxed);
+	}
+}
+
+extern "C"{
+
+int epoll_wait(int _epfd, struct epoll_event *_pevs, int _maxevs, int _tout){
+	count(SysEpollWait);
+	return syscall(SYS_epoll_pwait, _epfd, _pevs, _maxevs, _tout, NULL, _NSIG / 8);
+}
+
+int epoll_ctl(int _epfd, int _op, int _fd, struct epoll_event *_pev) __THROW{
+	count(SysEpollCtl);
+	return syscall(SYS_epoll_ctl, _epfd, _op, _fd, _pev);
+}
+
+ssize_t recv(int _fd, void *_pb, size_t _bl, int _flags){
+	count(SysRecv);
+	return syscall(SYS_recvfrom, _fd, _pb, _bl, _flags, NULL, NULL);
+}
+
+ssize_t send(int _fd, const void *_pb, size_t _bl, int _flags){
+	count(SysSend);
+	return syscall(SYS_sendto, _fd, _pb, _bl, _flags, NULL, 0);
+}
+
+ssize_t read(int _fd, void *_pb, size_t _bl){
+	count(SysRead);
+	return syscall(SYS_read, _fd, _pb, _bl);
+}
+
+ssize_t write(int _fd, const void *_pb, size_t _bl){
+	count(SysWrite);
+	return syscall(SYS_write, _fd, _pb, _bl);
+}
+
+int accept(int _fd, struct sockaddr *_psa, socklen_t *_psalen){
+	count(SysAccept);
+	return syscall(SYS_accept4, _fd, _psa, _psalen, 0);
+}
+
+}//extern "C"
+
+typedef frame::Scheduler<frame::aio::Selector>	AioSchedulerT;
+
+namespace{
+	Mutex		mtx;
+	Condition	cnd;
+	size_t		closedcnt(0);
+}
+
+class Listener: public Dynamic<Listener, frame::aio::SingleObject>{
+public:
+	Listener(frame::Manager &_rm, AioSchedulerT &_rsched, const SocketDevice &_rsd):BaseT(_rsd, true), rm(_rm), rsched(_rsched){}
+private:
+	/*virtual*/ void execute(ExecuteContext &_rexectx);
+
+	SocketDevice		sd;
+	frame::Manager		&rm;
+	AioSchedulerT		&rsched;
+};
+
+class ShardListener: public Dynamic<ShardListener, frame::aio::ShardListener>{
+public:
+	ShardListener(frame::Manager &_rm, AioSchedulerT &_rsched, const SocketDevice &_rsd):BaseT(_rsd), rm(_rm), rsched(_rsched){}
+private:
+	/*virtual*/ void onAccept(SocketDevice &_rsd);
+
+	frame::Manager		&rm;
+	AioSchedulerT		&rsched;
+};
+
+class Connection: public Dynamic<Connection, frame::aio::SingleObject>{
+public:
+	Connection(const SocketDevice &_rsd):BaseT(_rsd), state(Read){}
+	~Connection(){
+		Locker<Mutex>	lock(mtx);
+		++closedcnt;
+		cnd.signal();
+	}
+private:
+	/*virtual*/ void execute(ExecuteContext &_rexectx);
+private:
+	enum {BUFSZ = 4 * 1024};
+	enum {Read, ReadWait, Write, WriteWait};
+	int		state;
+	char	buf[BUFSZ];
+};
+
+/*virtual*/ void Listener::execute(ExecuteContext &_rexectx){
+	if(notified()){
+		ulong sm = this->grabSignalMask();
+		if(sm & frame::S_KILL){
+			_rexectx.close();
+			return;
+		}
+	}
+	while(true){
+		switch(this->socketAccept(sd)){
+			case frame::aio::AsyncError:
+				_rexectx.close();
+				return;
+			case frame::aio::AsyncSuccess:break;
+			case frame::aio::AsyncWait:
+				return;
+		}
+		sd.enableNoDelay();
+		DynamicPointer<Connection> conptr(new Connection(sd));
+		rm.registerObject(*conptr);
+		rsched.schedule(conptr);
+	}
+}
+
+/*virtual*/ void ShardListener::onAccept(SocketDevice &_rsd){
+	_rsd.enableNoDelay();
+	DynamicPointer<Connection> conptr(new Connection(_rsd));
+	rm.registerObject(*conptr);
+	rsched.scheduleLocal(conptr);
+}
+
+/*virtual*/ void Connection::execute(ExecuteContext &_rexectx){
+	if(_rexectx.eventMask() & (frame::EventTimeout | frame::EventDoneError)){
+		_rexectx.close();
+		return;
+	}
+	if(socketEventsGrab() & frame::EventDoneError){
+		_rexectx.close();
+		return;
+	}
+	while(true){
+		switch(state){
+			case Read:
+				switch(socketRecv(buf, BUFSZ)){
+					case frame::aio::AsyncError:
+						_rexectx.close();
+						return;
+					case frame::aio::AsyncSuccess: break;
+					case frame::aio::AsyncWait:
+						state = ReadWait;
+						return;
+				}
+			case ReadWait:
+				state = Write;
+			case Write:
+				switch(socketSend(buf, socketRecvSize())){
+					case frame::aio::AsyncError:
+						_rexectx.close();
+						return;
+					case frame::aio::AsyncSuccess: break;
+					case frame::aio::AsyncWait:
+						state = WriteWait;
+						return;
+				}
+			case WriteWait:
+				state = Read;
+				break;
+		}
+	}
+}
+
+struct ClientStub{
+	int		port;
+	size_t	msgcnt;
+	size_t	msgsz;
+};
+
+static void* client_run(void *_pv){
+	const ClientStub	&rcs(*static_cast<ClientStub*>(_pv));
+	const int			sd(socket(AF_INET, SOCK_STREAM, 0));
+	sockaddr_in			addr;
+	int					one(1);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(rcs.port);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if(connect(sd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))){
+		cout<<"client connect error: "<<strerror(errno)<<endl;
+		close(sd);
+		return NULL;
+	}
+	setsockopt(sd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	char	*pbuf(new char[rcs.msgsz]);
+	memset(pbuf, 'a', rcs.msgsz);
+	for(size_t i = 0; i < rcs.msgcnt; ++i){
+		if(::send(sd, pbuf, rcs.msgsz, 0) != (ssize_t)rcs.msgsz) break;
+		size_t	rcvsz(0);
+		while(rcvsz < rcs.msgsz){
+			const ssize_t rv(::recv(sd, pbuf + rcvsz, rcs.msgsz - rcvsz, 0));
+			if(rv <= 0) break;
+			rcvsz += rv;
+		}
+		if(rcvsz != rcs.msgsz) break;
+	}
+	delete []pbuf;
+	close(sd);
+	return NULL;
+}
+
+static void run_clients(const ClientStub &_rcs, const size_t _concnt){
+	pthread_t	*pth(new pthread_t[_concnt]);
+	for(size_t i = 0; i < _concnt; ++i){
+		pthread_create(&pth[i], NULL, client_run, const_cast<ClientStub*>(&_rcs));
+	}
+	for(size_t i = 0; i < _concnt; ++i){
+		pthread_join(pth[i], NULL);
+	}
+	delete []pth;
+}
+
+enum TestE{
+	TestModify,
+	TestPersistent,
+	TestShared,
+	TestSharded
+};
+
+static void test(const TestE _test, const size_t _concnt, const ClientStub &_rcs, const size_t _selcnt){
+	ResolveData		rd = synchronous_resolve("127.0.0.1", _rcs.port, 0, SocketInfo::Inet4, SocketInfo::Stream);
+	SocketDevice	sd;
+
+	frame::aio::SocketDeviceVectorT	sdvec;
+
+	if(_test == TestSharded){
+		if(!frame::aio::ShardListener::prepareAccept(sdvec, rd.begin(), _selcnt)){
+			cout<<"error creating sharded listeners on port "<<_rcs.port<<endl;
+			return;
+		}
+	}else{
+		sd.create(rd.begin());
+		sd.makeNonBlocking();
+		if(!sd.ok() || !sd.prepareAccept(rd.begin(), 1024)){
+			cout<<"error creating listener on port "<<_rcs.port<<endl;
+			return;
+		}
+	}
+
+	const pid_t		pid(fork());
+	if(pid == 0){
+		//NOTE: do not close sd - SocketDevice::close also shuts the listener down for the parent
+		run_clients(_rcs, _concnt);
+		_exit(0);
+	}
+
+	closedcnt = 0;
+	for(size_t i = 0; i < SysCount; ++i){
+		syscnt[i].store(0);
+	}
+	{
+		const size_t	selcnt(_test >= TestShared ? _selcnt : 1);
+		frame::Manager	m;
+		AioSchedulerT	aiosched(m, -static_cast<int>(selcnt), selcnt);
+
+		aiosched.persistentRegistration(_test != TestModify);
+
+		TimeSpec		start(TimeSpec::createMonotonic());
+
+		counting.store(true);
+
+		if(_test == TestSharded){
+			//one listener on every selector
+			for(frame::aio::SocketDeviceVectorT::const_iterator it(sdvec.begin()); it != sdvec.end(); ++it){
+				DynamicPointer<ShardListener> lsnptr(new ShardListener(m, aiosched, *it));
+				m.registerObject(*lsnptr);
+				aiosched.scheduleEach(lsnptr);
+			}
+			aiosched.start(selcnt);
+		}else{
+			aiosched.start(selcnt);
+			DynamicPointer<Listener> lsnptr(new Listener(m, aiosched, sd));
+			m.registerObject(*lsnptr);
+			aiosched.schedule(lsnptr);
+		}
+
+		{
+			Locker<Mutex>	lock(mtx);
+			while(closedcnt < _concnt){
+				cnd.wait(lock);
+			}
+		}
+		counting.store(false);
+
+		TimeSpec		end(TimeSpec::createMonotonic());
+		end -= start;
+
+		waitpid(pid, NULL, 0);
+		m.stop();
+
+		const size_t	msgcnt(_concnt * _rcs.msgcnt);
+		uint64			total(0);
+		static const char *testnames[] = {
+			"modify registration", "persistent registration",
+			"shared queue", "sharded listeners"
+		};
+		cout<<testnames[_test]<<" on "<<selcnt<<" selector(s): messages = "<<msgcnt;
+		cout<<" time = "<<(end.seconds() * 1000 + end.nanoSeconds() / 1000000)<<"ms"<<endl;
+		for(size_t i = 0; i < SysCount; ++i){
+			const uint64 v(syscnt[i].load());
+			total += v;
+			cout<<'\t'<<sysnames[i]<<" = "<<v<<" ("<<((double)v / msgcnt)<<"/msg)"<<endl;
+		}
+		cout<<"\ttotal = "<<total<<" ("<<((double)total / msgcnt)<<"/msg)"<<endl;
+	}
+}
+///\endcond
+
+int main(int argc, char *argv[]){
+	size_t		concnt(8);
+	ClientStub	cs;
+	size_t		selcnt(2);
+
+	cs.msgcnt = 10000;
+	cs.msgsz = 64;
+	cs.port = 3111;
+
+	if(argc > 1) concnt = atoi(argv[1]);
+	if(argc > 2) cs.msgcnt = atoi(argv[2]);
+	if(argc > 3) cs.msgsz = atoi(argv[3]);
+	if(argc > 4) cs.port = atoi(argv[4]);
+	if(argc > 5) selcnt = atoi(argv[5]);
+
+	signal(SIGPIPE, SIG_IGN);
+
+	Thread::init();
+
+	test(TestModify, concnt, cs, selcnt);
+	++cs.port;
+	test(TestPersistent, concnt, cs, selcnt);
+	++cs.port;
+	test(TestShared, concnt, cs, selcnt);
+	++cs.port;
+	test(TestSharded, concnt, cs, selcnt);
+
+	Thread::waitAll();
+	return 0;
+}
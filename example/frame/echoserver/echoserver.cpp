@@ -1,9 +1,11 @@
 #include "frame/manager.hpp"
 #include "frame/scheduler.hpp"
+#include "frame/stealingscheduler.hpp"
 #include "frame/objectselector.hpp"
 
 #include "frame/aio/aioselector.hpp"
 #include "frame/aio/aiosingleobject.hpp"
+#include "frame/aio/aiorecvbuffer.hpp"
 #include "frame/aio/openssl/opensslsocket.hpp"
 
 #include "system/thread.hpp"
@@ -21,9 +23,41 @@ using namespace std;
 using namespace solid;
 
 typedef frame::IndexT							IndexT;
-typedef frame::Scheduler<frame::aio::Selector>	AioSchedulerT;
 typedef frame::Scheduler<frame::ObjectSelector>	SchedulerT;
 
+//! Schedules on a frame::Scheduler or on a frame::StealingScheduler
+class AioSchedulerT{
+public:
+	typedef frame::Scheduler<frame::aio::Selector>			SharedSchedulerT;
+	typedef frame::StealingScheduler<frame::aio::Selector>	StealingSchedulerT;
+	typedef frame::aio::Selector::JobT						JobT;
+	
+	//! The scheduler is created stopped, so it can be configured before start
+	AioSchedulerT(frame::Manager &_rm, const bool _stealing, const uint16 _maxwkrcnt, const IndexT _selcap){
+		if(_stealing){
+			pstealsch.reset(new StealingSchedulerT(_rm, -1, _maxwkrcnt, _selcap));
+		}else{
+			pshrsch.reset(new SharedSchedulerT(_rm, -1, _maxwkrcnt, _selcap));
+		}
+	}
+	frame::SchedulerBase& scheduler(){
+		if(pstealsch.get()){
+			return *pstealsch;
+		}
+		return *pshrsch;
+	}
+	void schedule(const JobT &_rjb){
+		if(pstealsch.get()){
+			pstealsch->schedule(_rjb);
+		}else{
+			pshrsch->schedule(_rjb);
+		}
+	}
+private:
+	std::auto_ptr<SharedSchedulerT>		pshrsch;
+	std::auto_ptr<StealingSchedulerT>	pstealsch;
+};
+
 //------------------------------------------------------------------
 //------------------------------------------------------------------
 
@@ -36,6 +70,14 @@ struct Params{
 	bool		dbg_console;
 	bool		dbg_buffered;
 	bool		log;
+	bool		stealing;
+	uint16		maxwkrcnt;
+	uint32		selcap;
+	string		affinity;
+	ulong		idlemsec;
+	ulong		budgetcnt;
+	ulong		budgetusec;
+	uint32		zcthreshold;
 };
 
 namespace{
@@ -85,13 +127,9 @@ private:
 	/*virtual*/ void execute(ExecuteContext &_rexectx);
 	
 private:
-	enum {BUFSZ = 1024};
 	enum {INIT,READ, READ_TOUT, WRITE, WRITE_TOUT, CONNECT, CONNECT_TOUT};
 	int							state;
-	char						bbeg[BUFSZ];
-	const char					*bend;
-	char						*brpos;
-	const char					*bwpos;
+	frame::aio::RecvBuffer		rcvbuf;
 	ResolveData					rd;
 	ResolveIterator				it;
 	bool						b;
@@ -167,7 +205,26 @@ int main(int argc, char *argv[]){
 	
 	{
 		frame::Manager	m;
-		AioSchedulerT	aiosched(m);
+		AioSchedulerT	aiosched(m, p.stealing, p.maxwkrcnt, p.selcap);
+		
+		if(p.affinity == "spread"){
+			aiosched.scheduler().affinity(frame::SchedulerBase::AffinitySpread);
+		}else if(p.affinity == "numa"){
+			//the selectors take the NUMA nodes in turn
+			Thread::ProcessorVectorT	nodevec;
+			for(unsigned i = 0; i < Thread::numaNodeCount(); ++i){
+				nodevec.push_back(i);
+			}
+			aiosched.scheduler().affinity(frame::SchedulerBase::AffinityNumaNodes, nodevec);
+		}else if(p.affinity != "none"){
+			cout<<"unknown affinity: "<<p.affinity<<endl;
+			return 0;
+		}
+		aiosched.scheduler().workerIdleTimeout(p.idlemsec);
+		//the listener is interactive, only the echo connections are limited
+		aiosched.scheduler().executionBudget(frame::PriorityNormal, p.budgetcnt, p.budgetusec);
+		aiosched.scheduler().zeroCopyThreshold(p.zcthreshold);
+		aiosched.scheduler().start();
 		
 		insertListener(m, aiosched, "0.0.0.0", p.start_port + 111, false);
 		insertTalker(m, aiosched, "0.0.0.0", p.start_port + 112);
@@ -265,6 +322,14 @@ bool parseArguments(Params &_par, int argc, char *argv[]){
 			("debug-console,C", value<bool>(&_par.dbg_console)->implicit_value(true)->default_value(false), "Debug console")
 			("debug-unbuffered,S", value<bool>(&_par.dbg_buffered)->implicit_value(false)->default_value(true), "Debug unbuffered")
 			("use-log,l", value<bool>(&_par.log)->implicit_value(true)->default_value(false), "Debug buffered")
+			("stealing,s", value<bool>(&_par.stealing)->implicit_value(true)->default_value(false), "Use the work-stealing scheduler")
+			("threads,t", value<uint16>(&_par.maxwkrcnt)->default_value(2), "The maximum number of selector threads")
+			("affinity,a", value<string>(&_par.affinity)->default_value("none"), "Selector thread placement: none, spread or numa")
+			("capacity,c", value<uint32>(&_par.selcap)->default_value(1024 * 64), "The number of objects per selector")
+			("idle-timeout,i", value<ulong>(&_par.idlemsec)->default_value(0), "Retire the selector threads idle for this many milliseconds, 0 for never")
+			("budget", value<ulong>(&_par.budgetcnt)->default_value(0), "The connections a selector executes per loop, 0 for no limit")
+			("budget-usec", value<ulong>(&_par.budgetusec)->default_value(0), "The microseconds a selector executes connections per loop, 0 for no limit")
+			("zero-copy,z", value<uint32>(&_par.zcthreshold)->default_value(0), "Echo the chunks of at least this many bytes with MSG_ZEROCOPY, 0 for never")
 	/*		("verbose,v", po::value<int>()->implicit_value(1),
 					"enable verbosity (optionally specify level)")*/
 	/*		("listen,l", po::value<int>(&portnum)->implicit_value(1001)
@@ -296,6 +361,8 @@ Listener::Listener(
 	frame::aio::openssl::Context *_pctx
 ):BaseT(_rsd, true), pctx(_pctx), rm(_rm), rsched(_rsched){
 	state = 0;
+	//accept new clients ahead of the busy connections
+	priority(frame::PriorityInteractive);
 }
 
 Listener::~Listener(){
@@ -346,7 +413,7 @@ Listener::~Listener(){
 static const char	*hellostr = "Welcome to echo service!!!\r\n"; 
 
 Connection::Connection(const char *_node, const char *_srv): 
-	BaseT(), bend(bbeg + BUFSZ), brpos(bbeg), bwpos(bbeg), b(false)
+	BaseT(), b(false)
 {
 	cassert(_node && _srv);
 	rd = synchronous_resolve(_node, _srv);
@@ -355,7 +422,7 @@ Connection::Connection(const char *_node, const char *_srv):
 	
 }
 Connection::Connection(const SocketDevice &_rsd):
-	BaseT(_rsd), bend(bbeg + BUFSZ), brpos(bbeg), bwpos(bbeg), b(false)
+	BaseT(_rsd), b(false)
 {
 	state = INIT;
 }
@@ -403,7 +470,7 @@ Connection::~Connection(){
 	do{
 		switch(state){
 			case READ:
-				switch(socketRecv(bbeg, BUFSZ)){
+				switch(socketRecv(rcvbuf)){
 					case frame::aio::AsyncError:
 						_rexectx.close();
 						return;
@@ -416,7 +483,7 @@ Connection::~Connection(){
 			case READ_TOUT:
 				state = WRITE;
 			case WRITE:
-				switch(socketSend(bbeg, socketRecvSize())){
+				switch(socketSend(rcvbuf.data(), socketRecvSize())){
 					case frame::aio::AsyncError:
 						_rexectx.close();
 						return;
@@ -121,6 +121,7 @@ private:
 		WaitRead,
 		WaitWrite,
 		RunRead,
+		RunReadDone,
 		RunWrite,
 		CloseFileError,
 	};
@@ -136,6 +137,7 @@ private:
 	char						cmd;
 	std::string					path;
 	IOFileStreamT				iofs;
+	frame::file::FilePointerT	filptr;
 	const char 					*crtpat;
 	DynamicPointerVectorT		dv;
 };
@@ -583,22 +585,18 @@ struct OpenCbk{
 			idbg("keep waiting");
 			break;
 		case RunRead:
+			//the file goes to the socket without being copied into bbeg
+			rv = socketSendFile(filptr, 0, filptr->size());
+			if(rv == frame::aio::AsyncWait){
+				state = RunReadDone;
+				break;
+			}
+		case RunReadDone:
 			if(socketHasPendingSend()){
 				return;
 			}
-			if(!iofs.eof()){
-				iofs.read(bbeg, BUFSZ);
-				rv = socketSend(bbeg, iofs.gcount());
-				if(rv == frame::aio::AsyncSuccess){
-					_rexectx.reschedule();
-				}else if(rv == frame::aio::AsyncWait){
-				}else{
-					_rexectx.close();
-				}
-			}else{
-				iofs.close();
-				_rexectx.close();
-			}
+			filptr.clear();
+			_rexectx.close();
 			break;
 		case RunWrite:{
 			if(socketHasPendingRecv()){
@@ -654,10 +652,11 @@ void Connection::dynamicHandle(solid::DynamicPointer<> &_dp){
 void Connection::dynamicHandle(solid::DynamicPointer<FilePointerMessage> &_rmsgptr){
 	idbg("");
 	if(!_rmsgptr->ptr.empty()){
-		iofs.device(_rmsgptr->ptr);
 		if(state == WaitRead){
+			filptr = _rmsgptr->ptr;
 			state = RunRead;
 		}else if(state == WaitWrite){
+			iofs.device(_rmsgptr->ptr);
 			state = RunWrite;
 		}
 	}else{
@@ -1,5 +1,6 @@
 #include "frame/manager.hpp"
 #include "frame/scheduler.hpp"
+#include "frame/resolver.hpp"
 
 #include "frame/aio/aioselector.hpp"
 #include "frame/aio/aioobject.hpp"
@@ -48,7 +49,57 @@ struct Params{
 	StringVectorT			relaystringvec;
 	string					acceptaddrstring;
     
-	bool prepare(frame::ipc::Configuration &_rcfg, string &_err);
+	bool prepare(
+		frame::ipc::Configuration &_rcfg,
+		frame::Manager &_rm,
+		frame::Resolver &_rr,
+		string &_err
+	);
+};
+
+//! Collects the ResolveMessages for the configuration addresses
+/*!
+	It is not scheduled - the messages are grabbed directly from notify.
+*/
+struct ResolveWaiter: frame::Object{
+	typedef DynamicPointer<frame::ResolveMessage>	ResolveMessagePointerT;
+	typedef std::vector<ResolveMessagePointerT>		ResolveMessageVectorT;
+	
+	~ResolveWaiter(){
+		//unregister before the members are gone
+		unregister();
+	}
+	/*virtual*/ bool notify(DynamicPointer<frame::Message> &_rmsgptr){
+		if(_rmsgptr->isTypeDynamic(frame::ResolveMessage::staticTypeId())){
+			Locker<Mutex>	lock(mtx);
+			msgvec.push_back(ResolveMessagePointerT(_rmsgptr));
+			cnd.signal();
+		}
+		return false;
+	}
+	//! Wait for _cnt messages
+	void wait(const size_t _cnt){
+		Locker<Mutex>	lock(mtx);
+		while(msgvec.size() < _cnt){
+			cnd.wait(lock);
+		}
+	}
+	//! Grab the first result for _node and _service
+	ResolveData grab(const char *_node, const char *_service){
+		Locker<Mutex>	lock(mtx);
+		for(ResolveMessageVectorT::iterator it(msgvec.begin()); it != msgvec.end(); ++it){
+			if((*it)->node == _node && (*it)->service == _service){
+				ResolveData	rd((*it)->data);
+				msgvec.erase(it);
+				return rd;
+			}
+		}
+		return ResolveData();
+	}
+private:
+	Mutex					mtx;
+	Condition				cnd;
+	ResolveMessageVectorT	msgvec;
 };
 
 namespace{
@@ -118,6 +169,8 @@ int main(int argc, char *argv[]){
 		
 		AioSchedulerT			aiosched(m);
 		
+		frame::Resolver			resolver(m);
+		
 		frame::ipc::Service		ipcsvc(m, new frame::ipc::BasicController(aiosched));
 		
 		m.registerService(ipcsvc);
@@ -128,8 +181,9 @@ int main(int argc, char *argv[]){
 			int							err;
 			{
 				string errstr;
-				if(!p.prepare(cfg, errstr)){
+				if(!p.prepare(cfg, m, resolver, errstr)){
 					cout<<"Error preparing ipc configuration: "<<errstr<<endl;
+					resolver.stop();
 					Thread::waitAll();
 					return 0;
 				}
@@ -140,6 +194,7 @@ int main(int argc, char *argv[]){
 				//TODO:
 				//cout<<"Error starting ipcservice: "<<err.toString()<<endl;
 				cout<<"Error starting ipcservice"<<endl;
+				resolver.stop();
 				Thread::waitAll();
 				return 0;
 			}
@@ -150,6 +205,7 @@ int main(int argc, char *argv[]){
 				cnd.wait(lock);
 			}
 		}
+		resolver.stop();
 		m.stop();
 	}
 	Thread::waitAll();
@@ -189,10 +245,23 @@ bool parseArguments(Params &_par, int argc, char *argv[]){
 	}
 }
 //------------------------------------------------------
-bool Params::prepare(frame::ipc::Configuration &_rcfg, string &_err){
-	const uint16	default_port = 4000;
-	size_t 			posa;
-	size_t 			posb;
+bool Params::prepare(
+	frame::ipc::Configuration &_rcfg,
+	frame::Manager &_rm,
+	frame::Resolver &_rr,
+	string &_err
+){
+	const uint16		default_port = 4000;
+	size_t 				posa;
+	size_t 				posb;
+	std::vector<int>	relaynetidvec;
+	StringVectorT		relayaddrvec;
+	StringVectorT		relayportvec;
+	ResolveWaiter		waiter;
+	
+	const frame::ObjectUidT	waiteruid = _rm.registerObject(waiter);
+	
+	//first parse all the addresses, then resolve them all at once
 	for(std::vector<std::string>::iterator it(relaystringvec.begin()); it != relaystringvec.end(); ++it){
 		posa = it->find(':');
 		posb = it->rfind(':');
@@ -202,37 +271,47 @@ bool Params::prepare(frame::ipc::Configuration &_rcfg, string &_err){
 			return false;
 		}
 		
-		(*it)[posa] = '\0';
-		int netid = atoi(it->c_str());
-		int port  = -1;
+		relaynetidvec.push_back(atoi(it->c_str()));
 		
 		if(posb == posa){
-			port = default_port;
+			char	buf[16];
+			sprintf(buf, "%u", (uint)default_port);
+			relayaddrvec.push_back(it->substr(posa + 1));
+			relayportvec.push_back(buf);
 		}else{
-			(*it)[posb] = '\0';
-			port = atoi(it->c_str() + posb + 1);
+			relayaddrvec.push_back(it->substr(posa + 1, posb - posa - 1));
+			relayportvec.push_back(it->substr(posb + 1));
 		}
-		
-		const char *addr = it->c_str() + posa + 1;
-		
-		ResolveData	rd = synchronous_resolve(addr, port, 0, SocketInfo::Inet4, SocketInfo::Stream);
+	}
+	posb = acceptaddrstring.rfind(':');
+	string	acceptaddr(acceptaddrstring);
+	string	acceptport("4000");
+	if(posb != string::npos){
+		acceptaddr.resize(posb);
+		acceptport = acceptaddrstring.substr(posb + 1);
+	}
+	
+	for(size_t i = 0; i < relayaddrvec.size(); ++i){
+		_rr.resolve(waiteruid, relayaddrvec[i].c_str(), relayportvec[i].c_str(), 0, SocketInfo::Inet4, SocketInfo::Stream);
+	}
+	_rr.resolve(waiteruid, acceptaddr.c_str(), acceptport.c_str(), 0, SocketInfo::Inet4, SocketInfo::Stream);
+	
+	waiter.wait(relayaddrvec.size() + 1);
+	
+	for(size_t i = 0; i < relayaddrvec.size(); ++i){
+		ResolveData	rd = waiter.grab(relayaddrvec[i].c_str(), relayportvec[i].c_str());
 		
 		if(!rd.empty()){
 			_rcfg.relayaddrvec.push_back(frame::ipc::Configuration::RelayAddress());
-			_rcfg.relayaddrvec.back().networkid = netid;
+			_rcfg.relayaddrvec.back().networkid = relaynetidvec[i];
 			_rcfg.relayaddrvec.back().address = rd.begin();
-			idbg("added relay address "<<*it);
+			idbg("added relay address "<<relaystringvec[i]);
 		}else{
-			idbg("skiped relay address "<<*it);
+			idbg("skiped relay address "<<relaystringvec[i]);
 		}
 	}
-	posb = acceptaddrstring.rfind(':');
-	int port = 4000;
-	if(posb != string::npos){
-		acceptaddrstring[posb] = '\0';
-		port = atoi(acceptaddrstring.c_str() + posb + 1);
-	}
-	ResolveData	rd = synchronous_resolve(acceptaddrstring.c_str(), port, 0, SocketInfo::Inet4, SocketInfo::Stream);
+	
+	ResolveData	rd = waiter.grab(acceptaddr.c_str(), acceptport.c_str());
 	if(!rd.empty()){
 		_rcfg.acceptaddr = rd.begin();
 	}
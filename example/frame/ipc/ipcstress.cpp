@@ -268,17 +268,32 @@ int main(int argc, char *argv[]){
 				cnd.wait(lock);
 			}
 		}
+		TimeSpec	endtime(TimeSpec::createRealTime());
+		endtime -= begintime;
+		uint64		duration = endtime.seconds() * 1000;
+		
+		duration += endtime.nanoSeconds() / 1000000;
+		if(duration == 0) duration = 1;
+		
 		if(srvvec.size()){
-			TimeSpec	endtime(TimeSpec::createRealTime());
-			endtime -= begintime;
-			uint64		duration = endtime.seconds() * 1000;
-			
-			duration += endtime.nanoSeconds() / 1000000;
-			
 			uint64		speed = (srvvec.front().sz * 125) / (128 * duration);
 			
+			cout<<"Duration = "<<duration<<" msec"<<endl;
 			cout<<"Speed = "<<speed<<" KB/s"<<endl;
 		}
+		{
+			const frame::ipc::TalkerStatistics	ts(ipcsvc.talkerStatistics());
+			const uint64						pktcnt(ts.rcvpktcnt + ts.sndpktcnt);
+			const uint64						callcnt(ts.rcvcallcnt + ts.sndcallcnt);
+			
+			cout<<"Packets received = "<<ts.rcvpktcnt<<" sent = "<<ts.sndpktcnt<<endl;
+			cout<<"Packets/s = "<<(pktcnt * 1000) / duration<<endl;
+			if(pktcnt){
+				cout<<"Syscalls/packet = "<<(double)callcnt / pktcnt;
+				cout<<" (receive "<<(ts.rcvpktcnt ? (double)ts.rcvcallcnt / ts.rcvpktcnt : 0.);
+				cout<<" send "<<(ts.sndpktcnt ? (double)ts.sndcallcnt / ts.sndpktcnt : 0.)<<')'<<endl;
+			}
+		}
 		m.stop();
 		vdbg("done stop");
 	}
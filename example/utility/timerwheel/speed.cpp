@@ -0,0 +1,124 @@
+// speed.cpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include "system/timespec.hpp"
+#include "utility/timerwheel.hpp"
+using namespace std;
+using namespace solid;
+
+///\cond 0
+/*
+	Simulates the timeout handling of an aio::Selector loop, one millisecond
+	per iteration: every iteration some timers are rearmed (socket activity)
+	and the due ones are fired and rearmed.
+	Compares the former full scan (scan all stubs when the nearest timeout
+	is reached) with the TimerWheel.
+*/
+enum{
+	MinTimeout = 1000,
+	MaxTimeout = 60 * 1000,
+};
+
+static uint64 timeout(){
+	return MinTimeout + (rand() % (MaxTimeout - MinTimeout));
+}
+
+typedef std::vector<uint64>	Uint64VectorT;
+
+struct FullScan{
+	FullScan(const size_t _cnt):tv(_cnt), ntick(0){
+		for(size_t i = 0; i < _cnt; ++i){
+			tv[i] = timeout();
+		}
+	}
+	void rearm(const size_t _idx, const uint64 _crttick){
+		tv[_idx] = _crttick + timeout();
+		if(tv[_idx] < ntick) ntick = tv[_idx];
+	}
+	size_t advance(const uint64 _crttick){
+		size_t cnt(0);
+		if(_crttick < ntick) return cnt;
+		ntick = (uint64)-1;
+		for(Uint64VectorT::iterator it(tv.begin()); it != tv.end(); ++it){
+			if(_crttick >= *it){
+				*it = _crttick + timeout();
+				++cnt;
+			}
+			if(*it < ntick) ntick = *it;
+		}
+		return cnt;
+	}
+	Uint64VectorT	tv;
+	uint64			ntick;
+};
+
+struct Wheel{
+	struct Handler{
+		Handler(Wheel &_rw):rw(_rw){}
+		void operator()(const size_t _idx){
+			rw.tw.schedule(_idx, rw.tw.currentTick() + timeout());
+		}
+		Wheel &rw;
+	};
+	Wheel(const size_t _cnt){
+		tw.reserve(_cnt);
+		for(size_t i = 0; i < _cnt; ++i){
+			tw.schedule(i, timeout());
+		}
+	}
+	void rearm(const size_t _idx, const uint64 _crttick){
+		tw.schedule(_idx, _crttick + timeout());
+	}
+	size_t advance(const uint64 _crttick){
+		Handler h(*this);
+		if(_crttick < tw.nextTick()) return 0;
+		return tw.advance(_crttick, h);
+	}
+	TimerWheel	tw;
+};
+
+template <class T>
+void test(const char *_name, const size_t _cnt, const size_t _itcnt, const size_t _actcnt){
+	srand(1);
+	T			t(_cnt);
+	size_t		firecnt(0);
+	TimeSpec	start(TimeSpec::createMonotonic());
+
+	for(size_t i = 1; i <= _itcnt; ++i){
+		for(size_t j = 0; j < _actcnt; ++j){
+			t.rearm(rand() % _cnt, i);
+		}
+		firecnt += t.advance(i);
+	}
+
+	TimeSpec	end(TimeSpec::createMonotonic());
+	end -= start;
+	const uint64 ns(end.seconds() * 1000000000ULL + end.nanoSeconds());
+	cout<<_name<<" timers = "<<_cnt<<" iterations = "<<_itcnt<<" fired = "<<firecnt;
+	cout<<" ns/iteration = "<<(ns / _itcnt)<<endl;
+}
+///\endcond
+
+int main(int argc, char *argv[]){
+	size_t		itcnt(2000);
+	size_t		actcnt(100);
+	if(argc > 1) itcnt = atoi(argv[1]);
+	if(argc > 2) actcnt = atoi(argv[2]);
+
+	const size_t cnts[] = {10 * 1000, 100 * 1000, 1000 * 1000};
+
+	for(size_t i = 0; i < sizeof(cnts)/sizeof(size_t); ++i){
+		test<FullScan>("fullscan", cnts[i], itcnt, actcnt);
+		test<Wheel>("timerwheel", cnts[i], itcnt, actcnt);
+	}
+	return 0;
+}
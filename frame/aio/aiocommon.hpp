@@ -11,8 +11,12 @@
 #define SOLID_FRAME_AIO_COMMON_HPP
 
 #include "frame/common.hpp"
+#include <vector>
 
 namespace solid{
+
+class SocketDevice;
+
 namespace frame{
 namespace aio{
 
@@ -22,6 +26,21 @@ enum AsyncE{
 	AsyncWait = solid::AsyncWait,
 };
 
+//! A buffer of a scatter/gather io list - see SingleObject::socketSendv
+/*!
+	Modeled after struct iovec, but the list and the buffers must stay
+	valid until the asynchronous opperation completes.
+*/
+struct IoBuffer{
+	IoBuffer(char *_pb = NULL, const uint32 _bl = 0):pb(_pb), bl(_bl){}
+	IoBuffer(const char *_pb, const uint32 _bl):pb(const_cast<char*>(_pb)), bl(_bl){}
+	char	*pb;
+	uint32	bl;
+};
+
+//! The connections accepted at once - see SingleObject::socketAccept
+typedef std::vector<SocketDevice>	SocketDeviceVectorT;
+
 }//namespace aio
 }//namespace frame
 }//namespace solid
@@ -0,0 +1,91 @@
+// frame/aio/aiohandshakepool.hpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#ifndef SOLID_FRAME_AIO_HANDSHAKE_POOL_HPP
+#define SOLID_FRAME_AIO_HANDSHAKE_POOL_HPP
+
+#include "frame/aio/aiocommon.hpp"
+#include "frame/common.hpp"
+#include "system/socketdevice.hpp"
+#include "system/atomic.hpp"
+
+namespace solid{
+namespace frame{
+
+class Manager;
+
+namespace aio{
+
+class Socket;
+class SecureSocket;
+
+//! A pool of threads doing the secure hand-shakes of the aio sockets
+/*!
+	A hand-shake step (mostly the key exchange and the signing) costs
+	far more than the io of a connection. Done on the selector thread,
+	a burst of hand-shakes stalls the io of all the other objects of
+	the selector.
+
+	<b>Usage:</b><br>
+	- Create the pool, before the schedulers.<br>
+	- Give it to the schedulers with SchedulerBase::handshakePool.<br>
+	- Use socketSecureAccept/socketSecureConnect as usual: the steps
+	run on the pool, the io readiness between them is still waited for
+	by the selector, and the object is executed with EventDoneSend
+	(or EventDoneError) when the hand-shake completes.<br>
+
+	The pool wakes the object with S_RAISE when a step completes, but
+	the object is executed only for the last one, along with EventDoneSend.
+	The pool must outlive the schedulers using it.
+*/
+class HandshakePool{
+public:
+	//! Constructor
+	/*!
+		\param _wkrcnt The maximum number of threads - created on demand;
+		zero for the number of processors.
+	*/
+	HandshakePool(Manager &_rm, const size_t _wkrcnt = 0);
+	~HandshakePool();
+	//! Wait for the queued steps then stop the threads
+	void stop();
+private:
+	friend class Socket;
+	//! The hand-shake of a socket, shared by the socket and the pool
+	struct Job{
+		Job(SecureSocket *_pss, const ObjectUidT &_ruid, const bool _connect);
+		~Job();
+
+		SecureSocket				*pss;
+		SocketDevice				sd;//only for orphans - keeps the descriptor open till the step ends
+		ObjectUidT					uid;//the object to notify
+		bool						connect;
+		bool						orphan;//the socket was destroyed - the job owns pss and sd
+		AsyncE						rv;//the result of the last step
+		uint						want;//the events wanted by the last step
+		ATOMIC_NS::atomic<bool>		done;//a step completed and was not yet consumed by the socket
+		ATOMIC_NS::atomic<size_t>	usecnt;
+	};
+	struct Data;
+
+	void push(Job &_rjob);
+	static void release(Job &_rjob);
+	void execute(Job &_rjob);
+private:
+	HandshakePool(const HandshakePool&);
+	HandshakePool& operator=(const HandshakePool&);
+private:
+	Data	&d;
+};
+
+}//namespace aio
+}//namespace frame
+}//namespace solid
+
+#endif
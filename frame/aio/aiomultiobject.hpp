@@ -14,6 +14,7 @@
 #include "frame/aio/aiocommon.hpp"
 #include "frame/aio/aioobject.hpp"
 #include "frame/aio/aiosocketpointer.hpp"
+#include "frame/file/filestore.hpp"
 #include "utility/stack.hpp"
 #include "system/error.hpp"
 
@@ -23,11 +24,14 @@ class SocketDevice;
 class SocketAddress;
 class SocketAddressStub;
 class ResolveIterator;
+struct RecvDatagram;
+struct SendDatagram;
 
 namespace frame{
 namespace aio{
 
 class SecureSocket;
+class RecvBuffer;
 
 //! A class for multi socket asynchronous communication
 /*!
@@ -62,6 +66,12 @@ public:
 	//! Asynchronous accept an incomming connection
 	AsyncE socketAccept(const size_t _pos, SocketDevice &_rsd);
 	
+	//! Asynchronous accept of up to _cnt incomming connections at once
+	/*!
+		See SingleObject::socketAccept.
+	*/
+	AsyncE socketAccept(const size_t _pos, SocketDeviceVectorT &_rsdvec, const size_t _cnt);
+	
 	//! Asynchronous connect
 	/*!
 		\param _pos The socket identifier
@@ -75,8 +85,39 @@ public:
 	AsyncE socketSendTo(const size_t _pos, const char* _pb, uint32 _bl, const SocketAddressStub &_sap, uint32 _flags = 0);
 	//! Asynchronous receive for socket on position _pos
 	AsyncE socketRecv(const size_t _pos, char *_pb, uint32 _bl, uint32 _flags = 0);
+	//! Asynchronous gather send of a list of buffers for socket on position _pos
+	/*!
+		EventDoneSend comes only after all the buffers were sent.
+		The list and the buffers must stay valid until then.
+	*/
+	AsyncE socketSendv(const size_t _pos, const IoBuffer *_pbufs, const size_t _bufcnt, uint32 _flags = 0);
+	//! Asynchronous scatter receive for socket on position _pos
+	/*!
+		Completes as soon as some data was received, see socketRecvSize.
+	*/
+	AsyncE socketRecvv(const size_t _pos, IoBuffer *_pbufs, const size_t _bufcnt, uint32 _flags = 0);
+	//! Asynchronous receive of all the available data into an adaptive buffer
+	/*!
+		The received data is in _rrb.data(), of size socketRecvSize().
+		The buffer must stay valid until EventDoneRecv, see RecvBuffer.
+	*/
+	AsyncE socketRecv(const size_t _pos, RecvBuffer &_rrb, uint32 _flags = 0);
+	//! Asynchronous send of a range of a file for socket on position _pos
+	/*!
+		On plain sockets the data goes from the file to the socket
+		without being copied in user space. EventDoneSend comes only
+		after the whole range was sent; the file must stay valid until then.
+	*/
+	AsyncE socketSendFile(const size_t _pos, file::FilePointerT &_rfileptr, const int64 _off, const uint64 _len);
 	//! Asynchronous receive for socket on position _pos
 	AsyncE socketRecvFrom(const size_t _pos, char *_pb, uint32 _bl, uint32 _flags = 0);
+	//! Asynchronous receive of up to _cnt datagrams for socket on position _pos
+	/*!
+		socketRecvSize is the number of datagrams received.
+	*/
+	AsyncE socketRecvFrom(const size_t _pos, RecvDatagram *_pdgs, const size_t _cnt, uint32 _flags = 0);
+	//! Asynchronous send of a list of datagrams for socket on position _pos
+	AsyncE socketSendTo(const size_t _pos, const SendDatagram *_pdgs, const size_t _cnt, uint32 _flags = 0);
 	
 	//! Get the size of the received data for socket on position _pos
 	/*!
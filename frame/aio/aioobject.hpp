@@ -12,6 +12,7 @@
 
 #include "system/timespec.hpp"
 #include "frame/object.hpp"
+#include "frame/message.hpp"
 
 namespace solid{
 namespace frame{
@@ -20,6 +21,22 @@ namespace aio{
 class Socket;
 class SocketPointer;
 class Selector;
+
+//! Notifies a producer that an object crossed one of its send watermarks
+/*!
+	See aio::Object::sendBacklogPush. With high == true the producer
+	should stop producing data for the object (e.g. stop reading its
+	own socket) until it gets the message with high == false.
+*/
+struct SendWatermarkMessage: Dynamic<SendWatermarkMessage, frame::Message>{
+	SendWatermarkMessage(
+		const ObjectUidT &_ruid,
+		const bool _high
+	):uid(_ruid), high(_high){}
+	ObjectUidT	uid;//the object with the send backlog
+	bool		high;
+};
+
 //! aio::Object is the base class for all classes doing asynchronous socket io
 /*!
 	Although it can be inherited directly, one should use the extended
@@ -33,6 +50,8 @@ class Selector;
 class Object: public Dynamic<Object, frame::Object>{
 public:
 	virtual ~Object();
+	//! The execution priority class - see frame::PriorityE
+	PriorityE priority()const{return static_cast<PriorityE>(prio);}
 protected:
 	//! Returns true if there are pending io requests
 	/*!
@@ -111,16 +130,56 @@ protected:
 		reqbeg(_reqbeg), reqpos(_reqbeg),
 		resbeg(_resbeg), respos(0), ressize(0),
 		itoutbeg(_itoutbeg), itoutpos(_itoutbeg),
-		otoutbeg(_otoutbeg), otoutpos(_otoutbeg){
+		otoutbeg(_otoutbeg), otoutpos(_otoutbeg), hscnt(0), psndbl(NULL), prio(PriorityNormal){
 	}
 	
+	//! Set the execution priority class
+	/*!
+		Should be called before the object is scheduled; afterwards it
+		only takes effect the next time the object is queued for execution.
+		The selector budgets the execution of every class, see
+		SchedulerBase::executionBudget.
+	*/
+	void priority(const PriorityE _prio){prio = _prio;}
+	
 	void socketPushRequest(const size_t _pos, const uint8 _req);
 	void socketPostEvents(const size_t _pos, const uint32 _evs);
+	//! The uid given to the sockets for the hand-shakes on a HandshakePool
+	ObjectUidT socketHandshakeUid()const;
+	
+	//! Set the send watermarks, in bytes - see sendBacklogPush
+	void sendWatermarks(const size_t _low, const size_t _high);
+	//! Account data queued by the object for sending
+	/*!
+		Meant for the data waiting beyond the pending socket send, e.g. the
+		messages queued from other objects. Once the backlog goes above
+		the high watermark, every producer pushing data is notified (once)
+		with SendWatermarkMessage(high = true). When the backlog drops to
+		the low watermark, or the object stops, the notified producers
+		get SendWatermarkMessage(high = false).
+		Must be called from execute, without holding the object's mutex.
+		\param _rproduceruid The object producing the data, if any
+		\retval false the backlog is above the high watermark
+	*/
+	bool sendBacklogPush(const size_t _sz, const ObjectUidT &_rproduceruid = invalid_uid());
+	//! Account data from the backlog that was sent
+	void sendBacklogPop(const size_t _sz);
+	//! The amount of data queued for sending
+	size_t sendBacklog()const;
+	//! True while the backlog is above the high watermark
+	bool isSendBacklogHigh()const;
 private:
+	struct SendBacklog;
+	void doNotifyProducers();
 	void doPrepare(TimeSpec *_pitimepos, TimeSpec *_potimepos);
 	void doUnprepare();
 	/*virtual*/void doStop();
 	void doClearRequests();
+	ulong doHandshakeEvents();
+	//! A raise must execute the object: notified, or waiting for the HandshakePool
+	bool isRaised()const{
+		return hscnt != 0 || notified(S_RAISE);
+	}
 	
 	size_t doOnTimeoutRecv(const TimeSpec &_timepos);
 	size_t doOnTimeoutSend(const TimeSpec &_timepos);
@@ -148,6 +207,9 @@ protected:
 	size_t				*itoutpos;
 	size_t				*otoutbeg;
 	size_t				*otoutpos;
+	size_t				hscnt;//the sockets with the hand-shake on a HandshakePool
+	SendBacklog			*psndbl;//the send backlog accounting, NULL till used
+	uint8				prio;
 };
 
 }//namespace aio
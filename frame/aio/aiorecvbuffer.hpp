@@ -0,0 +1,97 @@
+// frame/aio/aiorecvbuffer.hpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#ifndef SOLID_FRAME_AIO_RECV_BUFFER_HPP
+#define SOLID_FRAME_AIO_RECV_BUFFER_HPP
+
+#include "system/common.hpp"
+
+namespace solid{
+
+class SocketDevice;
+
+namespace frame{
+namespace aio{
+
+class Socket;
+
+//! An adaptive receive buffer for the aio stream sockets
+/*!
+	Used with socketRecv(RecvBuffer&) instead of a fixed buffer chosen
+	by the object:
+	- A receive reads until the socket is drained (a short read), or
+	the buffer is full at the maximum capacity, growing the buffer
+	while the reads fill it. So a single call usually gets all the data
+	pending on the socket.<br>
+	- After ShrinkCount consecutive receives using at most a quarter
+	of the buffer, the capacity is halved, down to the minimum.<br>
+	- While the receive waits for data, the buffer holds no memory:
+	it is taken from the thread's cache (see Specific::popBuffer) only
+	when there is something to read.<br>
+
+	The capacities are powers of 2, limited by the largest buffer
+	of the Specific cache. The received data (data(), size()) stays valid
+	till the next receive, or clear. The buffer must stay valid while
+	a receive is pending.
+*/
+class RecvBuffer{
+public:
+	enum{
+		ShrinkCount = 8,
+	};
+	//! Constructor
+	/*!
+		\param _mincp The minimum (and initial) capacity
+		\param _maxcp The maximum capacity
+		\param _syncrcvbuf Keep the socket's SO_RCVBUF at twice the
+		capacity - note that setting SO_RCVBUF disables the kernel's
+		own tuning of the receive window.
+	*/
+	RecvBuffer(
+		const uint32 _mincp = 512,
+		const uint32 _maxcp = 32 * 1024,
+		const bool _syncrcvbuf = false
+	);
+	~RecvBuffer();
+	//! The data received by the last completed receive
+	char* data(){return pb;}
+	const char* data()const{return pb;}
+	//! The size of the data received by the last completed receive
+	uint32 size()const{return sz;}
+	//! The capacity the next receive starts with
+	uint32 capacity()const;
+	//! Give back the memory - the received data is lost
+	void clear();
+private:
+	friend class Socket;
+
+	char* doPrepare();
+	bool doGrow(const uint32 _sz);
+	void doDone(const uint32 _sz, SocketDevice &_rsd);
+	uint32 doCapacity()const;
+private:
+	RecvBuffer(const RecvBuffer&);
+	RecvBuffer& operator=(const RecvBuffer&);
+private:
+	char	*pb;
+	uint32	sz;
+	uint16	bufid;//the Specific index of pb
+	uint16	capid;//the Specific index of the capacity for the next receive
+	uint16	minid;
+	uint16	maxid;
+	uint16	sockid;//the index SO_RCVBUF was last set for
+	uint16	smallcnt;//consecutive small receives
+	bool	syncrcvbuf;
+};
+
+}//namespace aio
+}//namespace frame
+}//namespace solid
+
+#endif
@@ -92,6 +92,14 @@ public:
 		(for nonblocking sockets check wantEvents), >0 success.
 	*/
 	virtual AsyncE secureConnect() = 0;
+	//! Return true if the kernel encrypts the sent data (kernel TLS)
+	/*!
+		Asked after the secure hand-shake completes. If true, aio::Socket
+		sends the data directly on the socket descriptor, using the plain
+		send, sendv and sendfile paths, while receiving still goes through
+		recv.
+	*/
+	virtual bool kernelSend()const = 0;
 };
 
 }//namespace aio
@@ -43,6 +43,10 @@ public:
 	bool init(ulong _cp);
 	//signal a specific object
 	void raise(uint32 _pos);
+	//signal a specific object from the thread running the selector
+	void raiseLocal(uint32 _pos);
+	//signal many objects waking the selector once
+	void raiseMany(const uint32 *_ppos, const size_t _cnt);
 	void run();
 	ulong capacity()const;
 	ulong size() const;
@@ -50,14 +54,33 @@ public:
 	bool full()const;
 	
 	bool push(JobT &_rcon);
+	//! Push an object from the thread running the selector
+	/*!
+		E.g. from the execute of an object. The object is registered
+		by the selector loop. Returns false if there is no room for it.
+	*/
+	bool pushLocal(JobT &_rcon);
 	void prepare();
 	void unprepare();
 private:
 	struct Stub;
+	struct TimerHandler;
+	struct MigrateStub;
+	/*virtual*/ bool migrate(SelectorBase &_rs);
+	void doOpenMigration();
+	void doCloseMigration();
+	void doAdoptMigrated();
+	void doPushLocal();
+	void doAdopt(MigrateStub &_rms);
+	void doDetach(const ulong _pos, MigrateStub &_rms);
+	void doBalance();
 	ulong doReadPipe();
 	ulong doAllIo();
 	ulong doFullScan();
 	void doFullScanCheck(Stub &_rs, const ulong _pos);
+	ulong doTimeout();
+	void doTimeoutCheck(const ulong _pos);
+	void doScheduleTimer(const ulong _pos);
 	ulong doExecuteQueue();
 	ulong doAddNewStub();
 	
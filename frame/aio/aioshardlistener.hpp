@@ -0,0 +1,67 @@
+// frame/aio/aioshardlistener.hpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#ifndef SOLID_FRAME_AIO_SHARD_LISTENER_HPP
+#define SOLID_FRAME_AIO_SHARD_LISTENER_HPP
+
+#include "frame/aio/aiosingleobject.hpp"
+#include "system/socketdevice.hpp"
+
+namespace solid{
+namespace frame{
+namespace aio{
+
+//! A listener on one of the SO_REUSEPORT sockets sharing an address
+/*!
+	The kernel spreads the incoming connections across the listening
+	sockets bound on the same address with SO_REUSEPORT.
+
+	<b>Usage:</b><br>
+	- Create one socket for every selector thread with prepareAccept.<br>
+	- Give a ShardListener on every socket to the scheduler with
+	Scheduler::scheduleEach, before starting it.<br>
+	- In onAccept, schedule the connection with Scheduler::scheduleLocal,
+	so it stays on the selector thread which accepted it.<br>
+*/
+class ShardListener: public Dynamic<ShardListener, SingleObject>{
+public:
+	//! Create _cnt nonblocking sockets listening on the same address
+	/*!
+		Returns false, with _rsdvec empty, if any of them fails.
+	*/
+	static bool prepareAccept(
+		SocketDeviceVectorT &_rsdvec,
+		const SocketAddressStub &_rsas,
+		const size_t _cnt,
+		const size_t _listencnt = 1024
+	);
+
+	//! Constructor
+	/*!
+		\param _acceptcnt The accept budget: at most how many connections
+		an execute accepts, at once, before letting the other objects run
+	*/
+	ShardListener(const SocketDevice &_rsd, const size_t _acceptcnt = 64);
+	~ShardListener();
+protected:
+	//! Called for every accepted connection, from the selector thread
+	virtual void onAccept(SocketDevice &_rsd) = 0;
+private:
+	/*virtual*/ void execute(ExecuteContext &_rexectx);
+private:
+	SocketDeviceVectorT	sdvec;
+	size_t				acceptcnt;
+	int					state;
+};
+
+}//namespace aio
+}//namespace frame
+}//namespace solid
+
+#endif
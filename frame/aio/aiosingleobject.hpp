@@ -13,6 +13,7 @@
 #include "frame/aio/aiocommon.hpp"
 #include "frame/aio/aioobject.hpp"
 #include "frame/aio/aiosocketpointer.hpp"
+#include "frame/file/filestore.hpp"
 #include "system/error.hpp"
 
 namespace solid{
@@ -21,11 +22,14 @@ class SocketDevice;
 class SocketAddress;
 class SocketAddressStub;
 class ResolveIterator;
+struct RecvDatagram;
+struct SendDatagram;
 
 namespace frame{
 namespace aio{
 
 class SecureSocket;
+class RecvBuffer;
 
 //! A class for single socket asynchronous communication
 /*!
@@ -52,6 +56,16 @@ public:
 	//! Asynchronous accept an incomming connection
 	AsyncE socketAccept(SocketDevice &_rsd);
 	
+	//! Asynchronous accept of up to _cnt incomming connections at once
+	/*!
+		The connections are appended to _rsdvec, nonblocking and
+		close-on-exec (accept4). Waits only if there is no pending
+		connection. _cnt is the accept budget: set it to what one
+		execute should handle, so a connection storm does not starve
+		the other objects of the selector.
+	*/
+	AsyncE socketAccept(SocketDeviceVectorT &_rsdvec, const size_t _cnt);
+	
 	//! Asynchronous connect
 	/*!
 		\param _rai An SocketAddressInfo iterator holding the destination address.
@@ -64,8 +78,46 @@ public:
 	AsyncE socketSendTo(const char *_pb, uint32 _bl, const SocketAddressStub &_sap, uint32 _flags = 0);
 	//! Asynchronous receive
 	AsyncE socketRecv(char *_pb, uint32 _bl, uint32 _flags = 0);
+	//! Asynchronous gather send of a list of buffers
+	/*!
+		EventDoneSend comes only after all the buffers were sent.
+		The list and the buffers must stay valid until then.
+	*/
+	AsyncE socketSendv(const IoBuffer *_pbufs, const size_t _bufcnt, uint32 _flags = 0);
+	//! Asynchronous scatter receive into a list of buffers
+	/*!
+		Completes as soon as some data was received, see socketRecvSize.
+	*/
+	AsyncE socketRecvv(IoBuffer *_pbufs, const size_t _bufcnt, uint32 _flags = 0);
+	//! Asynchronous receive of all the available data into an adaptive buffer
+	/*!
+		The received data is in _rrb.data(), of size socketRecvSize().
+		The buffer must stay valid until EventDoneRecv, see RecvBuffer.
+	*/
+	AsyncE socketRecv(RecvBuffer &_rrb, uint32 _flags = 0);
+	//! Asynchronous send of a range of a file
+	/*!
+		On plain sockets the data goes from the file to the socket
+		without being copied in user space. EventDoneSend comes only
+		after the whole range was sent; the file must stay valid until then.
+	*/
+	AsyncE socketSendFile(file::FilePointerT &_rfileptr, const int64 _off, const uint64 _len);
 	//! Asynchronous receive
 	AsyncE socketRecvFrom(char *_pb, uint32 _bl, uint32 _flags = 0);
+	//! Asynchronous receive of up to _cnt datagrams at once
+	/*!
+		Uses a single system call (recvmmsg) where possible. Waits only if
+		there is no pending datagram; socketRecvSize is the number of
+		datagrams received. The list must stay valid until EventDoneRecv.
+	*/
+	AsyncE socketRecvFrom(RecvDatagram *_pdgs, const size_t _cnt, uint32 _flags = 0);
+	//! Asynchronous send of a list of datagrams at once
+	/*!
+		Uses a single system call (sendmmsg) where possible.
+		EventDoneSend comes only after all the datagrams were sent.
+		The list and the buffers must stay valid until then.
+	*/
+	AsyncE socketSendTo(const SendDatagram *_pdgs, const size_t _cnt, uint32 _flags = 0);
 	//! Get the size of the received data
 	/*!
 		Call this on successful completion of socketRecv
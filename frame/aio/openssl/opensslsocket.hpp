@@ -28,6 +28,19 @@ class Socket;
 */
 class Context{
 public:
+	//! The hand-shake statistics of a context
+	struct Statistics{
+		Statistics();
+		//! The ratio of the hand-shakes which resumed a session
+		double resumptionRatio()const;
+		
+		uint64	handshakecnt;//the completed hand-shakes
+		uint64	resumedcnt;//the ones which resumed a session - from the cache or from a ticket
+		uint64	cachehitcnt;//the sessions found in the session cache
+		uint64	cachemisscnt;//the sessions not found, or expired
+		uint64	cachesize;//the sessions currently in the session cache
+		uint64	ticketkeyrotatecnt;//the ticket keys generated
+	};
 	static Context* create();
 	~Context();
 	//! Creates a new OpenSSL SecureSocket
@@ -42,7 +55,69 @@ public:
 	bool loadCertificateFile(const char *_path);
 	//!Use it on server side to load the certificates
 	bool loadPrivateKeyFile(const char *_path);
-
+	
+	//! Enable or disable the kernel TLS offload - disabled by default
+	/*!
+		When enabled, OpenSSL moves the connections to the kernel TLS
+		(TLS_TX/TLS_RX) after the hand-shake, if the kernel supports it
+		for the negotiated cipher. Returns false if the OpenSSL library
+		was built without kernel TLS support.
+	*/
+	bool kernelTls(const bool _enable);
+	
+	//! Use a session cache shared by all the connections of the context
+	/*!
+		Replaces the OpenSSL internal cache, which is guarded by a single
+		lock, with one split in _shardcnt independently locked shards,
+		so the selector threads rarely contend on it.
+		\param _capacity The maximum number of sessions - the oldest
+		session of a full shard is evicted.
+		\param _timeout The session lifetime in seconds
+	*/
+	bool sessionCache(
+		const size_t _shardcnt = 16,
+		const size_t _capacity = 16 * 1024,
+		const uint32 _timeout = 300
+	);
+	//! Load the session ticket keys from a file
+	/*!
+		The file holds one or more keys, 80 bytes each: 16 bytes name,
+		32 bytes HMAC secret and 32 bytes AES secret. The first key
+		encrypts the new tickets, the others only decrypt old ones.
+		Sharing the file among the processes of a service lets the
+		tickets survive restarts and work on every process.
+	*/
+	bool loadTicketKeyFile(const char *_path);
+	//! Generate a new random ticket key for the new tickets
+	/*!
+		The previous keys are kept, up to MaxTicketKeyCount, so the
+		tickets they encrypted can still be resumed (and get renewed).
+	*/
+	bool rotateTicketKey();
+	//! Rotate the ticket key every _seconds, 0 to disable
+	void ticketKeyLifetime(const uint32 _seconds);
+	
+	//! Fills in the statistics - see Statistics
+	void statistics(Statistics &_rs)const;
+	
+	enum{
+		MaxTicketKeyCount = 3
+	};
+private:
+	friend class Socket;
+	friend struct TicketKeyCallback;
+	struct Data;
+	
+	void doHandshakeDone(SSL *_pssl);
+	bool doSetTicketCallback();
+	static Context& context(SSL *_pssl);
+	static int onNewSession(SSL *_pssl, SSL_SESSION *_psess);
+	static SSL_SESSION* onGetSession(SSL *_pssl, const unsigned char *_pid, int _len, int *_pcopy);
+	static void onRemoveSession(SSL_CTX *_pctx, SSL_SESSION *_psess);
+	static int onTicketKey(
+		SSL *_pssl, unsigned char *_pname, unsigned char *_piv,
+		EVP_CIPHER_CTX *_pcctx, void *_phctx, int _enc
+	);
 private:
 	Context(const Context&);
 	Context& operator=(const Context&);
@@ -50,6 +125,8 @@ protected:
 	Context(SSL_CTX *_pctx);
 protected:
 	SSL_CTX	*pctx;
+private:
+	Data	&d;
 };
 //! A OpenSSL secure communication wrapper
 /*!
@@ -70,6 +147,7 @@ public:
 	/*virtual*/ uint wantEvents()const;
 	/*virtual*/ AsyncE secureAccept();
 	/*virtual*/ AsyncE secureConnect();
+	/*virtual*/ bool kernelSend()const;
 private:
 
 	friend class Context;	
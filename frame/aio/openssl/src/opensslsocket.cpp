@@ -10,16 +10,160 @@
 #include "frame/aio/openssl/opensslsocket.hpp"
 #include "system/socketdevice.hpp"
 #include "system/common.hpp"
+#include "system/mutex.hpp"
+#include "system/atomic.hpp"
+#include "system/debug.hpp"
 
 #include "openssl/bio.h"
 #include "openssl/ssl.h"
 #include "openssl/err.h"
+#include "openssl/evp.h"
+#include "openssl/rand.h"
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include "openssl/core_names.h"
+#else
+#include "openssl/hmac.h"
+#endif
+
+#include <vector>
+#include <deque>
+#include <list>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+#ifdef HAS_CPP11
+
+#include <unordered_map>
+
+#else
+
+#include <map>
+
+#endif
 
 namespace solid{
 namespace frame{
 namespace aio{
 namespace openssl{
 
+//! A shard of the session cache
+/*!
+	The sessions are also linked in insertion order, the oldest first,
+	for eviction. A session and its link are always removed together.
+*/
+struct SessionShard{
+	typedef std::list<std::string>				KeyListT;
+	struct Session{
+		Session():expire(0){}
+		std::string			der;//the serialized session
+		time_t				expire;
+		KeyListT::iterator	keyit;//the link in keylst
+	};
+#ifdef HAS_CPP11
+	typedef std::unordered_map<std::string, Session>	SessionMapT;
+#else
+	typedef std::map<std::string, Session>				SessionMapT;
+#endif
+	
+	//! Insert or replace a session, making it the newest - true if inserted
+	bool insert(const std::string &_key, Session &_rsess){
+		std::pair<SessionMapT::iterator, bool>	rv(sessmap.insert(SessionMapT::value_type(_key, _rsess)));
+		if(rv.second){
+			rv.first->second.keyit = keylst.insert(keylst.end(), _key);
+		}else{
+			_rsess.keyit = rv.first->second.keyit;
+			rv.first->second = _rsess;
+			keylst.splice(keylst.end(), keylst, _rsess.keyit);
+		}
+		return rv.second;
+	}
+	void erase(const SessionMapT::iterator &_rit){
+		keylst.erase(_rit->second.keyit);
+		sessmap.erase(_rit);
+	}
+	bool erase(const std::string &_key){
+		SessionMapT::iterator	it(sessmap.find(_key));
+		if(it != sessmap.end()){
+			erase(it);
+			return true;
+		}
+		return false;
+	}
+	//! Remove the oldest session
+	void evict(){
+		erase(sessmap.find(keylst.front()));
+	}
+	
+	Mutex			mtx;
+	SessionMapT		sessmap;
+	KeyListT		keylst;//the keys in insertion order, the oldest first
+};
+
+struct TicketKey{
+	unsigned char	name[16];
+	unsigned char	hmackey[32];
+	unsigned char	aeskey[32];
+	time_t			created;
+};
+
+struct Context::Data{
+	typedef std::vector<SessionShard*>	SessionShardVectorT;
+	typedef std::deque<TicketKey>		TicketKeyDequeT;
+	
+	Data():
+		shardcap(0), sesstimeout(0), ticketlifetime(0), ticketcb(false),
+		handshakecnt(0), resumedcnt(0), cachehitcnt(0), cachemisscnt(0),
+		cachesize(0), ticketkeyrotatecnt(0){}
+	~Data(){
+		for(SessionShardVectorT::const_iterator it(shardvec.begin()); it != shardvec.end(); ++it){
+			delete *it;
+		}
+	}
+	SessionShard& shard(const unsigned char *_pid, const size_t _len){
+		size_t h(0);
+		for(size_t i(0); i < _len && i < sizeof(size_t); ++i){
+			h = (h << 8) | _pid[i];
+		}
+		return *shardvec[h % shardvec.size()];
+	}
+	bool newTicketKey(){
+		TicketKey	tk;
+		if(
+			RAND_bytes(tk.name, sizeof(tk.name)) != 1 ||
+			RAND_bytes(tk.hmackey, sizeof(tk.hmackey)) != 1 ||
+			RAND_bytes(tk.aeskey, sizeof(tk.aeskey)) != 1
+		){
+			return false;
+		}
+		tk.created = time(NULL);
+		pushTicketKey(tk);
+		++ticketkeyrotatecnt;
+		return true;
+	}
+	void pushTicketKey(const TicketKey &_rtk){
+		tkdq.push_front(_rtk);
+		if(tkdq.size() > MaxTicketKeyCount){
+			tkdq.pop_back();
+		}
+	}
+	
+	SessionShardVectorT			shardvec;
+	size_t						shardcap;//the capacity of a shard
+	uint32						sesstimeout;
+	Mutex						tkmtx;
+	TicketKeyDequeT				tkdq;//the ticket keys, the current one in front
+	uint32						ticketlifetime;
+	bool						ticketcb;
+	ATOMIC_NS::atomic<uint64>	handshakecnt;
+	ATOMIC_NS::atomic<uint64>	resumedcnt;
+	ATOMIC_NS::atomic<uint64>	cachehitcnt;
+	ATOMIC_NS::atomic<uint64>	cachemisscnt;
+	ATOMIC_NS::atomic<uint64>	cachesize;
+	ATOMIC_NS::atomic<uint64>	ticketkeyrotatecnt;
+};
+
 #ifdef HAS_SAFE_STATIC
 
 struct Initor{
@@ -63,6 +207,7 @@ void once_initor(){
 #endif
 Context::~Context(){
 	SSL_CTX_free(pctx);
+	delete &d;
 }
 Socket*	Context::createSocket(){
 	SSL *pssl(SSL_new(pctx));
@@ -85,13 +230,255 @@ bool Context::loadPrivateKeyFile(const char *_path){
 	if(SSL_CTX_use_PrivateKey_file(pctx, _path, SSL_FILETYPE_PEM)) return false;
 	return true;
 }
-Context::Context(SSL_CTX *_pctx):pctx(_pctx){
+bool Context::kernelTls(const bool _enable){
+#ifdef SSL_OP_ENABLE_KTLS
+	if(_enable){
+		SSL_CTX_set_options(pctx, SSL_OP_ENABLE_KTLS);
+	}else{
+		SSL_CTX_clear_options(pctx, SSL_OP_ENABLE_KTLS);
+	}
+	return true;
+#else
+	return !_enable;
+#endif
+}
+bool Context::sessionCache(
+	const size_t _shardcnt,
+	const size_t _capacity,
+	const uint32 _timeout
+){
+	if(!d.shardvec.empty() || !_shardcnt) return false;
+	for(size_t i(0); i < _shardcnt; ++i){
+		d.shardvec.push_back(new SessionShard);
+	}
+	d.shardcap = (_capacity + _shardcnt - 1) / _shardcnt;
+	d.sesstimeout = _timeout;
+	SSL_CTX_set_session_cache_mode(pctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+	SSL_CTX_set_session_id_context(pctx, reinterpret_cast<const unsigned char*>("solid"), 5);
+	SSL_CTX_set_timeout(pctx, _timeout);
+	SSL_CTX_sess_set_new_cb(pctx, &Context::onNewSession);
+	SSL_CTX_sess_set_get_cb(pctx, &Context::onGetSession);
+	SSL_CTX_sess_set_remove_cb(pctx, &Context::onRemoveSession);
+	return true;
+}
+bool Context::loadTicketKeyFile(const char *_path){
+	FILE	*pf(fopen(_path, "rb"));
+	if(!pf) return false;
+	std::vector<TicketKey>	tkvec;
+	unsigned char			buf[80];
+	size_t					rv;
+	while((rv = fread(buf, 1, sizeof(buf), pf)) == sizeof(buf)){
+		TicketKey	tk;
+		memcpy(tk.name, buf, 16);
+		memcpy(tk.hmackey, buf + 16, 32);
+		memcpy(tk.aeskey, buf + 48, 32);
+		tk.created = time(NULL);
+		tkvec.push_back(tk);
+	}
+	fclose(pf);
+	if(rv || tkvec.empty() || tkvec.size() > MaxTicketKeyCount){
+		edbgx(Debug::aio, "invalid ticket key file "<<_path);
+		return false;
+	}
+	{
+		Locker<Mutex>	lock(d.tkmtx);
+		d.tkdq.clear();
+		//the first key in file is the current one
+		for(std::vector<TicketKey>::const_reverse_iterator it(tkvec.rbegin()); it != tkvec.rend(); ++it){
+			d.pushTicketKey(*it);
+		}
+	}
+	return doSetTicketCallback();
+}
+bool Context::rotateTicketKey(){
+	{
+		Locker<Mutex>	lock(d.tkmtx);
+		if(!d.newTicketKey()) return false;
+	}
+	return doSetTicketCallback();
+}
+void Context::ticketKeyLifetime(const uint32 _seconds){
+	{
+		Locker<Mutex>	lock(d.tkmtx);
+		d.ticketlifetime = _seconds;
+		if(d.tkdq.empty()){
+			d.newTicketKey();
+		}
+	}
+	doSetTicketCallback();
+}
+void Context::statistics(Statistics &_rs)const{
+	_rs.handshakecnt = d.handshakecnt.load(ATOMIC_NS::memory_order_relaxed);
+	_rs.resumedcnt = d.resumedcnt.load(ATOMIC_NS::memory_order_relaxed);
+	_rs.cachehitcnt = d.cachehitcnt.load(ATOMIC_NS::memory_order_relaxed);
+	_rs.cachemisscnt = d.cachemisscnt.load(ATOMIC_NS::memory_order_relaxed);
+	_rs.cachesize = d.cachesize.load(ATOMIC_NS::memory_order_relaxed);
+	_rs.ticketkeyrotatecnt = d.ticketkeyrotatecnt.load(ATOMIC_NS::memory_order_relaxed);
+}
+void Context::doHandshakeDone(SSL *_pssl){
+	d.handshakecnt.fetch_add(1, ATOMIC_NS::memory_order_relaxed);
+	if(SSL_session_reused(_pssl)){
+		d.resumedcnt.fetch_add(1, ATOMIC_NS::memory_order_relaxed);
+	}
+}
+/*static*/ Context& Context::context(SSL *_pssl){
+	return *static_cast<Context*>(SSL_CTX_get_app_data(SSL_get_SSL_CTX(_pssl)));
+}
+/*static*/ int Context::onNewSession(SSL *_pssl, SSL_SESSION *_psess){
+	Data				&rd(context(_pssl).d);
+	unsigned int		idlen;
+	const unsigned char	*pid(SSL_SESSION_get_id(_psess, &idlen));
+	const int			sz(i2d_SSL_SESSION(_psess, NULL));
+	if(sz <= 0 || !idlen) return 0;
+	
+	SessionShard::Session	sess;
+	sess.der.resize(sz);
+	unsigned char			*pder(reinterpret_cast<unsigned char*>(&sess.der[0]));
+	i2d_SSL_SESSION(_psess, &pder);
+	sess.expire = time(NULL) + SSL_SESSION_get_timeout(_psess);
+	
+	const std::string	key(reinterpret_cast<const char*>(pid), idlen);
+	SessionShard		&rs(rd.shard(pid, idlen));
+	Locker<Mutex>		lock(rs.mtx);
+	if(rs.insert(key, sess)){
+		rd.cachesize.fetch_add(1, ATOMIC_NS::memory_order_relaxed);
+	}
+	while(rs.sessmap.size() > rd.shardcap){
+		rs.evict();
+		rd.cachesize.fetch_sub(1, ATOMIC_NS::memory_order_relaxed);
+	}
+	return 0;//we keep a serialized copy, not the session
+}
+/*static*/ SSL_SESSION* Context::onGetSession(SSL *_pssl, const unsigned char *_pid, int _len, int *_pcopy){
+	Data			&rd(context(_pssl).d);
+	SessionShard	&rs(rd.shard(_pid, _len));
+	std::string		der;
+	*_pcopy = 0;
+	{
+		Locker<Mutex>							lock(rs.mtx);
+		SessionShard::SessionMapT::iterator		it(rs.sessmap.find(std::string(reinterpret_cast<const char*>(_pid), _len)));
+		if(it != rs.sessmap.end()){
+			if(it->second.expire > time(NULL)){
+				der = it->second.der;
+			}else{
+				rs.erase(it);
+				rd.cachesize.fetch_sub(1, ATOMIC_NS::memory_order_relaxed);
+			}
+		}
+	}
+	if(der.empty()){
+		rd.cachemisscnt.fetch_add(1, ATOMIC_NS::memory_order_relaxed);
+		return NULL;
+	}
+	rd.cachehitcnt.fetch_add(1, ATOMIC_NS::memory_order_relaxed);
+	const unsigned char	*pder(reinterpret_cast<const unsigned char*>(der.data()));
+	return d2i_SSL_SESSION(NULL, &pder, der.size());
+}
+/*static*/ void Context::onRemoveSession(SSL_CTX *_pctx, SSL_SESSION *_psess){
+	Data				&rd(static_cast<Context*>(SSL_CTX_get_app_data(_pctx))->d);
+	unsigned int		idlen;
+	const unsigned char	*pid(SSL_SESSION_get_id(_psess, &idlen));
+	if(!idlen) return;
+	SessionShard		&rs(rd.shard(pid, idlen));
+	Locker<Mutex>		lock(rs.mtx);
+	if(rs.erase(std::string(reinterpret_cast<const char*>(pid), idlen))){
+		rd.cachesize.fetch_sub(1, ATOMIC_NS::memory_order_relaxed);
+	}
+}
+//! Adapts the ticket key callback to the MAC context type of the OpenSSL version
+struct TicketKeyCallback{
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	typedef EVP_MAC_CTX	MacContextT;
+#else
+	typedef HMAC_CTX	MacContextT;
+#endif
+	static int call(
+		SSL *_pssl, unsigned char *_pname, unsigned char *_piv,
+		EVP_CIPHER_CTX *_pcctx, MacContextT *_phctx, int _enc
+	){
+		return Context::onTicketKey(_pssl, _pname, _piv, _pcctx, _phctx, _enc);
+	}
+};
+bool Context::doSetTicketCallback(){
+	Locker<Mutex>	lock(d.tkmtx);
+	if(d.ticketcb) return true;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	d.ticketcb = SSL_CTX_set_tlsext_ticket_key_evp_cb(pctx, &TicketKeyCallback::call) == 1;
+#else
+	d.ticketcb = SSL_CTX_set_tlsext_ticket_key_cb(pctx, &TicketKeyCallback::call) == 1;
+#endif
+	return d.ticketcb;
+}
+//! Encrypt a new ticket with the current key, or find the key of a received one
+/*!
+	\retval 1 ok, 2 ok but the ticket should be renewed, 0 unknown key
+	(a full hand-shake is done), <0 error
+*/
+/*static*/ int Context::onTicketKey(
+	SSL *_pssl, unsigned char *_pname, unsigned char *_piv,
+	EVP_CIPHER_CTX *_pcctx, void *_phctx, int _enc
+){
+	Data		&rd(context(_pssl).d);
+	TicketKey	tk;
+	int			rv(1);
+	{
+		Locker<Mutex>	lock(rd.tkmtx);
+		if(_enc){
+			if(
+				rd.tkdq.empty() ||
+				(rd.ticketlifetime && (time(NULL) - rd.tkdq.front().created) >= static_cast<time_t>(rd.ticketlifetime))
+			){
+				if(!rd.newTicketKey() && rd.tkdq.empty()) return -1;
+			}
+			tk = rd.tkdq.front();
+		}else{
+			Data::TicketKeyDequeT::const_iterator it(rd.tkdq.begin());
+			for(; it != rd.tkdq.end(); ++it){
+				if(memcmp(it->name, _pname, sizeof(it->name)) == 0) break;
+			}
+			if(it == rd.tkdq.end()) return 0;
+			if(it != rd.tkdq.begin()) rv = 2;
+			tk = *it;
+		}
+	}
+	if(_enc){
+		if(RAND_bytes(_piv, EVP_MAX_IV_LENGTH) != 1) return -1;
+		memcpy(_pname, tk.name, sizeof(tk.name));
+		if(EVP_EncryptInit_ex(_pcctx, EVP_aes_256_cbc(), NULL, tk.aeskey, _piv) != 1) return -1;
+	}else{
+		if(EVP_DecryptInit_ex(_pcctx, EVP_aes_256_cbc(), NULL, tk.aeskey, _piv) != 1) return -1;
+	}
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	OSSL_PARAM	params[3];
+	params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, tk.hmackey, sizeof(tk.hmackey));
+	params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char*>("sha256"), 0);
+	params[2] = OSSL_PARAM_construct_end();
+	if(EVP_MAC_CTX_set_params(static_cast<EVP_MAC_CTX*>(_phctx), params) != 1) return -1;
+#else
+	if(HMAC_Init_ex(static_cast<HMAC_CTX*>(_phctx), tk.hmackey, sizeof(tk.hmackey), EVP_sha256(), NULL) != 1) return -1;
+#endif
+	return rv;
+}
+Context::Context(SSL_CTX *_pctx):pctx(_pctx), d(*(new Data)){
+	SSL_CTX_set_app_data(pctx, this);
+}
+Context::Statistics::Statistics():
+	handshakecnt(0), resumedcnt(0), cachehitcnt(0), cachemisscnt(0),
+	cachesize(0), ticketkeyrotatecnt(0){}
+
+double Context::Statistics::resumptionRatio()const{
+	if(!handshakecnt) return 0;
+	return static_cast<double>(resumedcnt) / handshakecnt;
 }
 //============================================================================
 inline bool Socket::shouldWait()const{
 	return SSL_want(pssl) != SSL_NOTHING;
 }
 Socket::~Socket(){
+	if(SSL_get_shutdown(pssl) & SSL_RECEIVED_SHUTDOWN){
+		//the peer closed cleanly - keep the session resumable
+		SSL_set_shutdown(pssl, SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+	}
 	SSL_free(pssl);
 }
 /*virtual*/ void Socket::descriptor(const SocketDevice &_sd){
@@ -115,7 +502,10 @@ Socket::~Socket(){
 }
 /*virtual*/ AsyncE Socket::secureAccept(){
 	int rv = SSL_accept(pssl);
-	if(rv > 0) return AsyncSuccess;
+	if(rv > 0){
+		Context::context(pssl).doHandshakeDone(pssl);
+		return AsyncSuccess;
+	}
 	if(rv == 0) return AsyncError;
 	if(shouldWait()){
 		return AsyncWait;
@@ -123,12 +513,22 @@ Socket::~Socket(){
 }
 /*virtual*/ AsyncE Socket::secureConnect(){
 	int rv = SSL_connect(pssl);
-	if(rv > 0) return AsyncSuccess;
+	if(rv > 0){
+		Context::context(pssl).doHandshakeDone(pssl);
+		return AsyncSuccess;
+	}
 	if(rv == 0) return AsyncError;
 	if(shouldWait()){
 		return AsyncWait;
 	}return AsyncError;
 }
+/*virtual*/ bool Socket::kernelSend()const{
+#ifdef BIO_get_ktls_send
+	return BIO_get_ktls_send(SSL_get_wbio(pssl));
+#else
+	return false;
+#endif
+}
 Socket::Socket(SSL *_pssl):pssl(_pssl){
 }
 
@@ -0,0 +1,124 @@
+// frame/aio/src/aiohandshakepool.cpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#include "frame/aio/aiohandshakepool.hpp"
+#include "frame/aio/aiosecuresocket.hpp"
+#include "frame/manager.hpp"
+#include "system/debug.hpp"
+#include "system/thread.hpp"
+#include "utility/workpool.hpp"
+
+namespace solid{
+namespace frame{
+namespace aio{
+
+//! The hand-shake workers are created on demand, up to maxwkrcnt
+struct HandshakePool::Data{
+	struct Controller: WorkPoolControllerBase{
+		typedef WorkPool<HandshakePool::Job*, Controller>	WorkPoolT;
+
+		Controller(Data &_rd):rd(_rd), wkrcnt(0){}
+
+		bool createWorker(WorkPoolT &_rwp){
+			WorkerBase	*pw(_rwp.createSingleWorker());
+			if(pw && !pw->start()){
+				delete pw;
+				return false;
+			}
+			++wkrcnt;
+			return true;
+		}
+		void onPush(WorkPoolT &_rwp){
+			if(wkrcnt < rd.maxwkrcnt){
+				_rwp.createWorker();
+			}
+		}
+		void execute(WorkerBase &, HandshakePool::Job *&_rpjob){
+			rd.rhp.execute(*_rpjob);
+		}
+
+		Data	&rd;
+		size_t	wkrcnt;
+	};
+	typedef Controller::WorkPoolT	WorkPoolT;
+
+	Data(
+		HandshakePool &_rhp, Manager &_rm, const size_t _maxwkrcnt
+	):rhp(_rhp), rm(_rm), maxwkrcnt(_maxwkrcnt), wp(*this){}
+
+	HandshakePool	&rhp;
+	Manager			&rm;
+	const size_t	maxwkrcnt;
+	WorkPoolT		wp;
+};
+
+//--------------------------------------------------------------------
+HandshakePool::Job::Job(
+	SecureSocket *_pss, const ObjectUidT &_ruid, const bool _connect
+):pss(_pss), uid(_ruid), connect(_connect), orphan(false), rv(AsyncWait), want(0){
+	done.store(false, ATOMIC_NS::memory_order_relaxed);
+	usecnt.store(1, ATOMIC_NS::memory_order_relaxed);
+}
+
+HandshakePool::Job::~Job(){
+	if(orphan){
+		delete pss;
+	}
+}
+
+//--------------------------------------------------------------------
+static size_t worker_count(const size_t _wkrcnt){
+	if(_wkrcnt) return _wkrcnt;
+	const size_t	cnt(Thread::processorCount());
+	return cnt ? cnt : 1;
+}
+
+HandshakePool::HandshakePool(
+	Manager &_rm, const size_t _wkrcnt
+):d(*(new Data(*this, _rm, worker_count(_wkrcnt)))){
+	d.wp.start();
+}
+
+HandshakePool::~HandshakePool(){
+	stop();
+	delete &d;
+}
+
+void HandshakePool::stop(){
+	d.wp.stop(true);
+}
+
+void HandshakePool::push(Job &_rjob){
+	_rjob.usecnt.fetch_add(1, ATOMIC_NS::memory_order_relaxed);
+	d.wp.push(&_rjob);
+}
+
+/*static*/ void HandshakePool::release(Job &_rjob){
+	if(_rjob.usecnt.fetch_sub(1, ATOMIC_NS::memory_order_acq_rel) == 1){
+		delete &_rjob;
+	}
+}
+
+void HandshakePool::execute(Job &_rjob){
+	if(_rjob.usecnt.load(ATOMIC_NS::memory_order_acquire) == 1){
+		//the socket is gone
+		release(_rjob);
+		return;
+	}
+	_rjob.rv = _rjob.connect ? _rjob.pss->secureConnect() : _rjob.pss->secureAccept();
+	_rjob.want = _rjob.pss->wantEvents();
+	vdbgx(Debug::aio, "handshake step rv = "<<_rjob.rv<<" want = "<<_rjob.want);
+	_rjob.done.store(true, ATOMIC_NS::memory_order_release);
+	d.rm.notify(frame::S_RAISE, _rjob.uid);
+	release(_rjob);
+}
+
+}//namespace aio
+}//namespace frame
+}//namespace solid
@@ -11,12 +11,15 @@
 #include "frame/aio/aiosingleobject.hpp"
 #include "frame/aio/aiomultiobject.hpp"
 #include "frame/aio/src/aiosocket.hpp"
+#include "frame/manager.hpp"
 #include "system/cassert.hpp"
 #include "system/debug.hpp"
 #include "system/thread.hpp"
 
 #include <memory>
 #include <cstring>
+#include <vector>
+#include <algorithm>
 
 namespace solid{
 namespace frame{
@@ -34,7 +37,20 @@ Object::SocketStub::~SocketStub(){
 	delete psock;
 }
 
+struct Object::SendBacklog{
+	typedef std::vector<ObjectUidT>	UidVectorT;
+	
+	SendBacklog():low(0), high(-1), size(0), ishigh(false){}
+	
+	size_t		low;
+	size_t		high;
+	size_t		size;
+	bool		ishigh;
+	UidVectorT	prodvec;//the producers notified with high
+};
+
 /*virtual*/ Object::~Object(){
+	delete psndbl;
 }
 
 void Object::setSocketPointer(const SocketPointer &_rsp, Socket *_ps){
@@ -196,6 +212,11 @@ void Object::doUnprepare(){
 }
 
 /*virtual*/void Object::doStop(){
+	if(psndbl && psndbl->ishigh){
+		//do not leave the producers stopped
+		psndbl->ishigh = false;
+		doNotifyProducers();
+	}
 	doUnprepare();
 }
 
@@ -203,6 +224,105 @@ void Object::doClearRequests(){
 	reqpos = reqbeg;
 }
 
+void Object::sendWatermarks(const size_t _low, const size_t _high){
+	cassert(_low <= _high);
+	if(!psndbl){
+		psndbl = new SendBacklog;
+	}
+	psndbl->low = _low;
+	psndbl->high = _high;
+}
+
+bool Object::sendBacklogPush(const size_t _sz, const ObjectUidT &_rproduceruid){
+	if(!psndbl){
+		psndbl = new SendBacklog;
+	}
+	SendBacklog	&rsb(*psndbl);
+	rsb.size += _sz;
+	if(rsb.size > rsb.high){
+		rsb.ishigh = true;
+	}
+	if(!rsb.ishigh){
+		return true;
+	}
+	if(
+		!is_invalid_uid(_rproduceruid) &&
+		std::find(rsb.prodvec.begin(), rsb.prodvec.end(), _rproduceruid) == rsb.prodvec.end()
+	){
+		vdbgx(Debug::aio, "send backlog "<<rsb.size<<" stop producer "<<_rproduceruid.first);
+		rsb.prodvec.push_back(_rproduceruid);
+		MessagePointerT	msgptr(new SendWatermarkMessage(Manager::specific().id(*this), true));
+		Manager::specific().notify(msgptr, _rproduceruid);
+	}
+	return false;
+}
+
+void Object::sendBacklogPop(const size_t _sz){
+	cassert(psndbl && psndbl->size >= _sz);
+	SendBacklog	&rsb(*psndbl);
+	rsb.size -= _sz;
+	if(rsb.ishigh && rsb.size <= rsb.low){
+		rsb.ishigh = false;
+		doNotifyProducers();
+	}
+}
+
+size_t Object::sendBacklog()const{
+	return psndbl ? psndbl->size : 0;
+}
+
+bool Object::isSendBacklogHigh()const{
+	return psndbl && psndbl->ishigh;
+}
+
+//! Resume the producers stopped on the high watermark
+void Object::doNotifyProducers(){
+	SendBacklog		&rsb(*psndbl);
+	const ObjectUidT	uid(Manager::specific().id(*this));
+	Manager				&rm(Manager::specific());
+	vdbgx(Debug::aio, "send backlog "<<rsb.size<<" resume "<<rsb.prodvec.size()<<" producers");
+	for(SendBacklog::UidVectorT::const_iterator it(rsb.prodvec.begin()); it != rsb.prodvec.end(); ++it){
+		MessagePointerT	msgptr(new SendWatermarkMessage(uid, false));
+		rm.notify(msgptr, *it);
+	}
+	rsb.prodvec.clear();
+}
+
+ObjectUidT Object::socketHandshakeUid()const{
+	if(isRegistered()){
+		return Manager::specific().id(*this);
+	}
+	return invalid_uid();
+}
+
+//! Collect the completed hand-shake steps of the HandshakePool
+/*!
+	Called by the selector, before executing the object.
+	The S_RAISE used by the pool to wake the object is cleared here,
+	so that the next step completion raises the object again.
+*/
+ulong Object::doHandshakeEvents(){
+	ulong	rv(0);
+	size_t	cnt(0);
+	grabSignalMask(~static_cast<size_t>(S_RAISE));
+	for(size_t i(0); i < stubcp; ++i){
+		Socket	*psock(pstubs[i].psock);
+		if(!psock || !psock->isHandshakeOffloaded()) continue;
+		const ulong	evs(psock->doHandshakeEvents());
+		if(evs){
+			socketPostEvents(i, evs);
+			rv |= evs;
+		}else{
+			++cnt;
+			if(psock->ioRequest()){
+				socketPushRequest(i, SocketStub::IORequest);
+			}
+		}
+	}
+	hscnt = cnt;
+	return rv;
+}
+
 //========================== aio::SingleObject =============================
 
 SingleObject::SingleObject(const SocketPointer& _rsp):
@@ -236,6 +356,14 @@ AsyncE SingleObject::socketAccept(SocketDevice &_rsd){
 	return rv;
 }
 
+AsyncE SingleObject::socketAccept(SocketDeviceVectorT &_rsdvec, const size_t _cnt){
+	const AsyncE rv = stub.psock->accept(_rsdvec, _cnt);
+	if(rv == AsyncWait){
+		socketPushRequest(0, SocketStub::IORequest);
+	}
+	return rv;
+}
+
 AsyncE SingleObject::socketConnect(const SocketAddressStub& _rsas){
 	cassert(stub.psock);
 	const AsyncE rv = stub.psock->connect(_rsas);
@@ -280,6 +408,43 @@ AsyncE SingleObject::socketRecv(char *_pb, uint32 _bl, uint32 _flags){
 	return rv;
 }
 
+AsyncE SingleObject::socketSendv(const IoBuffer *_pbufs, const size_t _bufcnt, uint32 _flags){
+	cassert(stub.psock);
+	const AsyncE rv = stub.psock->sendv(_pbufs, _bufcnt, _flags);
+	if(rv == AsyncWait){
+		socketPushRequest(0, SocketStub::IORequest);
+	}
+	return rv;
+}
+
+AsyncE SingleObject::socketRecvv(IoBuffer *_pbufs, const size_t _bufcnt, uint32 _flags){
+	cassert(stub.psock);
+	const AsyncE rv = stub.psock->recvv(_pbufs, _bufcnt, _flags);
+	if(rv == AsyncWait){
+		socketPushRequest(0, SocketStub::IORequest);
+	}
+	return rv;
+}
+
+AsyncE SingleObject::socketRecv(RecvBuffer &_rrb, uint32 _flags){
+	cassert(stub.psock);
+	const AsyncE rv = stub.psock->recv(_rrb, _flags);
+	if(rv == AsyncWait){
+		socketPushRequest(0, SocketStub::IORequest);
+	}
+	return rv;
+}
+
+AsyncE SingleObject::socketSendFile(file::FilePointerT &_rfileptr, const int64 _off, const uint64 _len){
+	cassert(stub.psock);
+	cassert(!_rfileptr.empty());
+	const AsyncE rv = stub.psock->sendFile(*_rfileptr, _off, _len);
+	if(rv == AsyncWait){
+		socketPushRequest(0, SocketStub::IORequest);
+	}
+	return rv;
+}
+
 AsyncE SingleObject::socketRecvFrom(char *_pb, uint32 _bl, uint32 _flags){
 	//ensure that we dont have double request
 	//cassert(stub.request <= SocketStub::Response);
@@ -292,6 +457,24 @@ AsyncE SingleObject::socketRecvFrom(char *_pb, uint32 _bl, uint32 _flags){
 	return rv;
 }
 
+AsyncE SingleObject::socketRecvFrom(RecvDatagram *_pdgs, const size_t _cnt, uint32 _flags){
+	cassert(stub.psock);
+	const AsyncE rv = stub.psock->recvFrom(_pdgs, _cnt, _flags);
+	if(rv == AsyncWait){
+		socketPushRequest(0, SocketStub::IORequest);
+	}
+	return rv;
+}
+
+AsyncE SingleObject::socketSendTo(const SendDatagram *_pdgs, const size_t _cnt, uint32 _flags){
+	cassert(stub.psock);
+	const AsyncE rv = stub.psock->sendTo(_pdgs, _cnt, _flags);
+	if(rv == AsyncWait){
+		socketPushRequest(0, SocketStub::IORequest);
+	}
+	return rv;
+}
+
 uint32 SingleObject::socketRecvSize()const{
 	return stub.psock->recvSize();
 }
@@ -419,8 +602,9 @@ void SingleObject::socketSecureSocket(SecureSocket *_pss){
 }
 
 AsyncE SingleObject::socketSecureAccept(){
-	const AsyncE rv = stub.psock->secureAccept();
+	const AsyncE rv = stub.psock->secureAccept(socketHandshakeUid());
 	if(rv == AsyncWait){
+		if(stub.psock->isHandshakeOffloaded()) ++hscnt;
 		//stub.timepos.set(0xffffffff, 0xffffffff);
 		socketPushRequest(0, SocketStub::IORequest);
 	}
@@ -428,8 +612,9 @@ AsyncE SingleObject::socketSecureAccept(){
 }
 
 AsyncE SingleObject::socketSecureConnect(){
-	const AsyncE rv = stub.psock->secureConnect();
+	const AsyncE rv = stub.psock->secureConnect(socketHandshakeUid());
 	if(rv == AsyncWait){
+		if(stub.psock->isHandshakeOffloaded()) ++hscnt;
 		//stub.timepos.set(0xffffffff, 0xffffffff);
 		socketPushRequest(0, SocketStub::IORequest);
 	}
@@ -490,6 +675,15 @@ AsyncE MultiObject::socketAccept(const size_t _pos, SocketDevice &_rsd){
 	return rv;
 }
 
+AsyncE MultiObject::socketAccept(const size_t _pos, SocketDeviceVectorT &_rsdvec, const size_t _cnt){
+	cassert(_pos < stubcp);
+	const AsyncE rv = pstubs[_pos].psock->accept(_rsdvec, _cnt);
+	if(rv == AsyncWait){
+		socketPushRequest(_pos, SocketStub::IORequest);
+	}
+	return rv;
+}
+
 AsyncE MultiObject::socketConnect(const size_t _pos, const SocketAddressStub& _rsas){
 	cassert(_pos < stubcp);
 	const AsyncE rv = pstubs[_pos].psock->connect(_rsas);
@@ -546,6 +740,62 @@ AsyncE MultiObject::socketRecv(
 	return rv;
 }
 
+AsyncE MultiObject::socketSendv(
+	const size_t _pos,
+	const IoBuffer *_pbufs,
+	const size_t _bufcnt,
+	uint32 _flags
+){
+	cassert(_pos < stubcp);
+	const AsyncE rv = pstubs[_pos].psock->sendv(_pbufs, _bufcnt, _flags);
+	if(rv == AsyncWait){
+		socketPushRequest(_pos, SocketStub::IORequest);
+	}
+	return rv;
+}
+
+AsyncE MultiObject::socketRecvv(
+	const size_t _pos,
+	IoBuffer *_pbufs,
+	const size_t _bufcnt,
+	uint32 _flags
+){
+	cassert(_pos < stubcp);
+	const AsyncE rv = pstubs[_pos].psock->recvv(_pbufs, _bufcnt, _flags);
+	if(rv == AsyncWait){
+		socketPushRequest(_pos, SocketStub::IORequest);
+	}
+	return rv;
+}
+
+AsyncE MultiObject::socketRecv(
+	const size_t _pos,
+	RecvBuffer &_rrb,
+	uint32 _flags
+){
+	cassert(_pos < stubcp);
+	const AsyncE rv = pstubs[_pos].psock->recv(_rrb, _flags);
+	if(rv == AsyncWait){
+		socketPushRequest(_pos, SocketStub::IORequest);
+	}
+	return rv;
+}
+
+AsyncE MultiObject::socketSendFile(
+	const size_t _pos,
+	file::FilePointerT &_rfileptr,
+	const int64 _off,
+	const uint64 _len
+){
+	cassert(_pos < stubcp);
+	cassert(!_rfileptr.empty());
+	const AsyncE rv = pstubs[_pos].psock->sendFile(*_rfileptr, _off, _len);
+	if(rv == AsyncWait){
+		socketPushRequest(_pos, SocketStub::IORequest);
+	}
+	return rv;
+}
+
 AsyncE MultiObject::socketRecvFrom(
 	const size_t _pos,
 	char *_pb,
@@ -560,6 +810,34 @@ AsyncE MultiObject::socketRecvFrom(
 	return rv;
 }
 
+AsyncE MultiObject::socketRecvFrom(
+	const size_t _pos,
+	RecvDatagram *_pdgs,
+	const size_t _cnt,
+	uint32 _flags
+){
+	cassert(_pos < stubcp);
+	const AsyncE rv = pstubs[_pos].psock->recvFrom(_pdgs, _cnt, _flags);
+	if(rv == AsyncWait){
+		socketPushRequest(_pos, SocketStub::IORequest);
+	}
+	return rv;
+}
+
+AsyncE MultiObject::socketSendTo(
+	const size_t _pos,
+	const SendDatagram *_pdgs,
+	const size_t _cnt,
+	uint32 _flags
+){
+	cassert(_pos < stubcp);
+	const AsyncE rv = pstubs[_pos].psock->sendTo(_pdgs, _cnt, _flags);
+	if(rv == AsyncWait){
+		socketPushRequest(_pos, SocketStub::IORequest);
+	}
+	return rv;
+}
+
 uint32 MultiObject::socketRecvSize(const size_t _pos)const{	
 	cassert(_pos < stubcp);
 	return pstubs[_pos].psock->recvSize();
@@ -779,16 +1057,18 @@ void MultiObject::socketSecureSocket(const size_t _pos, SecureSocket *_pss){
 }
 
 AsyncE MultiObject::socketSecureAccept(const size_t _pos){
-	const AsyncE rv = pstubs[_pos].psock->secureAccept();
+	const AsyncE rv = pstubs[_pos].psock->secureAccept(socketHandshakeUid());
 	if(rv == AsyncWait){
+		if(pstubs[_pos].psock->isHandshakeOffloaded()) ++hscnt;
 		socketPushRequest(_pos, SocketStub::IORequest);
 	}
 	return rv;
 }
 
 AsyncE MultiObject::socketSecureConnect(const size_t _pos){
-	const AsyncE rv = pstubs[_pos].psock->secureConnect();
+	const AsyncE rv = pstubs[_pos].psock->secureConnect(socketHandshakeUid());
 	if(rv == AsyncWait){
+		if(pstubs[_pos].psock->isHandshakeOffloaded()) ++hscnt;
 		socketPushRequest(_pos, SocketStub::IORequest);
 	}
 	return rv;
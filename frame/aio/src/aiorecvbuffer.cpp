@@ -0,0 +1,117 @@
+// frame/aio/src/aiorecvbuffer.cpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#include "frame/aio/aiorecvbuffer.hpp"
+#include "system/socketdevice.hpp"
+#include "system/specific.hpp"
+#include "system/cassert.hpp"
+#include "system/debug.hpp"
+#include <cstring>
+
+namespace solid{
+namespace frame{
+namespace aio{
+
+//! The index of the largest Specific capacity not greater than _sz
+static uint16 capacity_index(uint32 _sz){
+	int id(Specific::sizeToIndex(_sz));
+	while(id < 0 && _sz){
+		_sz >>= 1;
+		id = Specific::sizeToIndex(_sz);
+	}
+	if(id < 0) id = 0;
+	if(Specific::indexToCapacity(id) > _sz && id){
+		--id;
+	}
+	return id;
+}
+
+RecvBuffer::RecvBuffer(
+	const uint32 _mincp,
+	const uint32 _maxcp,
+	const bool _syncrcvbuf
+):pb(NULL), sz(0), bufid(0), capid(0), minid(0), maxid(0), sockid(-1), smallcnt(0), syncrcvbuf(_syncrcvbuf){
+	minid = capacity_index(_mincp);
+	maxid = capacity_index(_maxcp);
+	if(maxid < minid) maxid = minid;
+	capid = minid;
+}
+
+RecvBuffer::~RecvBuffer(){
+	clear();
+}
+
+uint32 RecvBuffer::capacity()const{
+	return Specific::indexToCapacity(capid);
+}
+
+void RecvBuffer::clear(){
+	if(pb){
+		Specific::pushBuffer(pb, bufid);
+		pb = NULL;
+	}
+	sz = 0;
+}
+
+//! Get the memory for a receive, of the current capacity
+char* RecvBuffer::doPrepare(){
+	if(pb && bufid != capid){
+		Specific::pushBuffer(pb, bufid);
+		pb = NULL;
+	}
+	if(!pb){
+		pb = Specific::popBuffer(capid);
+		bufid = capid;
+	}
+	sz = 0;
+	return pb;
+}
+
+uint32 RecvBuffer::doCapacity()const{
+	return Specific::indexToCapacity(bufid);
+}
+
+//! Double the buffer, keeping the _sz bytes already received
+bool RecvBuffer::doGrow(const uint32 _sz){
+	if(bufid >= maxid) return false;
+	const uint16	newid(bufid + 1);
+	char			*pnb(Specific::popBuffer(newid));
+	memcpy(pnb, pb, _sz);
+	Specific::pushBuffer(pb, bufid);
+	pb = pnb;
+	bufid = newid;
+	capid = newid;
+	smallcnt = 0;
+	vdbgx(Debug::aio, "grow to "<<doCapacity());
+	return true;
+}
+
+//! Called on the completion of a receive, to adapt the capacity
+void RecvBuffer::doDone(const uint32 _sz, SocketDevice &_rsd){
+	sz = _sz;
+	if(_sz <= (doCapacity() >> 2)){
+		if(++smallcnt >= ShrinkCount){
+			smallcnt = 0;
+			if(capid > minid){
+				--capid;
+				vdbgx(Debug::aio, "shrink to "<<capacity());
+			}
+		}
+	}else{
+		smallcnt = 0;
+	}
+	if(syncrcvbuf && sockid != capid){
+		sockid = capid;
+		_rsd.recvBufferSize(2 * capacity());
+	}
+}
+
+}//namespace aio
+}//namespace frame
+}//namespace solid
@@ -23,13 +23,17 @@
 #include <vector>
 #include <cerrno>
 #include <cstring>
+#include <climits>
 
 #include "system/debug.hpp"
 #include "system/timespec.hpp"
 #include "system/mutex.hpp"
+#include "system/atomic.hpp"
 
 #include "utility/queue.hpp"
 #include "utility/stack.hpp"
+#include "utility/timerwheel.hpp"
+#include "utility/mpscring.hpp"
 
 #include "frame/object.hpp"
 #include "frame/common.hpp"
@@ -59,12 +63,14 @@ struct Selector::Stub{
 		itimepos(TimeSpec::maximum),
 		otimepos(TimeSpec::maximum),
 		state(OutExecQueue),
-		events(0){
+		events(0), exetime(0), execnt(0){
 	}
 	void reset(){
 		timepos = TimeSpec::maximum; 
 		state = OutExecQueue;
 		events = 0;
+		exetime = 0;
+		execnt = 0;
 	}
 	ObjectPointerT	objptr;
 	TimeSpec		timepos;//object timepos
@@ -72,6 +78,16 @@ struct Selector::Stub{
 	TimeSpec		otimepos;//output timepos
 	State			state;
 	uint			events;
+	uint64			exetime;//nanoseconds spent executing in the balancing period
+	uint32			execnt;//executions in the balancing period
+};
+
+//! An object in transit between two selectors
+struct Selector::MigrateStub{
+	ObjectPointerT	objptr;
+	TimeSpec		timepos;
+	TimeSpec		itimepos;
+	TimeSpec		otimepos;
 };
 
 struct Selector::Data{
@@ -86,6 +102,14 @@ struct Selector::Data{
 	typedef Stack<uint32>			Uint32StackT;
 	typedef Queue<uint32>			Uint32QueueT;
 	typedef std::vector<Stub>		StubVectorT;
+	typedef std::vector<MigrateStub>	MigrateVectorT;
+	typedef std::vector<ObjectPointerT>	ObjectVectorT;
+	typedef ATOMIC_NS::atomic<bool>	AtomicBoolT;
+#ifndef UPIPESIGNAL
+	typedef MpscRing<uint32>		Uint32RingT;
+#endif
+	//raised only to wake up the selector - it is not a valid position
+	static const uint32				WakePos = 0xffffffff;
 	
 	ulong				objcp;
 	ulong				objsz;
@@ -95,18 +119,37 @@ struct Selector::Data{
 	int					epollfd;
 	epoll_event 		events[MAX_EVENTS_COUNT];
 	StubVectorT			stubs;
-	Uint32QueueT		execq;
+	Uint32QueueT		execq[PriorityCount];//one execution queue per priority class
 	Uint32StackT		freestubsstk;
 #ifdef UPIPESIGNAL
 	int					pipefds[2];
 #else
 	int					efd;//eventfd
+	Uint32RingT			sigring;//lock-free raised positions
+	AtomicBoolT			sigwake;//the eventfd was written and not yet consumed
+	AtomicBoolT			sigovfl;//sigq is not empty
 	Mutex				m;
-	Uint32QueueT		sigq;//a signal queue
+	Uint32QueueT		sigq;//overflow signal queue - used when sigring is full
 	uint64				efdv;//the eventfd value
 #endif
-	TimeSpec			ntimepos;//next timepos == next timeout
+	TimerWheel			timewheel;//one timer per stub - the nearest of its timeouts
 	TimeSpec			ctimepos;//current time pos
+	uint32				exepos;//the position of the executing object, 0 if none
+	Mutex				migmtx;
+	MigrateVectorT		migvec;//objects migrated here by other selectors
+	ulong				migroom;//how many objects can still be migrated here
+	AtomicBoolT			migflag;//migvec is not empty
+	ObjectVectorT		locvec;//objects pushed from the selector thread, registered by the loop
+	ulong				balmsec;//the balancing period, 0 if not balancing
+	TimeSpec			balpos;//the start of the balancing period
+	TimeSpec			balnext;//the end of the balancing period
+	uint64				balperiod;//the length in nanoseconds of the last balancing period
+	uint64				balbusy;//nanoseconds spent executing objects in the balancing period
+	ulong				budgetcnt[PriorityCount];//objects executed per loop, 0 for no limit
+	ulong				budgetusec[PriorityCount];//microseconds executing per loop, 0 for no limit
+	bool				persistent;//the sockets are registered once, for both input and output
+	uint32				zcthreshold;//the stream sockets send with MSG_ZEROCOPY from this size, 0 for never
+	HandshakePool		*phspool;//the pool doing the secure hand-shakes, NULL for none
 	
 //reporting data:
 	uint				rep_fullscancount;
@@ -114,21 +157,34 @@ struct Selector::Data{
 public://methods:
 	Data();
 	~Data();
+	void pushExec(const uint32 _pos);
+	size_t execSize()const;
 	int computeWaitTimeout()const;
+	uint64 currentTick()const;
+	static uint64 tick(const TimeSpec &_rts);
 	void addNewSocket();
 	epoll_event* eventPrepare(epoll_event &_ev, const uint32 _objpos, const uint32 _sockpos);
 	void stub(uint32 &_objpos, uint32 &_sockpos, const epoll_event &_ev);
+	void signal(const uint32 _pos, ulong &_rflags);
+	uint32 registerEvents(const uint32 _selevents)const;
 };
 //-------------------------------------------------------------
 Selector::Data::Data():
 	objcp(0), objsz(0), /*sockcp(0),*/ socksz(0), selcnt(0), epollfd(-1),
-	rep_fullscancount(0){
+	exepos(0), migroom(0), balmsec(0), balperiod(0), balbusy(0), persistent(false), zcthreshold(0), phspool(NULL), rep_fullscancount(0){
+	for(uint i = 0; i < PriorityCount; ++i){
+		budgetcnt[i] = 0;
+		budgetusec[i] = 0;
+	}
+	migflag.store(false);
 #ifdef UPIPESIGNAL
 	pipefds[0] = -1;
 	pipefds[1] = -1;
 #else
 	efd = -1;
 	efdv = 0;
+	sigwake.store(false);
+	sigovfl.store(false);
 #endif
 }
 
@@ -149,11 +205,64 @@ Selector::Data::~Data(){
 }
 
 int Selector::Data::computeWaitTimeout()const{
-	if(ntimepos.isMax()) return -1;//return MAXPOLLWAIT;
-	int rv = (ntimepos.seconds() - ctimepos.seconds()) * 1000;
-	rv += ((long)ntimepos.nanoSeconds() - ctimepos.nanoSeconds()) / 1000000;
-	if(rv < 0) return MAXPOLLWAIT;
-	return rv;
+	const uint64	nexttick(timewheel.nextTick());
+	if(nexttick == TimerWheel::invalidTick()) return -1;//return MAXPOLLWAIT;
+	const uint64	crttick(currentTick());
+	if(nexttick <= crttick) return 0;
+	if((nexttick - crttick) > MAXPOLLWAIT) return MAXPOLLWAIT;
+	return nexttick - crttick;
+}
+//! Schedule the object on _pos for execution, if it was notified
+/*!
+	Position zero means the selector must exit the loop.
+*/
+void Selector::Data::signal(const uint32 _pos, ulong &_rflags){
+	Stub *pstub;
+	if(_pos){
+		if(_pos < stubs.size() && !(pstub = &stubs[_pos])->objptr.empty() && pstub->objptr->isRaised()){
+			idbgx(Debug::aio, "signaled object on pos "<<_pos);
+			pstub->events |= EventSignal;
+			if(pstub->state == Stub::OutExecQueue){
+				pushExec(_pos);
+				pstub->state = Stub::InExecQueue;
+			}
+		}
+	}else _rflags = EXIT_LOOP;
+}
+//! Queue the object on _pos for execution, in the queue of its priority class
+inline void Selector::Data::pushExec(const uint32 _pos){
+	execq[stubs[_pos].objptr->priority()].push(_pos);
+}
+inline size_t Selector::Data::execSize()const{
+	size_t sz(0);
+	for(uint i = 0; i < PriorityCount; ++i){
+		sz += execq[i].size();
+	}
+	return sz;
+}
+//! The current time in milliseconds, rounded down
+inline uint64 Selector::Data::currentTick()const{
+	return ctimepos.seconds() * 1000ULL + ctimepos.nanoSeconds() / 1000000;
+}
+//! A timeout in milliseconds, rounded up so that ctimepos >= _rts when it fires
+/*static*/ inline uint64 Selector::Data::tick(const TimeSpec &_rts){
+	return _rts.seconds() * 1000ULL + (_rts.nanoSeconds() + 999999) / 1000000;
+}
+//! The events to register a socket with
+/*!
+	In persistent mode the socket is registered once for both input and
+	output and never modified afterwards. Edge triggered readiness needs
+	no rearming because every aio::Socket operation first tries the io
+	directly and asks to wait only after it hit EAGAIN - so a wait always
+	starts with the direction not ready and the next edge is not missed.
+	The events reported for a direction the socket does not wait for
+	are simply dropped (see doAllIo).
+*/
+inline uint32 Selector::Data::registerEvents(const uint32 _selevents)const{
+	if(persistent){
+		return EPOLLIN | EPOLLOUT | EPOLLERR | EPOLLHUP | EPOLLET;
+	}
+	return (_selevents & EPOLLMASK) | EPOLLERR | EPOLLHUP | EPOLLET;
 }
 void Selector::Data::addNewSocket(){
 	++socksz;
@@ -181,6 +290,10 @@ bool Selector::init(ulong _cp){
 	idbgx(Debug::aio, "aio::Selector "<<(void*)this);
 	cassert(_cp);
 	d.objcp = _cp;
+	//objects are added before the loop is run - fix the registration mode now
+	d.persistent = persistentRegistration();
+	d.zcthreshold = zeroCopyThreshold();
+	d.phspool = handshakePool();
 	//d.sockcp = _cp;
 	
 	setCurrentTimeSpecific(d.ctimepos);
@@ -218,6 +331,9 @@ bool Selector::init(ulong _cp){
 #else
 	cassert(d.efd < 0);
 	d.efd = eventfd(0, EFD_NONBLOCK);
+	//a raised position is queued at most once for every notification
+	//so the ring rarely overflows
+	d.sigring.reserve(_cp);
 	//register the pipes onto epoll
 	epoll_event ev;
 	ev.data.u64 = 0;
@@ -241,7 +357,6 @@ bool Selector::init(ulong _cp){
 	doAddNewStub();
 	
 	d.ctimepos.set(0);
-	d.ntimepos = TimeSpec::maximum;
 	d.objsz = 1;
 	d.socksz = 1;
 	return true;
@@ -259,16 +374,65 @@ void Selector::raise(uint32 _pos){
 	write(d.pipefds[1], &_pos, sizeof(uint32));
 #else
 	idbgx(Debug::aio, "signal connection evnt: "<<_pos<<" this "<<(void*)this);
-	uint64 v(1);
-	{
+	if(!d.sigring.push(_pos)){
 		Locker<Mutex> lock(d.m);
 		d.sigq.push(_pos);
+		d.sigovfl.store(true);
+	}
+	//only the first raise after the selector consumed the eventfd writes it
+	if(!d.sigwake.exchange(true, ATOMIC_NS::memory_order_acq_rel)){
+		uint64 v(1);
+		int rv = write(d.efd, &v, sizeof(v));
+		cassert(rv == sizeof(v));
+	}
+#endif
+}
+
+void Selector::raiseMany(const uint32 *_ppos, const size_t _cnt){
+#ifdef UPIPESIGNAL
+	//a write of at most PIPE_BUF bytes is atomic so the positions
+	//are never interleaved with the ones written by other threads
+	const size_t	chunkcp(PIPE_BUF / sizeof(uint32));
+	idbgx(Debug::aio, "signal "<<_cnt<<" connections pipe this "<<(void*)this);
+	size_t			cnt(_cnt);
+	while(cnt){
+		const size_t sz(cnt < chunkcp ? cnt : chunkcp);
+		write(d.pipefds[1], _ppos, sz * sizeof(uint32));
+		_ppos += sz;
+		cnt -= sz;
+	}
+#else
+	idbgx(Debug::aio, "signal "<<_cnt<<" connections evnt this "<<(void*)this);
+	size_t i(0);
+	while(i < _cnt && d.sigring.push(_ppos[i])){
+		++i;
+	}
+	if(i < _cnt){
+		Locker<Mutex> lock(d.m);
+		for(; i < _cnt; ++i){
+			d.sigq.push(_ppos[i]);
+		}
+		d.sigovfl.store(true);
+	}
+	if(_cnt && !d.sigwake.exchange(true, ATOMIC_NS::memory_order_acq_rel)){
+		uint64 v(1);
+		int rv = write(d.efd, &v, sizeof(v));
+		cassert(rv == sizeof(v));
 	}
-	int rv = write(d.efd, &v, sizeof(v));
-	cassert(rv == sizeof(v));
 #endif
 }
 
+void Selector::raiseLocal(uint32 _pos){
+	if(_pos == 0 || _pos == d.exepos || _pos >= d.stubs.size()){
+		//the executing object is taken care of by the wakeup path
+		raise(_pos);
+		return;
+	}
+	idbgx(Debug::aio, "signal connection local: "<<_pos<<" this "<<(void*)this);
+	ulong flags(0);
+	d.signal(_pos, flags);
+}
+
 ulong Selector::capacity()const{
 	return d.objcp;
 }
@@ -307,7 +471,7 @@ bool Selector::push(JobT &_objptr){
 	{
 		epoll_event ev;
 		ev.data.u64 = 0L;
-		ev.events = 0;
+		ev.events = d.persistent ? d.registerEvents(0) : 0;
 		
 		Object::SocketStub *psockstub = _objptr->pstubs;
 		for(uint i = 0; i < _objptr->stubcp; ++i, ++psockstub){
@@ -323,7 +487,7 @@ bool Selector::push(JobT &_objptr){
 				}else{
 					//success adding new
 					d.addNewSocket();
-					psock->doPrepare();
+					psock->doPrepare(d.zcthreshold, d.phspool);
 				}
 			}
 		}
@@ -339,19 +503,43 @@ bool Selector::push(JobT &_objptr){
 		stub.objptr->doPrepare(&stub.itimepos, &stub.otimepos);
 		vdbgx(Debug::aio, "pushing object "<<&(*(stub.objptr))<<" on position "<<stubpos);
 		stub.state = Stub::InExecQueue;
-		d.execq.push(stubpos);
+		d.pushExec(stubpos);
 	}
 	return true;
 }
 
+//! Execute the queued objects in priority order, within the class budgets
+/*!
+	Every class gets a single scan, so the objects rescheduled while
+	executing wait for the next loop, as do the ones left over when
+	the class runs out of budget.
+*/
 inline ulong Selector::doExecuteQueue(){
 	ulong		flags = 0;
-	ulong		qsz(d.execq.size());
-	while(qsz){//we only do a single scan:
-		const uint pos = d.execq.front();
-		d.execq.pop();
-		--qsz;
-		flags |= doExecute(pos);
+	for(uint i = 0; i < PriorityCount; ++i){
+		Data::Uint32QueueT	&rq(d.execq[i]);
+		ulong				qsz(rq.size());
+		if(d.budgetcnt[i] && qsz > d.budgetcnt[i]){
+			qsz = d.budgetcnt[i];
+		}
+		if(qsz && d.budgetusec[i]){
+			TimeSpec	endpos(TimeSpec::createMonotonic());
+			endpos.add(d.budgetusec[i] / 1000000, (d.budgetusec[i] % 1000000) * 1000);
+			while(qsz){
+				const uint pos = rq.front();
+				rq.pop();
+				--qsz;
+				flags |= doExecute(pos);
+				if(qsz && TimeSpec::createMonotonic() >= endpos) break;
+			}
+		}else{
+			while(qsz){
+				const uint pos = rq.front();
+				rq.pop();
+				--qsz;
+				flags |= doExecute(pos);
+			}
+		}
 	}
 	return flags;
 }
@@ -364,6 +552,8 @@ void Selector::run(){
 									//used to reduce the number of calls for the system time.
 	int 				pollwait = 0;
 	
+	doOpenMigration();
+	
 	do{
 		flags = 0;
 		if(nbcnt < 0){
@@ -381,24 +571,44 @@ void Selector::run(){
 			flags |= doReadPipe();
 		}
 		
-		if(d.ctimepos >= d.ntimepos || (flags & Data::FULL_SCAN)){
+		if(d.timewheel.empty() || d.currentTick() >= d.timewheel.nextTick()){
+			--nbcnt;
+			flags |= doTimeout();
+		}
+		
+		if(flags & Data::FULL_SCAN){
 			nbcnt -= 4;
 			flags |= doFullScan();
 		}
 		
-		if(d.execq.size()){
-			nbcnt -= d.execq.size();
+		if(d.migflag.load(ATOMIC_NS::memory_order_relaxed)){
+			--nbcnt;
+			doAdoptMigrated();
+		}
+		
+		if(d.execSize()){
+			nbcnt -= d.execSize();
 			flags |= doExecuteQueue();
 		}
 		
+		//the objects pushed locally while executing are executed on the next loop
+		if(d.locvec.size()){
+			--nbcnt;
+			doPushLocal();
+		}
+		
+		if(d.balmsec && d.ctimepos >= d.balnext){
+			doBalance();
+		}
+		
 		if(empty()) flags |= Data::EXIT_LOOP;
 		
-		if(flags || d.execq.size()){
+		if(flags || d.execSize()){
 			pollwait = 0;
 			--nbcnt;
 		}else{
 			pollwait = d.computeWaitTimeout();
-			vdbgx(Debug::aio, "pollwait "<<pollwait<<" ntimepos.s = "<<d.ntimepos.seconds()<<" ntimepos.ns = "<<d.ntimepos.nanoSeconds());
+			vdbgx(Debug::aio, "pollwait "<<pollwait<<" nexttick = "<<d.timewheel.nextTick()<<" timers = "<<d.timewheel.size());
 			vdbgx(Debug::aio, "ctimepos.s = "<<d.ctimepos.seconds()<<" ctimepos.ns = "<<d.ctimepos.nanoSeconds());
 			nbcnt = -1;
         }
@@ -407,6 +617,196 @@ void Selector::run(){
 		vdbgx(Debug::aio, "epollwait = "<<d.selcnt);
 		if(d.selcnt < 0) d.selcnt = 0;
 	}while(!(flags & Data::EXIT_LOOP));
+	
+	doCloseMigration();
+}
+
+//-------------------------------------------------------------
+//! Accept objects from other selectors while the loop runs
+void Selector::doOpenMigration(){
+	Locker<Mutex>	lock(d.migmtx);
+	d.migroom = d.objcp - d.objsz;
+	d.balmsec = balancePeriod();
+	for(uint i = 0; i < PriorityCount; ++i){
+		d.budgetcnt[i] = budgetCount(static_cast<PriorityE>(i));
+		d.budgetusec[i] = budgetTime(static_cast<PriorityE>(i));
+	}
+	if(d.balmsec){
+		d.balpos.currentMonotonic();
+		d.balnext = d.balpos;
+		d.balnext += d.balmsec;
+		d.balbusy = 0;
+	}
+}
+//! Stop accepting objects and take the ones already migrated here
+/*!
+	They are executed when the loop is run again.
+*/
+void Selector::doCloseMigration(){
+	{
+		Locker<Mutex>	lock(d.migmtx);
+		d.migroom = 0;
+	}
+	doAdoptMigrated();
+	doPushLocal();
+}
+void Selector::doAdoptMigrated(){
+	Data::MigrateVectorT	migvec;
+	{
+		Locker<Mutex>	lock(d.migmtx);
+		migvec.swap(d.migvec);
+		d.migflag.store(false);
+		if(d.migroom){
+			//the objects closed meanwhile make room
+			d.migroom = d.objcp - d.objsz - migvec.size() - d.locvec.size();
+		}
+	}
+	for(Data::MigrateVectorT::iterator it(migvec.begin()); it != migvec.end(); ++it){
+		doAdopt(*it);
+	}
+}
+bool Selector::pushLocal(JobT &_objptr){
+	{
+		//the objects pushed locally take the room of the migrated ones
+		Locker<Mutex>	lock(d.migmtx);
+		if(!d.migroom) return false;
+		--d.migroom;
+	}
+	d.locvec.push_back(_objptr);
+	return true;
+}
+//! Register the objects pushed locally, outside of any object execution
+void Selector::doPushLocal(){
+	Data::ObjectVectorT		locvec;
+	locvec.swap(d.locvec);
+	for(Data::ObjectVectorT::iterator it(locvec.begin()); it != locvec.end(); ++it){
+		if(!push(*it)){
+			edbgx(Debug::aio, "failed pushing local object "<<&(**it));
+		}
+	}
+}
+//! Called with the migration mutex of the destination selector locked
+void Selector::doDetach(const ulong _pos, MigrateStub &_rms){
+	Stub				&stub(d.stubs[_pos]);
+	Object::SocketStub	*psockstub = stub.objptr->pstubs;
+	for(uint i = 0; i < stub.objptr->stubcp; ++i, ++psockstub){
+		Socket *psock = psockstub->psock;
+		if(psock && psock->descriptor() >= 0){
+			//the socket keeps its state and its io requests (selevents)
+			check_call(Debug::aio, 0, epoll_ctl(d.epollfd, EPOLL_CTL_DEL, psock->descriptor(), NULL));
+			--d.socksz;
+		}
+	}
+	_rms.timepos = stub.timepos;
+	_rms.itimepos = stub.itimepos;
+	_rms.otimepos = stub.otimepos;
+	stub.objptr->doUnprepare();
+	_rms.objptr = stub.objptr;
+	d.timewheel.cancel(_pos);
+	stub.reset();
+	d.freestubsstk.push(_pos);
+	--d.objsz;
+}
+void Selector::doAdopt(MigrateStub &_rms){
+	const uint	stubpos = doAddNewStub();
+	Stub		&stub = d.stubs[stubpos];
+	
+	this->setObjectThread(*_rms.objptr, stubpos);
+	
+	stub.timepos  = _rms.timepos;
+	stub.itimepos = _rms.itimepos;
+	stub.otimepos = _rms.otimepos;
+	
+	epoll_event ev;
+	Object::SocketStub *psockstub = _rms.objptr->pstubs;
+	for(uint i = 0; i < _rms.objptr->stubcp; ++i, ++psockstub){
+		Socket *psock = psockstub->psock;
+		if(psock && psock->descriptor() >= 0){
+			//epoll reports the current readiness of an added descriptor
+			//so no edge is lost while the object was in transit
+			ev.events = d.registerEvents(psockstub->selevents);
+			if(epoll_ctl(d.epollfd, EPOLL_CTL_ADD, psock->descriptor(), d.eventPrepare(ev, stubpos, i))){
+				edbgx(Debug::aio, "epoll_ctl adding filedesc "<<psock->descriptor()<<" stubpos = "<<stubpos<<" pos = "<<i<<" err = "<<strerror(errno));
+				_rms.objptr->socketPostEvents(i, EventDoneError);
+				stub.events |= EventDoneError;
+			}else{
+				d.addNewSocket();
+			}
+		}
+	}
+	++d.objsz;
+	stub.objptr = _rms.objptr;
+	stub.objptr->doPrepare(&stub.itimepos, &stub.otimepos);
+	vdbgx(Debug::aio, "adopting object "<<&(*(stub.objptr))<<" on position "<<stubpos);
+	//a raise might have reached the previous selector while the object was in transit
+	if(stub.objptr->isRaised()){
+		stub.events |= EventSignal;
+	}
+	if(stub.events){
+		stub.state = Stub::InExecQueue;
+		d.pushExec(stubpos);
+	}else{
+		doScheduleTimer(stubpos);
+	}
+}
+/*virtual*/ bool Selector::migrate(SelectorBase &_rs){
+	Selector		&rs(static_cast<Selector&>(_rs));
+	//the gap between the selectors, in nanoseconds of execution
+	const uint64	gap((load() - rs.load()) * d.balperiod / 1000);
+	ulong			pos(0);
+	for(ulong i(1); i < d.stubs.size(); ++i){
+		const Stub &rstub(d.stubs[i]);
+		//moving an object narrows the gap only if it takes at most half of it
+		if(
+			!rstub.objptr.empty() && rstub.state == Stub::OutExecQueue &&
+			rstub.exetime && 2 * rstub.exetime <= gap && (
+				!pos || rstub.exetime > d.stubs[pos].exetime ||
+				(rstub.exetime == d.stubs[pos].exetime && rstub.execnt > d.stubs[pos].execnt)
+			)
+		){
+			pos = i;
+		}
+	}
+	if(!pos) return false;
+	
+	const ulong	share(d.stubs[pos].exetime * 1000 / d.balperiod);
+	{
+		Locker<Mutex>	lock(rs.d.migmtx);
+		if(!rs.d.migroom) return false;
+		--rs.d.migroom;
+		rs.d.migvec.push_back(MigrateStub());
+		doDetach(pos, rs.d.migvec.back());
+		rs.d.migflag.store(true);
+	}
+	idbgx(Debug::aio, "migrated object from "<<pos<<" share "<<share<<" to selector "<<rs.id());
+	//so that other selectors do not choose the same destination in this period
+	rs.load(rs.load() + share);
+	load(load() - share);
+	rs.raise(Data::WakePos);
+	return true;
+}
+//! Publish the load for the ending period and maybe move an object away
+void Selector::doBalance(){
+	TimeSpec	ts(d.ctimepos);
+	ts -= d.balpos;
+	d.balperiod = ts.seconds() * 1000000000ULL + ts.nanoSeconds();
+	if(d.balperiod){
+		ulong ld(d.balbusy * 1000 / d.balperiod);
+		if(ld > 1000) ld = 1000;
+		load(ld);
+		vdbgx(Debug::aio, "selector "<<id()<<" load = "<<ld<<" objects = "<<d.objsz);
+		if(ld >= balanceLoad()){
+			balance();
+		}
+	}
+	for(Data::StubVectorT::iterator it(d.stubs.begin()); it != d.stubs.end(); ++it){
+		it->exetime = 0;
+		it->execnt = 0;
+	}
+	d.balbusy = 0;
+	d.balpos = d.ctimepos;
+	d.balnext = d.ctimepos;
+	d.balnext += d.balmsec;
 }
 
 //-------------------------------------------------------------
@@ -424,10 +824,10 @@ ulong Selector::doReadPipe(){
 		for(int i = 0; i < BUFSZ; ++i){
 			uint pos(buf[i]);
 			if(pos){
-				if(pos < d.stubs.size() && !(pstub = &d.stubs[pos])->objptr.empty() && pstub->objptr->notified(S_RAISE)){
+				if(pos < d.stubs.size() && !(pstub = &d.stubs[pos])->objptr.empty() && pstub->objptr->isRaised()){
 					pstub->events |= EventSignal;
 					if(pstub->state == Stub::OutExecQueue){
-						d.execq.push(pos);
+						d.pushExec(pos);
 						pstub->state = Stub::InExecQueue;
 					}
 				}
@@ -439,10 +839,10 @@ ulong Selector::doReadPipe(){
 		for(int i = 0; i < rsz; ++i){	
 			uint pos(buf[i]);
 			if(pos){
-				if(pos < d.stubs.size() && !(pstub = &d.stubs[pos])->objptr.empty() && pstub->objptr->notified(S_RAISE)){
+				if(pos < d.stubs.size() && !(pstub = &d.stubs[pos])->objptr.empty() && pstub->objptr->isRaised()){
 					pstub->events |= EventSignal;
 					if(pstub->state == Stub::OutExecQueue){
-						d.execq.push(pos);
+						d.pushExec(pos);
 						pstub->state = Stub::InExecQueue;
 					}
 				}
@@ -458,52 +858,32 @@ ulong Selector::doReadPipe(){
 	return rv;
 #else
 	//using eventfd
-	int		rv = 0;
-	uint64	v = 0;
-	bool mustempty = false;
-	Stub		*pstub(NULL);
+	ulong	rv(0);
+	uint64	v(0);
+	uint32	pos;
+	size_t	limiter(d.sigring.capacity());
 	
-	while(read(d.efd, &v, sizeof(v)) == sizeof(v)){
-		Locker<Mutex> lock(d.m);
-		uint	limiter = 16;
-		while(d.sigq.size() && --limiter){
-			uint pos(d.sigq.front());
-			d.sigq.pop();
-			if(pos){
-				idbgx(Debug::aio, "signaling object on pos "<<pos);
-				if(pos < d.stubs.size() && (pstub = &d.stubs[pos])->objptr && pstub->objptr->signaled(S_RAISE)){
-					idbgx(Debug::aio, "signaled object on pos "<<pos);
-					pstub->events |= EventSignal;
-					if(pstub->state == Stub::OutExecQueue){
-						d.execq.push(pos);
-						pstub->state = Stub::InExecQueue;
-					}
-				}
-			}else rv = Data::EXIT_LOOP;
-		}
-		if(limiter == 0){
-			//d.sigq.size() != 0
-			mustempty = true;
-		}else{
-			mustempty = false;
-		}
+	read(d.efd, &v, sizeof(v));
+	//from now on, raise must write the eventfd again
+	d.sigwake.exchange(false, ATOMIC_NS::memory_order_acq_rel);
+	
+	while(limiter && d.sigring.pop(pos)){
+		--limiter;
+		d.signal(pos, rv);
 	}
-	if(mustempty){
+	if(d.sigovfl.load()){
 		Locker<Mutex> lock(d.m);
+		d.sigovfl.store(false);
 		while(d.sigq.size()){
-			uint pos(d.sigq.front());
+			d.signal(d.sigq.front(), rv);
 			d.sigq.pop();
-			if(pos){
-				if(pos < d.stubs.size() && (pstub = &d.stubs[pos])->objptr && pstub->objptr->signaled(S_RAISE)){
-					pstub->events |= EventSignal;
-					if(pstub->state == Stub::OutExecQueue){
-						d.execq.push(pos);
-						pstub->state = Stub::InExecQueue;
-					}
-				}
-			}else rv = Data::EXIT_LOOP;
 		}
 	}
+	if(!limiter && !d.sigwake.exchange(true, ATOMIC_NS::memory_order_acq_rel)){
+		//the raisers outrun us - come back on the next loop
+		v = 1;
+		write(d.efd, &v, sizeof(v));
+	}
 	return rv;
 #endif
 }
@@ -524,6 +904,16 @@ void Selector::doUnregisterObject(Object &_robj, int _lastfailpos){
 }
 
 inline ulong Selector::doIo(Socket &_rsock, ulong _evs, ulong){
+	ulong rv = 0;
+	if((_evs & EPOLLERR) && _rsock.isZeroCopy()){
+		//most likely MSG_ZEROCOPY completions on the error queue
+		rv = _rsock.doZeroCopyCompletions();
+		if(rv & EventDoneError){
+			_rsock.doClear();
+			return EventDoneError;
+		}
+		_evs &= ~EPOLLERR;
+	}
 	if(_evs & (EPOLLERR | EPOLLHUP)){
 		_rsock.doClear();
 		int err(0);
@@ -535,9 +925,8 @@ inline ulong Selector::doIo(Socket &_rsock, ulong _evs, ulong){
 			return EventDoneError;
 		}//else ignore spurious EPOLLHUP for just created sockets
 	}
-	ulong rv = 0;
 	if(_evs & EPOLLIN){
-		rv = _rsock.doRecv();
+		rv |= _rsock.doRecv();
 	}
 	if(!(rv & EventDoneError) && (_evs & EPOLLOUT)){
 		rv |= _rsock.doSend();
@@ -565,10 +954,14 @@ ulong Selector::doAllIo(){
 			cassert(stub.objptr->pstubs[sockpos].psock);
 			
 			vdbgx(Debug::aio, "io events stubpos = "<<stubpos<<" events = "<<d.events[i].events);
-			evs = doIo(sock, d.events[i].events);
-			{
+			if(d.persistent){
+				//only the directions the socket waits for - see Data::registerEvents
+				evs = d.events[i].events & (sockstub.psock->ioRequest() | EPOLLERR | EPOLLHUP);
+				evs = evs ? doIo(sock, evs) : 0;
+			}else{
+				evs = doIo(sock, d.events[i].events);
 				const uint t = sockstub.psock->ioRequest();
-				if((sockstub.selevents & Data::EPOLLMASK) != t){
+				if((sockstub.selevents & Data::EPOLLMASK) != (t & Data::EPOLLMASK)){
 					sockstub.selevents = t;
 					
 					epoll_event ev;
@@ -584,7 +977,7 @@ ulong Selector::doAllIo(){
 				stub.events |= evs;
 				//push channel execqueue
 				if(stub.state == Stub::OutExecQueue){
-					d.execq.push(stubpos);
+					d.pushExec(stubpos);
 					stub.state = Stub::InExecQueue;
 				}
 			}
@@ -594,39 +987,74 @@ ulong Selector::doAllIo(){
 	}
 	return flags;
 }
-void Selector::doFullScanCheck(Stub &_rstub, const ulong _pos){
-	ulong	evs = 0;
-	if(d.ctimepos >= _rstub.itimepos){
-		evs |= _rstub.objptr->doOnTimeoutRecv(d.ctimepos);
-		if(d.ntimepos > _rstub.itimepos){
-			d.ntimepos = _rstub.itimepos;
-		}
-	}else if(d.ntimepos > _rstub.itimepos){
-		d.ntimepos = _rstub.itimepos;
+struct Selector::TimerHandler{
+	TimerHandler(Selector &_rs):rs(_rs){}
+	void operator()(const size_t _pos){
+		rs.doTimeoutCheck(_pos);
 	}
+	Selector	&rs;
+};
+
+void Selector::doTimeoutCheck(const ulong _pos){
+	Stub	&stub(d.stubs[_pos]);
+	ulong	evs = 0;
 	
-	if(d.ctimepos >= _rstub.otimepos){
-		evs |= _rstub.objptr->doOnTimeoutSend(d.ctimepos);
-		if(d.ntimepos > _rstub.otimepos){
-			d.ntimepos = _rstub.otimepos;
-		}
-	}else if(d.ntimepos > _rstub.otimepos){
-		d.ntimepos = _rstub.otimepos;
-	}
+	if(stub.objptr.empty()) return;
 	
-	if(d.ctimepos >= _rstub.timepos){
+	if(d.ctimepos >= stub.itimepos){
+		evs |= stub.objptr->doOnTimeoutRecv(d.ctimepos);
+	}
+	if(d.ctimepos >= stub.otimepos){
+		evs |= stub.objptr->doOnTimeoutSend(d.ctimepos);
+	}
+	if(d.ctimepos >= stub.timepos){
 		evs |= EventTimeout;
-	}else if(d.ntimepos > _rstub.timepos){
-		d.ntimepos = _rstub.timepos;
 	}
+	if(evs){
+		stub.events |= evs;
+		if(stub.state == Stub::OutExecQueue){
+			d.pushExec(_pos);
+			stub.state = Stub::InExecQueue;
+		}
+	}
+	if(stub.state == Stub::OutExecQueue){
+		//a stale timer or the sockets have further timeouts
+		//objects in the execq are rescheduled after execution
+		doScheduleTimer(_pos);
+	}
+}
+
+void Selector::doScheduleTimer(const ulong _pos){
+	const Stub		&stub(d.stubs[_pos]);
+	const TimeSpec	*pts(&stub.timepos);
 	
-	if(_rstub.objptr->notified(S_RAISE)){
-		evs |= EventSignal;//should not be checked by objs
+	if(stub.itimepos < *pts){
+		pts = &stub.itimepos;
 	}
-	if(evs){
-		_rstub.events |= evs;
+	if(stub.otimepos < *pts){
+		pts = &stub.otimepos;
+	}
+	if(pts->isMax()){
+		d.timewheel.cancel(_pos);
+	}else{
+		d.timewheel.schedule(_pos, Data::tick(*pts));
+	}
+}
+
+ulong Selector::doTimeout(){
+	TimerHandler	th(*this);
+	const size_t	cnt(d.timewheel.advance(d.currentTick(), th));
+	if(cnt){
+		vdbgx(Debug::aio, "timeout count "<<cnt);
+	}
+	return 0;
+}
+
+void Selector::doFullScanCheck(Stub &_rstub, const ulong _pos){
+	if(_rstub.objptr->notified(S_RAISE)){
+		_rstub.events |= EventSignal;//should not be checked by objs
 		if(_rstub.state == Stub::OutExecQueue){
-			d.execq.push(_pos);
+			d.pushExec(_pos);
 			_rstub.state = Stub::InExecQueue;
 		}
 	}
@@ -634,7 +1062,6 @@ void Selector::doFullScanCheck(Stub &_rstub, const ulong _pos){
 ulong Selector::doFullScan(){
 	++d.rep_fullscancount;
 	idbgx(Debug::aio, "fullscan count "<<d.rep_fullscancount);
-	d.ntimepos = TimeSpec::maximum;
 	for(Data::StubVectorT::iterator it(d.stubs.begin()); it != d.stubs.end(); it += 4){
 		if(!it->objptr.empty()){
 			doFullScanCheck(*it, it - d.stubs.begin());
@@ -658,22 +1085,45 @@ ulong Selector::doExecute(const ulong _pos){
 	stub.state = Stub::OutExecQueue;
 	
 	ulong						rv(0);
+	stub.objptr->doClearRequests();//clears the requests from object to selector
+	if(stub.objptr->hscnt){
+		stub.events |= stub.objptr->doHandshakeEvents();
+		if(stub.events == EventSignal && !stub.objptr->notified(~static_cast<size_t>(S_RAISE))){
+			//raised by the HandshakePool for a step which did not end the hand-shake
+			stub.events = 0;
+			doPrepareObjectWait(_pos, stub.timepos);
+			return 0;
+		}
+	}
+	
 	Object::ExecuteController	exectl(stub.events, d.ctimepos);
 	
 	stub.timepos = TimeSpec::maximum;
 	
 	stub.events = 0;
-	stub.objptr->doClearRequests();//clears the requests from object to selector
 	
 	idbgx(Debug::aio, "execute object "<<_pos);
 	
 	this->associateObjectToCurrentThread(*stub.objptr);
 	
-	this->executeObject(*stub.objptr, exectl);
+	d.exepos = _pos;
+	if(d.balmsec){
+		TimeSpec	ts(TimeSpec::createMonotonic());
+		this->executeObject(*stub.objptr, exectl);
+		TimeSpec	te(TimeSpec::createMonotonic());
+		te -= ts;
+		const uint64	ns(te.seconds() * 1000000000ULL + te.nanoSeconds());
+		stub.exetime += ns;
+		++stub.execnt;
+		d.balbusy += ns;
+	}else{
+		this->executeObject(*stub.objptr, exectl);
+	}
+	d.exepos = 0;
 	
 	switch(exectl.returnValue()){
 		case Object::ExecuteContext::RescheduleRequest:
-			d.execq.push(_pos);
+			d.pushExec(_pos);
 			stub.state = Stub::InExecQueue;
 			stub.events |= EventReschedule;
 		case Object::ExecuteContext::WaitRequest:
@@ -690,18 +1140,21 @@ ulong Selector::doExecute(const ulong _pos){
 			//stub.objptr->doUnprepare();
 			this->stopObject(*stub.objptr);
 			stub.objptr.clear();
-			stub.timepos = TimeSpec::maximum;
+			stub.reset();
+			d.timewheel.cancel(_pos);
 			--d.objsz;
 			rv = Data::EXIT_LOOP;
 			break;
 		case Object::ExecuteContext::LeaveRequest:
 			d.freestubsstk.push(_pos);
 			doUnregisterObject(*stub.objptr);
-			stub.timepos = TimeSpec::maximum;
+			stub.reset();
+			d.timewheel.cancel(_pos);
 			--d.objsz;
 			stub.objptr->doUnprepare();
 			stub.objptr.release();
 			rv = Data::EXIT_LOOP;
+			break;
 		default:
 			cassert(false);
 	}
@@ -720,7 +1173,7 @@ void Selector::doPrepareObjectWait(const size_t _pos, const TimeSpec &_timepos){
 			case Object::SocketStub::IORequest:{
 				uint t = sockstub.psock->ioRequest();
 				vdbgx(Debug::aio, "sockstub "<<*pit<<" ioreq "<<t);
-				if((sockstub.selevents & Data::EPOLLMASK) != t){
+				if(!d.persistent && (sockstub.selevents & Data::EPOLLMASK) != (t & Data::EPOLLMASK)){
 					vdbgx(Debug::aio, "sockstub "<<*pit);
 					epoll_event ev;
 					sockstub.selevents = t;
@@ -736,9 +1189,9 @@ void Selector::doPrepareObjectWait(const size_t _pos, const TimeSpec &_timepos){
 					EPOLLET on them.
 				*/
 				epoll_event ev;
-				sockstub.psock->doPrepare();
+				sockstub.psock->doPrepare(d.zcthreshold, d.phspool);
 				sockstub.selevents = 0;
-				ev.events =  EPOLLERR | EPOLLHUP | EPOLLET;
+				ev.events = d.registerEvents(0);
 				check_call(Debug::aio, 0, epoll_ctl(d.epollfd, EPOLL_CTL_ADD, sockstub.psock->descriptor(), d.eventPrepare(ev, _pos, *pit)));
 				stub.objptr->socketPostEvents(*pit, EventDoneSuccess);
 				d.addNewSocket();
@@ -766,19 +1219,10 @@ void Selector::doPrepareObjectWait(const size_t _pos, const TimeSpec &_timepos){
 		
 		if(stub.timepos == d.ctimepos){
 			stub.timepos = TimeSpec::maximum;
-		}else if(d.ntimepos > stub.timepos){
-			d.ntimepos = stub.timepos;
-		}
-		
-		if(d.ntimepos > stub.itimepos){
-			d.ntimepos = stub.itimepos;
 		}
-		if(d.ntimepos > stub.otimepos){
-			d.ntimepos = stub.otimepos;
-		}
-		
+		doScheduleTimer(_pos);
 	}else if(stub.state != Stub::InExecQueue){
-		d.execq.push(_pos);
+		d.pushExec(_pos);
 		stub.state = Stub::InExecQueue;
 	}
 }
@@ -797,6 +1241,7 @@ ulong Selector::doAddNewStub(){
 			d.stubs.push_back(Stub());
 			d.freestubsstk.push(i);
 		}
+		d.timewheel.reserve(d.stubs.size());
 		if(cp != d.stubs.capacity()){
 			//we need to reset the aioobject's pointer to timepos
 			for(Data::StubVectorT::iterator it(d.stubs.begin()); it != d.stubs.end(); it += 4){
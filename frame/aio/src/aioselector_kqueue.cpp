@@ -25,13 +25,16 @@
 #include <vector>
 #include <cerrno>
 #include <cstring>
+#include <climits>
 
 #include "system/debug.hpp"
 #include "system/timespec.hpp"
 #include "system/mutex.hpp"
+#include "system/atomic.hpp"
 
 #include "utility/queue.hpp"
 #include "utility/stack.hpp"
+#include "utility/timerwheel.hpp"
 
 #include "frame/object.hpp"
 #include "frame/common.hpp"
@@ -61,12 +64,14 @@ struct Selector::Stub{
 		itimepos(TimeSpec::maximum),
 		otimepos(TimeSpec::maximum),
 		state(OutExecQueue),
-		events(0){
+		events(0), exetime(0), execnt(0){
 	}
 	void reset(){
 		timepos = TimeSpec::maximum; 
 		state = OutExecQueue;
 		events = 0;
+		exetime = 0;
+		execnt = 0;
 	}
 	ObjectPointerT	objptr;
 	TimeSpec		timepos;//object timepos
@@ -74,6 +79,16 @@ struct Selector::Stub{
 	TimeSpec		otimepos;//output timepos
 	State			state;
 	uint			events;
+	uint64			exetime;//nanoseconds spent executing in the balancing period
+	uint32			execnt;//executions in the balancing period
+};
+
+//! An object in transit between two selectors
+struct Selector::MigrateStub{
+	ObjectPointerT	objptr;
+	TimeSpec		timepos;
+	TimeSpec		itimepos;
+	TimeSpec		otimepos;
 };
 
 struct Selector::Data{
@@ -91,6 +106,11 @@ struct Selector::Data{
 	typedef std::vector<Stub>			StubVectorT;
 	typedef std::pair<uint32, uint32>	Uint32PairT;
 	typedef std::vector<Uint32PairT>	Uint32PairVectorT;
+	typedef std::vector<MigrateStub>	MigrateVectorT;
+	typedef std::vector<ObjectPointerT>	ObjectVectorT;
+	typedef ATOMIC_NS::atomic<bool>		AtomicBoolT;
+	//raised only to wake up the selector - it is not a valid position
+	static const uint32					WakePos = 0xffffffff;
 	
 	ulong				objcp;
 	ulong				objsz;
@@ -100,7 +120,7 @@ struct Selector::Data{
 	int					kqfd;
 	struct kevent 		events[MAX_EVENTS_COUNT];
 	StubVectorT			stubs;
-	Uint32QueueT		execq;
+	Uint32QueueT		execq[PriorityCount];//one execution queue per priority class
 	Uint32StackT		freestubsstk;
 #ifdef UPIPESIGNAL
 	int					pipefds[2];
@@ -110,8 +130,22 @@ struct Selector::Data{
 	Uint32QueueT		sigq;//a signal queue
 	uint64				efdv;//the eventfd value
 #endif
-	TimeSpec			ntimepos;//next timepos == next timeout
+	TimerWheel			timewheel;//one timer per stub - the nearest of its timeouts
 	TimeSpec			ctimepos;//current time pos
+	uint32				exepos;//the position of the executing object, 0 if none
+	Mutex				migmtx;
+	MigrateVectorT		migvec;//objects migrated here by other selectors
+	ulong				migroom;//how many objects can still be migrated here
+	AtomicBoolT			migflag;//migvec is not empty
+	ObjectVectorT		locvec;//objects pushed from the selector thread, registered by the loop
+	ulong				balmsec;//the balancing period, 0 if not balancing
+	TimeSpec			balpos;//the start of the balancing period
+	TimeSpec			balnext;//the end of the balancing period
+	uint64				balperiod;//the length in nanoseconds of the last balancing period
+	uint64				balbusy;//nanoseconds spent executing objects in the balancing period
+	ulong				budgetcnt[PriorityCount];//objects executed per loop, 0 for no limit
+	ulong				budgetusec[PriorityCount];//microseconds executing per loop, 0 for no limit
+	HandshakePool		*phspool;//the pool doing the secure hand-shakes, NULL for none
 	
 //reporting data:
 	uint				rep_fullscancount;
@@ -120,7 +154,11 @@ struct Selector::Data{
 public://methods:
 	Data();
 	~Data();
+	void pushExec(const uint32 _pos);
+	size_t execSize()const;
 	TimeSpec* computeWaitTimeout(TimeSpec &_rts)const;
+	uint64 currentTick()const;
+	static uint64 tick(const TimeSpec &_rts);
 	void addNewSocket();
 	void* eventPrepare(const uint32 _objpos, const uint32 _sockpos);
 	void stub(uint32 &_objpos, uint32 &_sockpos, const struct kevent &_ev);
@@ -128,7 +166,12 @@ public://methods:
 //-------------------------------------------------------------
 Selector::Data::Data():
 	objcp(0), objsz(0), /*sockcp(0),*/ socksz(0), selcnt(0), kqfd(-1),
-	rep_fullscancount(0){
+	exepos(0), migroom(0), balmsec(0), balperiod(0), balbusy(0), phspool(NULL), rep_fullscancount(0){
+	for(uint i = 0; i < PriorityCount; ++i){
+		budgetcnt[i] = 0;
+		budgetusec[i] = 0;
+	}
+	migflag.store(false);
 #ifdef UPIPESIGNAL
 	pipefds[0] = -1;
 	pipefds[1] = -1;
@@ -155,13 +198,37 @@ Selector::Data::~Data(){
 }
 
 TimeSpec* Selector::Data::computeWaitTimeout(TimeSpec &_rts)const{
-	if(ntimepos.isMax()){
+	const uint64	nexttick(timewheel.nextTick());
+	if(nexttick == TimerWheel::invalidTick()){
 		return NULL;//return MAXPOLLWAIT;
 	}
-	_rts = ntimepos;
-	_rts -= ctimepos;
+	const uint64	crttick(currentTick());
+	if(nexttick <= crttick){
+		_rts.set(0, 0);
+	}else{
+		_rts.set((nexttick - crttick) / 1000, ((nexttick - crttick) % 1000) * 1000000);
+	}
 	return &_rts;
 }
+//! Queue the object on _pos for execution, in the queue of its priority class
+inline void Selector::Data::pushExec(const uint32 _pos){
+	execq[stubs[_pos].objptr->priority()].push(_pos);
+}
+inline size_t Selector::Data::execSize()const{
+	size_t sz(0);
+	for(uint i = 0; i < PriorityCount; ++i){
+		sz += execq[i].size();
+	}
+	return sz;
+}
+//! The current time in milliseconds, rounded down
+inline uint64 Selector::Data::currentTick()const{
+	return ctimepos.seconds() * 1000ULL + ctimepos.nanoSeconds() / 1000000;
+}
+//! A timeout in milliseconds, rounded up so that ctimepos >= _rts when it fires
+/*static*/ inline uint64 Selector::Data::tick(const TimeSpec &_rts){
+	return _rts.seconds() * 1000ULL + (_rts.nanoSeconds() + 999999) / 1000000;
+}
 void Selector::Data::addNewSocket(){
 	++socksz;
 }
@@ -228,6 +295,7 @@ bool Selector::init(ulong _cp){
 	idbgx(Debug::aio, "aio::Selector "<<(void*)this);
 	cassert(_cp);
 	d.objcp = _cp;
+	d.phspool = handshakePool();
 	//d.sockcp = _cp;
 	
 	setCurrentTimeSpecific(d.ctimepos);
@@ -287,7 +355,6 @@ bool Selector::init(ulong _cp){
 	doAddNewStub();
 	
 	d.ctimepos.set(0);
-	d.ntimepos = TimeSpec::maximum;
 	d.objsz = 1;
 	d.socksz = 1;
 	return true;
@@ -315,6 +382,51 @@ void Selector::raise(uint32 _pos){
 #endif
 }
 
+void Selector::raiseMany(const uint32 *_ppos, const size_t _cnt){
+#ifdef UPIPESIGNAL
+	//a write of at most PIPE_BUF bytes is atomic so the positions
+	//are never interleaved with the ones written by other threads
+	const size_t	chunkcp(PIPE_BUF / sizeof(uint32));
+	idbgx(Debug::aio, "signal "<<_cnt<<" connections pipe this "<<(void*)this);
+	size_t			cnt(_cnt);
+	while(cnt){
+		const size_t sz(cnt < chunkcp ? cnt : chunkcp);
+		write(d.pipefds[1], _ppos, sz * sizeof(uint32));
+		_ppos += sz;
+		cnt -= sz;
+	}
+#else
+	idbgx(Debug::aio, "signal "<<_cnt<<" connections evnt this "<<(void*)this);
+	if(!_cnt) return;
+	{
+		Locker<Mutex> lock(d.m);
+		for(size_t i = 0; i < _cnt; ++i){
+			d.sigq.push(_ppos[i]);
+		}
+	}
+	uint64 v(1);
+	int rv = write(d.efd, &v, sizeof(v));
+	cassert(rv == sizeof(v));
+#endif
+}
+
+void Selector::raiseLocal(uint32 _pos){
+	if(_pos == 0 || _pos == d.exepos || _pos >= d.stubs.size()){
+		//the executing object is taken care of by the wakeup path
+		raise(_pos);
+		return;
+	}
+	idbgx(Debug::aio, "signal connection local: "<<_pos<<" this "<<(void*)this);
+	Stub &rstub(d.stubs[_pos]);
+	if(!rstub.objptr.empty() && rstub.objptr->isRaised()){
+		rstub.events |= EventSignal;
+		if(rstub.state == Stub::OutExecQueue){
+			d.pushExec(_pos);
+			rstub.state = Stub::InExecQueue;
+		}
+	}
+}
+
 ulong Selector::capacity()const{
 	return d.objcp - 1;
 }
@@ -370,7 +482,7 @@ bool Selector::push(JobT &_objptr){
 				}else{
 					//success adding new
 					d.addNewSocket();
-					psock->doPrepare();
+					psock->doPrepare(0, d.phspool);
 				}
 			}
 		}
@@ -386,19 +498,43 @@ bool Selector::push(JobT &_objptr){
 		stub.objptr->doPrepare(&stub.itimepos, &stub.otimepos);
 		vdbgx(Debug::aio, "pushing object "<<&(*(stub.objptr))<<" on position "<<stubpos);
 		stub.state = Stub::InExecQueue;
-		d.execq.push(stubpos);
+		d.pushExec(stubpos);
 	}
 	return true;
 }
 
+//! Execute the queued objects in priority order, within the class budgets
+/*!
+	Every class gets a single scan, so the objects rescheduled while
+	executing wait for the next loop, as do the ones left over when
+	the class runs out of budget.
+*/
 inline ulong Selector::doExecuteQueue(){
 	ulong		flags = 0;
-	ulong		qsz(d.execq.size());
-	while(qsz){//we only do a single scan:
-		const uint pos = d.execq.front();
-		d.execq.pop();
-		--qsz;
-		flags |= doExecute(pos);
+	for(uint i = 0; i < PriorityCount; ++i){
+		Data::Uint32QueueT	&rq(d.execq[i]);
+		ulong				qsz(rq.size());
+		if(d.budgetcnt[i] && qsz > d.budgetcnt[i]){
+			qsz = d.budgetcnt[i];
+		}
+		if(qsz && d.budgetusec[i]){
+			TimeSpec	endpos(TimeSpec::createMonotonic());
+			endpos.add(d.budgetusec[i] / 1000000, (d.budgetusec[i] % 1000000) * 1000);
+			while(qsz){
+				const uint pos = rq.front();
+				rq.pop();
+				--qsz;
+				flags |= doExecute(pos);
+				if(qsz && TimeSpec::createMonotonic() >= endpos) break;
+			}
+		}else{
+			while(qsz){
+				const uint pos = rq.front();
+				rq.pop();
+				--qsz;
+				flags |= doExecute(pos);
+			}
+		}
 	}
 	return flags;
 }
@@ -409,6 +545,9 @@ void Selector::run(){
 	uint 				flags;
 	int					nbcnt = -1;	//non blocking opperations count,
 									//used to reduce the number of calls for the system time.
+	
+	doOpenMigration();
+	
 	do{
 		flags = 0;
 		if(nbcnt < 0){
@@ -426,26 +565,46 @@ void Selector::run(){
 			flags |= doReadPipe();
 		}
 		
-		if(d.ctimepos >= d.ntimepos || (flags & Data::FULL_SCAN)){
+		if(d.timewheel.empty() || d.currentTick() >= d.timewheel.nextTick()){
+			--nbcnt;
+			flags |= doTimeout();
+		}
+		
+		if(flags & Data::FULL_SCAN){
 			nbcnt -= 4;
 			flags |= doFullScan();
 		}
 		
-		if(d.execq.size()){
-			nbcnt -= d.execq.size();
+		if(d.migflag.load(ATOMIC_NS::memory_order_relaxed)){
+			--nbcnt;
+			doAdoptMigrated();
+		}
+		
+		if(d.execSize()){
+			nbcnt -= d.execSize();
 			flags |= doExecuteQueue();
 		}
 		
+		//the objects pushed locally while executing are executed on the next loop
+		if(d.locvec.size()){
+			--nbcnt;
+			doPushLocal();
+		}
+		
+		if(d.balmsec && d.ctimepos >= d.balnext){
+			doBalance();
+		}
+		
 		if(empty()) flags |= Data::EXIT_LOOP;
 		
 		TimeSpec ts(0, 0);
 		TimeSpec *pts(&ts);
 		
-		if(flags || d.execq.size()){
+		if(flags || d.execSize()){
 			--nbcnt;
 		}else{
 			pts = d.computeWaitTimeout(ts);
-			vdbgx(Debug::aio, "ntimepos.s = "<<d.ntimepos.seconds()<<" ntimepos.ns = "<<d.ntimepos.nanoSeconds());
+			vdbgx(Debug::aio, "nexttick = "<<d.timewheel.nextTick()<<" timers = "<<d.timewheel.size());
 			vdbgx(Debug::aio, "ctimepos.s = "<<d.ctimepos.seconds()<<" ctimepos.ns = "<<d.ctimepos.nanoSeconds());
 			nbcnt = -1;
         }
@@ -455,6 +614,204 @@ void Selector::run(){
 		vdbgx(Debug::aio, "kqueue = "<<d.selcnt);
 		if(d.selcnt < 0) d.selcnt = 0;
 	}while(!(flags & Data::EXIT_LOOP));
+	
+	doCloseMigration();
+}
+
+//-------------------------------------------------------------
+//! Accept objects from other selectors while the loop runs
+void Selector::doOpenMigration(){
+	Locker<Mutex>	lock(d.migmtx);
+	d.migroom = d.objcp - d.objsz;
+	d.balmsec = balancePeriod();
+	for(uint i = 0; i < PriorityCount; ++i){
+		d.budgetcnt[i] = budgetCount(static_cast<PriorityE>(i));
+		d.budgetusec[i] = budgetTime(static_cast<PriorityE>(i));
+	}
+	if(d.balmsec){
+		d.balpos.currentMonotonic();
+		d.balnext = d.balpos;
+		d.balnext += d.balmsec;
+		d.balbusy = 0;
+	}
+}
+//! Stop accepting objects and take the ones already migrated here
+/*!
+	They are executed when the loop is run again.
+*/
+void Selector::doCloseMigration(){
+	{
+		Locker<Mutex>	lock(d.migmtx);
+		d.migroom = 0;
+	}
+	doAdoptMigrated();
+	doPushLocal();
+}
+void Selector::doAdoptMigrated(){
+	Data::MigrateVectorT	migvec;
+	{
+		Locker<Mutex>	lock(d.migmtx);
+		migvec.swap(d.migvec);
+		d.migflag.store(false);
+		if(d.migroom){
+			//the objects closed meanwhile make room
+			d.migroom = d.objcp - d.objsz - migvec.size() - d.locvec.size();
+		}
+	}
+	for(Data::MigrateVectorT::iterator it(migvec.begin()); it != migvec.end(); ++it){
+		doAdopt(*it);
+	}
+}
+bool Selector::pushLocal(JobT &_objptr){
+	{
+		//the objects pushed locally take the room of the migrated ones
+		Locker<Mutex>	lock(d.migmtx);
+		if(!d.migroom) return false;
+		--d.migroom;
+	}
+	d.locvec.push_back(_objptr);
+	return true;
+}
+//! Register the objects pushed locally, outside of any object execution
+void Selector::doPushLocal(){
+	Data::ObjectVectorT		locvec;
+	locvec.swap(d.locvec);
+	for(Data::ObjectVectorT::iterator it(locvec.begin()); it != locvec.end(); ++it){
+		if(!push(*it)){
+			edbgx(Debug::aio, "failed pushing local object "<<&(**it));
+		}
+	}
+}
+//! Called with the migration mutex of the destination selector locked
+void Selector::doDetach(const ulong _pos, MigrateStub &_rms){
+	Stub				&stub(d.stubs[_pos]);
+	Object::SocketStub	*psockstub = stub.objptr->pstubs;
+	for(uint i = 0; i < stub.objptr->stubcp; ++i, ++psockstub){
+		Socket *psock = psockstub->psock;
+		if(psock && psock->descriptor() >= 0){
+			//the socket keeps its state and its io requests (selevents)
+			struct kevent	evr,evw;
+			EV_SET (&evr, psock->descriptor(), EVFILT_READ, EV_DELETE, 0, 0, NULL);
+			EV_SET (&evw, psock->descriptor(), EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+			check_call(Debug::aio, 0, kevent (d.kqfd, &evr, 1, NULL, 0, NULL));
+			check_call(Debug::aio, 0, kevent (d.kqfd, &evw, 1, NULL, 0, NULL));
+			--d.socksz;
+		}
+	}
+	_rms.timepos = stub.timepos;
+	_rms.itimepos = stub.itimepos;
+	_rms.otimepos = stub.otimepos;
+	stub.objptr->doUnprepare();
+	_rms.objptr = stub.objptr;
+	d.timewheel.cancel(_pos);
+	stub.reset();
+	d.freestubsstk.push(_pos);
+	--d.objsz;
+}
+void Selector::doAdopt(MigrateStub &_rms){
+	const uint	stubpos = doAddNewStub();
+	Stub		&stub = d.stubs[stubpos];
+	
+	this->setObjectThread(*_rms.objptr, stubpos);
+	
+	stub.timepos  = _rms.timepos;
+	stub.itimepos = _rms.itimepos;
+	stub.otimepos = _rms.otimepos;
+	
+	Object::SocketStub *psockstub = _rms.objptr->pstubs;
+	for(uint i = 0; i < _rms.objptr->stubcp; ++i, ++psockstub){
+		Socket *psock = psockstub->psock;
+		if(psock && psock->descriptor() >= 0){
+			//the filters are level triggered, so no event is lost while the object was in transit
+			struct kevent	evr,evw;
+			void 			*pv(d.eventPrepare(stubpos, i));
+			EV_SET (&evr, psock->descriptor(), EVFILT_READ, EV_ADD | ((psockstub->selevents & Data::EVENT_IN) ? EV_ENABLE : EV_DISABLE), 0, 0, pv);
+			EV_SET (&evw, psock->descriptor(), EVFILT_WRITE, EV_ADD | ((psockstub->selevents & Data::EVENT_OUT) ? EV_ENABLE : EV_DISABLE), 0, 0, pv);
+			if(
+				kevent (d.kqfd, &evr, 1, NULL, 0, NULL) ||
+				kevent (d.kqfd, &evw, 1, NULL, 0, NULL)
+			){
+				edbgx(Debug::aio, "kqueue adding filedesc "<<psock->descriptor()<<" stubpos = "<<stubpos<<" pos = "<<i<<" err = "<<strerror(errno));
+				_rms.objptr->socketPostEvents(i, EventDoneError);
+				stub.events |= EventDoneError;
+			}else{
+				d.addNewSocket();
+			}
+		}
+	}
+	++d.objsz;
+	stub.objptr = _rms.objptr;
+	stub.objptr->doPrepare(&stub.itimepos, &stub.otimepos);
+	vdbgx(Debug::aio, "adopting object "<<&(*(stub.objptr))<<" on position "<<stubpos);
+	//a raise might have reached the previous selector while the object was in transit
+	if(stub.objptr->isRaised()){
+		stub.events |= EventSignal;
+	}
+	if(stub.events){
+		stub.state = Stub::InExecQueue;
+		d.pushExec(stubpos);
+	}else{
+		doScheduleTimer(stubpos);
+	}
+}
+/*virtual*/ bool Selector::migrate(SelectorBase &_rs){
+	Selector		&rs(static_cast<Selector&>(_rs));
+	//the gap between the selectors, in nanoseconds of execution
+	const uint64	gap((load() - rs.load()) * d.balperiod / 1000);
+	ulong			pos(0);
+	for(ulong i(1); i < d.stubs.size(); ++i){
+		const Stub &rstub(d.stubs[i]);
+		//moving an object narrows the gap only if it takes at most half of it
+		if(
+			!rstub.objptr.empty() && rstub.state == Stub::OutExecQueue &&
+			rstub.exetime && 2 * rstub.exetime <= gap && (
+				!pos || rstub.exetime > d.stubs[pos].exetime ||
+				(rstub.exetime == d.stubs[pos].exetime && rstub.execnt > d.stubs[pos].execnt)
+			)
+		){
+			pos = i;
+		}
+	}
+	if(!pos) return false;
+	
+	const ulong	share(d.stubs[pos].exetime * 1000 / d.balperiod);
+	{
+		Locker<Mutex>	lock(rs.d.migmtx);
+		if(!rs.d.migroom) return false;
+		--rs.d.migroom;
+		rs.d.migvec.push_back(MigrateStub());
+		doDetach(pos, rs.d.migvec.back());
+		rs.d.migflag.store(true);
+	}
+	idbgx(Debug::aio, "migrated object from "<<pos<<" share "<<share<<" to selector "<<rs.id());
+	//so that other selectors do not choose the same destination in this period
+	rs.load(rs.load() + share);
+	load(load() - share);
+	rs.raise(Data::WakePos);
+	return true;
+}
+//! Publish the load for the ending period and maybe move an object away
+void Selector::doBalance(){
+	TimeSpec	ts(d.ctimepos);
+	ts -= d.balpos;
+	d.balperiod = ts.seconds() * 1000000000ULL + ts.nanoSeconds();
+	if(d.balperiod){
+		ulong ld(d.balbusy * 1000 / d.balperiod);
+		if(ld > 1000) ld = 1000;
+		load(ld);
+		vdbgx(Debug::aio, "selector "<<id()<<" load = "<<ld<<" objects = "<<d.objsz);
+		if(ld >= balanceLoad()){
+			balance();
+		}
+	}
+	for(Data::StubVectorT::iterator it(d.stubs.begin()); it != d.stubs.end(); ++it){
+		it->exetime = 0;
+		it->execnt = 0;
+	}
+	d.balbusy = 0;
+	d.balpos = d.ctimepos;
+	d.balnext = d.ctimepos;
+	d.balnext += d.balmsec;
 }
 
 //-------------------------------------------------------------
@@ -472,10 +829,10 @@ ulong Selector::doReadPipe(){
 		for(int i = 0; i < BUFSZ; ++i){
 			uint pos(buf[i]);
 			if(pos){
-				if(pos < d.stubs.size() && !(pstub = &d.stubs[pos])->objptr.empty() && pstub->objptr->notified(S_RAISE)){
+				if(pos < d.stubs.size() && !(pstub = &d.stubs[pos])->objptr.empty() && pstub->objptr->isRaised()){
 					pstub->events |= EventSignal;
 					if(pstub->state == Stub::OutExecQueue){
-						d.execq.push(pos);
+						d.pushExec(pos);
 						pstub->state = Stub::InExecQueue;
 					}
 				}
@@ -487,10 +844,10 @@ ulong Selector::doReadPipe(){
 		for(int i = 0; i < rsz; ++i){	
 			uint pos(buf[i]);
 			if(pos){
-				if(pos < d.stubs.size() && !(pstub = &d.stubs[pos])->objptr.empty() && pstub->objptr->notified(S_RAISE)){
+				if(pos < d.stubs.size() && !(pstub = &d.stubs[pos])->objptr.empty() && pstub->objptr->isRaised()){
 					pstub->events |= EventSignal;
 					if(pstub->state == Stub::OutExecQueue){
-						d.execq.push(pos);
+						d.pushExec(pos);
 						pstub->state = Stub::InExecQueue;
 					}
 				}
@@ -523,7 +880,7 @@ ulong Selector::doReadPipe(){
 					idbgx(Debug::aio, "signaled object on pos "<<pos);
 					pstub->events |= EventSignal;
 					if(pstub->state == Stub::OutExecQueue){
-						d.execq.push(pos);
+						d.pushExec(pos);
 						pstub->state = Stub::InExecQueue;
 					}
 				}
@@ -545,7 +902,7 @@ ulong Selector::doReadPipe(){
 				if(pos < d.stubs.size() && (pstub = &d.stubs[pos])->objptr && pstub->objptr->signaled(S_RAISE)){
 					pstub->events |= EventSignal;
 					if(pstub->state == Stub::OutExecQueue){
-						d.execq.push(pos);
+						d.pushExec(pos);
 						pstub->state = Stub::InExecQueue;
 					}
 				}
@@ -651,7 +1008,7 @@ ulong Selector::doAllIo(){
 				stub.events |= evs;
 				//push channel execqueue
 				if(stub.state == Stub::OutExecQueue){
-					d.execq.push(stubpos);
+					d.pushExec(stubpos);
 					stub.state = Stub::InExecQueue;
 				}
 			}
@@ -661,39 +1018,74 @@ ulong Selector::doAllIo(){
 	}
 	return flags;
 }
-void Selector::doFullScanCheck(Stub &_rstub, const ulong _pos){
-	ulong	evs = 0;
-	if(d.ctimepos >= _rstub.itimepos){
-		evs |= _rstub.objptr->doOnTimeoutRecv(d.ctimepos);
-		if(d.ntimepos > _rstub.itimepos){
-			d.ntimepos = _rstub.itimepos;
-		}
-	}else if(d.ntimepos > _rstub.itimepos){
-		d.ntimepos = _rstub.itimepos;
+struct Selector::TimerHandler{
+	TimerHandler(Selector &_rs):rs(_rs){}
+	void operator()(const size_t _pos){
+		rs.doTimeoutCheck(_pos);
 	}
+	Selector	&rs;
+};
+
+void Selector::doTimeoutCheck(const ulong _pos){
+	Stub	&stub(d.stubs[_pos]);
+	ulong	evs = 0;
 	
-	if(d.ctimepos >= _rstub.otimepos){
-		evs |= _rstub.objptr->doOnTimeoutSend(d.ctimepos);
-		if(d.ntimepos > _rstub.otimepos){
-			d.ntimepos = _rstub.otimepos;
-		}
-	}else if(d.ntimepos > _rstub.otimepos){
-		d.ntimepos = _rstub.otimepos;
-	}
+	if(stub.objptr.empty()) return;
 	
-	if(d.ctimepos >= _rstub.timepos){
+	if(d.ctimepos >= stub.itimepos){
+		evs |= stub.objptr->doOnTimeoutRecv(d.ctimepos);
+	}
+	if(d.ctimepos >= stub.otimepos){
+		evs |= stub.objptr->doOnTimeoutSend(d.ctimepos);
+	}
+	if(d.ctimepos >= stub.timepos){
 		evs |= EventTimeout;
-	}else if(d.ntimepos > _rstub.timepos){
-		d.ntimepos = _rstub.timepos;
 	}
+	if(evs){
+		stub.events |= evs;
+		if(stub.state == Stub::OutExecQueue){
+			d.pushExec(_pos);
+			stub.state = Stub::InExecQueue;
+		}
+	}
+	if(stub.state == Stub::OutExecQueue){
+		//a stale timer or the sockets have further timeouts
+		//objects in the execq are rescheduled after execution
+		doScheduleTimer(_pos);
+	}
+}
+
+void Selector::doScheduleTimer(const ulong _pos){
+	const Stub		&stub(d.stubs[_pos]);
+	const TimeSpec	*pts(&stub.timepos);
 	
-	if(_rstub.objptr->notified(S_RAISE)){
-		evs |= EventSignal;//should not be checked by objs
+	if(stub.itimepos < *pts){
+		pts = &stub.itimepos;
 	}
-	if(evs){
-		_rstub.events |= evs;
+	if(stub.otimepos < *pts){
+		pts = &stub.otimepos;
+	}
+	if(pts->isMax()){
+		d.timewheel.cancel(_pos);
+	}else{
+		d.timewheel.schedule(_pos, Data::tick(*pts));
+	}
+}
+
+ulong Selector::doTimeout(){
+	TimerHandler	th(*this);
+	const size_t	cnt(d.timewheel.advance(d.currentTick(), th));
+	if(cnt){
+		vdbgx(Debug::aio, "timeout count "<<cnt);
+	}
+	return 0;
+}
+
+void Selector::doFullScanCheck(Stub &_rstub, const ulong _pos){
+	if(_rstub.objptr->notified(S_RAISE)){
+		_rstub.events |= EventSignal;//should not be checked by objs
 		if(_rstub.state == Stub::OutExecQueue){
-			d.execq.push(_pos);
+			d.pushExec(_pos);
 			_rstub.state = Stub::InExecQueue;
 		}
 	}
@@ -701,7 +1093,6 @@ void Selector::doFullScanCheck(Stub &_rstub, const ulong _pos){
 ulong Selector::doFullScan(){
 	++d.rep_fullscancount;
 	idbgx(Debug::aio, "fullscan count "<<d.rep_fullscancount);
-	d.ntimepos = TimeSpec::maximum;
 	for(Data::StubVectorT::iterator it(d.stubs.begin()); it != d.stubs.end(); it += 4){
 		if(!it->objptr.empty()){
 			doFullScanCheck(*it, it - d.stubs.begin());
@@ -726,22 +1117,45 @@ ulong Selector::doExecute(const ulong _pos){
 	
 	ulong						rv(0);
 	
+	stub.objptr->doClearRequests();//clears the requests from object to selector
+	if(stub.objptr->hscnt){
+		stub.events |= stub.objptr->doHandshakeEvents();
+		if(stub.events == EventSignal && !stub.objptr->notified(~static_cast<size_t>(S_RAISE))){
+			//raised by the HandshakePool for a step which did not end the hand-shake
+			stub.events = 0;
+			doPrepareObjectWait(_pos, stub.timepos);
+			return 0;
+		}
+	}
+	
 	stub.timepos = TimeSpec::maximum;
 	
 	Object::ExecuteController	exectl(stub.events, d.ctimepos);
 	
 	stub.events = 0;
-	stub.objptr->doClearRequests();//clears the requests from object to selector
 	
 	idbgx(Debug::aio, "execute object "<<_pos);
 	
 	this->associateObjectToCurrentThread(*stub.objptr);
 	
-	this->executeObject(*stub.objptr, exectl);
+	d.exepos = _pos;
+	if(d.balmsec){
+		TimeSpec	ts(TimeSpec::createMonotonic());
+		this->executeObject(*stub.objptr, exectl);
+		TimeSpec	te(TimeSpec::createMonotonic());
+		te -= ts;
+		const uint64	ns(te.seconds() * 1000000000ULL + te.nanoSeconds());
+		stub.exetime += ns;
+		++stub.execnt;
+		d.balbusy += ns;
+	}else{
+		this->executeObject(*stub.objptr, exectl);
+	}
+	d.exepos = 0;
 	
 	switch(exectl.returnValue()){
 		case Object::ExecuteContext::RescheduleRequest:
-			d.execq.push(_pos);
+			d.pushExec(_pos);
 			stub.state = Stub::InExecQueue;
 			stub.events |= EventReschedule;
 		case Object::ExecuteContext::WaitRequest:
@@ -757,18 +1171,21 @@ ulong Selector::doExecute(const ulong _pos){
 			doUnregisterObject(*stub.objptr);
 			this->stopObject(*stub.objptr);
 			stub.objptr.clear();
-			stub.timepos = TimeSpec::maximum;
+			stub.reset();
+			d.timewheel.cancel(_pos);
 			--d.objsz;
 			rv = Data::EXIT_LOOP;
 			break;
 		case Object::ExecuteContext::LeaveRequest:
 			d.freestubsstk.push(_pos);
 			doUnregisterObject(*stub.objptr);
-			stub.timepos = TimeSpec::maximum;
+			stub.reset();
+			d.timewheel.cancel(_pos);
 			--d.objsz;
 			stub.objptr->doUnprepare();
 			stub.objptr.release();
 			rv = Data::EXIT_LOOP;
+			break;
 		default:
 			cassert(false);
 	}
@@ -822,7 +1239,7 @@ void Selector::doPrepareObjectWait(const size_t _pos, const TimeSpec &_timepos){
 					Epoll doesn't like sockets that are only created, it signals
 					EPOLLET on them.
 				*/
-				sockstub.psock->doPrepare();
+				sockstub.psock->doPrepare(0, d.phspool);
 				sockstub.selevents = 0;
 				struct kevent	evr,evw;
 				EV_SET (&evr, sockstub.psock->descriptor(), EVFILT_READ, EV_ADD | EV_DISABLE, 0, 0, NULL);
@@ -859,19 +1276,10 @@ void Selector::doPrepareObjectWait(const size_t _pos, const TimeSpec &_timepos){
 		
 		if(stub.timepos == d.ctimepos){
 			stub.timepos = TimeSpec::maximum;
-		}else if(d.ntimepos > stub.timepos){
-			d.ntimepos = stub.timepos;
 		}
-		
-		if(d.ntimepos > stub.itimepos){
-			d.ntimepos = stub.itimepos;
-		}
-		if(d.ntimepos > stub.otimepos){
-			d.ntimepos = stub.otimepos;
-		}
-		
+		doScheduleTimer(_pos);
 	}else if(stub.state != Stub::InExecQueue){
-		d.execq.push(_pos);
+		d.pushExec(_pos);
 		stub.state = Stub::InExecQueue;
 	}
 }
@@ -890,6 +1298,7 @@ ulong Selector::doAddNewStub(){
 			d.stubs.push_back(Stub());
 			d.freestubsstk.push(i);
 		}
+		d.timewheel.reserve(d.stubs.size());
 		if(cp != d.stubs.capacity()){
 			//we need to reset the aioobject's pointer to timepos
 			for(Data::StubVectorT::iterator it(d.stubs.begin()); it != d.stubs.end(); it += 4){
@@ -0,0 +1,1416 @@
+// frame/aio/src/aioselector_uring.cpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#include "system/common.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <linux/io_uring.h>
+#include "system/exception.hpp"
+
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+
+#include "system/debug.hpp"
+#include "system/timespec.hpp"
+#include "system/mutex.hpp"
+
+#include "utility/queue.hpp"
+#include "utility/stack.hpp"
+#include "utility/timerwheel.hpp"
+
+#include "frame/object.hpp"
+#include "frame/common.hpp"
+
+#include "frame/aio/aioselector.hpp"
+#include "frame/aio/aioobject.hpp"
+
+#include "aiosocket.hpp"
+
+
+namespace solid{
+namespace frame{
+namespace aio{
+//=============================================================
+// The io_uring selector:
+// - the sockets' readiness is waited for with one shot
+//   IORING_OP_POLL_ADD requests (the poll mask values are the
+//   same as the EPOLL ones used by aio::Socket);
+// - the poll (re)arming requests are queued on the submission
+//   ring during the loop iteration and submitted together with
+//   the wait, in a single io_uring_enter call;
+// - the completions are reaped directly from the shared ring.
+//=============================================================
+
+struct Selector::Stub{
+	enum State{
+		InExecQueue,
+		OutExecQueue
+	};
+	Stub():
+		timepos(TimeSpec::maximum),
+		itimepos(TimeSpec::maximum),
+		otimepos(TimeSpec::maximum),
+		state(OutExecQueue),
+		events(0), exetime(0), execnt(0), gen(0){
+	}
+	void reset(){
+		timepos = TimeSpec::maximum;
+		state = OutExecQueue;
+		events = 0;
+		exetime = 0;
+		execnt = 0;
+	}
+	ObjectPointerT	objptr;
+	TimeSpec		timepos;//object timepos
+	TimeSpec		itimepos;//input timepos
+	TimeSpec		otimepos;//output timepos
+	State			state;
+	uint			events;
+	uint64			exetime;//nanoseconds spent executing in the balancing period
+	uint32			execnt;//executions in the balancing period
+	uint8			gen;//discriminates completions for a reused stub
+};
+
+//! An object in transit between two selectors
+struct Selector::MigrateStub{
+	ObjectPointerT	objptr;
+	TimeSpec		timepos;
+	TimeSpec		itimepos;
+	TimeSpec		otimepos;
+};
+
+struct Selector::Data{
+	enum{
+		POLLMASK = EPOLLIN | EPOLLOUT,
+		MAXPOLLWAIT = 0x7FFFFFFF,
+		EXIT_LOOP = 1,
+		FULL_SCAN = 2,
+		READ_PIPE = 4,
+		MAX_RING_SIZE = 1024 * 2,
+		MAX_SUBMIT_RETRY = 8,//flushes of a full submission ring before giving up
+	};
+	//the user_data of requests not for sockets, i.e. for stub zero
+	static const uint64	PipeKey = 0;
+	static const uint64	TimeoutKey = 1;
+	static const uint64	RemoveKey = 2;
+	static const uint64	InvalidKey = (uint64)-1;
+
+	typedef Stack<uint32>			Uint32StackT;
+	typedef Queue<uint32>			Uint32QueueT;
+	typedef std::vector<Stub>		StubVectorT;
+	typedef std::vector<uint64>		Uint64VectorT;
+	typedef std::vector<MigrateStub>	MigrateVectorT;
+	typedef std::vector<ObjectPointerT>	ObjectVectorT;
+	typedef std::vector<io_uring_cqe>	CqeVectorT;
+	typedef ATOMIC_NS::atomic<bool>	AtomicBoolT;
+	//raised only to wake up the selector - it is not a valid position
+	static const uint32				WakePos = 0xffffffff;
+
+	ulong				objcp;
+	ulong				objsz;
+	ulong				socksz;
+	int					selcnt;
+	int					ringfd;
+	bool				extarg;//timeout given to io_uring_enter
+//submission ring:
+	uint32				*psqhead;
+	uint32				*psqtail;
+	uint32				*psqarray;
+	uint32				*psqflags;
+	uint32				sqmask;
+	uint32				sqentries;
+	uint32				sqtail;
+	io_uring_sqe		*psqes;
+//completion ring:
+	uint32				*pcqhead;
+	uint32				*pcqtail;
+	uint32				cqmask;
+	io_uring_cqe		*pcqes;
+	CqeVectorT			cqevec;//completions moved off the ring to make room - handled first
+//the mappings:
+	void				*psqring;
+	size_t				sqringsz;
+	void				*pcqring;
+	size_t				cqringsz;
+	size_t				sqessz;
+
+	__kernel_timespec	waitts;
+	Uint64VectorT		fdkeys;//the key of the armed poll for every descriptor
+	StubVectorT			stubs;
+	Uint32QueueT		execq[PriorityCount];//one execution queue per priority class
+	Uint32StackT		freestubsstk;
+	int					pipefds[2];
+	TimerWheel			timewheel;//one timer per stub - the nearest of its timeouts
+	TimeSpec			ctimepos;//current time pos
+	uint32				exepos;//the position of the executing object, 0 if none
+	Mutex				migmtx;
+	MigrateVectorT		migvec;//objects migrated here by other selectors
+	ulong				migroom;//how many objects can still be migrated here
+	AtomicBoolT			migflag;//migvec is not empty
+	ObjectVectorT		locvec;//objects pushed from the selector thread, registered by the loop
+	ulong				balmsec;//the balancing period, 0 if not balancing
+	TimeSpec			balpos;//the start of the balancing period
+	TimeSpec			balnext;//the end of the balancing period
+	uint64				balperiod;//the length in nanoseconds of the last balancing period
+	uint64				balbusy;//nanoseconds spent executing objects in the balancing period
+	ulong				budgetcnt[PriorityCount];//objects executed per loop, 0 for no limit
+	ulong				budgetusec[PriorityCount];//microseconds executing per loop, 0 for no limit
+	uint32				zcthreshold;//the stream sockets send with MSG_ZEROCOPY from this size, 0 for never
+	HandshakePool		*phspool;//the pool doing the secure hand-shakes, NULL for none
+
+//reporting data:
+	uint				rep_fullscancount;
+
+public://methods:
+	Data();
+	~Data();
+	void pushExec(const uint32 _pos);
+	size_t execSize()const;
+	bool initRing(ulong _cp);
+	int computeWaitTimeout()const;
+	uint64 currentTick()const;
+	static uint64 tick(const TimeSpec &_rts);
+	void addNewSocket();
+	static uint64 key(const uint32 _objpos, const uint8 _gen, const uint32 _mask, const uint32 _sockpos);
+	static void stub(uint32 &_objpos, uint8 &_gen, uint32 &_mask, uint32 &_sockpos, const uint64 _key);
+	io_uring_sqe* sqePrepare();
+	void sqeCommit();
+	void cqeStash();
+	int submit(const uint _minwait, const int _pollwait);
+	int waitEvents(const int _pollwait);
+	bool pollAdd(const int _fd, const uint32 _mask, const uint64 _key);
+	bool pollRemove(const int _fd);
+};
+//-------------------------------------------------------------
+/*static*/ const uint64	Selector::Data::PipeKey;
+/*static*/ const uint64	Selector::Data::TimeoutKey;
+/*static*/ const uint64	Selector::Data::RemoveKey;
+/*static*/ const uint64	Selector::Data::InvalidKey;
+
+Selector::Data::Data():
+	objcp(0), objsz(0), socksz(0), selcnt(0), ringfd(-1), extarg(false),
+	psqhead(NULL), psqtail(NULL), psqarray(NULL), psqflags(NULL), sqmask(0), sqentries(0), sqtail(0), psqes(NULL),
+	pcqhead(NULL), pcqtail(NULL), cqmask(0), pcqes(NULL),
+	psqring(MAP_FAILED), sqringsz(0), pcqring(MAP_FAILED), cqringsz(0), sqessz(0),
+	exepos(0), migroom(0), balmsec(0), balperiod(0), balbusy(0), zcthreshold(0), phspool(NULL), rep_fullscancount(0){
+	for(uint i = 0; i < PriorityCount; ++i){
+		budgetcnt[i] = 0;
+		budgetusec[i] = 0;
+	}
+	migflag.store(false);
+	pipefds[0] = -1;
+	pipefds[1] = -1;
+}
+
+Selector::Data::~Data(){
+	if(psqes){
+		munmap(psqes, sqessz);
+	}
+	if(pcqring != MAP_FAILED && pcqring != psqring){
+		munmap(pcqring, cqringsz);
+	}
+	if(psqring != MAP_FAILED){
+		munmap(psqring, sqringsz);
+	}
+	if(ringfd >= 0){
+		close(ringfd);
+	}
+	if(pipefds[0] >= 0){
+		close(pipefds[0]);
+	}
+	if(pipefds[1] >= 0){
+		close(pipefds[1]);
+	}
+}
+
+bool Selector::Data::initRing(ulong _cp){
+	io_uring_params	params;
+	uint32			entries(1);
+
+	while(entries < _cp && entries < MAX_RING_SIZE){
+		entries <<= 1;
+	}
+
+	memset(&params, 0, sizeof(params));
+	ringfd = syscall(__NR_io_uring_setup, entries, &params);
+	if(ringfd < 0){
+		edbgx(Debug::aio, "io_uring_setup: "<<strerror(errno));
+		return false;
+	}
+	if(!(params.features & IORING_FEAT_NODROP)){
+		//we cannot afford losing completions
+		edbgx(Debug::aio, "io_uring without IORING_FEAT_NODROP");
+		return false;
+	}
+	extarg = (params.features & IORING_FEAT_EXT_ARG) != 0;
+
+	sqringsz = params.sq_off.array + params.sq_entries * sizeof(uint32);
+	cqringsz = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	if(params.features & IORING_FEAT_SINGLE_MMAP){
+		if(cqringsz > sqringsz){
+			sqringsz = cqringsz;
+		}
+		cqringsz = sqringsz;
+	}
+	psqring = mmap(NULL, sqringsz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_SQ_RING);
+	if(psqring == MAP_FAILED){
+		edbgx(Debug::aio, "mmap sq ring: "<<strerror(errno));
+		return false;
+	}
+	if(params.features & IORING_FEAT_SINGLE_MMAP){
+		pcqring = psqring;
+	}else{
+		pcqring = mmap(NULL, cqringsz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_CQ_RING);
+		if(pcqring == MAP_FAILED){
+			edbgx(Debug::aio, "mmap cq ring: "<<strerror(errno));
+			return false;
+		}
+	}
+	sqessz = params.sq_entries * sizeof(io_uring_sqe);
+	void *pv = mmap(NULL, sqessz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_SQES);
+	if(pv == MAP_FAILED){
+		edbgx(Debug::aio, "mmap sqes: "<<strerror(errno));
+		return false;
+	}
+	psqes = static_cast<io_uring_sqe*>(pv);
+
+	char *psq = static_cast<char*>(psqring);
+	psqhead		= reinterpret_cast<uint32*>(psq + params.sq_off.head);
+	psqtail		= reinterpret_cast<uint32*>(psq + params.sq_off.tail);
+	psqarray	= reinterpret_cast<uint32*>(psq + params.sq_off.array);
+	psqflags	= reinterpret_cast<uint32*>(psq + params.sq_off.flags);
+	sqmask		= *reinterpret_cast<uint32*>(psq + params.sq_off.ring_mask);
+	sqentries	= *reinterpret_cast<uint32*>(psq + params.sq_off.ring_entries);
+	sqtail		= *psqtail;
+
+	char *pcq = static_cast<char*>(pcqring);
+	pcqhead		= reinterpret_cast<uint32*>(pcq + params.cq_off.head);
+	pcqtail		= reinterpret_cast<uint32*>(pcq + params.cq_off.tail);
+	cqmask		= *reinterpret_cast<uint32*>(pcq + params.cq_off.ring_mask);
+	pcqes		= reinterpret_cast<io_uring_cqe*>(pcq + params.cq_off.cqes);
+
+	idbgx(Debug::aio, "io_uring sq_entries = "<<params.sq_entries<<" cq_entries = "<<params.cq_entries<<" extarg = "<<extarg);
+	return true;
+}
+
+int Selector::Data::computeWaitTimeout()const{
+	const uint64	nexttick(timewheel.nextTick());
+	if(nexttick == TimerWheel::invalidTick()) return -1;//return MAXPOLLWAIT;
+	const uint64	crttick(currentTick());
+	if(nexttick <= crttick) return 0;
+	if((nexttick - crttick) > MAXPOLLWAIT) return MAXPOLLWAIT;
+	return nexttick - crttick;
+}
+//! Queue the object on _pos for execution, in the queue of its priority class
+inline void Selector::Data::pushExec(const uint32 _pos){
+	execq[stubs[_pos].objptr->priority()].push(_pos);
+}
+inline size_t Selector::Data::execSize()const{
+	size_t sz(0);
+	for(uint i = 0; i < PriorityCount; ++i){
+		sz += execq[i].size();
+	}
+	return sz;
+}
+//! The current time in milliseconds, rounded down
+inline uint64 Selector::Data::currentTick()const{
+	return ctimepos.seconds() * 1000ULL + ctimepos.nanoSeconds() / 1000000;
+}
+//! A timeout in milliseconds, rounded up so that ctimepos >= _rts when it fires
+/*static*/ inline uint64 Selector::Data::tick(const TimeSpec &_rts){
+	return _rts.seconds() * 1000ULL + (_rts.nanoSeconds() + 999999) / 1000000;
+}
+void Selector::Data::addNewSocket(){
+	++socksz;
+}
+/*
+	The key of a socket poll request is:
+	objpos(32) | gen(8) | mask(4) | sockpos(20)
+*/
+/*static*/ inline uint64 Selector::Data::key(
+	const uint32 _objpos, const uint8 _gen, const uint32 _mask, const uint32 _sockpos
+){
+	cassert(_sockpos < (1 << 20));
+	uint64 rv(_objpos);
+	rv <<= 32;
+	rv |= (static_cast<uint32>(_gen) << 24) | ((_mask & 0xf) << 20) | _sockpos;
+	return rv;
+}
+/*static*/ inline void Selector::Data::stub(
+	uint32 &_objpos, uint8 &_gen, uint32 &_mask, uint32 &_sockpos, const uint64 _key
+){
+	_objpos = (_key >> 32);
+	_gen = (_key >> 24) & 0xff;
+	_mask = (_key >> 20) & 0xf;
+	_sockpos = _key & ((1 << 20) - 1);
+}
+//! Get a free submission entry, NULL if the ring stays full
+/*!
+	A full submission ring is flushed. The kernel refuses new
+	submissions (EBUSY) while the completions overflow the completion
+	ring, so those are moved aside, to cqevec, before trying again.
+*/
+io_uring_sqe* Selector::Data::sqePrepare(){
+	for(int i(0); (sqtail - __atomic_load_n(psqhead, __ATOMIC_ACQUIRE)) >= sqentries; ++i){
+		if(i == MAX_SUBMIT_RETRY){
+			edbgx(Debug::aio, "the submission ring stays full");
+			return NULL;
+		}
+		const int rv = submit(0, 0);
+		if(rv < 0){
+			if(errno == EBUSY || errno == EAGAIN){
+				cqeStash();
+			}else if(errno != EINTR){
+				return NULL;
+			}
+		}
+	}
+	io_uring_sqe *psqe(&psqes[sqtail & sqmask]);
+	memset(psqe, 0, sizeof(*psqe));
+	return psqe;
+}
+void Selector::Data::sqeCommit(){
+	psqarray[sqtail & sqmask] = sqtail & sqmask;
+	++sqtail;
+	__atomic_store_n(psqtail, sqtail, __ATOMIC_RELEASE);
+}
+//! Move the ready completions off the ring, to be handled by doAllIo
+void Selector::Data::cqeStash(){
+	uint32			head(*pcqhead);
+	const uint32	tail(__atomic_load_n(pcqtail, __ATOMIC_ACQUIRE));
+	for(; head != tail; ++head){
+		cqevec.push_back(pcqes[head & cqmask]);
+	}
+	__atomic_store_n(pcqhead, head, __ATOMIC_RELEASE);
+}
+//! Submit the queued requests and wait for at most _pollwait msecs for _minwait completions
+int Selector::Data::submit(const uint _minwait, const int _pollwait){
+	const uint				tosubmit(sqtail - __atomic_load_n(psqhead, __ATOMIC_ACQUIRE));
+	uint					flags(0);
+	io_uring_getevents_arg	arg;
+	void					*parg(NULL);
+	size_t					argsz(0);
+
+	if(_minwait){
+		flags |= IORING_ENTER_GETEVENTS;
+		if(_pollwait > 0 && extarg){
+			waitts.tv_sec = _pollwait / 1000;
+			waitts.tv_nsec = (_pollwait % 1000) * 1000000;
+			arg.sigmask = 0;
+			arg.sigmask_sz = _NSIG / 8;
+			arg.pad = 0;
+			arg.ts = reinterpret_cast<uint64>(&waitts);
+			flags |= IORING_ENTER_EXT_ARG;
+			parg = &arg;
+			argsz = sizeof(arg);
+		}
+	}
+	if(__atomic_load_n(psqflags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW){
+		//the kernel holds completions that did not fit the ring - have them flushed
+		flags |= IORING_ENTER_GETEVENTS;
+	}
+	if(tosubmit == 0 && !(flags & IORING_ENTER_GETEVENTS)){
+		return 0;
+	}
+	const int rv = syscall(__NR_io_uring_enter, ringfd, tosubmit, _minwait, flags, parg, argsz);
+	if(rv < 0 && errno != EINTR && errno != ETIME && errno != EBUSY && errno != EAGAIN){
+		edbgx(Debug::aio, "io_uring_enter: "<<strerror(errno));
+	}
+	return rv;
+}
+//! Submit the queued requests and wait for completions
+/*!
+	Returns the number of completions ready to be reaped.
+*/
+int Selector::Data::waitEvents(const int _pollwait){
+	uint32 ready(__atomic_load_n(pcqtail, __ATOMIC_ACQUIRE) - *pcqhead + cqevec.size());
+	if(_pollwait == 0 || ready){
+		submit(0, 0);
+	}else if(_pollwait > 0 && !extarg){
+		//older kernels: a pure timeout request wakes us up
+		io_uring_sqe	*psqe(sqePrepare());
+		if(psqe){
+			waitts.tv_sec = _pollwait / 1000;
+			waitts.tv_nsec = (_pollwait % 1000) * 1000000;
+			psqe->opcode = IORING_OP_TIMEOUT;
+			psqe->fd = -1;
+			psqe->addr = reinterpret_cast<uint64>(&waitts);
+			psqe->len = 1;
+			psqe->off = 0;
+			psqe->user_data = TimeoutKey;
+			sqeCommit();
+			submit(1, _pollwait);
+		}else{
+			//nothing would wake us up in time
+			submit(0, 0);
+		}
+	}else{
+		submit(1, _pollwait);
+	}
+	ready = __atomic_load_n(pcqtail, __ATOMIC_ACQUIRE) - *pcqhead + cqevec.size();
+	return ready;
+}
+//! Queue a one shot poll - false if the submission ring stays full
+bool Selector::Data::pollAdd(const int _fd, const uint32 _mask, const uint64 _key){
+	io_uring_sqe	*psqe(sqePrepare());
+	if(!psqe){
+		return false;
+	}
+	psqe->opcode = IORING_OP_POLL_ADD;
+	psqe->fd = _fd;
+	psqe->poll32_events = _mask;
+	psqe->user_data = _key;
+	sqeCommit();
+	if(static_cast<size_t>(_fd) >= fdkeys.size()){
+		fdkeys.resize(_fd + 1, InvalidKey);
+	}
+	fdkeys[_fd] = _key;
+	return true;
+}
+//! Cancel the armed poll - false if the submission ring stays full
+/*!
+	The poll left armed is harmless: its completion no longer matches
+	the socket's events and is dropped.
+*/
+bool Selector::Data::pollRemove(const int _fd){
+	if(static_cast<size_t>(_fd) < fdkeys.size() && fdkeys[_fd] != InvalidKey){
+		io_uring_sqe	*psqe(sqePrepare());
+		if(!psqe){
+			return false;
+		}
+		psqe->opcode = IORING_OP_POLL_REMOVE;
+		psqe->fd = -1;
+		psqe->addr = fdkeys[_fd];
+		psqe->user_data = RemoveKey;
+		sqeCommit();
+		fdkeys[_fd] = InvalidKey;
+	}
+	return true;
+}
+//=============================================================
+Selector::Selector():d(*(new Data)){
+}
+Selector::~Selector(){
+	delete &d;
+}
+bool Selector::init(ulong _cp){
+	idbgx(Debug::aio, "aio::Selector "<<(void*)this);
+	cassert(_cp);
+	d.objcp = _cp;
+	//objects are added before the loop is run
+	d.zcthreshold = zeroCopyThreshold();
+	d.phspool = handshakePool();
+
+	setCurrentTimeSpecific(d.ctimepos);
+
+	//first create the io_uring:
+	cassert(d.ringfd < 0);
+	if(!d.initRing(_cp)){
+		cassert(false);
+		return false;
+	}
+	//next create the pipefds:
+	cassert(d.pipefds[0] < 0 && d.pipefds[1] < 0);
+	if(pipe(d.pipefds)){
+		edbgx(Debug::aio, "pipe: "<<strerror(errno));
+		cassert(false);
+		return false;
+	}
+
+	//make the pipes nonblocking
+	fcntl(d.pipefds[0], F_SETFL, O_NONBLOCK);
+	fcntl(d.pipefds[1], F_SETFL, O_NONBLOCK);
+
+	//wait for signals on the pipe
+	if(!d.pollAdd(d.pipefds[0], EPOLLIN | EPOLLPRI, Data::PipeKey)){
+		cassert(false);
+		return false;
+	}
+
+	//We need to have the stubs preallocated
+	//because of aio::Object::ptimeout
+	d.stubs.reserve(d.objcp);
+	//add the pipe stub:
+	doAddNewStub();
+
+	d.ctimepos.set(0);
+	d.objsz = 1;
+	d.socksz = 1;
+	return true;
+}
+
+void Selector::prepare(){
+	setCurrentTimeSpecific(d.ctimepos);
+}
+void Selector::unprepare(){
+}
+
+void Selector::raise(uint32 _pos){
+	idbgx(Debug::aio, "signal connection pipe: "<<_pos<<" this "<<(void*)this);
+	write(d.pipefds[1], &_pos, sizeof(uint32));
+}
+
+void Selector::raiseMany(const uint32 *_ppos, const size_t _cnt){
+	//a write of at most PIPE_BUF bytes is atomic so the positions
+	//are never interleaved with the ones written by other threads
+	const size_t	chunkcp(PIPE_BUF / sizeof(uint32));
+	idbgx(Debug::aio, "signal "<<_cnt<<" connections pipe this "<<(void*)this);
+	size_t			cnt(_cnt);
+	while(cnt){
+		const size_t sz(cnt < chunkcp ? cnt : chunkcp);
+		write(d.pipefds[1], _ppos, sz * sizeof(uint32));
+		_ppos += sz;
+		cnt -= sz;
+	}
+}
+
+void Selector::raiseLocal(uint32 _pos){
+	if(_pos == 0 || _pos == d.exepos || _pos >= d.stubs.size()){
+		//the executing object is taken care of by the wakeup path
+		raise(_pos);
+		return;
+	}
+	idbgx(Debug::aio, "signal connection local: "<<_pos<<" this "<<(void*)this);
+	Stub &rstub(d.stubs[_pos]);
+	if(!rstub.objptr.empty() && rstub.objptr->isRaised()){
+		rstub.events |= EventSignal;
+		if(rstub.state == Stub::OutExecQueue){
+			d.pushExec(_pos);
+			rstub.state = Stub::InExecQueue;
+		}
+	}
+}
+
+ulong Selector::capacity()const{
+	return d.objcp;
+}
+ulong Selector::size() const{
+	return d.objsz;
+}
+bool Selector::empty()const{
+	return d.objsz == 1;
+}
+bool Selector::full()const{
+	return d.objsz == d.objcp;
+}
+
+bool Selector::push(JobT &_objptr){
+	if(full()){
+		//NOTE:we cannot increase selvec because, objects keep pointers to Stub structures from vector
+		//if we'd use deque instead, we'd have a performance penalty
+		THROW_EXCEPTION("Selector full");
+	}
+	uint stubpos = doAddNewStub();
+	Stub &stub = d.stubs[stubpos];
+
+	if(!this->setObjectThread(*_objptr, stubpos)){
+		return false;
+	}
+
+	stub.timepos  = TimeSpec::maximum;
+	stub.itimepos = TimeSpec::maximum;
+	stub.otimepos = TimeSpec::maximum;
+
+	//no registration needed - the sockets are polled on io requests
+	Object::SocketStub *psockstub = _objptr->pstubs;
+	for(uint i = 0; i < _objptr->stubcp; ++i, ++psockstub){
+		Socket *psock = psockstub->psock;
+		if(psock && psock->descriptor() >= 0){
+			psockstub->selevents = 0;
+			d.addNewSocket();
+			psock->doPrepare(d.zcthreshold, d.phspool);
+		}
+	}
+
+	++d.objsz;
+	stub.objptr = _objptr;
+	stub.objptr->doPrepare(&stub.itimepos, &stub.otimepos);
+	vdbgx(Debug::aio, "pushing object "<<&(*(stub.objptr))<<" on position "<<stubpos);
+	stub.state = Stub::InExecQueue;
+	d.pushExec(stubpos);
+	return true;
+}
+
+//! Execute the queued objects in priority order, within the class budgets
+/*!
+	Every class gets a single scan, so the objects rescheduled while
+	executing wait for the next loop, as do the ones left over when
+	the class runs out of budget.
+*/
+inline ulong Selector::doExecuteQueue(){
+	ulong		flags = 0;
+	for(uint i = 0; i < PriorityCount; ++i){
+		Data::Uint32QueueT	&rq(d.execq[i]);
+		ulong				qsz(rq.size());
+		if(d.budgetcnt[i] && qsz > d.budgetcnt[i]){
+			qsz = d.budgetcnt[i];
+		}
+		if(qsz && d.budgetusec[i]){
+			TimeSpec	endpos(TimeSpec::createMonotonic());
+			endpos.add(d.budgetusec[i] / 1000000, (d.budgetusec[i] % 1000000) * 1000);
+			while(qsz){
+				const uint pos = rq.front();
+				rq.pop();
+				--qsz;
+				flags |= doExecute(pos);
+				if(qsz && TimeSpec::createMonotonic() >= endpos) break;
+			}
+		}else{
+			while(qsz){
+				const uint pos = rq.front();
+				rq.pop();
+				--qsz;
+				flags |= doExecute(pos);
+			}
+		}
+	}
+	return flags;
+}
+
+
+void Selector::run(){
+	static const int	maxnbcnt = 16;
+	uint 				flags;
+	int					nbcnt = -1;	//non blocking opperations count,
+									//used to reduce the number of calls for the system time.
+	int 				pollwait = 0;
+
+	doOpenMigration();
+
+	do{
+		flags = 0;
+		if(nbcnt < 0){
+			d.ctimepos.currentMonotonic();
+			nbcnt = maxnbcnt;
+		}
+
+		if(d.selcnt){
+			--nbcnt;
+			flags |= doAllIo();
+		}
+
+		if(flags & Data::READ_PIPE){
+			--nbcnt;
+			flags |= doReadPipe();
+		}
+
+		if(d.timewheel.empty() || d.currentTick() >= d.timewheel.nextTick()){
+			--nbcnt;
+			flags |= doTimeout();
+		}
+
+		if(flags & Data::FULL_SCAN){
+			nbcnt -= 4;
+			flags |= doFullScan();
+		}
+
+		if(d.migflag.load(ATOMIC_NS::memory_order_relaxed)){
+			--nbcnt;
+			doAdoptMigrated();
+		}
+
+		if(d.execSize()){
+			nbcnt -= d.execSize();
+			flags |= doExecuteQueue();
+		}
+		
+		//the objects pushed locally while executing are executed on the next loop
+		if(d.locvec.size()){
+			--nbcnt;
+			doPushLocal();
+		}
+
+		if(d.balmsec && d.ctimepos >= d.balnext){
+			doBalance();
+		}
+
+		if(empty()) flags |= Data::EXIT_LOOP;
+
+		if(flags || d.execSize()){
+			pollwait = 0;
+			--nbcnt;
+		}else{
+			pollwait = d.computeWaitTimeout();
+			vdbgx(Debug::aio, "pollwait "<<pollwait<<" nexttick = "<<d.timewheel.nextTick()<<" timers = "<<d.timewheel.size());
+			vdbgx(Debug::aio, "ctimepos.s = "<<d.ctimepos.seconds()<<" ctimepos.ns = "<<d.ctimepos.nanoSeconds());
+			nbcnt = -1;
+        }
+
+		//submits all the poll requests queued in this iteration
+		d.selcnt = d.waitEvents(pollwait);
+		vdbgx(Debug::aio, "io_uring completions = "<<d.selcnt);
+	}while(!(flags & Data::EXIT_LOOP));
+
+	doCloseMigration();
+}
+
+//-------------------------------------------------------------
+//! Accept objects from other selectors while the loop runs
+void Selector::doOpenMigration(){
+	Locker<Mutex>	lock(d.migmtx);
+	d.migroom = d.objcp - d.objsz;
+	d.balmsec = balancePeriod();
+	for(uint i = 0; i < PriorityCount; ++i){
+		d.budgetcnt[i] = budgetCount(static_cast<PriorityE>(i));
+		d.budgetusec[i] = budgetTime(static_cast<PriorityE>(i));
+	}
+	if(d.balmsec){
+		d.balpos.currentMonotonic();
+		d.balnext = d.balpos;
+		d.balnext += d.balmsec;
+		d.balbusy = 0;
+	}
+}
+//! Stop accepting objects and take the ones already migrated here
+/*!
+	They are executed when the loop is run again.
+*/
+void Selector::doCloseMigration(){
+	{
+		Locker<Mutex>	lock(d.migmtx);
+		d.migroom = 0;
+	}
+	doAdoptMigrated();
+	doPushLocal();
+}
+void Selector::doAdoptMigrated(){
+	Data::MigrateVectorT	migvec;
+	{
+		Locker<Mutex>	lock(d.migmtx);
+		migvec.swap(d.migvec);
+		d.migflag.store(false);
+		if(d.migroom){
+			//the objects closed meanwhile make room
+			d.migroom = d.objcp - d.objsz - migvec.size() - d.locvec.size();
+		}
+	}
+	for(Data::MigrateVectorT::iterator it(migvec.begin()); it != migvec.end(); ++it){
+		doAdopt(*it);
+	}
+}
+bool Selector::pushLocal(JobT &_objptr){
+	{
+		//the objects pushed locally take the room of the migrated ones
+		Locker<Mutex>	lock(d.migmtx);
+		if(!d.migroom) return false;
+		--d.migroom;
+	}
+	d.locvec.push_back(_objptr);
+	return true;
+}
+//! Register the objects pushed locally, outside of any object execution
+void Selector::doPushLocal(){
+	Data::ObjectVectorT		locvec;
+	locvec.swap(d.locvec);
+	for(Data::ObjectVectorT::iterator it(locvec.begin()); it != locvec.end(); ++it){
+		if(!push(*it)){
+			edbgx(Debug::aio, "failed pushing local object "<<&(**it));
+		}
+	}
+}
+//! Called with the migration mutex of the destination selector locked
+void Selector::doDetach(const ulong _pos, MigrateStub &_rms){
+	Stub				&stub(d.stubs[_pos]);
+	Object::SocketStub	*psockstub = stub.objptr->pstubs;
+	for(uint i = 0; i < stub.objptr->stubcp; ++i, ++psockstub){
+		Socket *psock = psockstub->psock;
+		if(psock && psock->descriptor() >= 0){
+			//the socket keeps its state - the poll is armed again by the destination
+			d.pollRemove(psock->descriptor());
+			--d.socksz;
+		}
+	}
+	_rms.timepos = stub.timepos;
+	_rms.itimepos = stub.itimepos;
+	_rms.otimepos = stub.otimepos;
+	stub.objptr->doUnprepare();
+	_rms.objptr = stub.objptr;
+	d.timewheel.cancel(_pos);
+	stub.reset();
+	++stub.gen;
+	d.freestubsstk.push(_pos);
+	--d.objsz;
+}
+void Selector::doAdopt(MigrateStub &_rms){
+	const uint	stubpos = doAddNewStub();
+	Stub		&stub = d.stubs[stubpos];
+
+	this->setObjectThread(*_rms.objptr, stubpos);
+
+	stub.timepos  = _rms.timepos;
+	stub.itimepos = _rms.itimepos;
+	stub.otimepos = _rms.otimepos;
+
+	Object::SocketStub *psockstub = _rms.objptr->pstubs;
+	for(uint i = 0; i < _rms.objptr->stubcp; ++i, ++psockstub){
+		Socket *psock = psockstub->psock;
+		if(psock && psock->descriptor() >= 0){
+			//a poll reports the current readiness, so no event is lost while the object was in transit
+			const uint t = psock->ioRequest();
+			psockstub->selevents = t;
+			if(t && !d.pollAdd(psock->descriptor(), t, Data::key(stubpos, stub.gen, t, i))){
+				psockstub->selevents = 0;
+				_rms.objptr->socketPostEvents(i, EventDoneError);
+				stub.events |= EventDoneError;
+			}
+			d.addNewSocket();
+		}
+	}
+	++d.objsz;
+	stub.objptr = _rms.objptr;
+	stub.objptr->doPrepare(&stub.itimepos, &stub.otimepos);
+	vdbgx(Debug::aio, "adopting object "<<&(*(stub.objptr))<<" on position "<<stubpos);
+	//a raise might have reached the previous selector while the object was in transit
+	if(stub.objptr->isRaised()){
+		stub.events |= EventSignal;
+	}
+	if(stub.events){
+		stub.state = Stub::InExecQueue;
+		d.pushExec(stubpos);
+	}else{
+		doScheduleTimer(stubpos);
+	}
+}
+/*virtual*/ bool Selector::migrate(SelectorBase &_rs){
+	Selector		&rs(static_cast<Selector&>(_rs));
+	//the gap between the selectors, in nanoseconds of execution
+	const uint64	gap((load() - rs.load()) * d.balperiod / 1000);
+	ulong			pos(0);
+	for(ulong i(1); i < d.stubs.size(); ++i){
+		const Stub &rstub(d.stubs[i]);
+		//moving an object narrows the gap only if it takes at most half of it
+		if(
+			!rstub.objptr.empty() && rstub.state == Stub::OutExecQueue &&
+			rstub.exetime && 2 * rstub.exetime <= gap && (
+				!pos || rstub.exetime > d.stubs[pos].exetime ||
+				(rstub.exetime == d.stubs[pos].exetime && rstub.execnt > d.stubs[pos].execnt)
+			)
+		){
+			pos = i;
+		}
+	}
+	if(!pos) return false;
+
+	const ulong	share(d.stubs[pos].exetime * 1000 / d.balperiod);
+	{
+		Locker<Mutex>	lock(rs.d.migmtx);
+		if(!rs.d.migroom) return false;
+		--rs.d.migroom;
+		rs.d.migvec.push_back(MigrateStub());
+		doDetach(pos, rs.d.migvec.back());
+		rs.d.migflag.store(true);
+	}
+	idbgx(Debug::aio, "migrated object from "<<pos<<" share "<<share<<" to selector "<<rs.id());
+	//so that other selectors do not choose the same destination in this period
+	rs.load(rs.load() + share);
+	load(load() - share);
+	rs.raise(Data::WakePos);
+	return true;
+}
+//! Publish the load for the ending period and maybe move an object away
+void Selector::doBalance(){
+	TimeSpec	ts(d.ctimepos);
+	ts -= d.balpos;
+	d.balperiod = ts.seconds() * 1000000000ULL + ts.nanoSeconds();
+	if(d.balperiod){
+		ulong ld(d.balbusy * 1000 / d.balperiod);
+		if(ld > 1000) ld = 1000;
+		load(ld);
+		vdbgx(Debug::aio, "selector "<<id()<<" load = "<<ld<<" objects = "<<d.objsz);
+		if(ld >= balanceLoad()){
+			balance();
+		}
+	}
+	for(Data::StubVectorT::iterator it(d.stubs.begin()); it != d.stubs.end(); ++it){
+		it->exetime = 0;
+		it->execnt = 0;
+	}
+	d.balbusy = 0;
+	d.balpos = d.ctimepos;
+	d.balnext = d.ctimepos;
+	d.balnext += d.balmsec;
+}
+
+//-------------------------------------------------------------
+ulong Selector::doReadPipe(){
+	enum {BUFSZ = 128, BUFLEN = BUFSZ * sizeof(uint32)};
+	uint32		buf[128];
+	ulong		rv(0);//no
+	long		rsz(0);
+	long		j(0);
+	long		maxcnt((d.objcp / BUFSZ) + 1);
+	Stub		*pstub(NULL);
+
+	//rearm the one shot poll on the pipe
+	if(!d.pollAdd(d.pipefds[0], EPOLLIN | EPOLLPRI, Data::PipeKey)){
+		edbgx(Debug::aio, "the pipe poll could not be armed");
+	}
+
+	while((++j <= maxcnt) && ((rsz = read(d.pipefds[0], buf, BUFLEN)) == BUFLEN)){
+		for(int i = 0; i < BUFSZ; ++i){
+			uint pos(buf[i]);
+			if(pos){
+				if(pos < d.stubs.size() && !(pstub = &d.stubs[pos])->objptr.empty() && pstub->objptr->isRaised()){
+					pstub->events |= EventSignal;
+					if(pstub->state == Stub::OutExecQueue){
+						d.pushExec(pos);
+						pstub->state = Stub::InExecQueue;
+					}
+				}
+			}else rv = Data::EXIT_LOOP;
+		}
+	}
+	if(rsz > 0){
+		rsz >>= 2;
+		for(int i = 0; i < rsz; ++i){
+			uint pos(buf[i]);
+			if(pos){
+				if(pos < d.stubs.size() && !(pstub = &d.stubs[pos])->objptr.empty() && pstub->objptr->isRaised()){
+					pstub->events |= EventSignal;
+					if(pstub->state == Stub::OutExecQueue){
+						d.pushExec(pos);
+						pstub->state = Stub::InExecQueue;
+					}
+				}
+			}else rv = Data::EXIT_LOOP;
+		}
+	}
+	if(j > maxcnt){
+		//dummy read:
+		rv = Data::EXIT_LOOP | Data::FULL_SCAN;//scan all filedescriptors for events
+		wdbgx(Debug::aio, "reading pipe dummy");
+		while((rsz = read(d.pipefds[0], buf, BUFSZ)) > 0);
+	}
+	return rv;
+}
+void Selector::doUnregisterObject(Object &_robj, int _lastfailpos){
+	Object::SocketStub *psockstub = _robj.pstubs;
+	uint to = _robj.stubcp;
+	if(_lastfailpos >= 0){
+		to = _lastfailpos + 1;
+	}
+	for(uint i = 0; i < to; ++i, ++psockstub){
+		Socket *psock = psockstub->psock;
+		if(psock && psock->descriptor() >= 0){
+			//the poll holds a reference on the file - it must be removed
+			d.pollRemove(psock->descriptor());
+			psockstub->selevents = 0;
+			--d.socksz;
+			psock->doUnprepare();
+		}
+	}
+}
+
+inline ulong Selector::doIo(Socket &_rsock, ulong _evs, ulong){
+	ulong rv = 0;
+	if((_evs & EPOLLERR) && _rsock.isZeroCopy()){
+		//most likely MSG_ZEROCOPY completions on the error queue
+		rv = _rsock.doZeroCopyCompletions();
+		if(rv & EventDoneError){
+			_rsock.doClear();
+			return EventDoneError;
+		}
+		_evs &= ~EPOLLERR;
+	}
+	if(_evs & (EPOLLERR | EPOLLHUP)){
+		_rsock.doClear();
+		int err(0);
+		socklen_t len(sizeof(err));
+		int rv = getsockopt(_rsock.descriptor(), SOL_SOCKET, SO_ERROR, &err, &len);
+		wdbgx(Debug::aio, "sock error evs = "<<_evs<<" err = "<<err<<" errstr = "<<strerror(err));
+		wdbgx(Debug::aio, "rv = "<<rv<<" "<<strerror(errno)<<" desc"<<_rsock.descriptor());
+		if(rv || err || (_evs & EPOLLERR)){
+			return EventDoneError;
+		}//else ignore spurious EPOLLHUP for just created sockets
+	}
+	if(_evs & EPOLLIN){
+		rv |= _rsock.doRecv();
+	}
+	if(!(rv & EventDoneError) && (_evs & EPOLLOUT)){
+		rv |= _rsock.doSend();
+	}
+	return rv;
+}
+
+ulong Selector::doAllIo(){
+	ulong		flags = 0;
+	uint32		evs;
+	uint32		stubpos;
+	uint8		gen;
+	uint32		mask;
+	uint32		sockpos;
+	uint64		ukey;
+	int			res;
+	size_t		stashpos(0);
+	const uint32 tail(__atomic_load_n(d.pcqtail, __ATOMIC_ACQUIRE));
+	Data::CqeVectorT	stashvec;
+	//first the completions moved off the ring
+	stashvec.swap(d.cqevec);
+
+	while(true){
+		if(stashpos < stashvec.size()){
+			ukey = stashvec[stashpos].user_data;
+			res = stashvec[stashpos].res;
+			++stashpos;
+		}else{
+			//handling might stash the ring, so reload its head
+			const uint32	head(*d.pcqhead);
+			if(static_cast<int32>(tail - head) <= 0){
+				break;
+			}
+			const io_uring_cqe	&rcqe(d.pcqes[head & d.cqmask]);
+			ukey = rcqe.user_data;
+			res = rcqe.res;
+			//release the entry before handling it, as handling might submit
+			__atomic_store_n(d.pcqhead, head + 1, __ATOMIC_RELEASE);
+		}
+
+		Data::stub(stubpos, gen, mask, sockpos, ukey);
+		vdbgx(Debug::aio, "stubpos = "<<stubpos<<" res = "<<res);
+		if(stubpos){
+			if(res == -ECANCELED || stubpos >= d.stubs.size()) continue;
+			Stub				&stub(d.stubs[stubpos]);
+			if(stub.objptr.empty() || stub.gen != gen || sockpos >= stub.objptr->stubcp){
+				//a completion for a poll of a gone object
+				continue;
+			}
+			Object::SocketStub	&sockstub(stub.objptr->pstubs[sockpos]);
+			if(!sockstub.psock || sockstub.psock->descriptor() < 0){
+				continue;
+			}
+			Socket				&sock(*sockstub.psock);
+
+			if(sockstub.selevents == mask){
+				//the currently armed poll - else a superseded one
+				sockstub.selevents = 0;
+				if(d.fdkeys[sock.descriptor()] == ukey){
+					d.fdkeys[sock.descriptor()] = Data::InvalidKey;
+				}
+			}
+
+			vdbgx(Debug::aio, "io events stubpos = "<<stubpos<<" events = "<<res);
+			evs = doIo(sock, res < 0 ? static_cast<ulong>(EPOLLERR) : static_cast<ulong>(res));
+			{
+				const uint t = sockstub.psock->ioRequest();
+				if(t && (sockstub.selevents & t) != t){
+					if(sockstub.selevents){
+						d.pollRemove(sock.descriptor());
+					}
+					sockstub.selevents = t;
+					if(!d.pollAdd(sock.descriptor(), t, Data::key(stubpos, stub.gen, t, sockpos))){
+						sockstub.selevents = 0;
+						evs |= EventDoneError;
+					}
+				}
+			}
+			if(evs){
+				//first mark the socket in connection
+				vdbgx(Debug::aio, "evs = "<<evs<<" indone = "<<EventDoneRecv<<" stubpos = "<<stubpos);
+				stub.objptr->socketPostEvents(sockpos, evs);
+				stub.events |= evs;
+				//push channel execqueue
+				if(stub.state == Stub::OutExecQueue){
+					d.pushExec(stubpos);
+					stub.state = Stub::InExecQueue;
+				}
+			}
+		}else if(ukey == Data::PipeKey){//the pipe stub
+			flags |= Data::READ_PIPE;
+		}//else a timeout or a poll remove completion
+	}
+	return flags;
+}
+struct Selector::TimerHandler{
+	TimerHandler(Selector &_rs):rs(_rs){}
+	void operator()(const size_t _pos){
+		rs.doTimeoutCheck(_pos);
+	}
+	Selector	&rs;
+};
+
+void Selector::doTimeoutCheck(const ulong _pos){
+	Stub	&stub(d.stubs[_pos]);
+	ulong	evs = 0;
+
+	if(stub.objptr.empty()) return;
+
+	if(d.ctimepos >= stub.itimepos){
+		evs |= stub.objptr->doOnTimeoutRecv(d.ctimepos);
+	}
+	if(d.ctimepos >= stub.otimepos){
+		evs |= stub.objptr->doOnTimeoutSend(d.ctimepos);
+	}
+	if(d.ctimepos >= stub.timepos){
+		evs |= EventTimeout;
+	}
+	if(evs){
+		stub.events |= evs;
+		if(stub.state == Stub::OutExecQueue){
+			d.pushExec(_pos);
+			stub.state = Stub::InExecQueue;
+		}
+	}
+	if(stub.state == Stub::OutExecQueue){
+		//a stale timer or the sockets have further timeouts
+		//objects in the execq are rescheduled after execution
+		doScheduleTimer(_pos);
+	}
+}
+
+void Selector::doScheduleTimer(const ulong _pos){
+	const Stub		&stub(d.stubs[_pos]);
+	const TimeSpec	*pts(&stub.timepos);
+
+	if(stub.itimepos < *pts){
+		pts = &stub.itimepos;
+	}
+	if(stub.otimepos < *pts){
+		pts = &stub.otimepos;
+	}
+	if(pts->isMax()){
+		d.timewheel.cancel(_pos);
+	}else{
+		d.timewheel.schedule(_pos, Data::tick(*pts));
+	}
+}
+
+ulong Selector::doTimeout(){
+	TimerHandler	th(*this);
+	const size_t	cnt(d.timewheel.advance(d.currentTick(), th));
+	if(cnt){
+		vdbgx(Debug::aio, "timeout count "<<cnt);
+	}
+	return 0;
+}
+
+void Selector::doFullScanCheck(Stub &_rstub, const ulong _pos){
+	if(_rstub.objptr->notified(S_RAISE)){
+		_rstub.events |= EventSignal;//should not be checked by objs
+		if(_rstub.state == Stub::OutExecQueue){
+			d.pushExec(_pos);
+			_rstub.state = Stub::InExecQueue;
+		}
+	}
+}
+ulong Selector::doFullScan(){
+	++d.rep_fullscancount;
+	idbgx(Debug::aio, "fullscan count "<<d.rep_fullscancount);
+	for(Data::StubVectorT::iterator it(d.stubs.begin()); it != d.stubs.end(); it += 4){
+		if(!it->objptr.empty()){
+			doFullScanCheck(*it, it - d.stubs.begin());
+		}
+		if(!(it + 1)->objptr.empty()){
+			doFullScanCheck(*(it + 1), it - d.stubs.begin() + 1);
+		}
+		if(!(it + 2)->objptr.empty()){
+			doFullScanCheck(*(it + 2), it - d.stubs.begin() + 2);
+		}
+		if(!(it + 3)->objptr.empty()){
+			doFullScanCheck(*(it + 3), it - d.stubs.begin() + 3);
+		}
+	}
+	return 0;
+}
+ulong Selector::doExecute(const ulong _pos){
+	Stub						&stub(d.stubs[_pos]);
+
+	cassert(stub.state == Stub::InExecQueue);
+	stub.state = Stub::OutExecQueue;
+
+	ulong						rv(0);
+
+	stub.objptr->doClearRequests();//clears the requests from object to selector
+	if(stub.objptr->hscnt){
+		stub.events |= stub.objptr->doHandshakeEvents();
+		if(stub.events == EventSignal && !stub.objptr->notified(~static_cast<size_t>(S_RAISE))){
+			//raised by the HandshakePool for a step which did not end the hand-shake
+			stub.events = 0;
+			doPrepareObjectWait(_pos, stub.timepos);
+			return 0;
+		}
+	}
+
+	Object::ExecuteController	exectl(stub.events, d.ctimepos);
+
+	stub.timepos = TimeSpec::maximum;
+
+	stub.events = 0;
+
+	idbgx(Debug::aio, "execute object "<<_pos);
+
+	this->associateObjectToCurrentThread(*stub.objptr);
+
+	d.exepos = _pos;
+	if(d.balmsec){
+		TimeSpec	ts(TimeSpec::createMonotonic());
+		this->executeObject(*stub.objptr, exectl);
+		TimeSpec	te(TimeSpec::createMonotonic());
+		te -= ts;
+		const uint64	ns(te.seconds() * 1000000000ULL + te.nanoSeconds());
+		stub.exetime += ns;
+		++stub.execnt;
+		d.balbusy += ns;
+	}else{
+		this->executeObject(*stub.objptr, exectl);
+	}
+	d.exepos = 0;
+
+	switch(exectl.returnValue()){
+		case Object::ExecuteContext::RescheduleRequest:
+			d.pushExec(_pos);
+			stub.state = Stub::InExecQueue;
+			stub.events |= EventReschedule;
+		case Object::ExecuteContext::WaitRequest:
+			doPrepareObjectWait(_pos, d.ctimepos);
+			break;
+		case Object::ExecuteContext::WaitUntilRequest:
+			doPrepareObjectWait(_pos, exectl.waitTime());
+			break;
+		case Object::ExecuteContext::CloseRequest:
+			idbgx(Debug::aio, "BAD: removing the connection");
+			d.freestubsstk.push(_pos);
+			//unregister all channels
+			doUnregisterObject(*stub.objptr);
+			//stub.objptr->doUnprepare();
+			this->stopObject(*stub.objptr);
+			stub.objptr.clear();
+			stub.reset();
+			d.timewheel.cancel(_pos);
+			++stub.gen;
+			--d.objsz;
+			rv = Data::EXIT_LOOP;
+			break;
+		case Object::ExecuteContext::LeaveRequest:
+			d.freestubsstk.push(_pos);
+			doUnregisterObject(*stub.objptr);
+			stub.reset();
+			d.timewheel.cancel(_pos);
+			++stub.gen;
+			--d.objsz;
+			stub.objptr->doUnprepare();
+			stub.objptr.release();
+			rv = Data::EXIT_LOOP;
+			break;
+		default:
+			cassert(false);
+	}
+	return rv;
+}
+void Selector::doPrepareObjectWait(const size_t _pos, const TimeSpec &_timepos){
+	Stub 					&stub(d.stubs[_pos]);
+	const size_t * const	pend(stub.objptr->reqpos);
+	bool 					mustwait = true;
+	vdbgx(Debug::aio, "stub "<<_pos);
+	for(const size_t *pit(stub.objptr->reqbeg); pit != pend; ++pit){
+		Object::SocketStub	&sockstub(stub.objptr->pstubs[*pit]);
+		const 				uint8 reqtp = sockstub.requesttype;
+		sockstub.requesttype = 0;
+		switch(reqtp){
+			case Object::SocketStub::IORequest:{
+				const uint t = sockstub.psock->ioRequest();
+				vdbgx(Debug::aio, "sockstub "<<*pit<<" ioreq "<<t);
+				//no syscall here - the poll is submitted together with the wait
+				if(t && (sockstub.selevents & t) != t){
+					vdbgx(Debug::aio, "sockstub "<<*pit);
+					if(sockstub.selevents){
+						d.pollRemove(sockstub.psock->descriptor());
+					}
+					sockstub.selevents = t;
+					if(!d.pollAdd(sockstub.psock->descriptor(), t, Data::key(_pos, stub.gen, t, *pit))){
+						sockstub.selevents = 0;
+						stub.objptr->socketPostEvents(*pit, EventDoneError);
+						mustwait = false;
+					}
+				}
+			}break;
+			case Object::SocketStub::RegisterRequest:{
+				vdbgx(Debug::aio, "sockstub "<<*pit<<" regreq");
+				sockstub.psock->doPrepare(d.zcthreshold, d.phspool);
+				sockstub.selevents = 0;
+				stub.objptr->socketPostEvents(*pit, EventDoneSuccess);
+				d.addNewSocket();
+				mustwait = false;
+			}break;
+			case Object::SocketStub::UnregisterRequest:{
+				vdbgx(Debug::aio, "sockstub "<<*pit<<" unregreq");
+				if(sockstub.psock->ok()){
+					d.pollRemove(sockstub.psock->descriptor());
+					sockstub.selevents = 0;
+					--d.socksz;
+					sockstub.psock->doUnprepare();
+					stub.objptr->socketPostEvents(*pit, EventDoneSuccess);
+					mustwait = false;
+				}
+			}break;
+			default:
+				cassert(false);
+		}
+	}
+	if(mustwait){
+		//will step here when, for example, the object waits for an external signal.
+		if(_timepos < stub.timepos && _timepos != d.ctimepos){
+			stub.timepos = _timepos;
+		}
+
+		if(stub.timepos == d.ctimepos){
+			stub.timepos = TimeSpec::maximum;
+		}
+		doScheduleTimer(_pos);
+	}else if(stub.state != Stub::InExecQueue){
+		d.pushExec(_pos);
+		stub.state = Stub::InExecQueue;
+	}
+}
+
+ulong Selector::doAddNewStub(){
+	ulong pos = 0;
+	if(d.freestubsstk.size()){
+		pos = d.freestubsstk.top();
+		d.freestubsstk.pop();
+	}else{
+		size_t cp = d.stubs.capacity();
+		pos = d.stubs.size();
+		size_t nextsize(fast_padding_size(pos, 2));
+		d.stubs.push_back(Stub());
+		for(size_t i(pos + 1); i < nextsize; ++i){
+			d.stubs.push_back(Stub());
+			d.freestubsstk.push(i);
+		}
+		d.timewheel.reserve(d.stubs.size());
+		if(cp != d.stubs.capacity()){
+			//we need to reset the aioobject's pointer to timepos
+			for(Data::StubVectorT::iterator it(d.stubs.begin()); it != d.stubs.end(); it += 4){
+				if(!it->objptr.empty()){
+					it->objptr->doPrepare(&it->itimepos, &it->otimepos);
+				}
+				if(!(it + 1)->objptr.empty()){
+					(it + 1)->objptr->doPrepare(&(it + 1)->itimepos, &(it + 1)->otimepos);
+				}
+				if(!(it + 2)->objptr.empty()){
+					(it + 2)->objptr->doPrepare(&(it + 2)->itimepos, &(it + 2)->otimepos);
+				}
+				if(!(it + 3)->objptr.empty()){
+					(it + 3)->objptr->doPrepare(&(it + 3)->itimepos, &(it + 3)->otimepos);
+				}
+			}
+		}
+	}
+	return pos;
+}
+
+//-------------------------------------------------------------
+}//namespace aio
+}//namespace frame
+}//namespace solid
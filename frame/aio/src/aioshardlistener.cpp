@@ -0,0 +1,108 @@
+// frame/aio/src/aioshardlistener.cpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#include "frame/aio/aioshardlistener.hpp"
+#include "frame/manager.hpp"
+#include "system/socketaddress.hpp"
+#include "system/cassert.hpp"
+#include "system/debug.hpp"
+#include "system/mutex.hpp"
+
+namespace solid{
+namespace frame{
+namespace aio{
+
+/*static*/ bool ShardListener::prepareAccept(
+	SocketDeviceVectorT &_rsdvec,
+	const SocketAddressStub &_rsas,
+	const size_t _cnt,
+	const size_t _listencnt
+){
+	SocketAddress		sa;
+	SocketAddressStub	sas(_rsas);
+	_rsdvec.clear();
+	_rsdvec.resize(_cnt);
+	for(SocketDeviceVectorT::iterator it(_rsdvec.begin()); it != _rsdvec.end(); ++it){
+		SocketDevice	&rsd(*it);
+		if(
+			!rsd.create(sas.family(), SocketInfo::Stream) ||
+			!rsd.makeNonBlocking() ||
+			!rsd.enableReusePort() ||
+			!rsd.prepareAccept(sas, _listencnt)
+		){
+			edbgx(Debug::aio, "preparing listener "<<(it - _rsdvec.begin())<<" of "<<_cnt<<": "<<specific_error_back().message());
+			_rsdvec.clear();
+			return false;
+		}
+		if(it == _rsdvec.begin() && !sas.port()){
+			//bind the others on the port the system chose for the first
+			if(!rsd.localAddress(sa)){
+				_rsdvec.clear();
+				return false;
+			}
+			sas = sa;
+		}
+	}
+	return true;
+}
+
+ShardListener::ShardListener(
+	const SocketDevice &_rsd, const size_t _acceptcnt
+):BaseT(_rsd, true), acceptcnt(_acceptcnt ? _acceptcnt : 1), state(0){
+	sdvec.reserve(acceptcnt);
+}
+
+ShardListener::~ShardListener(){
+}
+
+/*virtual*/ void ShardListener::execute(ExecuteContext &_rexectx){
+	cassert(this->socketOk());
+	if(notified()){
+		Locker<Mutex>	lock(Manager::specific().mutex(*this));
+		ulong sm = this->grabSignalMask();
+		if(sm & frame::S_KILL){
+			_rexectx.close();
+			return;
+		}
+	}
+	if(state == 1 && socketHasPendingRecv()){
+		//woken by a signal while waiting for connections
+		return;
+	}
+	while(true){
+		if(state == 0){
+			switch(this->socketAccept(sdvec, acceptcnt)){
+				case AsyncError:
+					_rexectx.close();
+					return;
+				case AsyncSuccess:break;
+				case AsyncWait:
+					state = 1;
+					return;
+			}
+		}
+		state = 0;
+		const bool	budgetdone(sdvec.size() >= acceptcnt);
+		for(SocketDeviceVectorT::iterator it(sdvec.begin()); it != sdvec.end(); ++it){
+			cassert(it->ok());
+			onAccept(*it);
+		}
+		sdvec.clear();
+		if(budgetdone){
+			//there might be more pending - let the other objects run first
+			_rexectx.reschedule();
+			return;
+		}
+		//most likely nothing pending: the accept will wait
+	}
+}
+
+}//namespace aio
+}//namespace frame
+}//namespace solid
@@ -10,13 +10,24 @@
 #include "frame/common.hpp"
 #include "frame/aio/src/aiosocket.hpp"
 #include "frame/aio/aiosecuresocket.hpp"
+#include "frame/aio/aiorecvbuffer.hpp"
+#include "frame/file/filestore.hpp"
 #include "system/socketaddress.hpp"
 #include "system/specific.hpp"
 #include "system/cassert.hpp"
 #include "system/debug.hpp"
 #include <cerrno>
 #include <cstring>
+#include <sys/uio.h>
+#include <poll.h>
 
+#ifdef ON_LINUX
+#include <sys/sendfile.h>
+#endif
+
+#ifdef HAS_ZEROCOPY
+#include <linux/errqueue.h>
+#endif
 
 #ifdef HAS_EPOLL
 
@@ -24,7 +35,8 @@
 
 enum{
 	FLAG_POLL_IN  = EPOLLIN,
-	FLAG_POLL_OUT = EPOLLOUT 
+	FLAG_POLL_OUT = EPOLLOUT,
+	FLAG_POLL_ERR = EPOLLERR
 };
 
 #endif
@@ -37,7 +49,8 @@ enum{
 
 enum{
 	FLAG_POLL_IN  = 1,
-	FLAG_POLL_OUT = 2 
+	FLAG_POLL_OUT = 2,
+	FLAG_POLL_ERR = 4
 };
 
 #endif
@@ -53,28 +66,42 @@ namespace aio{
 
 
 struct Socket::StationData{
-	StationData()/*:rcvaddrpair(rcvaddr)*/{}
+	StationData():prcvdgs(NULL), rcvdgcnt(0), psnddgs(NULL), snddgcnt(0)/*:rcvaddrpair(rcvaddr)*/{}
 	static unsigned specificCount(){return 0xffffff;}
 	void specificRelease(){
 		sndaddrpair.clear();
+		prcvdgs = NULL;
+		rcvdgcnt = 0;
+		psnddgs = NULL;
+		snddgcnt = 0;
 	}
 	SocketAddress		rcvaddr;
 	//SocketAddressStub	rcvaddrpair;
 	SocketAddressStub	sndaddrpair;
+	RecvDatagram		*prcvdgs;//the list of a pending batched receive, NULL if none
+	size_t				rcvdgcnt;
+	const SendDatagram	*psnddgs;//the rest of a pending batched send, NULL if none
+	size_t				snddgcnt;
 };
 
 struct Socket::AcceptorData{
-	AcceptorData():psd(NULL){}
+	AcceptorData():psd(NULL), psdvec(NULL), cnt(0){}
 	static unsigned specificCount(){return 0xffffff;}
-	void specificRelease(){psd = NULL;}
-	SocketDevice	*psd;
+	void specificRelease(){psd = NULL; psdvec = NULL; cnt = 0;}
+	SocketDevice		*psd;
+	SocketDeviceVectorT	*psdvec;//not NULL for a pending batched accept
+	size_t				cnt;//how many connections the batched accept can take
 };
 
 
 Socket::Socket(Type _type, SecureSocket *_pss):
 	pss(NULL),
 	type(_type), want(0), rcvcnt(0), sndcnt(0),
-	rcvbuf(NULL), sndbuf(NULL), rcvlen(0), sndlen(0), ioreq(0)
+	rcvbuf(NULL), sndbuf(NULL), rcvlen(0), sndlen(0), ioreq(0),
+	sndvec(NULL), sndveccnt(0), rcvvec(NULL), rcvveccnt(0), prcvbuf(NULL), secbuf(NULL),
+	sndfile(NULL), sndfileoff(0), sndfilelen(0),
+	zcthreshold(0), zcseq(0), zcdone(0), zcsend(false), ktls(false),
+	phspool(NULL), phsjob(NULL)
 {
 	d.psd = NULL;
 }
@@ -83,7 +110,11 @@ Socket::Socket(Type _type, const SocketDevice &_rsd, SecureSocket *_pss):
 	sd(_rsd),
 	pss(NULL),
 	type(_type), want(0), rcvcnt(0), sndcnt(0),
-	rcvbuf(NULL), sndbuf(NULL), rcvlen(0), sndlen(0), ioreq(0)
+	rcvbuf(NULL), sndbuf(NULL), rcvlen(0), sndlen(0), ioreq(0),
+	sndvec(NULL), sndveccnt(0), rcvvec(NULL), rcvveccnt(0), prcvbuf(NULL), secbuf(NULL),
+	sndfile(NULL), sndfileoff(0), sndfilelen(0),
+	zcthreshold(0), zcseq(0), zcdone(0), zcsend(false), ktls(false),
+	phspool(NULL), phsjob(NULL)
 {	
 	sd.makeNonBlocking();
 	secureSocket(_pss);
@@ -91,7 +122,15 @@ Socket::Socket(Type _type, const SocketDevice &_rsd, SecureSocket *_pss):
 }
 
 Socket::~Socket(){
-	delete pss;
+	if(phsjob){
+		//a step might still run on the pool - the job takes the secure socket and the descriptor
+		phsjob->orphan = true;
+		phsjob->sd = sd;
+		HandshakePool::release(*phsjob);
+	}else{
+		delete pss;
+	}
+	delete []secbuf;
 }
 
 
@@ -134,10 +173,65 @@ AsyncE Socket::accept(Socket &_rs){
 	return static_cast<AsyncE>(rv);
 }
 
+AsyncE Socket::accept(SocketDeviceVectorT &_rsdvec, const size_t _cnt){
+	cassert(type == ACCEPTOR);
+	const AsyncE rv = doAcceptMany(_rsdvec, _cnt);
+	if(rv == AsyncWait){
+		d.pad->psdvec = &_rsdvec;
+		d.pad->cnt = _cnt;
+		rcvbuf = reinterpret_cast<char*>(1);
+		rcvlen = 0;
+		ioreq |= FLAG_POLL_IN;
+	}
+	return rv;
+}
+
+AsyncE Socket::doAcceptMany(SocketDeviceVectorT &_rsdvec, const size_t _cnt){
+	const size_t	sz(_rsdvec.size());
+	solid::AsyncE	rv(solid::AsyncSuccess);
+	for(size_t i(0); i < _cnt; ++i){
+		_rsdvec.push_back(SocketDevice());
+		rv = sd.acceptNonBlocking(_rsdvec.back(), true);
+		if(rv != solid::AsyncSuccess){
+			_rsdvec.pop_back();
+			break;
+		}
+	}
+	vdbgx(Debug::aio, "accepted "<<(_rsdvec.size() - sz)<<" rv = "<<rv);
+	if(_rsdvec.size() != sz){
+		//an error is reported on the next call
+		return AsyncSuccess;
+	}
+	return static_cast<AsyncE>(rv);
+}
+
 AsyncE Socket::doSendPlain(const char* _pb, uint32 _bl, uint32 _flags){
 	cassert(!isSendPending());
 	cassert(type == CHANNEL);
 	if(!_bl) return AsyncSuccess;
+	if(zcthreshold && _bl >= zcthreshold){
+		sndbuf = _pb;
+		sndlen = _bl;
+		zcsend = true;
+		const int rv = doSendZeroCopy();
+		if(rv == 0){
+			ioreq |= FLAG_POLL_OUT;
+			return AsyncWait;
+		}
+		if(rv > 0 && doReadErrorQueue()){
+			if(zcdone == zcseq){
+				sndbuf = NULL;
+				zcsend = false;
+				return AsyncSuccess;
+			}
+			//the buffer stays pinned till the kernel releases it
+			ioreq |= FLAG_POLL_ERR;
+			return AsyncWait;
+		}
+		sndbuf = NULL;
+		zcsend = false;
+		return AsyncError;
+	}
 	int rv = sd.send(_pb, _bl);
 	if(rv == (int)_bl){
 		sndlen = 0;
@@ -173,6 +267,467 @@ AsyncE Socket::doRecvPlain(char *_pb, uint32 _bl, uint32 _flags){
 	return AsyncWait;
 }
 
+AsyncE Socket::sendv(const IoBuffer *_pbufs, const size_t _bufcnt, uint32 _flags){
+	cassert(!isSendPending());
+	cassert(type == CHANNEL);
+	if(!_bufcnt) return AsyncSuccess;
+	sndvec = _pbufs;
+	sndveccnt = _bufcnt;
+	sndlen = 0;
+	if(isPlainSend()){
+		sndbuf = "";
+		doAdvanceSend(0);
+		switch(doSendv()){
+			case 1:
+				sndbuf = NULL;
+				sndvec = NULL;
+				return AsyncSuccess;
+			case 0:
+				ioreq |= FLAG_POLL_OUT;
+				return AsyncWait;
+		}
+	}else{
+		switch(doSecureSendv()){
+			case 1:
+				sndbuf = NULL;
+				sndvec = NULL;
+				return AsyncSuccess;
+			case 0:
+				return AsyncWait;
+		}
+	}
+	sndbuf = NULL;
+	sndvec = NULL;
+	return AsyncError;
+}
+
+AsyncE Socket::recvv(IoBuffer *_pbufs, const size_t _bufcnt, uint32 _flags){
+	cassert(!isRecvPending());
+	cassert(type == CHANNEL);
+	rcvvec = _pbufs;
+	rcvveccnt = _bufcnt;
+	rcvlen = 0;
+	for(size_t i = 0; i < _bufcnt; ++i){
+		rcvlen += _pbufs[i].bl;
+	}
+	if(!rcvlen){
+		rcvvec = NULL;
+		return AsyncSuccess;
+	}
+	const int rv = (pss == NULL) ? doRecvv() : doSecureRecvv();
+	if(rv > 0){
+		rcvvec = NULL;
+		rcvlen = rv;
+		rcvcnt += rv;
+		return AsyncSuccess;
+	}
+	if(rv == 0 || (pss == NULL && errno != EAGAIN)){
+		rcvvec = NULL;
+		return AsyncError;
+	}
+	if(pss != NULL){
+		const int w = pss->wantEvents();
+		if(!w){
+			rcvvec = NULL;
+			return AsyncError;
+		}
+		doWantRead(w);
+	}
+	rcvbuf = reinterpret_cast<char*>(1);
+	ioreq |= FLAG_POLL_IN;
+	return AsyncWait;
+}
+
+AsyncE Socket::recv(RecvBuffer &_rrb, uint32 _flags){
+	cassert(!isRecvPending());
+	cassert(type == CHANNEL);
+	const int rv = doRecvBuffer(_rrb);
+	if(rv > 0){
+		rcvlen = rv;
+		rcvcnt += rv;
+		return AsyncSuccess;
+	}
+	if(rv == 0 || (pss == NULL && errno != EAGAIN)){
+		_rrb.clear();
+		return AsyncError;
+	}
+	if(pss != NULL){
+		const int w = pss->wantEvents();
+		if(!w){
+			_rrb.clear();
+			return AsyncError;
+		}
+		doWantRead(w);
+	}
+	//an idle connection keeps no buffer
+	_rrb.clear();
+	prcvbuf = &_rrb;
+	rcvlen = 0;
+	rcvbuf = reinterpret_cast<char*>(1);
+	ioreq |= FLAG_POLL_IN;
+	return AsyncWait;
+}
+
+//! Read all the available data into the adaptive buffer
+/*!
+	Plain sockets stop on a short read - the socket was drained, so
+	with edge triggered notifications the next receive gets EAGAIN and
+	waits. The TLS reads return at most a record, so secure sockets stop
+	only when the secure socket wants events.
+	\retval >0 the size received, 0 the connection was closed, <0 wait or error
+*/
+int Socket::doRecvBuffer(RecvBuffer &_rrb){
+	char	*pb(_rrb.doPrepare());
+	uint32	sz(0);
+	while(true){
+		const uint32	len(_rrb.doCapacity() - sz);
+		const int		rv((pss == NULL) ? sd.recv(pb + sz, len) : pss->recv(pb + sz, len));
+		vdbgx(Debug::aio, "recv rv = "<<rv<<" len = "<<len<<" sz = "<<sz);
+		if(rv <= 0){
+			if(sz) break;//the error or the wait comes with the next receive
+			return rv;
+		}
+		sz += rv;
+		if(pss == NULL && static_cast<uint32>(rv) < len) break;
+		if(sz == _rrb.doCapacity()){
+			if(!_rrb.doGrow(sz)) break;
+			pb = _rrb.data();
+		}
+	}
+	_rrb.doDone(sz, sd);
+	return sz;
+}
+
+//! Consume _sz sent bytes from the pending buffer and load the next buffers of the list
+/*!
+	Stops on the first buffer not entirely sent - so, unless the list
+	is done, sndlen is never zero afterwards.
+*/
+void Socket::doAdvanceSend(size_t _sz){
+	while(_sz >= sndlen){
+		_sz -= sndlen;
+		if(!sndveccnt){
+			sndlen = 0;
+			return;
+		}
+		sndbuf = sndvec->pb;
+		sndlen = sndvec->bl;
+		++sndvec;
+		--sndveccnt;
+	}
+	sndbuf += _sz;
+	sndlen -= _sz;
+}
+
+//! Write the pending list with writev
+/*!
+	\retval 1 all was sent, 0 the socket is full, -1 error
+*/
+int Socket::doSendv(){
+	while(sndlen){
+		struct iovec	iov[MaxIoVectorCount];
+		size_t			iovcnt(1);
+		size_t			sz(sndlen);
+		
+		iov[0].iov_base = const_cast<char*>(sndbuf);
+		iov[0].iov_len = sndlen;
+		for(size_t i = 0; i < sndveccnt && iovcnt < MaxIoVectorCount; ++i){
+			iov[iovcnt].iov_base = sndvec[i].pb;
+			iov[iovcnt].iov_len = sndvec[i].bl;
+			sz += sndvec[i].bl;
+			++iovcnt;
+		}
+		const ssize_t rv = ::writev(descriptor(), iov, iovcnt);
+		vdbgx(Debug::aio, "writev rv = "<<rv<<" iovcnt = "<<iovcnt);
+		if(rv < 0){
+			return errno == EAGAIN ? 0 : -1;
+		}
+		sndcnt += rv;
+		doAdvanceSend(rv);
+		if(static_cast<size_t>(rv) < sz){
+			return sndlen ? 0 : 1;
+		}
+	}
+	return 1;
+}
+
+//! Read into the pending list with readv
+int Socket::doRecvv(){
+	struct iovec	iov[MaxIoVectorCount];
+	size_t			iovcnt(0);
+	for(size_t i = 0; i < rcvveccnt && iovcnt < MaxIoVectorCount; ++i){
+		iov[iovcnt].iov_base = rcvvec[i].pb;
+		iov[iovcnt].iov_len = rcvvec[i].bl;
+		++iovcnt;
+	}
+	return ::readv(descriptor(), iov, iovcnt);
+}
+
+//! Prepare the next chunk of the list to be sent over the secure socket
+/*!
+	Consecutive buffers are copied into secbuf as long as they fit in a
+	SecureChunkSize chunk, so that they go in a single TLS record.
+	A buffer bigger than that is sent in place.
+*/
+void Socket::doCoalesceSend(){
+	while(sndveccnt && !sndvec->bl){
+		++sndvec;
+		--sndveccnt;
+	}
+	if(!sndveccnt) return;
+	if(sndveccnt == 1 || sndvec->bl >= SecureChunkSize){
+		sndbuf = sndvec->pb;
+		sndlen = sndvec->bl;
+		++sndvec;
+		--sndveccnt;
+		return;
+	}
+	if(!secbuf){
+		secbuf = new char[SecureChunkSize];
+	}
+	sndbuf = secbuf;
+	sndlen = 0;
+	while(sndveccnt && (sndlen + sndvec->bl) <= SecureChunkSize){
+		memcpy(secbuf + sndlen, sndvec->pb, sndvec->bl);
+		sndlen += sndvec->bl;
+		++sndvec;
+		--sndveccnt;
+	}
+}
+
+//! Send the pending list over the secure socket, chunk by chunk
+/*!
+	On want, the chunk stays as is - the secure socket must be retried
+	with the same buffer.
+	\retval 1 all was sent, 0 waiting for the wanted events, -1 error
+*/
+int Socket::doSecureSendv(){
+	while(true){
+		if(!sndlen){
+			doCoalesceSend();
+			if(!sndlen) return 1;
+		}
+		const int rv = pss->send(sndbuf, sndlen);
+		vdbgx(Debug::aio, "secure send rv = "<<rv<<" len = "<<sndlen);
+		if(rv > 0){
+			sndcnt += rv;
+			sndbuf += rv;
+			sndlen -= rv;
+			continue;
+		}
+		if(rv == 0) return -1;
+		const int w = pss->wantEvents();
+		if(!w) return -1;
+		doWantWrite(w);
+		return 0;
+	}
+}
+
+//! Receive over the secure socket, filling the buffers of the list in order
+/*!
+	Stops on the first buffer not entirely filled.
+	\retval >0 the received size, 0 the connection was closed, <0 see wantEvents
+*/
+int Socket::doSecureRecvv(){
+	int sz(0);
+	for(size_t i = 0; i < rcvveccnt; ++i){
+		if(!rcvvec[i].bl) continue;
+		const int rv = pss->recv(rcvvec[i].pb, rcvvec[i].bl);
+		if(rv > 0){
+			sz += rv;
+			if(static_cast<uint32>(rv) < rcvvec[i].bl) break;
+			continue;
+		}
+		if(sz) break;
+		return rv;
+	}
+	return sz;
+}
+
+AsyncE Socket::sendFile(file::File &_rfile, int64 _off, uint64 _len){
+	cassert(!isSendPending());
+	cassert(type == CHANNEL);
+	if(!_len) return AsyncSuccess;
+	sndfile = &_rfile;
+	sndfileoff = _off;
+	sndfilelen = _len;
+	sndbuf = "";
+	sndlen = 0;
+	switch(doSendFile()){
+		case 1:
+			sndbuf = NULL;
+			sndfile = NULL;
+			return AsyncSuccess;
+		case 0:
+			if(isPlainSend()){
+				ioreq |= FLAG_POLL_OUT;
+			}
+			return AsyncWait;
+	}
+	sndbuf = NULL;
+	sndfile = NULL;
+	return AsyncError;
+}
+
+//! Send the pending file range
+/*!
+	Uses sendfile for files on disk over plain and kernel TLS sockets.
+	\retval 1 all was sent, 0 waiting for the socket, -1 error
+*/
+int Socket::doSendFile(){
+#ifdef ON_LINUX
+	const int fd = sndfile->descriptor();
+	if(isPlainSend() && fd >= 0){
+		while(sndfilelen){
+			off_t			off(sndfileoff);
+			const size_t	sz(sndfilelen < MaxSendFileSize ? sndfilelen : MaxSendFileSize);
+			const ssize_t	rv = ::sendfile(descriptor(), fd, &off, sz);
+			vdbgx(Debug::aio, "sendfile rv = "<<rv<<" off = "<<sndfileoff<<" len = "<<sndfilelen);
+			if(rv < 0){
+				return errno == EAGAIN ? 0 : -1;
+			}
+			if(rv == 0) return -1;//the file is shorter than the requested range
+			sndcnt += rv;
+			sndfileoff += rv;
+			sndfilelen -= rv;
+		}
+		return 1;
+	}
+#endif
+	return doBufferedSendFile();
+}
+
+//! Send the pending file range by reading it chunk by chunk into secbuf
+/*!
+	A chunk not entirely sent stays in place, as the secure socket
+	must be retried with the same buffer.
+	\retval 1 all was sent, 0 waiting for the socket, -1 error
+*/
+int Socket::doBufferedSendFile(){
+	while(true){
+		if(!sndlen){
+			if(!sndfilelen) return 1;
+			if(!secbuf){
+				secbuf = new char[SecureChunkSize];
+			}
+			const uint32	sz(sndfilelen < SecureChunkSize ? sndfilelen : SecureChunkSize);
+			const int		rv = sndfile->read(secbuf, sz, sndfileoff);
+			vdbgx(Debug::aio, "file read rv = "<<rv<<" off = "<<sndfileoff);
+			if(rv <= 0) return -1;
+			sndbuf = secbuf;
+			sndlen = rv;
+			sndfileoff += rv;
+			sndfilelen -= rv;
+		}
+		const int rv = isPlainSend() ? sd.send(sndbuf, sndlen) : pss->send(sndbuf, sndlen);
+		if(rv > 0){
+			sndcnt += rv;
+			sndbuf += rv;
+			sndlen -= rv;
+			continue;
+		}
+		if(rv == 0) return -1;
+		if(isPlainSend()){
+			return errno == EAGAIN ? 0 : -1;
+		}
+		const int w = pss->wantEvents();
+		if(!w) return -1;
+		doWantWrite(w);
+		return 0;
+	}
+}
+
+//! Send the pending buffer with MSG_ZEROCOPY
+/*!
+	Every send call that queues data gets the next completion id.
+	\retval 1 all was queued, 0 the socket is full, -1 error
+*/
+int Socket::doSendZeroCopy(){
+#ifdef HAS_ZEROCOPY
+	while(sndlen){
+		ssize_t rv = ::send(descriptor(), sndbuf, sndlen, MSG_ZEROCOPY);
+		if(rv > 0){
+			++zcseq;
+		}else if(rv < 0 && errno == ENOBUFS){
+			//too many pinned pages for the socket option memory - copy this piece
+			rv = ::send(descriptor(), sndbuf, sndlen, 0);
+		}
+		vdbgx(Debug::aio, "zerocopy send rv = "<<rv<<" len = "<<sndlen<<" seq = "<<zcseq);
+		if(rv < 0){
+			return errno == EAGAIN ? 0 : -1;
+		}
+		if(rv == 0) return -1;
+		sndcnt += rv;
+		sndbuf += rv;
+		sndlen -= rv;
+	}
+	return 1;
+#else
+	return -1;
+#endif
+}
+
+//! Read the MSG_ZEROCOPY completions from the socket error queue
+/*!
+	Each completion covers a range of send ids. Returns false on
+	errors or on unexpected entries in the queue.
+*/
+bool Socket::doReadErrorQueue(){
+#ifdef HAS_ZEROCOPY
+	while(zcdone != zcseq){
+		char		ctlbuf[128];
+		msghdr		msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = ctlbuf;
+		msg.msg_controllen = sizeof(ctlbuf);
+		if(::recvmsg(descriptor(), &msg, MSG_ERRQUEUE) < 0){
+			return errno == EAGAIN;
+		}
+		for(cmsghdr *pcmsg = CMSG_FIRSTHDR(&msg); pcmsg != NULL; pcmsg = CMSG_NXTHDR(&msg, pcmsg)){
+			if(
+				!(pcmsg->cmsg_level == SOL_IP && pcmsg->cmsg_type == IP_RECVERR) &&
+				!(pcmsg->cmsg_level == SOL_IPV6 && pcmsg->cmsg_type == IPV6_RECVERR)
+			){
+				continue;
+			}
+			const sock_extended_err	*pserr = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(pcmsg));
+			if(pserr->ee_errno != 0 || pserr->ee_origin != SO_EE_ORIGIN_ZEROCOPY){
+				return false;
+			}
+			zcdone += pserr->ee_data - pserr->ee_info + 1;
+			vdbgx(Debug::aio, "zerocopy done ["<<pserr->ee_info<<", "<<pserr->ee_data<<"] code = "<<pserr->ee_code);
+			if(pserr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED){
+				//the device cannot send from user pages (e.g. loopback) so the kernel
+				//copied anyway - zero copy would only add the completions
+				zcthreshold = 0;
+			}
+		}
+	}
+#endif
+	return true;
+}
+
+//! Called by the selector when the socket signals an error
+/*!
+	For sockets using MSG_ZEROCOPY, the error only tells there are
+	completions in the error queue - unless the socket is really in error.
+*/
+ulong Socket::doZeroCopyCompletions(){
+	if(!doReadErrorQueue()) return EventDoneError;
+	int			err(0);
+	socklen_t	len(sizeof(err));
+	if(getsockopt(descriptor(), SOL_SOCKET, SO_ERROR, &err, &len) || err){
+		return EventDoneError;
+	}
+	if(zcsend && !sndlen && zcdone == zcseq){
+		sndbuf = NULL;
+		zcsend = false;
+		ioreq &= ~FLAG_POLL_ERR;
+		return EventDoneSend;
+	}
+	return EventNone;
+}
+
 uint32 Socket::recvSize()const{
 	return rcvlen;
 }
@@ -239,16 +794,93 @@ AsyncE Socket::sendTo(const char *_pb, uint32 _bl, const SocketAddressStub &_sap
 	return AsyncWait;
 }
 
+AsyncE Socket::recvFrom(RecvDatagram *_pdgs, const size_t _cnt, uint32 _flags){
+	if(!_cnt) return AsyncSuccess;
+	cassert(!isRecvPending());
+	cassert(type == STATION);
+	const int rv = doRecvFromMany(_pdgs, _cnt);
+	if(rv > 0) return AsyncSuccess;
+	if(rv == 0 || errno != EAGAIN) return AsyncError;
+	d.psd->prcvdgs = _pdgs;
+	d.psd->rcvdgcnt = _cnt;
+	rcvbuf = reinterpret_cast<char*>(1);
+	rcvlen = 0;
+	ioreq |= FLAG_POLL_IN;
+	return AsyncWait;
+}
+
+AsyncE Socket::sendTo(const SendDatagram *_pdgs, const size_t _cnt, uint32 _flags){
+	if(!_cnt) return AsyncSuccess;
+	cassert(!isSendPending());
+	cassert(type == STATION);
+	d.psd->psnddgs = _pdgs;
+	d.psd->snddgcnt = _cnt;
+	switch(doSendToMany()){
+		case 1:
+			d.psd->psnddgs = NULL;
+			return AsyncSuccess;
+		case 0:
+			sndbuf = "";
+			sndlen = 0;
+			ioreq |= FLAG_POLL_OUT;
+			return AsyncWait;
+	}
+	d.psd->psnddgs = NULL;
+	return AsyncError;
+}
+
+//! Receive a batch of datagrams, recvSize being the number of datagrams
+int Socket::doRecvFromMany(RecvDatagram *_pdgs, const size_t _cnt){
+	const int rv = sd.recv(_pdgs, _cnt);
+	vdbgx(Debug::aio, "recv datagrams rv = "<<rv<<" cnt = "<<_cnt);
+	if(rv > 0){
+		rcvlen = rv;
+		for(int i(0); i < rv; ++i){
+			rcvcnt += _pdgs[i].sz;
+		}
+	}
+	return rv;
+}
+
+//! Send the rest of the pending datagrams
+/*!
+	\retval 1 all sent, 0 wait for the socket to be writable, -1 error
+*/
+int Socket::doSendToMany(){
+	while(d.psd->snddgcnt){
+		const int rv = sd.send(d.psd->psnddgs, d.psd->snddgcnt);
+		vdbgx(Debug::aio, "send datagrams rv = "<<rv<<" cnt = "<<d.psd->snddgcnt);
+		if(rv < 0){
+			return errno == EAGAIN ? 0 : -1;
+		}
+		for(int i(0); i < rv; ++i){
+			sndcnt += d.psd->psnddgs[i].bl;
+		}
+		d.psd->psnddgs += rv;
+		d.psd->snddgcnt -= rv;
+	}
+	return 1;
+}
+
 const SocketAddress &Socket::recvAddr()const{
 	return d.psd->rcvaddr;
 }
 
-void Socket::doPrepare(){
+void Socket::doPrepare(const uint32 _zcthreshold, HandshakePool *_phspool){
+	phspool = _phspool;
 	switch(type){
 		case ACCEPTOR:
 			d.pad = Specific::uncache<Socket::AcceptorData>();
 			break;
 		case CHANNEL:
+#ifdef HAS_ZEROCOPY
+			if(_zcthreshold && !zcthreshold && !isZeroCopy() && pss == NULL){
+				int one(1);
+				if(setsockopt(descriptor(), SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0){
+					zcthreshold = _zcthreshold;
+				}
+			}
+#endif
 			break;
 		case STATION:
 			d.psd = Specific::uncache<Socket::StationData>();
@@ -284,9 +916,36 @@ void Socket::doUnprepare(){
 ulong Socket::doSendPlain(){
 	switch(type){
 		case CHANNEL://tcp
-			if(sndlen && sndbuf){//NOTE: see the above note
-				const int rv = sd.send(sndbuf, sndlen);
+			if(sndfile){
+				const int rv = doSendFile();
+				if(rv < 0) return EventDoneError;
+				if(rv == 0) return EventNone;//not yet done
+				sndfile = NULL;
+			}else if(sndvec){
+				const int rv = doSendv();
+				if(rv < 0) return EventDoneError;
+				if(rv == 0) return EventNone;//not yet done
+				sndvec = NULL;
+			}else if(zcsend){
+				if(sndlen){
+					const int rv = doSendZeroCopy();
+					if(rv < 0) return EventDoneError;
+					if(rv == 0) return EventNone;//not yet done
+					ioreq &= ~FLAG_POLL_OUT;
+					if(!doReadErrorQueue()) return EventDoneError;
+				}
+				if(zcdone != zcseq){
+					//wait for the kernel to release the buffer - see doZeroCopyCompletions
+					ioreq |= FLAG_POLL_ERR;
+					return EventNone;
+				}
+				ioreq &= ~FLAG_POLL_ERR;
+				zcsend = false;
+			}else if(sndlen && sndbuf){//NOTE: see the above note
+				const int	rv = sd.send(sndbuf, sndlen);
+				const bool	again(rv < 0 && errno == EAGAIN);
 				vdbgx(Debug::aio, "send rv = "<<rv);
+				if(again) return EventNone;//spurious readiness
 				if(rv <= 0) return EventDoneError;
 				sndbuf += rv;
 				sndlen -= rv;
@@ -297,8 +956,14 @@ ulong Socket::doSendPlain(){
 			ioreq &= ~FLAG_POLL_OUT;
 			return EventDoneSend;
 		case STATION://udp
-			if(sndlen && sndbuf){//NOTE: see the above note
+			if(d.psd->psnddgs){
+				const int rv = doSendToMany();
+				if(rv < 0) return EventDoneError;
+				if(rv == 0) return EventNone;//not yet done
+				d.psd->psnddgs = NULL;
+			}else if(sndlen && sndbuf){//NOTE: see the above note
 				const int rv = sd.send(sndbuf, sndlen, d.psd->sndaddrpair);
+				if(rv < 0 && errno == EAGAIN) return EventNone;//spurious readiness
 				if(rv != (int)sndlen) return EventDoneError;
 				sndcnt += rv;
 				sndlen = 0;
@@ -314,9 +979,32 @@ ulong Socket::doSendPlain(){
 ulong Socket::doRecvPlain(){
 	switch(type){
 		case CHANNEL://tcp
-			if(rcvlen && rcvbuf){//NOTE: see the above note
-				const int rv = sd.recv(rcvbuf, rcvlen);
+			if(prcvbuf){
+				const int rv = doRecvBuffer(*prcvbuf);
+				if(rv <= 0){
+					const bool again(rv < 0 && errno == EAGAIN);
+					prcvbuf->clear();
+					if(again) return EventNone;//spurious readiness
+					prcvbuf = NULL;
+					return EventDoneError;
+				}
+				prcvbuf = NULL;
+				rcvcnt += rv;
+				rcvlen = rv;
+			}else if(rcvvec){
+				const int	rv = doRecvv();
+				const bool	again(rv < 0 && errno == EAGAIN);
+				vdbgx(Debug::aio, "readv rv = "<<rv);
+				if(again) return EventNone;//spurious readiness
+				rcvvec = NULL;
+				if(rv <= 0) return EventDoneError;
+				rcvcnt += rv;
+				rcvlen = rv;
+			}else if(rcvlen && rcvbuf){//NOTE: see the above note
+				const int	rv = sd.recv(rcvbuf, rcvlen);
+				const bool	again(rv < 0 && errno == EAGAIN);
 				vdbgx(Debug::aio, "recv rv = "<<rv<<" err = "<<strerror(errno)<<" rcvbuf = "<<(void*)rcvbuf<<" rcvlen = "<<rcvlen);
+				if(again) return EventNone;//spurious readiness
 				if(rv <= 0) return EventDoneError;
 				rcvcnt += rv;
 				rcvlen = rv;
@@ -325,8 +1013,14 @@ ulong Socket::doRecvPlain(){
 			ioreq &= ~FLAG_POLL_IN;
 			return EventDoneRecv;
 		case STATION://udp
-			if(rcvlen && rcvbuf){//NOTE: see the above note
+			if(d.psd->prcvdgs){
+				const int rv = doRecvFromMany(d.psd->prcvdgs, d.psd->rcvdgcnt);
+				if(rv < 0 && errno == EAGAIN) return EventNone;//spurious readiness
+				d.psd->prcvdgs = NULL;
+				if(rv <= 0) return EventDoneError;
+			}else if(rcvlen && rcvbuf){//NOTE: see the above note
 				const int rv = sd.recv(rcvbuf, rcvlen, d.psd->rcvaddr);
+				if(rv < 0 && errno == EAGAIN) return EventNone;//spurious readiness
 				if(rv <= 0) return EventDoneError;
 				rcvcnt += rv;
 				rcvlen = rv;
@@ -336,6 +1030,15 @@ ulong Socket::doRecvPlain(){
 			ioreq &= ~FLAG_POLL_IN;
 			return EventDoneRecv;
 		case ACCEPTOR:{
+			if(d.pad->psdvec){
+				const AsyncE rv = doAcceptMany(*d.pad->psdvec, d.pad->cnt);
+				if(rv == AsyncWait) return EventNone;//the connection was reset meanwhile
+				d.pad->psdvec = NULL;
+				rcvbuf = NULL;
+				ioreq &= ~FLAG_POLL_IN;
+				if(rv == AsyncSuccess) return EventDoneSend;
+				return EventDoneError;
+			}
 			const bool rv = sd.accept(*d.pad->psd);
 			sndbuf = NULL;
 			ioreq &= ~FLAG_POLL_IN;
@@ -349,7 +1052,16 @@ ulong Socket::doRecvPlain(){
 void  Socket::doClear(){
 	rcvbuf = NULL;
 	sndbuf = NULL;
+	rcvvec = NULL;
+	prcvbuf = NULL;
+	sndvec = NULL;
+	sndfile = NULL;
+	zcsend = false;
 	ioreq = 0;
+	if(type == STATION && d.psd){
+		d.psd->prcvdgs = NULL;
+		d.psd->psnddgs = NULL;
+	}
 }
 
 inline void Socket::doWantAccept(int _w){
@@ -436,12 +1148,17 @@ AsyncE Socket::doRecvSecure(char *_pb, uint32 _bl, uint32 _flags){
 }
 
 ulong Socket::doSecureAccept(){
+	if(phsjob){
+		doPushHandshake();
+		return EventNone;
+	}
 	const AsyncE rv = pss->secureAccept();
 	vdbgx(Debug::aio, " secureaccept "<<rv);
 	ioreq = 0;
 	want = 0;
 	if(rv == AsyncSuccess){
 		rcvbuf = NULL;
+		doSecureDone();
 		return EventDoneSend;
 	}
 	if(rv == AsyncError){
@@ -453,11 +1170,16 @@ ulong Socket::doSecureAccept(){
 }
 
 ulong Socket::doSecureConnect(){
+	if(phsjob){
+		doPushHandshake();
+		return EventNone;
+	}
 	const AsyncE rv = pss->secureConnect();
 	ioreq = 0;
 	want = 0;
 	if(rv == AsyncSuccess){
 		sndbuf = NULL;
+		doSecureDone();
 		return EventDoneSend;
 	}
 	if(rv == AsyncError){
@@ -473,7 +1195,21 @@ ulong Socket::doSecureReadWrite(int _w){
 	int w = _w & (SecureSocket::WANT_WRITE_ON_WRITE | SecureSocket::WANT_READ_ON_WRITE);
 	if(w){
 		want &= (~w);
-		if(sndlen && sndbuf){//NOTE: see the above note
+		if(sndfile){
+			const int rv = doBufferedSendFile();
+			if(rv < 0) return EventDoneError;
+			if(rv == 0) return EventNone;
+			sndbuf = NULL;
+			sndfile = NULL;
+			retval |= EventDoneSend;
+		}else if(sndvec){
+			const int rv = doSecureSendv();
+			if(rv < 0) return EventDoneError;
+			if(rv == 0) return EventNone;
+			sndbuf = NULL;
+			sndvec = NULL;
+			retval |= EventDoneSend;
+		}else if(sndlen && sndbuf){//NOTE: see the above note
 			int rv = pss->send(sndbuf, sndlen);
 			vdbgx(Debug::aio, "send rv = "<<rv);
 			if(rv == 0) return EventDoneError;
@@ -498,15 +1234,47 @@ ulong Socket::doSecureReadWrite(int _w){
 	w = _w & (SecureSocket::WANT_WRITE_ON_READ | SecureSocket::WANT_READ_ON_READ);
 	if(w){
 		want &= (~w);
-		if(rcvlen && rcvbuf){//NOTE: see the above note
+		if(prcvbuf){
+			const int rv = doRecvBuffer(*prcvbuf);
+			if(rv <= 0){
+				prcvbuf->clear();
+			}
+			if(rv == 0) return EventDoneError;
+			if(rv < 0){
+				const int sw = pss->wantEvents();
+				if(!sw) return EventDoneError;
+				doWantRead(sw);
+				return retval;
+			}
+			prcvbuf = NULL;
+			rcvcnt += rv;
+			rcvlen = rv;
+			rcvbuf = NULL;
+			retval |= EventDoneRecv;
+		}else if(rcvvec){
+			const int rv = doSecureRecvv();
+			vdbgx(Debug::aio, "secure recvv rv = "<<rv);
+			if(rv == 0) return EventDoneError;
+			if(rv < 0){
+				const int sw = pss->wantEvents();
+				if(!sw) return EventDoneError;
+				doWantRead(sw);
+				return retval;
+			}
+			rcvvec = NULL;
+			rcvcnt += rv;
+			rcvlen = rv;
+			rcvbuf = NULL;
+			retval |= EventDoneRecv;
+		}else if(rcvlen && rcvbuf){//NOTE: see the above note
 			int rv = pss->recv(rcvbuf, rcvlen);
 			vdbgx(Debug::aio, "recv rv = "<<rv);
 			if(rv == 0) return EventDoneError;
 			if(rv < 0){
 				int sw = pss->wantEvents();
 				if(!sw) return EventDoneError;
-				
-				return 0;
+				doWantRead(sw);
+				return retval;
 			}else{
 				rcvcnt += rv;
 				rcvlen = rv;
@@ -522,11 +1290,23 @@ ulong Socket::doSecureReadWrite(int _w){
 }
 
 ulong Socket::doSendSecure(){
+	if(ktls && !(want & SecureSocket::WANT_WRITE_ON_READ)){
+		return doSendPlain();
+	}
 	ioreq &= ~FLAG_POLL_OUT;
 	{
 		int w = want & (SecureSocket::WANT_WRITE_ON_WRITE | SecureSocket::WANT_WRITE_ON_READ);
 		if(w){
-			return doSecureReadWrite(w);
+			ulong rv = doSecureReadWrite(w);
+			if(ktls && sndbuf && !(rv & EventDoneError)){
+				//a send pending on the kernel tls, along with the recv
+				ioreq |= FLAG_POLL_OUT;
+				rv |= doSendPlain();
+				if(want & SecureSocket::WANT_WRITE_ON_READ){
+					ioreq |= FLAG_POLL_OUT;
+				}
+			}
+			return rv;
 		}
 	}
 	if(want == SecureSocket::WANT_WRITE_ON_ACCEPT){
@@ -557,11 +1337,17 @@ ulong Socket::doRecvSecure(){
 	return EventDoneError;
 }
 
-AsyncE Socket::secureAccept(){
+AsyncE Socket::secureAccept(const ObjectUidT &_ruid){
 	cassert(!isRecvPending());
 	cassert(isSecure());
 	cassert(type == CHANNEL);
+	if(phspool && !is_invalid_uid(_ruid)){
+		rcvbuf = reinterpret_cast<char*>(1);
+		rcvlen = 0;
+		return doStartHandshake(_ruid, false);
+	}
 	const AsyncE rv = pss->secureAccept();
+	if(rv == AsyncSuccess) doSecureDone();
 	if(rv != AsyncWait) return rv;
 	rcvbuf = reinterpret_cast<char*>(1);
 	rcvlen = 0;
@@ -570,11 +1356,17 @@ AsyncE Socket::secureAccept(){
 	return AsyncWait;
 }
 
-AsyncE Socket::secureConnect(){
+AsyncE Socket::secureConnect(const ObjectUidT &_ruid){
 	cassert(!isRecvPending());
 	cassert(isSecure());
 	cassert(type == CHANNEL);
+	if(phspool && !is_invalid_uid(_ruid)){
+		sndbuf = "";
+		sndlen = 0;
+		return doStartHandshake(_ruid, true);
+	}
 	const AsyncE rv = pss->secureConnect();
+	if(rv == AsyncSuccess) doSecureDone();
 	if(rv != AsyncWait) return rv;
 	
 	sndbuf = "";
@@ -584,9 +1376,84 @@ AsyncE Socket::secureConnect(){
 	return AsyncWait;
 }
 
+AsyncE Socket::doStartHandshake(const ObjectUidT &_ruid, const bool _connect){
+	cassert(!phsjob);
+	phsjob = new HandshakePool::Job(pss, _ruid, _connect);
+	doPushHandshake();
+	return AsyncWait;
+}
+
+//! Give the next hand-shake step to the pool
+/*!
+	The socket waits for nothing meanwhile: the secure socket
+	belongs to the pool thread till the step completes.
+*/
+void Socket::doPushHandshake(){
+	ioreq = 0;
+	want = 0;
+	phspool->push(*phsjob);
+}
+
+//! Called on the selector thread when the object is raised by the pool
+/*!
+	Returns EventNone while the hand-shake is not done. If the step
+	wants io, ioRequest is set for the selector to wait for it, unless
+	the descriptor is already ready - an edge which came while the step
+	was running - when the next step is pushed right away.
+*/
+ulong Socket::doHandshakeEvents(){
+	cassert(phsjob);
+	if(!phsjob->done.load(ATOMIC_NS::memory_order_acquire)){
+		return EventNone;
+	}
+	phsjob->done.store(false, ATOMIC_NS::memory_order_relaxed);
+	const AsyncE	rv(phsjob->rv);
+	const bool		connect(phsjob->connect);
+	
+	if(rv == AsyncWait){
+		ioreq = 0;
+		want = 0;
+		if(connect){
+			doWantConnect(phsjob->want);
+		}else{
+			doWantAccept(phsjob->want);
+		}
+		pollfd	pfd;
+		pfd.fd = descriptor();
+		pfd.events = 0;
+		pfd.revents = 0;
+		if(ioreq & FLAG_POLL_IN) pfd.events |= POLLIN;
+		if(ioreq & FLAG_POLL_OUT) pfd.events |= POLLOUT;
+		if(pfd.events && ::poll(&pfd, 1, 0) > 0){
+			doPushHandshake();
+		}
+		return EventNone;
+	}
+	
+	HandshakePool::release(*phsjob);
+	phsjob = NULL;
+	if(connect){
+		sndbuf = NULL;
+	}else{
+		rcvbuf = NULL;
+	}
+	if(rv == AsyncSuccess){
+		doSecureDone();
+		return EventDoneSend;
+	}
+	return EventDoneError;
+}
+
+//! Called on hand-shake completion, to switch the sending to the kernel TLS
+void Socket::doSecureDone(){
+	ktls = pss->kernelSend();
+	vdbgx(Debug::aio, "kernel tls send = "<<ktls);
+}
+
 void Socket::secureSocket(SecureSocket *_pss){
 	delete pss;
 	pss = _pss;
+	ktls = false;
 	if(pss)
 		pss->descriptor(sd);
 }
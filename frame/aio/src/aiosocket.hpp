@@ -12,6 +12,7 @@
 
 #include "system/socketdevice.hpp"
 #include "frame/aio/aiocommon.hpp"
+#include "frame/aio/aiohandshakepool.hpp"
 
 struct SocketAddress;
 struct SocketAddressStub;
@@ -19,10 +20,14 @@ class SocketDevice;
 
 namespace solid{
 namespace frame{
+namespace file{
+struct File;
+}//namespace file
 namespace aio{
 
 class Selector;
 class SecureSocket;
+class RecvBuffer;
 //! Asynchronous socket
 /*!
 	Implements an asynchronous socket to be used by aio::Object and aio::Selector.
@@ -37,6 +42,11 @@ public:
 		CHANNEL,
 		STATION,
 	};
+	enum{
+		MaxIoVectorCount = 64,//the buffers given to a single readv/writev call
+		SecureChunkSize = 16 * 1024,//the maximum payload of a TLS record
+		MaxSendFileSize = 1024 * 1024 * 1024,//the range given to a single sendfile call
+	};
 	//!Constructor
 	Socket(Type _tp, SecureSocket *_pss = NULL);
 	Socket(Type _tp, const SocketDevice &_rsd, SecureSocket *_pss = NULL);
@@ -51,10 +61,44 @@ public:
 	AsyncE connect(const SocketAddressStub& _rsas);
 	AsyncE accept(SocketDevice &_rsd);
 	AsyncE accept(Socket &_rs);
+	//! Accept up to _cnt pending connections, appending them to _rsdvec
+	/*!
+		Waits only if there is no pending connection, then the ones
+		pending on readiness are accepted, again up to _cnt.
+	*/
+	AsyncE accept(SocketDeviceVectorT &_rsdvec, const size_t _cnt);
 	//! Send a buffer
 	AsyncE send(const char* _pb, uint32 _bl, uint32 _flags = 0);
 	//! Receives data into a buffer
 	AsyncE recv(char *_pb, uint32 _bl, uint32 _flags = 0);
+	//! Send a list of buffers, using a single system call when possible
+	/*!
+		Completes only when all the buffers were sent; the list must stay
+		valid till then. Secure sockets coalesce small buffers into
+		chunks of at most SecureChunkSize, one TLS record each.
+	*/
+	AsyncE sendv(const IoBuffer *_pbufs, const size_t _bufcnt, uint32 _flags = 0);
+	//! Receive data into a list of buffers
+	/*!
+		Completes as soon as some data was received - see recvSize.
+	*/
+	AsyncE recvv(IoBuffer *_pbufs, const size_t _bufcnt, uint32 _flags = 0);
+	//! Receive all the available data into an adaptive buffer
+	/*!
+		Reads until the socket is drained or the buffer is full at its
+		maximum capacity - see RecvBuffer. recvSize is the size of
+		the whole batch. While waiting, the buffer holds no memory.
+	*/
+	AsyncE recv(RecvBuffer &_rrb, uint32 _flags = 0);
+	//! Send a range of a file
+	/*!
+		On plain sockets the kernel moves the data from the file straight
+		to the socket (sendfile), without copying it to user space.
+		Memory temps and secure sockets fall back to reading the file in
+		SecureChunkSize chunks, unless the kernel does the encryption
+		(see SecureSocket::kernelSend). The file must stay valid till completion.
+	*/
+	AsyncE sendFile(file::File &_rfile, int64 _off, uint64 _len);
 	//! The size of the buffer received
 	uint32 recvSize()const;
 	//! The amount of data sent
@@ -74,6 +118,19 @@ public:
 	AsyncE recvFrom(char *_pb, uint32 _bl, uint32 _flags = 0);
 	//! Asynchrounous send_to call
 	AsyncE sendTo(const char *_pb, uint32 _bl, const SocketAddressStub &_sap, uint32 _flags = 0);
+	//! Receive up to _cnt datagrams, using a single system call when possible
+	/*!
+		Waits only if there is no pending datagram. recvSize is the number
+		of datagrams received, each with its size and sender in the list.
+		The list must stay valid till completion.
+	*/
+	AsyncE recvFrom(RecvDatagram *_pdgs, const size_t _cnt, uint32 _flags = 0);
+	//! Send a list of datagrams, using a single system call when possible
+	/*!
+		Completes only when all the datagrams were sent; the list and the
+		buffers must stay valid till then.
+	*/
+	AsyncE sendTo(const SendDatagram *_pdgs, const size_t _cnt, uint32 _flags = 0);
 	//! The sender address for last received data.
 	const SocketAddress &recvAddr() const;
 	//! Setter for the secure socket
@@ -81,12 +138,20 @@ public:
 	//! Getter for the secure socket
 	SecureSocket* secureSocket()const;
 	//! Do a SSL accept - secure handshake
-	AsyncE secureAccept();
+	/*!
+		If the selector has a HandshakePool and _ruid is valid, the
+		hand-shake steps run on the pool and the object _ruid is raised
+		when one completes - see Object::doHandshakeEvents.
+	*/
+	AsyncE secureAccept(const ObjectUidT &_ruid = invalid_uid());
 	//! Do a SSL connect - secure handshake
-	AsyncE secureConnect();
+	AsyncE secureConnect(const ObjectUidT &_ruid = invalid_uid());
+	//! Return true if the pending hand-shake runs on the HandshakePool
+	bool isHandshakeOffloaded()const;
 private:
 	friend class Selector;
-	void doPrepare();
+	friend class Object;
+	void doPrepare(const uint32 _zcthreshold = 0, HandshakePool *_phspool = NULL);
 	void doUnprepare();
 	void doClear();
 	
@@ -104,6 +169,22 @@ private:
 	AsyncE doSendPlain(const char* _pb, uint32 _bl, uint32 _flags);
 	AsyncE doRecvPlain(char *_pb, uint32 _bl, uint32 _flags);
 	
+	int doSendv();
+	int doRecvv();
+	void doAdvanceSend(size_t _sz);
+	void doCoalesceSend();
+	int doSecureSendv();
+	int doSecureRecvv();
+	int doRecvBuffer(RecvBuffer &_rrb);
+	int doSendFile();
+	int doBufferedSendFile();
+	
+	bool isZeroCopy()const;
+	bool isPlainSend()const;
+	int doSendZeroCopy();
+	bool doReadErrorQueue();
+	ulong doZeroCopyCompletions();
+	
 	ulong doSendSecure();
 	ulong doRecvSecure();
 	
@@ -112,7 +193,15 @@ private:
 	
 	ulong doSecureReadWrite(int _w);
 	ulong doSecureAccept();
+	AsyncE doAcceptMany(SocketDeviceVectorT &_rsdvec, const size_t _cnt);
+	int doRecvFromMany(RecvDatagram *_pdgs, const size_t _cnt);
+	int doSendToMany();
 	ulong doSecureConnect();
+	void doSecureDone();
+	
+	AsyncE doStartHandshake(const ObjectUidT &_ruid, const bool _connect);
+	void doPushHandshake();
+	ulong doHandshakeEvents();
 	
 	uint32 ioRequest()const;
 	int descriptor()const{return sd.descriptor();}
@@ -130,6 +219,22 @@ private:
 	uint32			rcvlen;
 	uint32			sndlen;
 	uint32			ioreq;
+	const IoBuffer	*sndvec;//the rest of the list being sent, NULL if not sending a list
+	size_t			sndveccnt;
+	IoBuffer		*rcvvec;//the list being received into, NULL if not receiving into a list
+	size_t			rcvveccnt;
+	RecvBuffer		*prcvbuf;//the adaptive buffer being received into, NULL if none
+	char			*secbuf;//the chunk buffer for coalescing lists on secure sockets and for buffered sendFile
+	file::File		*sndfile;//the file being sent, NULL if not sending a file
+	int64			sndfileoff;
+	uint64			sndfilelen;//the rest of the file range to be sent
+	uint32			zcthreshold;//the sends of at least this size use MSG_ZEROCOPY, 0 for none
+	uint32			zcseq;//the MSG_ZEROCOPY sends issued
+	uint32			zcdone;//the MSG_ZEROCOPY sends the kernel released the buffers for
+	bool			zcsend;//the pending send waits for its MSG_ZEROCOPY completions
+	bool			ktls;//the kernel encrypts the sent data - see SecureSocket::kernelSend
+	HandshakePool	*phspool;//the pool doing the secure hand-shakes, NULL for the selector thread
+	HandshakePool::Job	*phsjob;//the hand-shake running on the pool, NULL if none
 	union{
 		StationData		*psd;
 		AcceptorData	*pad;
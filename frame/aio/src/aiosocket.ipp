@@ -20,7 +20,7 @@ inline bool Socket::ok()const{
 	return sd.ok();
 }
 inline AsyncE Socket::send(const char* _pb, uint32 _bl, uint32 _flags){
-	if(pss == NULL){
+	if(isPlainSend()){
 		return doSendPlain(_pb, _bl, _flags);
 	}else{
 		return doSendSecure(_pb, _bl, _flags);
@@ -52,9 +52,20 @@ inline ulong Socket::doRecv(){
 inline uint32 Socket::ioRequest()const{
 	return ioreq;
 }
+//! True if the socket ever sent with MSG_ZEROCOPY, so it gets completions on its error queue
+inline bool Socket::isZeroCopy()const{
+	return zcseq != 0;
+}
+//! True if the data is sent directly on the descriptor: plain sockets and kernel TLS
+inline bool Socket::isPlainSend()const{
+	return pss == NULL || ktls;
+}
 inline SecureSocket* Socket::secureSocket()const{
 	return pss;
 }
+inline bool Socket::isHandshakeOffloaded()const{
+	return phsjob != NULL;
+}
 #ifdef NINLINES
 #undef inline
 #endif
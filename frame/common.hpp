@@ -50,6 +50,14 @@ enum EventE{
 	EventTimeoutSend = 512,
 };
 
+//! Execution priority classes of the objects within a selector
+enum PriorityE{
+	PriorityInteractive = 0,//!< Latency sensitive objects, executed first
+	PriorityNormal,//!< The default class
+	PriorityBulk,//!< Throughput objects, e.g. large transfers
+	PriorityCount
+};
+
 enum ConstE{
 	MAXTIMEOUT = (0xffffffffUL>>1)/1000
 };
@@ -118,6 +118,17 @@ struct File{
 	bool isTemp()const{
 		return ptmp != NULL;
 	}
+	//! The native descriptor to be used for zero copy transfers
+	/*!
+		Returns -1 for memory temps, which must be accessed through read.
+	*/
+	int descriptor()const{
+		if(!ptmp){
+			return fd.descriptor();
+		}else{
+			return ptmp->descriptor();
+		}
+	}
 	TempBase* temp()const{
 		return ptmp;
 	}
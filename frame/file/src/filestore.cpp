@@ -587,6 +587,9 @@ void Utf8Controller::doDeliverTemp(shared::StoreBase::Accessor &_rsbacc, const s
 }
 /*virtual*/ void TempBase::flush(){
 }
+/*virtual*/ int TempBase::descriptor()const{
+	return -1;
+}
 //--------------------------------------------------------------------------
 //		TempFile
 //--------------------------------------------------------------------------
@@ -690,6 +693,9 @@ bool prepare_temp_file_path(std::string &_rpath, const char *_prefix, size_t _id
 /*virtual*/ void TempFile::flush(){
 	fd.flush();
 }
+/*virtual*/ int TempFile::descriptor()const{
+	return fd.descriptor();
+}
 
 //--------------------------------------------------------------------------
 //		TempMemory
@@ -38,6 +38,7 @@ private:
 	
 	/*virtual*/ bool truncate(int64 _len = 0);
 	/*virtual*/ void flush();
+	/*virtual*/ int descriptor()const;
 private:
 	FileDevice	fd;
 };
@@ -44,6 +44,8 @@ struct TempBase{
 	virtual int64 size()const = 0;
 	virtual bool truncate(int64 _len = 0) = 0;
 	virtual void flush();
+	//! The native descriptor of the backing file, -1 if the temp is not on disk
+	virtual int descriptor()const;
 };
 
 }//namespace file
@@ -280,6 +280,21 @@ struct Configuration{
 	Session						session;
 };
 
+//! The datagram io of the talkers - see Service::talkerStatistics
+/*!
+	The talkers receive and send the packets in batches, so the number
+	of system calls per packet tells how well the batching works.
+	A call repeated within the selector after a wait counts as one.
+*/
+struct TalkerStatistics{
+	TalkerStatistics():rcvpktcnt(0), rcvcallcnt(0), sndpktcnt(0), sndcallcnt(0){}
+	
+	uint64		rcvpktcnt;//the packets received
+	uint64		rcvcallcnt;//the system calls receiving them
+	uint64		sndpktcnt;//the packets sent
+	uint64		sndcallcnt;//the system calls sending them
+};
+
 //! An Inter Process Communication service
 /*!
 	Allow for sending/receiving serializable foundation::Signal objects between
@@ -372,6 +387,9 @@ public:
 	
 	int basePort()const;
 	
+	//! The datagram io of all the talkers, since the service was created
+	TalkerStatistics talkerStatistics()const;
+	
 	//!Send a message (usually a response) to a peer process using a previously saved ConnectionUid
 	/*!
 		The message is send only if the connector exists. If the peer process,
@@ -533,6 +551,7 @@ private:
 	int allocateNodeForSession(bool _force = false);
 	int allocateNodeForSocket(bool _force = false);
 	uint32 keepAliveTimeout()const;
+	void collectTalkerStatistics(const TalkerStatistics &_rts);
 	void connectSession(const SocketAddressInet4 &_raddr);
 	void insertConnection(
 		SocketDevice &_rsd,
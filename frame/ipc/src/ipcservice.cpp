@@ -17,6 +17,7 @@
 #include "system/socketdevice.hpp"
 #include "system/specific.hpp"
 #include "system/exception.hpp"
+#include "system/atomic.hpp"
 
 #include "utility/queue.hpp"
 #include "utility/binaryseeker.hpp"
@@ -204,6 +205,10 @@ struct Service::Data{
 	Uint32QueueT				sessnodeq;
 	Uint32QueueT				socknodeq;
 	TimeSpec					timestamp;
+	ATOMIC_NS::atomic<uint64>	rcvpktcnt;
+	ATOMIC_NS::atomic<uint64>	rcvcallcnt;
+	ATOMIC_NS::atomic<uint64>	sndpktcnt;
+	ATOMIC_NS::atomic<uint64>	sndcallcnt;
 };
 
 //=======	ServiceData		===========================================
@@ -212,7 +217,8 @@ Service::Data::Data(
 	const DynamicPointer<Controller> &_rctrlptr
 ):
 	ctrlptr(_rctrlptr),
-	tkrcrt(0), nodecrt(0), baseport(-1), crtgwidx(0)
+	tkrcrt(0), nodecrt(0), baseport(-1), crtgwidx(0),
+	rcvpktcnt(0), rcvcallcnt(0), sndpktcnt(0), sndcallcnt(0)
 {
 	timestamp.currentRealTime();
 }
@@ -446,6 +452,23 @@ int Service::basePort()const{
 	return d.baseport;
 }
 //---------------------------------------------------------------------
+TalkerStatistics Service::talkerStatistics()const{
+	TalkerStatistics	ts;
+	ts.rcvpktcnt = d.rcvpktcnt.load();
+	ts.rcvcallcnt = d.rcvcallcnt.load();
+	ts.sndpktcnt = d.sndpktcnt.load();
+	ts.sndcallcnt = d.sndcallcnt.load();
+	return ts;
+}
+//---------------------------------------------------------------------
+//! Called by the talkers at the end of their execute, without locking
+void Service::collectTalkerStatistics(const TalkerStatistics &_rts){
+	d.rcvpktcnt += _rts.rcvpktcnt;
+	d.rcvcallcnt += _rts.rcvcallcnt;
+	d.sndpktcnt += _rts.sndpktcnt;
+	d.sndcallcnt += _rts.sndcallcnt;
+}
+//---------------------------------------------------------------------
 uint32 Service::computeNetworkId(
 	const SocketAddressStub &_rsa_dest,
 	const uint32 _netid_dest
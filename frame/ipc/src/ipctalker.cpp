@@ -263,19 +263,28 @@ struct Talker::Data{
 		TimerDataCmp
 	>											TimerQueueT;
 	typedef Queue<SendPacket>					SendQueueT;
+	typedef std::vector<SendPacket>				SendPacketVectorT;
+	
+	enum{
+		RecvBatchCount = 16,//the packets received with a single call
+		SendBatchCount = 32,//the packets sent with a single call
+	};
 	
 public:
 	Data(
 		Service &_rservice,
 		uint16 _tkridx
-	):	rservice(_rservice), tkridx(_tkridx), pendingreadpacket(NULL), nextsessionidx(1){
+	):	rservice(_rservice), tkridx(_tkridx), nextsessionidx(1){
+		for(size_t i(0); i < RecvBatchCount; ++i){
+			rcvdgs[i].bl = Packet::Capacity;
+		}
 	}
 	~Data();
 public:
 	Service					&rservice;
 	const uint16			tkridx;
 	RecvPacketVectorT		receivedpktvec;
-	char					*pendingreadpacket;
+	RecvDatagram			rcvdgs[RecvBatchCount];//the receive ring - a dispatched packet is replaced on the next receive
 	MessageQueueT			msgq;
 	EventQueueT				eventq;
 	UInt16PairStackT		freesessionstack;
@@ -288,6 +297,9 @@ public:
 	BaseAddr4MapT			baseaddr4map;
 	TimerQueueT				timerq;
 	SendQueueT				sendq;
+	SendPacketVectorT		sndpktvec;//the packets of the batch being sent
+	SendDatagram			snddgs[SendBatchCount];
+	TalkerStatistics		iostatistics;//collected by the service at the end of execute
 #ifdef USTATISTICS
 	StatisticData			statistics;
 #endif
@@ -295,8 +307,10 @@ public:
 
 
 Talker::Data::~Data(){
-	if(pendingreadpacket){
-		Packet::deallocate(pendingreadpacket);
+	for(size_t i(0); i < RecvBatchCount; ++i){
+		if(rcvdgs[i].pb){
+			Packet::deallocate(rcvdgs[i].pb);
+		}
 	}
 	for(RecvPacketVectorT::const_iterator it(receivedpktvec.begin()); it != receivedpktvec.end(); ++it){
 		Packet::deallocate(it->data);
@@ -397,6 +411,18 @@ void Talker::execute(ExecuteContext &_rexectx){
 	
 	must_reenter = doExecuteSessions(ts) || must_reenter;
 	
+	if(d.sendq.size()){
+		//flush the packets queued by the sessions
+		if(doSendPackets(ts, 0) == AsyncError){
+			_rexectx.close();
+			return;
+		}
+		must_reenter = must_reenter || d.sessionexecq.size() != 0;
+	}
+	
+	d.rservice.collectTalkerStatistics(d.iostatistics);
+	d.iostatistics = TalkerStatistics();
+	
 	if(must_reenter){
 		_rexectx.reschedule();
 	}else if(d.timerq.size()){
@@ -410,21 +436,23 @@ AsyncE Talker::doReceivePackets(TalkerStub &_rstub, uint _atmost, const ulong _s
 		return AsyncWait;
 	}
 	if(_sig & frame::EventDoneRecv){
-		doDispatchReceivedPacket(_rstub, d.pendingreadpacket, socketRecvSize(), socketRecvAddr());
-		d.pendingreadpacket = NULL;
+		++d.iostatistics.rcvcallcnt;
+		doDispatchReceivedDatagrams(_rstub, socketRecvSize());
 	}
 	while(_atmost--){
-		char 			*pbuf(Packet::allocate());
-		const uint32	bufsz(Packet::Capacity);
-		switch(socketRecvFrom(pbuf, bufsz)){
+		for(size_t i(0); i < Data::RecvBatchCount; ++i){
+			if(!d.rcvdgs[i].pb){
+				d.rcvdgs[i].pb = Packet::allocate();
+			}
+		}
+		++d.iostatistics.rcvcallcnt;
+		switch(socketRecvFrom(d.rcvdgs, Data::RecvBatchCount)){
 			case aio::AsyncSuccess:
-				doDispatchReceivedPacket(_rstub, pbuf, socketRecvSize(), socketRecvAddr());
+				doDispatchReceivedDatagrams(_rstub, socketRecvSize());
 				break;
 			case aio::AsyncWait:
-				d.pendingreadpacket = pbuf;
 				return AsyncWait;
 			case aio::AsyncError:
-				Packet::deallocate(pbuf);
 				return AsyncError;
 		}
 	}
@@ -433,6 +461,21 @@ AsyncE Talker::doReceivePackets(TalkerStub &_rstub, uint _atmost, const ulong _s
 	return AsyncSuccess;//can still read from socket
 }
 //----------------------------------------------------------------------
+//! Hand the first _cnt packets of the receive ring to doDispatchReceivedPacket
+void Talker::doDispatchReceivedDatagrams(TalkerStub &_rstub, const size_t _cnt){
+	d.iostatistics.rcvpktcnt += _cnt;
+	for(size_t i(0); i < _cnt; ++i){
+		RecvDatagram	&rdg(d.rcvdgs[i]);
+		if(!rdg.sz){
+			//an empty datagram - the buffer stays in the ring
+			continue;
+		}
+		char			*pbuf(rdg.pb);
+		rdg.pb = NULL;
+		doDispatchReceivedPacket(_rstub, pbuf, rdg.sz, rdg.addr);
+	}
+}
+//----------------------------------------------------------------------
 bool Talker::doPreprocessReceivedPackets(TalkerStub &_rstub){
 	for(Data::RecvPacketVectorT::const_iterator it(d.receivedpktvec.begin()); it != d.receivedpktvec.end(); ++it){
 		
@@ -721,13 +764,48 @@ AsyncE Talker::doSendPackets(TalkerStub &_rstub, const ulong _sig){
 		return AsyncWait;
 	}
 	
+	if(_sig & frame::EventDoneSend){
+		cassert(d.sndpktvec.size());
+		++d.iostatistics.sndcallcnt;
+		doCompleteSentPackets(_rstub);
+	}
+	
+	COLLECT_DATA_1(d.statistics.maxSendQueueSize, d.sendq.size());
+	
+	while(d.sendq.size()){
+		//move a batch from the queue to the send list
+		while(d.sendq.size() && d.sndpktvec.size() < Data::SendBatchCount){
+			const Data::SendPacket	&rsp(d.sendq.front());
+			Data::SessionStub		&rss(d.sessionvec[rsp.sessionidx]);
+			
+			d.snddgs[d.sndpktvec.size()] = SendDatagram(rsp.data, rsp.size, rss.psession->peerAddress());
+			d.sndpktvec.push_back(rsp);
+			d.sendq.pop();
+		}
+		
+		++d.iostatistics.sndcallcnt;
+		switch(socketSendTo(d.snddgs, d.sndpktvec.size())){
+			case aio::AsyncSuccess:
+				doCompleteSentPackets(_rstub);
+				break;
+			case aio::AsyncWait:
+				COLLECT_DATA_0(d.statistics.sendPending);
+				return AsyncWait;
+			case aio::AsyncError: return AsyncError;
+		}
+	}
+	return AsyncWait;
+}
+//----------------------------------------------------------------------
+//! Notify the sessions about the packets of the batch sent
+void Talker::doCompleteSentPackets(TalkerStub &_rstub){
 	TalkerStub &ts = _rstub;
 	
-	if(_sig & frame::EventDoneSend){
-		cassert(d.sendq.size());
-		COLLECT_DATA_1(d.statistics.maxSendQueueSize, d.sendq.size());
-		Data::SendPacket	&rsp(d.sendq.front());
-		Data::SessionStub	&rss(d.sessionvec[rsp.sessionidx]);
+	d.iostatistics.sndpktcnt += d.sndpktvec.size();
+	
+	for(Data::SendPacketVectorT::const_iterator it(d.sndpktvec.begin()); it != d.sndpktvec.end(); ++it){
+		const Data::SendPacket	&rsp(*it);
+		Data::SessionStub		&rss(d.sessionvec[rsp.sessionidx]);
 		
 		ts.sessionidx = rsp.sessionidx;
 		
@@ -741,35 +819,8 @@ AsyncE Talker::doSendPackets(TalkerStub &_rstub, const ulong _sig){
 				rss.inexeq = true;
 			}
 		}
-		d.sendq.pop();
 	}
-	
-	while(d.sendq.size()){
-		Data::SendPacket	&rsp(d.sendq.front());
-		Data::SessionStub	&rss(d.sessionvec[rsp.sessionidx]);
-		
-		switch(socketSendTo(rsp.data, rsp.size, rss.psession->peerAddress())){
-			case aio::AsyncSuccess:
-				Context::the().msgctx.connectionuid.sesidx = rsp.sessionidx;
-				Context::the().msgctx.connectionuid.sesuid = rss.uid;
-				rss.psession->prepareContext(Context::the());
-				
-				ts.sessionidx = rsp.sessionidx;
-				
-				if(rss.psession->pushSentPacket(ts, rsp.id, rsp.data, rsp.size)){
-					if(!rss.inexeq){
-						d.sessionexecq.push(rsp.sessionidx);
-						rss.inexeq = true;
-					}
-				}
-			case aio::AsyncWait:
-				COLLECT_DATA_0(d.statistics.sendPending);
-				return AsyncWait;
-			case aio::AsyncError: return AsyncError;
-		}
-		d.sendq.pop();
-	}
-	return AsyncWait;
+	d.sndpktvec.clear();
 }
 //----------------------------------------------------------------------
 //The talker's mutex should be locked
@@ -965,23 +1016,10 @@ void Talker::disconnectSessions(TalkerStub &_rstub){
 	d.closingsessionvec.clear();
 }
 //----------------------------------------------------------------------
+//! The packet is only queued, to be sent along with the others of the execute
 bool TalkerStub::pushSendPacket(uint32 _id, const char *_pb, uint32 _bl){
-	if(rt.d.sendq.size()){
-		rt.d.sendq.push(Talker::Data::SendPacket(_pb, _bl, this->sessionidx, _id));
-		return false;
-	}
-	Talker::Data::SessionStub &rss(rt.d.sessionvec[this->sessionidx]);
-	//try to send the packet right now:
-	switch(rt.socketSendTo(_pb, _bl, rss.psession->peerAddress())){
-		case aio::AsyncSuccess:
-			break;
-		case aio::AsyncError:
-		case aio::AsyncWait:
-			rt.d.sendq.push(Talker::Data::SendPacket(_pb, _bl, this->sessionidx, _id));
-			COLLECT_DATA_0(rt.d.statistics.sendPending);
-			return false;
-	}
-	return true;//the packet was written on socket
+	rt.d.sendq.push(Talker::Data::SendPacket(_pb, _bl, this->sessionidx, _id));
+	return false;
 }
 uint32 TalkerStub::relayId()const{
 	return pack(sessionidx, rt.d.sessionvec[sessionidx].uid);
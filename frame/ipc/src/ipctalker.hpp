@@ -150,10 +150,12 @@ private:
 		const uint32 _bufsz,
 		const SocketAddress &_rsap
 	);
+	void doDispatchReceivedDatagrams(TalkerStub &_rstub, const size_t _cnt);
 	void doInsertNewSessions(TalkerStub &_rstub);
 	void doDispatchMessages();
 	void doDispatchEvents();
 	AsyncE doSendPackets(TalkerStub &_rstub, const ulong _sig);
+	void doCompleteSentPackets(TalkerStub &_rstub);
 	bool doExecuteSessions(TalkerStub &_rstub);
 private:
 	friend struct TalkerStub;
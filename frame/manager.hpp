@@ -62,9 +62,38 @@ public:
 
 	bool notify(MessagePointerT &_rmsgptr, const ObjectUidT &_ruid);
 	
-	bool notifyAll(ulong _sm);
-	
-	bool notifyAll(MessageSharedPointerT &_rmsgptr);
+	//! Notify many objects with the same signal mask
+	/*!
+	 * The objects are grouped by the mutex guarding them, so that every
+	 * mutex is locked once, and by the selector they live on, so that
+	 * every selector is woken once.
+	 * Returns the number of objects notified.
+	 */
+	size_t notifyMany(ulong _sm, const ObjectUidT *_puids, const size_t _cnt);
+	
+	//! Notify many objects with the same message
+	/*!
+	 * \see notifyMany(ulong, const ObjectUidT*, const size_t)
+	 */
+	size_t notifyMany(MessageSharedPointerT &_rmsgptr, const ObjectUidT *_puids, const size_t _cnt);
+	
+	//! Notify all the objects of all the services with a signal mask
+	/*!
+	 * Large services are split in ranges of objects which are notified in
+	 * parallel, by the manager's notification workers, locking at most one
+	 * mutex at a time.
+	 * The call does not wait for the objects to be notified: when _rdoneuid
+	 * is a valid object uid, that object will be notified with _donesm
+	 * once all the objects were notified.
+	 * Returns false if there were no objects to notify.
+	 */
+	bool notifyAll(ulong _sm, const ObjectUidT &_rdoneuid = invalid_uid(), const ulong _donesm = S_RAISE);
+	
+	//! Notify all the objects of all the services with a message
+	/*!
+	 * \see notifyAll(ulong, const ObjectUidT&, const ulong)
+	 */
+	bool notifyAll(MessageSharedPointerT &_rmsgptr, const ObjectUidT &_rdoneuid = invalid_uid(), const ulong _donesm = S_RAISE);
 	
 	
 	void raise(const Object &_robj);
@@ -101,6 +130,17 @@ private:
 	friend class SelectorBase;
 	friend class SchedulerBase;
 	
+	size_t doNotifyMany(const ObjectUidT *_puids, const size_t _cnt, ulong _sm, MessageSharedPointerT *_pmsgptr);
+	
+	friend struct NotifyAllController;
+	struct NotifyAllStub;
+	struct NotifyAllJob;
+	
+	bool doNotifyAll(const size_t _svcidx, ulong _sm, MessageSharedPointerT *_pmsgptr, const ObjectUidT &_rdoneuid, const ulong _donesm);
+	bool doNotifyAllService(NotifyAllStub &_rnas, const size_t _svcidx);
+	size_t doNotifyAllRange(NotifyAllStub &_rnas, const size_t _svcidx, const size_t _first, const size_t _last);
+	void doNotifyAllDone(NotifyAllStub &_rnas);
+	
 	Mutex& mutex(const IndexT &_rfullid)const;
 	Object* unsafeObject(const IndexT &_rfullid)const;
 	
@@ -113,8 +153,10 @@ private:
 	
 	virtual bool doPrepareThread();
 	virtual void doUnprepareThread();
-	//ObjectUidT doRegisterServiceObject(const IndexT _svcidx, Object &_robj);
+	ObjectUidT doRegisterServiceObject(const IndexT _svcidx, Object &_robj);
 	ObjectUidT doUnsafeRegisterServiceObject(const IndexT _svcidx, Object &_robj);
+	ObjectUidT doRegisterObjectStub(const IndexT _svcidx, const IndexT _objidx, Object &_robj);
+	void doUnregisterObject(const IndexT _svcidx, const IndexT _objidx);
 	bool doForEachServiceObject(const Service &_rsvc, ObjectVisitFunctorT &_fctor);
 	bool doForEachServiceObject(const size_t _svcidx, ObjectVisitFunctorT &_fctor);
 	void doWaitStopService(const size_t _svcidx, Locker<Mutex> &_rlock, bool _wait);
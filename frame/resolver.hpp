@@ -0,0 +1,120 @@
+// frame/resolver.hpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#ifndef SOLID_FRAME_RESOLVER_HPP
+#define SOLID_FRAME_RESOLVER_HPP
+
+#include "frame/common.hpp"
+#include "frame/message.hpp"
+#include "system/socketaddress.hpp"
+
+#include <string>
+
+namespace solid{
+namespace frame{
+
+class Manager;
+
+//! The result of an asynchronous resolve - see Resolver
+struct ResolveMessage: Dynamic<ResolveMessage, Message>{
+	ResolveMessage(
+		const std::string &_node,
+		const std::string &_service,
+		const ResolveData &_rd,
+		const bool _cached
+	):node(_node), service(_service), data(_rd), cached(_cached){}
+
+	std::string		node;
+	std::string		service;
+	ResolveData		data;//empty if nothing was resolved
+	bool			cached;//the result came from the cache
+};
+
+//! Asynchronous synchronous_resolve, with a cache of the results
+/*!
+	The objects must not call synchronous_resolve from execute: it
+	blocks the selector thread for the whole name resolution. Instead,
+	an object asks Resolver::resolve and gets the result as a
+	ResolveMessage through Manager::notify.<br>
+
+	The resolves run on a pool of threads, created on demand. The results
+	are cached for a time to live (shorter for the failed ones) and
+	concurrent requests for the same name share a single resolve.
+	getaddrinfo does not give the DNS record TTL, so the time to live is
+	the same for all the entries.<br>
+
+	The resolver must outlive the objects using it.
+*/
+class Resolver{
+public:
+	enum{
+		DefaultWorkerCount = 4,
+		DefaultTimeToLive = 60,//seconds
+		DefaultNegativeTimeToLive = 5,//seconds
+		DefaultCacheCapacity = 1024,
+	};
+	//! The blocking lookup run by the threads
+	typedef ResolveData (*LookupFunctionT)(const char*, const char*, int, int, int, int);
+	//! Constructor
+	/*!
+		\param _wkrcnt The maximum number of threads - created on demand.
+		\param _ttl The time to live of a cached result, in seconds.
+		\param _negttl The time to live of a failed resolve, in seconds.
+		\param _cachecp The number of results kept, expired or not.
+		\param _pflookup The lookup, synchronous_resolve if NULL.
+	*/
+	Resolver(
+		Manager &_rm,
+		const size_t _wkrcnt = DefaultWorkerCount,
+		const uint32 _ttl = DefaultTimeToLive,
+		const uint32 _negttl = DefaultNegativeTimeToLive,
+		const size_t _cachecp = DefaultCacheCapacity,
+		LookupFunctionT _pflookup = NULL
+	);
+	~Resolver();
+	//! Wait for the queued resolves then stop the threads
+	void stop();
+	//! Resolve asynchronously, notifying object _ruid with a ResolveMessage
+	/*!
+		The parameters are the ones of synchronous_resolve.
+		A cached result is notified right away, from the calling thread,
+		so the caller must not hold the mutex of the object _ruid.
+	*/
+	void resolve(
+		const ObjectUidT &_ruid,
+		const char *_node,
+		const char *_service,
+		int _flags = 0,
+		int _family = -1,
+		int _type = -1,
+		int _proto = -1
+	);
+	void resolve(
+		const ObjectUidT &_ruid,
+		const char *_node,
+		int _port,
+		int _flags = 0,
+		int _family = -1,
+		int _type = -1,
+		int _proto = -1
+	);
+	//! Drop the cached results
+	void clear();
+private:
+	Resolver(const Resolver&);
+	Resolver& operator=(const Resolver&);
+private:
+	struct Data;
+	Data	&d;
+};
+
+}//namespace frame
+}//namespace solid
+
+#endif
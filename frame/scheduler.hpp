@@ -41,7 +41,10 @@ class Scheduler: public SchedulerBase, public WorkPoolControllerBase{
 	typedef S						SelectorT;
 	typedef Scheduler<S>			ThisT;
 	struct Worker: WorkerBase{
+		Worker():draining(false){}
 		SelectorT	s;
+		TimeSpec	busytime;//the last time the selector received objects
+		bool		draining;//the selector does not receive objects
 	};
 	typedef WorkPool<
 		typename S::JobT,
@@ -93,6 +96,38 @@ public://definition
 		wp.push(_rjb);
 	}
 	
+	//! Schedule a job on the selector running the current thread
+	/*!
+	 * Meant to be called from the execute of an object of this
+	 * scheduler, e.g. a listener: the new object is registered by the
+	 * selector loop, without waking another thread.
+	 * Falls back to schedule when not called from one of our selector
+	 * threads or when the selector is full.
+	 * Returns true if the job stays on the current selector.
+	 */
+	bool scheduleLocal(const JobT &_rjb){
+		JobT			job(_rjb);
+		SelectorBase	*ps(this->currentSelector());
+		if(ps && static_cast<SelectorT*>(ps)->pushLocal(job)){
+			return true;
+		}
+		schedule(job);
+		return false;
+	}
+	
+	//! Give a job to every selector thread created on start
+	/*!
+	 * Every selector started by start takes one of these jobs before
+	 * any job from the shared queue, so calling it N times for a scheduler
+	 * starting N threads places a job on each of them (e.g. the
+	 * aio::ShardListener objects of a SO_REUSEPORT address).
+	 * The jobs left over when fewer threads start are scheduled normally.
+	 * Must be called before the scheduler is started.
+	 */
+	void scheduleEach(const JobT &_rjb){
+		eachjobvec.push_back(_rjb);
+	}
+	
 	
 	//! Starts the scheduler
 	/*!
@@ -101,7 +136,16 @@ public://definition
 	 * NOTE: in future versions this might be made protected or private
 	 */
 	void start(ushort _startwkrcnt = 0){
-		wp.start(_startwkrcnt ? _startwkrcnt : startwkrcnt);
+		const ushort	wkrcnt(_startwkrcnt ? _startwkrcnt : startwkrcnt);
+		JobVectorT		jobvec;
+		while(eachjobvec.size() > wkrcnt){
+			jobvec.push_back(eachjobvec.back());
+			eachjobvec.pop_back();
+		}
+		wp.start(wkrcnt);
+		for(typename JobVectorT::const_iterator it(jobvec.begin()); it != jobvec.end(); ++it){
+			wp.push(*it);
+		}
 	}
 	
 	//! Starts the scheduler
@@ -131,7 +175,37 @@ private:
 			return false;
 		}
 		_rw.s.prepare();
-		return _rw.s.init(selcap);
+		_rw.busytime.currentMonotonic();
+		if(!_rw.s.init(selcap)){
+			return false;
+		}
+		if(eachjobvec.size()){
+			//called with the workpool locked
+			JobT	job(eachjobvec.back());
+			eachjobvec.pop_back();
+			if(!_rw.s.push(job)){
+				eachjobvec.push_back(job);
+			}
+		}
+		return true;
+	}
+	bool isIdle(const Worker &_rw)const{
+		TimeSpec	ts(TimeSpec::createMonotonic());
+		ts -= _rw.busytime;
+		return (ts.seconds() * 1000 + ts.nanoSeconds() / 1000000) >= idlemsec;
+	}
+	ulong idleTimeout()const{
+		return idlemsec;
+	}
+	bool onPopRetire(WorkPoolT &_rwp, Worker &_rw){
+		//only a worker with an empty selector can retire
+		if(
+			!idlemsec || !_rwp.isRunning() || _rwp.size() ||
+			!_rw.s.empty() || crtwkrcnt <= startwkrcnt
+		){
+			return false;
+		}
+		return _rw.draining || isIdle(_rw);
 	}
 	void unprepareWorker(Worker &_rw){
 		unprepareThread(&_rw.s);
@@ -151,6 +225,21 @@ private:
 		//NOTE: not used right now
 	}
 	ulong onPopStart(WorkPoolT &_rwp, Worker &_rw, ulong){
+		if(
+			idlemsec && !_rw.draining && crtwkrcnt > startwkrcnt &&
+			!_rw.s.empty() && isIdle(_rw) && hasBusierSelector(_rw.s)
+		){
+			//no new objects for a while - let the busier selectors take
+			//the new ones and exit when the last object closes
+			_rw.draining = true;
+		}
+		if(_rw.draining){
+			if(_rwp.empty() && !_rw.s.empty()){
+				markSelectorFull(_rw.s);
+				return 0;
+			}
+			_rw.draining = false;
+		}
 		if(_rw.s.full()){
 			markSelectorFull(_rw.s);
 			if(_rwp.size() && !tryRaiseOneSelector()){
@@ -162,11 +251,12 @@ private:
 			}
 			return 0;
 		}
-		markSelectorNotFull(_rw.s);
+		markSelectorNotFull(_rw.s, _rw.s.size());
 		if(_rwp.empty() && !_rw.s.empty()) return 0;
 		return _rw.s.capacity() - _rw.s.size();
 	}
 	void onPopDone(WorkPoolT &_rwp, Worker &_rw){
+		_rw.busytime.currentMonotonic();
 		if(_rwp.size()){
 			if(_rw.s.full()){
 				markSelectorFull(_rw.s);
@@ -196,6 +286,7 @@ private:
 	}
 private:
 	WorkPoolT		wp;
+	JobVectorT		eachjobvec;//the jobs for the selectors created on start
 };
 
 }//namespace frame
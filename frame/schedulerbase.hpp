@@ -11,6 +11,7 @@
 #define SOLID_FRAME_SCHEDULER_BASE_HPP
 
 #include "frame/common.hpp"
+#include "system/thread.hpp"
 
 namespace solid{
 namespace frame{
@@ -18,11 +19,94 @@ namespace frame{
 class Manager;
 class SelectorBase;
 
+namespace aio{
+class HandshakePool;
+}//namespace aio
+
 //! A base class for all schedulers
 class SchedulerBase{
 public:
+	//! Placement policies for the selector threads
+	enum Affinity{
+		AffinityNone,//!< Let the system place the threads
+		AffinityProcessors,//!< Pin selector i on processor _rvec[i % _rvec.size()]
+		AffinityNumaNodes,//!< Keep selector i on NUMA node _rvec[i % _rvec.size()]
+		AffinitySpread,//!< Pin selectors round-robin on all processors, alternating the NUMA nodes
+	};
 	virtual void start(uint16 _startwkrcnt = 0) = 0;
 	
+	//! Set the placement policy for the selector threads
+	/*!
+	 * Must be called before the scheduler is started (e.g. create
+	 * a Scheduler with a negative _startthrcnt).
+	 * When a selector ends up on a single NUMA node, the thread specific
+	 * caches are allocated from that node too (see Specific::prepareThread).
+	 */
+	void affinity(const Affinity _aff, const Thread::ProcessorVectorT &_rvec = Thread::ProcessorVectorT());
+	
+	//! Retire the selector threads idle for more than _msec milliseconds
+	/*!
+	 * Zero (the default) keeps the threads for ever. The scheduler never
+	 * goes below the start thread count.
+	 */
+	void workerIdleTimeout(const ulong _msec);
+	
+	//! Move hot objects off the selectors busier than _highload
+	/*!
+	 * Every _msec milliseconds, every selector measures the share of
+	 * time (in permille) it spent executing objects. A selector above
+	 * _highload moves its hottest object, with its sockets and timeouts,
+	 * to the least loaded selector, if that narrows the load gap.
+	 * Zero _msec (the default) disables the balancing.
+	 */
+	void loadBalancing(const ulong _msec, const ulong _highload = 700);
+	
+	//! Limit how much of a priority class a selector executes per loop
+	/*!
+	 * On every loop, a selector executes the queued objects in priority
+	 * order (see frame::PriorityE), at most _cnt objects and for at most
+	 * _usec microseconds of each class. What is left stays queued for the
+	 * next loop, after the io and the timers were handled - so bulk
+	 * objects cannot delay the interactive ones for more than their budget.
+	 * Zero means no limit (the default for all classes). Must be called
+	 * before the scheduler is started.
+	 */
+	void executionBudget(const PriorityE _prio, const ulong _cnt, const ulong _usec = 0);
+	
+	//! Register every socket once, for both input and output, edge triggered
+	/*!
+	 * Saves the system call the selector otherwise issues every time a
+	 * socket switches between waiting for input and waiting for output
+	 * (e.g. on every message of a request/response protocol).
+	 * Only the epoll based aio::Selector supports it, the others ignore it.
+	 * Must be called before the scheduler is started.
+	 */
+	void persistentRegistration(const bool _enable = true);
+	
+	//! Send the buffers of at least _size bytes without copying them into the kernel
+	/*!
+	 * The stream sockets use MSG_ZEROCOPY for such sends and report
+	 * EventDoneSend only after the kernel released the buffer, so the
+	 * buffer stays pinned till then - as for any pending socketSend.
+	 * It pays off for big buffers only (e.g. 64KB and above), as every
+	 * completion costs a read of the socket error queue.
+	 * Zero (the default) disables it. Needs kernel support (HAS_ZEROCOPY)
+	 * and a selector backend on epoll or io_uring, the others ignore it.
+	 * Must be called before the scheduler is started.
+	 */
+	void zeroCopyThreshold(const uint32 _size);
+	
+	//! Do the secure hand-shakes of the aio sockets on the _php worker pool
+	/*!
+	 * The selector threads then only do io: socketSecureAccept and
+	 * socketSecureConnect give every hand-shake step to the pool and the
+	 * selector resumes the object with the usual events when the step
+	 * completes. The pool must outlive the scheduler. NULL (the default)
+	 * does the hand-shakes on the selector threads.
+	 * Must be called before the scheduler is started.
+	 */
+	void handshakePool(aio::HandshakePool *_php);
+	
 	virtual void stop(bool _wait = true) = 0;
 	virtual ~SchedulerBase();
 protected:
@@ -37,12 +121,19 @@ protected:
 	bool prepareThread(SelectorBase *_ps = NULL);
 	void unprepareThread(SelectorBase *_ps = NULL);
 	
+	//! The selector running the current thread, NULL if it is not one of ours
+	SelectorBase* currentSelector()const;
+	
 	bool tryRaiseOneSelector()const;
 	void raiseOneSelector();
 	
 	void markSelectorFull(SelectorBase &_rs);
-	void markSelectorNotFull(SelectorBase &_rs);
+	void markSelectorNotFull(SelectorBase &_rs, const ulong _load = 0);
+	bool hasBusierSelector(const SelectorBase &_rs)const;
 	void doStop();
+private:
+	friend class SelectorBase;
+	void doBalance(SelectorBase &_rs);
 protected:
 	struct Data;
 	Manager	&rm;
@@ -52,6 +143,14 @@ protected:
 	uint16	maxwkrcnt;
 	uint16	crtwkrcnt;
 	IndexT	selcap;
+	ulong	idlemsec;
+	ulong	balmsec;
+	ulong	balload;
+	ulong	budgetcnt[PriorityCount];
+	ulong	budgetusec[PriorityCount];
+	bool	persistreg;
+	uint32	zcthreshold;
+	aio::HandshakePool	*phspool;
 };
 
 }//namespace frame
@@ -11,11 +11,17 @@
 #define SOLID_FRAME_SELECTOR_BASE_HPP
 
 #include "frame/object.hpp"
+#include "system/atomic.hpp"
 
 namespace solid{
 namespace frame{
 
 class Manager;
+class SchedulerBase;
+
+namespace aio{
+class HandshakePool;
+}//namespace aio
 
 //! The base for every selector
 /*!
@@ -24,8 +30,24 @@ class Manager;
  */
 class SelectorBase{
 public:
+	SelectorBase();
 	uint32 id()const;
 	virtual void raise(uint32 _objidx = 0) = 0;
+	//! Called by the manager, instead of raise, from the thread running the selector
+	/*!
+	 * No wakeup is needed so a selector can schedule the object directly.
+	 */
+	virtual void raiseLocal(uint32 _objidx){
+		raise(_objidx);
+	}
+	//! Raise many objects at once, waking the selector once
+	virtual void raiseMany(const uint32 *_pobjidx, const size_t _cnt){
+		for(size_t i = 0; i < _cnt; ++i){
+			raise(_pobjidx[i]);
+		}
+	}
+	//! The permille of the last balancing period spent executing objects
+	ulong load()const;
 protected:
 	void associateObjectToCurrentThread(Object &_robj);
 	bool setObjectThread(Object &_robj, const IndexT &_objidx);
@@ -33,11 +55,50 @@ protected:
 	void stopObject(Object &_robj);
 	void setCurrentTimeSpecific(const TimeSpec &_rtout);
 	void id(uint32 _id);
+	void load(const ulong _load);
+	//! The balancing period in milliseconds, zero if the scheduler does not balance
+	ulong balancePeriod()const;
+	//! The load above which the selector should give objects away
+	ulong balanceLoad()const;
+	//! How many objects of the class to execute per loop, zero for no limit
+	ulong budgetCount(const PriorityE _prio)const;
+	//! For how many microseconds to execute objects of the class per loop, zero for no limit
+	ulong budgetTime(const PriorityE _prio)const;
+	//! True if the sockets should be registered once, for both input and output
+	bool persistentRegistration()const;
+	//! The size from which the stream sockets send with MSG_ZEROCOPY, zero if never
+	uint32 zeroCopyThreshold()const;
+	//! The pool doing the secure hand-shakes of the aio sockets, NULL if none
+	aio::HandshakePool* handshakePool()const;
+	//! Let the scheduler choose a less loaded selector to migrate an object to
+	void balance();
+	//! Move an object to the less loaded _rs selector
+	/*!
+	 * Called by balance with the scheduler locked, so _rs cannot go away.
+	 * Returns false if no object was moved.
+	 */
+	virtual bool migrate(SelectorBase &_rs){
+		return false;
+	}
 private:
 	friend class Manager;
-	uint32	selid;//given by manager
+	friend class SchedulerBase;
+	uint32						selid;//given by manager
+	long						threadid;//the thread running the selector, given by manager
+	SchedulerBase				*psch;//given by the scheduler
+	ATOMIC_NS::atomic<ulong>	ldval;
 };
 
+inline SelectorBase::SelectorBase():selid(0), threadid(0), psch(NULL), ldval(ATOMIC_VAR_INIT(0)){
+}
+
+inline ulong SelectorBase::load()const{
+	return ldval.load(ATOMIC_NS::memory_order_relaxed);
+}
+inline void SelectorBase::load(const ulong _load){
+	ldval.store(_load, ATOMIC_NS::memory_order_relaxed);
+}
+
 inline uint32 SelectorBase::id()const{
 	return selid;
 }
@@ -44,9 +44,10 @@ public:
 	
 	bool isRegistered()const;
 	
-	bool notifyAll(ulong _sm);
+	//! Notify all the service's objects - see Manager::notifyAll
+	bool notifyAll(ulong _sm, const ObjectUidT &_rdoneuid = invalid_uid(), const ulong _donesm = S_RAISE);
 
-	bool notifyAll(MessageSharedPointerT &_rmsgptr);
+	bool notifyAll(MessageSharedPointerT &_rmsgptr, const ObjectUidT &_rdoneuid = invalid_uid(), const ulong _donesm = S_RAISE);
 	
 	template <class N>
 	bool forEachObject(N &_rn){
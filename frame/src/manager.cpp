@@ -9,6 +9,7 @@
 //
 #include <vector>
 #include <deque>
+#include <algorithm>
 
 #include "system/cassert.hpp"
 #include "system/debug.hpp"
@@ -28,6 +29,7 @@
 
 #include "utility/stack.hpp"
 #include "utility/queue.hpp"
+#include "utility/workpool.hpp"
 
 namespace solid{
 namespace frame{
@@ -42,21 +44,186 @@ struct DummySelector: SelectorBase{
 	void raise(uint32 _objidx){}
 };
 //---------------------------------------------------------
+//! The manager side of a registered object
+/*!
+	Lookups pin the stub before touching the object, so that
+	unregistering an object (done from its destructor) waits
+	until no lookup still uses it.
+*/
 struct ObjectStub{
-	ObjectStub(
-		Object *_pobj = NULL,
-		uint32 _uid = 0
-	): pobj(_pobj), uid(_uid){}
+	ObjectStub(){
+		pobj.store(NULL, ATOMIC_NS::memory_order_relaxed);
+		uid.store(0, ATOMIC_NS::memory_order_relaxed);
+		pincnt.store(0, ATOMIC_NS::memory_order_relaxed);
+		next.store(0, ATOMIC_NS::memory_order_relaxed);
+	}
+	
+	//! Wait-free - returns the object if it still has the given uid
+	Object* pin(const uint32 _uid){
+		pincnt.fetch_add(1/*, ATOMIC_NS::memory_order_seq_cst*/);
+		Object *pobjt = pobj.load(/*ATOMIC_NS::memory_order_seq_cst*/);
+		if(pobjt && uid.load(/*ATOMIC_NS::memory_order_seq_cst*/) == _uid){
+			return pobjt;
+		}
+		pincnt.fetch_sub(1, ATOMIC_NS::memory_order_release);
+		return NULL;
+	}
+	//! Wait-free - returns the registered object if any
+	Object* pin(){
+		pincnt.fetch_add(1/*, ATOMIC_NS::memory_order_seq_cst*/);
+		Object *pobjt = pobj.load(/*ATOMIC_NS::memory_order_seq_cst*/);
+		if(pobjt){
+			return pobjt;
+		}
+		pincnt.fetch_sub(1, ATOMIC_NS::memory_order_release);
+		return NULL;
+	}
+	void unpin(){
+		pincnt.fetch_sub(1, ATOMIC_NS::memory_order_release);
+	}
 	
 	void clear(){
-		pobj = NULL;
-		++uid;
+		pobj.store(NULL/*, ATOMIC_NS::memory_order_seq_cst*/);
+		uid.fetch_add(1/*, ATOMIC_NS::memory_order_seq_cst*/);
+		//wait for the lookups which might have found the object
+		while(pincnt.load(ATOMIC_NS::memory_order_acquire)){
+			Thread::yield();
+		}
 	}
-	Object		*pobj;
-	uint32		uid;
 	
+	ATOMIC_NS::atomic<Object*>	pobj;
+	ATOMIC_NS::atomic<uint32>	uid;
+	ATOMIC_NS::atomic<uint32>	pincnt;
+	ATOMIC_NS::atomic<uint32>	next;//the next free stub
 };
-typedef std::deque<ObjectStub>				ObjectVectorT;
+
+//! A table of object stubs which never moves its stubs
+/*!
+	The stubs live in segments of doubling size, so an index maps
+	to a stub without any lock and growing the table never touches
+	the existing stubs.
+	The free stubs are kept in a lock-free stack - its head packs
+	a tag with the index of the top stub, to avoid ABA.
+	
+	NOTE: grow and reset must be called with the service mutex locked.
+*/
+struct ObjectTable{
+	enum{
+		FirstSegmentBits = 8,
+		FirstSegmentSize = 1 << FirstSegmentBits,
+		SegmentCount = 32 - FirstSegmentBits
+	};
+	static const uint32 InvalidIndex = 0xffffffff;
+	
+	ObjectTable():segcnt(0), cp(0){
+		sz.store(0, ATOMIC_NS::memory_order_relaxed);
+		freehead.store(InvalidIndex, ATOMIC_NS::memory_order_relaxed);
+		for(size_t i = 0; i < SegmentCount; ++i){
+			segarr[i].store(NULL, ATOMIC_NS::memory_order_relaxed);
+		}
+	}
+	~ObjectTable(){
+		for(size_t i = 0; i < segcnt; ++i){
+			delete []segarr[i].load(ATOMIC_NS::memory_order_relaxed);
+		}
+	}
+	
+	size_t size()const{
+		return sz.load(ATOMIC_NS::memory_order_acquire);
+	}
+	
+	//! Wait-free - returns NULL for an index not in the table
+	ObjectStub* find(const size_t _idx)const{
+		if(_idx < size()){
+			return &at(_idx);
+		}
+		return NULL;
+	}
+	
+	ObjectStub& at(const size_t _idx)const{
+		const uint64	n(_idx + FirstSegmentSize);
+		const size_t	hb(lastBit(n));
+		return segarr[hb - FirstSegmentBits].load(ATOMIC_NS::memory_order_relaxed)[n - (1ULL << hb)];
+	}
+	
+	//! The size the table would have after the next grow
+	size_t nextSize()const{
+		if(size() < cp || segcnt == SegmentCount){
+			return cp;
+		}
+		return cp + (FirstSegmentSize << segcnt);
+	}
+	
+	//! Grow the table up to _sz stubs and make the new stubs free
+	void grow(const size_t _sz){
+		const size_t	oldsz = sz.load(ATOMIC_NS::memory_order_relaxed);
+		while(cp < _sz && segcnt < SegmentCount){
+			const size_t	segsz(FirstSegmentSize << segcnt);
+			segarr[segcnt].store(new ObjectStub[segsz], ATOMIC_NS::memory_order_relaxed);
+			++segcnt;
+			cp += segsz;
+		}
+		const size_t	newsz = _sz < cp ? _sz : cp;
+		sz.store(newsz, ATOMIC_NS::memory_order_release);
+		for(size_t i = newsz; i > oldsz; --i){
+			push(i - 1);
+		}
+	}
+	
+	//! Make all the stubs free - there must be no registered object
+	void reset(){
+		const size_t	objcnt = size();
+		freehead.store(InvalidIndex/*, ATOMIC_NS::memory_order_seq_cst*/);
+		for(size_t i = objcnt; i > 0; --i){
+			push(i - 1);
+		}
+	}
+	
+	bool pop(size_t &_ridx){
+		uint64	head = freehead.load(ATOMIC_NS::memory_order_acquire);
+		while(true){
+			const uint32	idx(head & InvalidIndex);
+			if(idx == InvalidIndex){
+				return false;
+			}
+			//the stub may be popped and reused meanwhile - the tag will fail the exchange
+			const uint64	newhead((((head >> 32) + 1) << 32) | at(idx).next.load(ATOMIC_NS::memory_order_relaxed));
+			if(freehead.compare_exchange_weak(head, newhead, ATOMIC_NS::memory_order_acq_rel, ATOMIC_NS::memory_order_acquire)){
+				_ridx = idx;
+				return true;
+			}
+		}
+	}
+	
+	void push(const size_t _idx){
+		ObjectStub	&rs(at(_idx));
+		uint64		head = freehead.load(ATOMIC_NS::memory_order_relaxed);
+		do{
+			rs.next.store(head & InvalidIndex, ATOMIC_NS::memory_order_relaxed);
+		}while(!freehead.compare_exchange_weak(head, (((head >> 32) + 1) << 32) | _idx, ATOMIC_NS::memory_order_release, ATOMIC_NS::memory_order_relaxed));
+	}
+private:
+	static size_t lastBit(uint64 _v){
+#ifdef __GNUC__
+		return 63 - __builtin_clzll(_v);
+#else
+		size_t rv(0);
+		while(_v >>= 1){
+			++rv;
+		}
+		return rv;
+#endif
+	}
+private:
+	typedef ATOMIC_NS::atomic<ObjectStub*>	AtomicObjectStubPointerT;
+	
+	AtomicSizeT					sz;
+	AtomicObjectStubPointerT	segarr[SegmentCount];
+	size_t						segcnt;
+	size_t						cp;
+	ATOMIC_NS::atomic<uint64>	freehead;
+};
+
 typedef Queue<size_t>						SizeQueueT;
 typedef Stack<size_t>						SizeStackT;
 typedef MutualStore<Mutex>					MutexMutualStoreT;
@@ -69,21 +236,91 @@ struct ServiceStub{
 		StateStopping,
 		StateStopped
 	};
-	ServiceStub():psvc(NULL), objvecsz(ATOMIC_VAR_INIT(0)), objpermutbts(ATOMIC_VAR_INIT(0)){
+	ServiceStub():psvc(NULL), objcnt(ATOMIC_VAR_INIT(0)), objpermutbts(ATOMIC_VAR_INIT(0)), state(ATOMIC_VAR_INIT(0)){
 		//mtxstore.safeAt(0);
 	}
 	
 	Service					*psvc;
-	AtomicSizeT				objvecsz;
+	AtomicSizeT				objcnt;//the number of registered objects
 	AtomicUintT				objpermutbts;
-	ObjectVectorT			objvec;
-	SizeStackT				objfreestk;
+	ObjectTable				objtab;
 	Mutex					mtx;
 	Condition				cnd;
 	MutexMutualStoreT		mtxstore;
-	ushort					state;
+	AtomicUintT				state;
 };
 //---------------------------------------------------------
+//! A notifyAll request shared by the ranges it was split in
+struct Manager::NotifyAllStub{
+	NotifyAllStub(
+		ulong _sm,
+		MessageSharedPointerT *_pmsgptr,
+		const ObjectUidT &_rdoneuid,
+		const ulong _donesm
+	):	sm(_sm), msgptr(_pmsgptr ? *_pmsgptr : MessageSharedPointerT()),
+		doneuid(_rdoneuid), donesm(_donesm), pendcnt(ATOMIC_VAR_INIT(1)){}
+	
+	ulong					sm;
+	MessageSharedPointerT	msgptr;
+	ObjectUidT				doneuid;
+	ulong					donesm;
+	AtomicSizeT				pendcnt;//the ranges not yet notified plus the caller
+};
+
+struct Manager::NotifyAllJob{
+	NotifyAllStub	*pnas;
+	size_t			svcidx;
+	size_t			first;
+	size_t			last;
+};
+
+namespace{
+size_t notify_worker_count(){
+	const size_t	cnt = Thread::processorCount();
+	return cnt ? cnt : 1;
+}
+}//namespace
+
+//! Controller for the workers notifying ranges of objects
+/*!
+	Workers are created on demand, up to the number of processors.
+*/
+struct NotifyAllController: WorkPoolControllerBase{
+	typedef WorkPool<Manager::NotifyAllJob, NotifyAllController>	WorkPoolT;
+	
+	NotifyAllController(Manager &_rm):rm(_rm), wkrcnt(0), maxwkrcnt(notify_worker_count()){}
+	
+	bool createWorker(WorkPoolT &_rwp){
+		WorkerBase	*pw(_rwp.createSingleWorker());
+		if(pw && !pw->start()){
+			delete pw;
+			return false;
+		}
+		++wkrcnt;
+		return true;
+	}
+	void onPush(WorkPoolT &_rwp){
+		if(wkrcnt < maxwkrcnt){
+			_rwp.createWorker();
+		}
+	}
+	void onMultiPush(WorkPoolT &_rwp, ulong _cnt){
+		while(wkrcnt < maxwkrcnt && _cnt--){
+			_rwp.createWorker();
+		}
+	}
+	void execute(WorkerBase &, Manager::NotifyAllJob &_rjob){
+		rm.doNotifyAllRange(*_rjob.pnas, _rjob.svcidx, _rjob.first, _rjob.last);
+		rm.doNotifyAllDone(*_rjob.pnas);
+	}
+	
+	Manager		&rm;
+	size_t		wkrcnt;
+	size_t		maxwkrcnt;
+};
+
+typedef NotifyAllController::WorkPoolT		NotifyAllWorkPoolT;
+//---------------------------------------------------------
 struct Manager::Data{
 	enum States{
 		StateStarting = 1,
@@ -98,10 +335,6 @@ struct Manager::Data{
 		uint _objpermutbts, uint _mutrowsbts, uint _mutcolsbts
 	);
 	
-	size_t computeObjectAddSize(const size_t /*_objvecsz*/, const size_t _objpermutcnt)const{
-		return mutcolscnt * _objpermutcnt;
-	}
-	
 	const size_t			svcprovisioncp;
 	const size_t			selprovisioncp;
 	const uint				objpermutbts;
@@ -123,6 +356,7 @@ struct Manager::Data{
 	SizeStackT				selfreestk;
 	DummySelector			dummysel;
 	Service					dummysvc;
+	NotifyAllWorkPoolT		notifywp;
 };
 
 
@@ -191,8 +425,9 @@ Manager::Data::Data(
 	mutcolscnt(bitsToCount(_mutcolsbts)),
 	svccnt(0),
 	selbts(ATOMIC_VAR_INIT(1)), svcbts(ATOMIC_VAR_INIT(0)),objbts(ATOMIC_VAR_INIT(0)),
-	selobjbts(ATOMIC_VAR_INIT(1)), state(StateRunning), dummysvc(_rm)
+	selobjbts(ATOMIC_VAR_INIT(1)), state(StateRunning), dummysvc(_rm), notifywp(_rm)
 {
+	notifywp.start();
 }
 
 /*static*/ Manager& Manager::specific(){
@@ -275,9 +510,7 @@ bool Manager::registerService(
 }
 
 ObjectUidT	Manager::registerObject(Object &_ro){
-	ServiceStub		&rss = d.psvcarr[0];
-	Locker<Mutex>	lock(rss.mtx);
-	return doUnsafeRegisterServiceObject(0, _ro);
+	return doRegisterServiceObject(0, _ro);
 }
 
 void Manager::unregisterService(Service &_rsvc){
@@ -308,38 +541,43 @@ void Manager::unregisterObject(Object &_robj){
 	
 	if(svcidx < d.svcprovisioncp){
 		ServiceStub		&rss = d.psvcarr[svcidx];
-		const uint 		objpermutbts = rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);//set it with release
-		const size_t	objcnt = rss.objvecsz.load(ATOMIC_NS::memory_order_acquire);
+		ObjectStub		*pos = rss.objtab.find(objidx);
 		
-		if(objpermutbts && objidx < objcnt){
-			Locker<Mutex>	lock(rss.mtxstore.at(objidx, objpermutbts));
-			
-			if(rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/) == objpermutbts){
-				cassert(rss.objvec[objidx].pobj == &_robj);
-				rss.objvec[objidx].clear();
-				rss.objfreestk.push(objidx);
-				if(rss.state == ServiceStub::StateStopping && rss.objfreestk.size() == rss.objvec.size()){
-					rss.state = ServiceStub::StateStopped;
-					rss.cnd.broadcast();
-				}
-				return;
-			}
+		if(pos){
+			cassert(pos->pobj.load() == &_robj);
+			doUnregisterObject(svcidx, objidx);
+			return;
 		}
 	}
 	cassert(false);
 }
+
+void Manager::doUnregisterObject(const IndexT _svcidx, const IndexT _objidx){
+	ServiceStub		&rss = d.psvcarr[_svcidx];
+	
+	rss.objtab.at(_objidx).clear();
+	rss.objtab.push(_objidx);
+	
+	if(rss.objcnt.fetch_sub(1/*, ATOMIC_NS::memory_order_seq_cst*/) == 1 && rss.state == ServiceStub::StateStopping){
+		Locker<Mutex>	lock(rss.mtx);
+		if(rss.state == ServiceStub::StateStopping && rss.objcnt.load(/*ATOMIC_NS::memory_order_seq_cst*/) == 0){
+			rss.state = ServiceStub::StateStopped;
+			rss.cnd.broadcast();
+		}
+	}
+}
 /*
  * NOTE:
- * 1) rss.objpermuts & rss.objvecsz:
- * 	[0,0] -> [X,0] -> [X,1] .. [X,a]  -> [0,0] -> [Y,0] -> [Y,1] .. [Y,b]
- * Situations:
- * Read:
- * [0,0] OK
- * [0,a] OK
- * [X,0] OK
- * [Y,a]\
- *		prevented with memory_order_acquire
- * [x,b]/ 
+ * 1) The object lookup is wait-free:
+ * 	the ObjectTable never moves its stubs and a stub is pinned
+ * 	before touching its object. Unregistering an object waits for
+ * 	the stub to be unpinned.
+ * 2) rss.objpermutbts only changes when the service is registered,
+ * 	while it has no objects, so it is read after pinning the stub.
+ * 3) Registering and stopping:
+ * 	registering publishes the object then checks the service state
+ * 	while stopping changes the state then visits the objects,
+ * 	so either the object gets killed or its registration is reverted.
 */
 bool Manager::notify(ulong _sm, const ObjectUidT &_ruid){
 	IndexT		svcidx;
@@ -349,18 +587,15 @@ bool Manager::notify(ulong _sm, const ObjectUidT &_ruid){
 	
 	if(svcidx < d.svcprovisioncp){
 		ServiceStub		&rss = d.psvcarr[svcidx];
-		const uint 		objpermutbts = rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);//set it with release
-		const size_t	objcnt = rss.objvecsz.load(ATOMIC_NS::memory_order_acquire);
+		ObjectStub		*pos = rss.objtab.find(objidx);
+		Object			*pobj;
 		
-		if(objpermutbts && objidx < objcnt){
-			Locker<Mutex>	lock(rss.mtxstore.at(objidx, objpermutbts));
-			
-			if(rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/) == objpermutbts && rss.objvec[objidx].uid == _ruid.second){
-				if(rss.objvec[objidx].pobj->notify(_sm)){
-					this->raise(*rss.objvec[objidx].pobj);
-				}
-				return true;
+		if(pos && (pobj = pos->pin(_ruid.second))){
+			if(pobj->notify(_sm)){
+				this->raise(*pobj);
 			}
+			pos->unpin();
+			return true;
 		}
 	}
 	return false;
@@ -374,32 +609,288 @@ bool Manager::notify(MessagePointerT &_rmsgptr, const ObjectUidT &_ruid){
 	
 	if(svcidx < d.svcprovisioncp){
 		ServiceStub		&rss = d.psvcarr[svcidx];
-		const uint 		objpermutbts = rss.objpermutbts.load(ATOMIC_NS::memory_order_acquire);//set it with release
-		const size_t	objcnt = rss.objvecsz.load(ATOMIC_NS::memory_order_acquire);
+		ObjectStub		*pos = rss.objtab.find(objidx);
+		Object			*pobj;
 		
-		if(objpermutbts && objidx < objcnt){
-			Locker<Mutex>	lock(rss.mtxstore.at(objidx, objpermutbts));
-			
-			if(
-				rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/) == objpermutbts &&
-				rss.objvec[objidx].uid == _ruid.second &&
-				rss.objvec[objidx].pobj
-			){
-				if(rss.objvec[objidx].pobj->notify(_rmsgptr)){
-					this->raise(*rss.objvec[objidx].pobj);
+		if(pos && (pobj = pos->pin(_ruid.second))){
+			{
+				//the mutex is only needed to deliver the message
+				Locker<Mutex>	lock(rss.mtxstore.at(objidx, rss.objpermutbts.load(ATOMIC_NS::memory_order_acquire)));
+				if(pobj->notify(_rmsgptr)){
+					this->raise(*pobj);
 				}
-				return true;
 			}
+			pos->unpin();
+			return true;
 		}
 	}
 	return false;
 }
 
+namespace{
+struct NotifyStub{
+	IndexT		svcidx;
+	IndexT		objidx;
+	uint32		uid;
+	bool operator<(const NotifyStub &_rns)const{
+		if(svcidx < _rns.svcidx) return true;
+		if(_rns.svcidx < svcidx) return false;
+		return objidx < _rns.objidx;
+	}
+};
+//! A raised object, kept pinned till its selector is raised
+struct RaiseStub{
+	RaiseStub(const IndexT _thrid, ObjectStub *_pos):thrid(_thrid), pos(_pos){}
+	IndexT		thrid;
+	ObjectStub	*pos;
+	bool operator<(const RaiseStub &_rrs)const{
+		return thrid < _rrs.thrid;
+	}
+};
+}//namespace
+
+size_t Manager::notifyMany(ulong _sm, const ObjectUidT *_puids, const size_t _cnt){
+	return doNotifyMany(_puids, _cnt, _sm, NULL);
+}
+
+size_t Manager::notifyMany(MessageSharedPointerT &_rmsgptr, const ObjectUidT *_puids, const size_t _cnt){
+	return doNotifyMany(_puids, _cnt, 0, &_rmsgptr);
+}
+
+size_t Manager::doNotifyMany(const ObjectUidT *_puids, const size_t _cnt, ulong _sm, MessageSharedPointerT *_pmsgptr){
+	const int				svcbts = d.svcbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
+	std::vector<NotifyStub>	nsvec;
+	std::vector<RaiseStub>	rsvec;
+	size_t					rv(0);
+	
+	nsvec.reserve(_cnt);
+	for(size_t i = 0; i < _cnt; ++i){
+		NotifyStub ns;
+		split_index(ns.svcidx, ns.objidx, svcbts, _puids[i].first);
+		if(ns.svcidx < d.svcprovisioncp){
+			ns.uid = _puids[i].second;
+			nsvec.push_back(ns);
+		}
+	}
+	//objects guarded by the same mutex become neighbours
+	std::sort(nsvec.begin(), nsvec.end());
+	
+	Mutex		*pmtx(NULL);
+	
+	for(std::vector<NotifyStub>::const_iterator it(nsvec.begin()); it != nsvec.end(); ++it){
+		ServiceStub		&rss = d.psvcarr[it->svcidx];
+		ObjectStub		*pos = rss.objtab.find(it->objidx);
+		Object			*pobj;
+		
+		if(!pos || !(pobj = pos->pin(it->uid))){
+			continue;
+		}
+		bool	mustraise;
+		if(_pmsgptr){
+			//the mutex is only needed to deliver the message
+			Mutex		&rmtx = rss.mtxstore.at(it->objidx, rss.objpermutbts.load(ATOMIC_NS::memory_order_acquire));
+			if(&rmtx != pmtx){
+				if(pmtx){
+					pmtx->unlock();
+				}
+				pmtx = &rmtx;
+				pmtx->lock();
+			}
+			MessagePointerT	msgptr(*_pmsgptr);
+			mustraise = pobj->notify(msgptr);
+		}else{
+			mustraise = pobj->notify(_sm);
+		}
+		if(mustraise){
+			//an object closing would empty its selector which might then retire
+			rsvec.push_back(RaiseStub(pobj->thrid.load(/*ATOMIC_NS::memory_order_seq_cst*/), pos));
+		}else{
+			pos->unpin();
+		}
+		++rv;
+	}
+	if(pmtx){
+		pmtx->unlock();
+	}
+	
+	//objects living on the same selector become neighbours
+	std::sort(rsvec.begin(), rsvec.end());
+	
+	const int				selbts = d.selbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
+	std::vector<uint32>		posvec;
+	size_t					i(0);
+	
+	while(i < rsvec.size()){
+		const size_t	beg(i);
+		IndexT			selidx;
+		IndexT			objidx;
+		split_index(selidx, objidx, selbts, rsvec[i].thrid);
+		SelectorBase	*psel = d.pselarr[selidx].load(/*ATOMIC_NS::memory_order_seq_cst*/);
+		posvec.clear();
+		posvec.push_back(objidx);
+		for(++i; i < rsvec.size(); ++i){
+			IndexT crtselidx;
+			split_index(crtselidx, objidx, selbts, rsvec[i].thrid);
+			if(crtselidx != selidx) break;
+			posvec.push_back(objidx);
+		}
+		if(psel->threadid == Thread::currentId()){
+			//the objects live on the selector of the current thread
+			for(std::vector<uint32>::const_iterator pit(posvec.begin()); pit != posvec.end(); ++pit){
+				psel->raiseLocal(*pit);
+			}
+		}else{
+			psel->raiseMany(posvec.data(), posvec.size());
+		}
+		//the selector is raised - the objects may close now
+		for(size_t j = beg; j < i; ++j){
+			rsvec[j].pos->unpin();
+		}
+	}
+	return rv;
+}
+
+bool Manager::notifyAll(ulong _sm, const ObjectUidT &_rdoneuid, const ulong _donesm){
+	return doNotifyAll(-1, _sm, NULL, _rdoneuid, _donesm);
+}
+
+bool Manager::notifyAll(MessageSharedPointerT &_rmsgptr, const ObjectUidT &_rdoneuid, const ulong _donesm){
+	return doNotifyAll(-1, 0, &_rmsgptr, _rdoneuid, _donesm);
+}
+
+bool Manager::doNotifyAll(
+	const size_t _svcidx,
+	ulong _sm,
+	MessageSharedPointerT *_pmsgptr,
+	const ObjectUidT &_rdoneuid,
+	const ulong _donesm
+){
+	NotifyAllStub	*pnas = new NotifyAllStub(_sm, _pmsgptr, _rdoneuid, _donesm);
+	bool			rv = false;
+	
+	if(_svcidx < d.svcprovisioncp){
+		rv = doNotifyAllService(*pnas, _svcidx);
+	}else{
+		Locker<Mutex>	lock(d.mtx);
+		size_t			crtsvccnt = d.svccnt;
+		for(size_t i = 0; i < d.svcprovisioncp && crtsvccnt; ++i){
+			ServiceStub &rss = d.psvcarr[i];
+			if(rss.psvc){
+				if(doNotifyAllService(*pnas, i)){
+					rv = true;
+				}
+				--crtsvccnt;
+			}
+		}
+	}
+	doNotifyAllDone(*pnas);
+	return rv;
+}
+
+bool Manager::doNotifyAllService(NotifyAllStub &_rnas, const size_t _svcidx){
+	enum{
+		MinRangeSize = 1024
+	};
+	ServiceStub		&rss = d.psvcarr[_svcidx];
+	const size_t	objcnt = rss.objtab.size();
+	
+	if(!rss.objcnt.load(/*ATOMIC_NS::memory_order_seq_cst*/)){
+		return false;
+	}
+	
+	//a few ranges for every worker, so that they end about the same time
+	const size_t	rangecnt = notify_worker_count() * 4;
+	const size_t	stripesz = bitsToCount(rss.objpermutbts.load(ATOMIC_NS::memory_order_acquire));
+	size_t			rangesz = objcnt / rangecnt;
+	
+	if(rangesz < MinRangeSize){
+		rangesz = MinRangeSize;
+	}
+	//a mutex is never shared by two ranges
+	rangesz = ((rangesz + stripesz - 1) / stripesz) * stripesz;
+	
+	if(rangesz >= objcnt){
+		doNotifyAllRange(_rnas, _svcidx, 0, objcnt);
+		return true;
+	}
+	
+	std::vector<NotifyAllJob>	jobvec;
+	
+	for(size_t first = 0; first < objcnt; first += rangesz){
+		NotifyAllJob	job;
+		job.pnas = &_rnas;
+		job.svcidx = _svcidx;
+		job.first = first;
+		job.last = first + rangesz < objcnt ? first + rangesz : objcnt;
+		jobvec.push_back(job);
+	}
+	_rnas.pendcnt.fetch_add(jobvec.size()/*, ATOMIC_NS::memory_order_seq_cst*/);
+	d.notifywp.push(jobvec.begin(), jobvec.end());
+	return true;
+}
+
+size_t Manager::doNotifyAllRange(NotifyAllStub &_rnas, const size_t _svcidx, const size_t _first, const size_t _last){
+	ServiceStub		&rss = d.psvcarr[_svcidx];
+	const uint		objpermutbts = rss.objpermutbts.load(ATOMIC_NS::memory_order_acquire);
+	Mutex			*pmtx(NULL);
+	size_t			rv(0);
+	
+	for(size_t idx = _first; idx < _last; ++idx){
+		ObjectStub	&ros = rss.objtab.at(idx);
+		Object		*pobj = ros.pin();
+		
+		if(!pobj){
+			continue;
+		}
+		bool		mustraise;
+		if(!_rnas.msgptr.empty()){
+			//the mutex is only needed to deliver the message
+			Mutex	&rmtx = rss.mtxstore.at(idx, objpermutbts);
+			if(&rmtx != pmtx){
+				if(pmtx){
+					pmtx->unlock();
+				}
+				pmtx = &rmtx;
+				pmtx->lock();
+			}
+			MessagePointerT	msgptr(_rnas.msgptr);
+			mustraise = pobj->notify(msgptr);
+		}else{
+			mustraise = pobj->notify(_rnas.sm);
+		}
+		if(mustraise){
+			this->raise(*pobj);
+		}
+		ros.unpin();
+		++rv;
+	}
+	if(pmtx){
+		pmtx->unlock();
+	}
+	vdbgx(Debug::frame, "Notified "<<rv<<" objects in ["<<_first<<", "<<_last<<')');
+	return rv;
+}
+
+void Manager::doNotifyAllDone(NotifyAllStub &_rnas){
+	if(_rnas.pendcnt.fetch_sub(1/*, ATOMIC_NS::memory_order_seq_cst*/) == 1){
+		if(!is_invalid_uid(_rnas.doneuid)){
+			notify(_rnas.donesm, _rnas.doneuid);
+		}
+		delete &_rnas;
+	}
+}
+
 void Manager::raise(const Object &_robj){
 	IndexT selidx;
 	IndexT objidx;
 	split_index(selidx, objidx, d.selbts.load(/*ATOMIC_NS::memory_order_seq_cst*/), _robj.thrid.load(/*ATOMIC_NS::memory_order_seq_cst*/));
-	d.pselarr[selidx].load(/*ATOMIC_NS::memory_order_seq_cst*/)->raise(objidx);
+	SelectorBase	*psel = d.pselarr[selidx].load(/*ATOMIC_NS::memory_order_seq_cst*/);
+	if(psel->threadid == Thread::currentId()){
+		//the object lives on the selector of the current thread
+		psel->raiseLocal(objidx);
+	}else{
+		psel->raise(objidx);
+	}
 }
 
 Mutex& Manager::mutex(const Object &_robj)const{
@@ -411,7 +902,7 @@ Mutex& Manager::mutex(const Object &_robj)const{
 	
 	ServiceStub		&rss = d.psvcarr[svcidx];
 	const uint 		objpermutbts = rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
-	cassert(objidx < rss.objvecsz.load(ATOMIC_NS::memory_order_acquire));
+	cassert(objidx < rss.objtab.size());
 	return rss.mtxstore.at(objidx, objpermutbts);
 }
 
@@ -423,10 +914,8 @@ ObjectUidT  Manager::id(const Object &_robj)const{
 	cassert(svcidx < d.svcprovisioncp);
 	
 	ServiceStub		&rss = d.psvcarr[svcidx];
-	cassert(objidx < rss.objvecsz.load(/*ATOMIC_NS::memory_order_seq_cst*/));
-	const uint 		objpermutbts = rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
-	Locker<Mutex>	lock(rss.mtxstore.at(objidx, objpermutbts));
-	return ObjectUidT(_robj.fullid, rss.objvec[objidx].uid);
+	cassert(objidx < rss.objtab.size());
+	return ObjectUidT(_robj.fullid, rss.objtab.at(objidx).uid.load(/*ATOMIC_NS::memory_order_seq_cst*/));
 }
 
 Service& Manager::service(const Object &_robj)const{
@@ -448,9 +937,9 @@ ObjectUidT  Manager::unsafeId(const Object &_robj)const{
 	cassert(svcidx < d.svcprovisioncp);
 	
 	ServiceStub		&rss = d.psvcarr[svcidx];
-	cassert(objidx < rss.objvecsz.load(/*ATOMIC_NS::memory_order_seq_cst*/));
+	cassert(objidx < rss.objtab.size());
 	cassert(!rss.mtxstore.at(objidx, rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/)).tryLock());
-	return ObjectUidT(_robj.fullid, rss.objvec[objidx].uid);
+	return ObjectUidT(_robj.fullid, rss.objtab.at(objidx).uid.load(ATOMIC_NS::memory_order_relaxed));
 }
 
 Mutex& Manager::serviceMutex(const Service &_rsvc)const{
@@ -465,8 +954,7 @@ ObjectUidT Manager::registerServiceObject(const Service &_rsvc, Object &_robj){
 	cassert(_rsvc.idx < d.svcprovisioncp);
 	ServiceStub		&rss = d.psvcarr[_rsvc.idx];
 	cassert(!_rsvc.idx || rss.psvc != NULL);
-	Locker<Mutex>	lock(rss.mtx);
-	return doUnsafeRegisterServiceObject(_rsvc.idx, _robj);
+	return doRegisterServiceObject(_rsvc.idx, _robj);
 }
 
 
@@ -505,18 +993,15 @@ bool Manager::doRegisterService(
 		
 		rss.state = ServiceStub::StateRunning;
 		
-		const size_t	objcnt = rss.objvecsz.load(/*ATOMIC_NS::memory_order_seq_cst*/);
+		const size_t	objcnt = rss.objtab.size();
 		const uint		oldobjpermutbts = rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
 		
 		lock_all(rss.mtxstore, objcnt, oldobjpermutbts);
 		
 		rss.objpermutbts.store(_objpermutbts, ATOMIC_NS::memory_order_release);
 		
-		while(rss.objfreestk.size()){
-			rss.objfreestk.pop();
-		}
+		rss.objtab.reset();
 		for(size_t i = objcnt; i > 0; --i){
-			rss.objfreestk.push(i - 1);
 			rss.mtxstore.safeAt(i - 1, _objpermutbts);
 		}
 		vdbgx(Debug::frame, "Last safe at = "<<(objcnt - 1));
@@ -528,13 +1013,42 @@ bool Manager::doRegisterService(
 	}
 }
 
-// ObjectUidT Manager::doRegisterServiceObject(const IndexT _svcidx, Object &_robj){
-// 	cassert(_svcidx < d.svcprovisioncp);
-// 	ServiceStub		&rss = d.psvcarr[_svcidx];
-// 	cassert(!_svcidx || rss.psvc != NULL);
-// 	//Locker<Mutex>	lock(rss.mtx);
-// 	return doUnsafeRegisterServiceObject(_svcidx, _robj);
-// }
+ObjectUidT Manager::doRegisterServiceObject(const IndexT _svcidx, Object &_robj){
+	cassert(_svcidx < d.svcprovisioncp);
+	ServiceStub		&rss = d.psvcarr[_svcidx];
+	size_t			objidx;
+	
+	if(rss.state != ServiceStub::StateRunning){
+		return ObjectUidT();
+	}
+	
+	if(rss.objtab.pop(objidx)){
+		const ObjectUidT	retval = doRegisterObjectStub(_svcidx, objidx, _robj);
+		
+		if(rss.state != ServiceStub::StateRunning){
+			//the service might have been stopped without seeing the object
+			doUnregisterObject(_svcidx, objidx);
+			_robj.fullid = -1;
+			return ObjectUidT();
+		}
+		return retval;
+	}
+	//only growing the object table needs the service lock
+	Locker<Mutex>	lock(rss.mtx);
+	return doUnsafeRegisterServiceObject(_svcidx, _robj);
+}
+
+ObjectUidT Manager::doRegisterObjectStub(const IndexT _svcidx, const IndexT _objidx, Object &_robj){
+	ServiceStub		&rss = d.psvcarr[_svcidx];
+	ObjectStub		&ros = rss.objtab.at(_objidx);
+	const IndexT	fullid = unite_index(_svcidx, _objidx, d.svcbts.load(/*ATOMIC_NS::memory_order_seq_cst*/));
+	
+	_robj.fullid = fullid;
+	rss.objcnt.fetch_add(1/*, ATOMIC_NS::memory_order_seq_cst*/);
+	ros.pobj.store(&_robj/*, ATOMIC_NS::memory_order_seq_cst*/);
+	
+	return ObjectUidT(fullid, ros.uid.load(ATOMIC_NS::memory_order_relaxed));
+}
 
 ObjectUidT Manager::doUnsafeRegisterServiceObject(const IndexT _svcidx, Object &_robj){
 	ServiceStub		&rss = d.psvcarr[_svcidx];
@@ -543,76 +1057,52 @@ ObjectUidT Manager::doUnsafeRegisterServiceObject(const IndexT _svcidx, Object &
 		return ObjectUidT();
 	}
 	
-	if(rss.objfreestk.size()){
-		const IndexT	objidx = rss.objfreestk.top();
-		
-		rss.objfreestk.pop();
-		
-		const IndexT	fullid = unite_index(_svcidx, objidx, d.svcbts.load(/*ATOMIC_NS::memory_order_seq_cst*/));
-		Locker<Mutex>	lock2(rss.mtxstore.at(objidx, rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/)));
-		
-		rss.objvec[objidx].pobj = &_robj;
-		_robj.fullid = fullid;
-		
-		return ObjectUidT(fullid, rss.objvec[objidx].uid);
-	}else{
-		const size_t	objcnt = rss.objvecsz.load(/*ATOMIC_NS::memory_order_seq_cst*/);
-		const uint		objbts = d.objbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
-		const size_t	objmaxcnt = bitsToCount(objbts);
-		
-		const uint		objpermutbts = rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
-		const size_t	objpermutcnt = bitsToCount(objpermutbts);
-		const size_t	objaddsz = d.computeObjectAddSize(rss.objvec.size(), objpermutcnt);
-		size_t			newobjcnt = objcnt + objaddsz;
-		ObjectUidT		retval;
+	size_t			objidx;
+	
+	if(rss.objtab.pop(objidx)){
+		return doRegisterObjectStub(_svcidx, objidx, _robj);
+	}
+	
+	const size_t	objcnt = rss.objtab.size();
+	const uint		objbts = d.objbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
+	const size_t	objmaxcnt = bitsToCount(objbts);
+	const uint		objpermutbts = rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
+	size_t			newobjcnt = rss.objtab.nextSize();
+	
+	if(newobjcnt >= objmaxcnt){
+		Locker<Mutex>	lockt(d.mtxobj);
+		const uint		svcbtst = d.svcbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
+		uint			objbtst = d.objbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
+		size_t			objmaxcntt = bitsToCount(objbtst);
 		
-		if(newobjcnt >= objmaxcnt){
-			Locker<Mutex>	lockt(d.mtxobj);
-			const uint		svcbtst = d.svcbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
-			uint			objbtst = d.objbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
-			size_t			objmaxcntt = bitsToCount(objbtst);
-			
-			while(newobjcnt >= objmaxcntt){
-				if((objbtst + svcbtst + 1) > (sizeof(IndexT) * 8)){
-					break;
-				}
-				++objbtst;
-				objmaxcntt = bitsToCount(objbtst);
+		while(newobjcnt >= objmaxcntt){
+			if((objbtst + svcbtst + 1) > (sizeof(IndexT) * 8)){
+				break;
 			}
-			if(newobjcnt >=  objmaxcntt){
-				if(objmaxcntt > objcnt){
-					newobjcnt = objmaxcntt;
-				}else{
-					return retval;
-				}
+			++objbtst;
+			objmaxcntt = bitsToCount(objbtst);
+		}
+		if(newobjcnt >=  objmaxcntt){
+			if(objmaxcntt > objcnt){
+				newobjcnt = objmaxcntt;
 			}else{
-				d.objbts.store(objbtst/*, ATOMIC_NS::memory_order_seq_cst*/);
+				return ObjectUidT();
 			}
+		}else{
+			d.objbts.store(objbtst/*, ATOMIC_NS::memory_order_seq_cst*/);
 		}
-		
-		for(size_t i = objcnt; i < newobjcnt; ++i){
-			rss.mtxstore.safeAt(i, objpermutbts);
-			rss.objfreestk.push(newobjcnt - (i - objcnt) - 1);
-		}
-		
-		const IndexT idx = rss.objfreestk.top();
-		
-		retval.first = unite_index(_svcidx, idx, d.svcbts.load(/*ATOMIC_NS::memory_order_seq_cst*/));;
-		
-		rss.objfreestk.pop();
-		
-		lock_all(rss.mtxstore, newobjcnt, objpermutbts);
-		
-		rss.objvec.resize(newobjcnt);
-		rss.objvec[idx].pobj = &_robj;
-		_robj.fullid = retval.first;
-		retval.second = rss.objvec[idx].uid;
-		rss.objvecsz.store(newobjcnt, ATOMIC_NS::memory_order_release);
-		
-		unlock_all(rss.mtxstore, newobjcnt, objpermutbts);
-		return retval;
 	}
 	
+	for(size_t i = objcnt; i < newobjcnt; ++i){
+		rss.mtxstore.safeAt(i, objpermutbts);
+	}
+	
+	rss.objtab.grow(newobjcnt);
+	
+	if(rss.objtab.pop(objidx)){
+		return doRegisterObjectStub(_svcidx, objidx, _robj);
+	}
+	return ObjectUidT();
 }
 bool Manager::doForEachServiceObject(const Service &_rsvc, ObjectVisitFunctorT &_fctor){
 	Locker<Mutex>	lock1(d.mtx);
@@ -627,31 +1117,31 @@ bool Manager::doForEachServiceObject(const Service &_rsvc, ObjectVisitFunctorT &
 bool Manager::doForEachServiceObject(const size_t _svcidx, Manager::ObjectVisitFunctorT &_fctor){
 	ServiceStub		&rss = d.psvcarr[_svcidx];
 	const uint		objpermutbts = rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
-	if(rss.objvec.empty()){
+	const size_t	objcnt = rss.objtab.size();
+	if(!objcnt){
 		return false;
 	}
-	size_t			loopcnt = 0;
 	size_t			hitcnt = 0;
-	const size_t	objcnt = rss.objvec.size() - rss.objfreestk.size();
 	Mutex			*poldmtx = &rss.mtxstore[0];
 	
 	poldmtx->lock();
-	for(ObjectVectorT::const_iterator it(rss.objvec.begin()); it != rss.objvec.end() && hitcnt < objcnt; ++it){
-		++loopcnt;
-		const size_t idx = it - rss.objvec.begin();
+	for(size_t idx = 0; idx < objcnt; ++idx){
 		Mutex &rmtx = rss.mtxstore.at(idx, objpermutbts);
 		if(&rmtx != poldmtx){
 			poldmtx->unlock();
 			rmtx.lock();
 			poldmtx = &rmtx;
 		}
-		if(it->pobj){
-			_fctor(*it->pobj);
+		ObjectStub	&ros = rss.objtab.at(idx);
+		Object		*pobj = ros.pin();
+		if(pobj){
+			_fctor(*pobj);
+			ros.unpin();
 			++hitcnt;
 		}
 	}
 	poldmtx->unlock();
-	vdbgx(Debug::frame, "Looped "<<loopcnt<<" times for "<<objcnt<<" objects");
+	vdbgx(Debug::frame, "Visited "<<hitcnt<<" objects out of "<<objcnt);
 	return hitcnt != 0;
 }
 
@@ -664,7 +1154,7 @@ Mutex& Manager::mutex(const IndexT &_rfullid)const{
 	
 	ServiceStub		&rss = d.psvcarr[svcidx];
 	const uint 		objpermutbts = rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/);
-	cassert(objidx < rss.objvecsz.load(ATOMIC_NS::memory_order_acquire));
+	cassert(objidx < rss.objtab.size());
 	return rss.mtxstore.at(objidx, objpermutbts);
 }
 
@@ -677,12 +1167,10 @@ Object* Manager::unsafeObject(const IndexT &_rfullid)const{
 	if(svcidx < d.svcprovisioncp){
 		ServiceStub		&rss = d.psvcarr[svcidx];
 		const uint 		objpermutbts = rss.objpermutbts.load(ATOMIC_NS::memory_order_acquire);//set it with release
-		const size_t	objcnt = rss.objvecsz.load(ATOMIC_NS::memory_order_acquire);
+		const size_t	objcnt = rss.objtab.size();
 		
 		if(objpermutbts && objidx < objcnt){
-			if(rss.objpermutbts.load(/*ATOMIC_NS::memory_order_seq_cst*/) == objpermutbts){
-				return rss.objvec[objidx].pobj;
-			}
+			return rss.objtab.at(objidx).pobj.load(/*ATOMIC_NS::memory_order_seq_cst*/);
 		}
 	}
 	return NULL;
@@ -740,6 +1228,7 @@ bool Manager::prepareThread(SelectorBase *_ps){
 		d.selfreestk.pop();
 		
 		_ps->selid = selidx;
+		_ps->threadid = Thread::currentId();
 		d.pselarr[_ps->selid] = _ps;
 	}
 	if(!doPrepareThread()){
@@ -759,6 +1248,7 @@ void Manager::unprepareThread(SelectorBase *_ps){
 		d.pselarr[_ps->selid] = NULL;
 		d.selfreestk.push(_ps->selid);
 		_ps->selid = 0;
+		_ps->threadid = 0;
 	}
 	//requestuidptr.unprepareThread();
 }
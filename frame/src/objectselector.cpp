@@ -61,7 +61,7 @@ ObjectSelector::~ObjectSelector(){
 }
 
 ulong ObjectSelector::capacity()const{
-	return d.sv.size();
+	return d.sv.size() - 1;//position 0 is not used
 }
 ulong ObjectSelector::size() const{
 	return d.sz;
@@ -70,7 +70,7 @@ bool  ObjectSelector::empty()const{
 	return d.sz == 0;
 }
 bool  ObjectSelector::full()const{
-	return d.sz == d.sv.size();
+	return d.fstk.empty();
 }
 
 bool ObjectSelector::init(ulong _cp){
@@ -0,0 +1,259 @@
+// frame/src/resolver.cpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#include "frame/resolver.hpp"
+#include "frame/manager.hpp"
+#include "system/cassert.hpp"
+#include "system/debug.hpp"
+#include "system/mutex.hpp"
+#include "system/timespec.hpp"
+#include "utility/workpool.hpp"
+
+#include <map>
+#include <vector>
+#include <cstdio>
+
+namespace solid{
+namespace frame{
+
+//! The resolve workers are created on demand, up to maxwkrcnt
+struct Resolver::Data{
+	struct Key{
+		Key(
+			const char *_node, const char *_service,
+			int _flags, int _family, int _type, int _proto
+		):	node(_node ? _node : ""), service(_service ? _service : ""),
+			flags(_flags), family(_family), type(_type), proto(_proto){}
+
+		bool operator<(const Key &_rk)const{
+			if(node != _rk.node) return node < _rk.node;
+			if(service != _rk.service) return service < _rk.service;
+			if(flags != _rk.flags) return flags < _rk.flags;
+			if(family != _rk.family) return family < _rk.family;
+			if(type != _rk.type) return type < _rk.type;
+			return proto < _rk.proto;
+		}
+
+		std::string	node;
+		std::string	service;
+		int			flags;
+		int			family;
+		int			type;
+		int			proto;
+	};
+	typedef std::vector<ObjectUidT>		UidVectorT;
+
+	struct Entry{
+		Entry():pending(true){}
+
+		ResolveData	data;
+		TimeSpec	expire;
+		bool		pending;//a resolve is running - the entry must not be erased
+		UidVectorT	waitvec;//the objects waiting for the pending resolve
+	};
+	typedef std::map<Key, Entry>		CacheMapT;
+
+	struct Controller: WorkPoolControllerBase{
+		typedef WorkPool<const Key*, Controller>	WorkPoolT;
+
+		Controller(Data &_rd):rd(_rd), wkrcnt(0){}
+
+		bool createWorker(WorkPoolT &_rwp){
+			WorkerBase	*pw(_rwp.createSingleWorker());
+			if(pw && !pw->start()){
+				delete pw;
+				return false;
+			}
+			++wkrcnt;
+			return true;
+		}
+		void onPush(WorkPoolT &_rwp){
+			if(wkrcnt < rd.maxwkrcnt){
+				_rwp.createWorker();
+			}
+		}
+		void execute(WorkerBase &, const Key *&_rpkey){
+			rd.execute(*_rpkey);
+		}
+
+		Data	&rd;
+		size_t	wkrcnt;
+	};
+	typedef Controller::WorkPoolT		WorkPoolT;
+
+	Data(
+		Manager &_rm, const size_t _maxwkrcnt,
+		const uint32 _ttl, const uint32 _negttl, const size_t _cachecp,
+		LookupFunctionT _pflookup
+	):rm(_rm), maxwkrcnt(_maxwkrcnt ? _maxwkrcnt : 1), ttl(_ttl), negttl(_negttl),
+		cachecp(_cachecp), pflookup(_pflookup), wp(*this){
+		if(!pflookup){
+			pflookup = &synchronous_resolve;
+		}
+	}
+
+	void execute(const Key &_rk);
+	void notify(const UidVectorT &_ruidvec, const Key &_rk, const ResolveData &_rrd, const bool _cached);
+	void evict(const TimeSpec &_rnow);
+
+	Manager			&rm;
+	const size_t	maxwkrcnt;
+	const uint32	ttl;
+	const uint32	negttl;
+	const size_t	cachecp;
+	LookupFunctionT	pflookup;
+	Mutex			mtx;
+	CacheMapT		cachemap;
+	WorkPoolT		wp;
+};
+
+//! Resolve a pending entry on a worker thread
+void Resolver::Data::execute(const Key &_rk){
+	//the entry is pending, so _rk stays valid till we clear the flag
+	const Key			key(_rk);
+	const ResolveData	rd((*pflookup)(
+		key.node.empty() ? NULL : key.node.c_str(),
+		key.service.empty() ? NULL : key.service.c_str(),
+		key.flags, key.family, key.type, key.proto
+	));
+	UidVectorT			uidvec;
+	{
+		Locker<Mutex>		lock(mtx);
+		CacheMapT::iterator	it(cachemap.find(key));
+		cassert(it != cachemap.end() && it->second.pending);
+		Entry				&re(it->second);
+
+		re.data = rd;
+		re.pending = false;
+		re.expire = TimeSpec::createMonotonic();
+		re.expire += TimeSpec(rd.empty() ? negttl : ttl);
+		uidvec.swap(re.waitvec);
+	}
+	vdbgx(Debug::frame, "resolved "<<key.node<<':'<<key.service<<" empty = "<<rd.empty()<<" for "<<uidvec.size()<<" objects");
+	notify(uidvec, key, rd, false);
+}
+
+void Resolver::Data::notify(
+	const UidVectorT &_ruidvec, const Key &_rk, const ResolveData &_rrd, const bool _cached
+){
+	for(UidVectorT::const_iterator it(_ruidvec.begin()); it != _ruidvec.end(); ++it){
+		MessagePointerT	msgptr(new ResolveMessage(_rk.node, _rk.service, _rrd, _cached));
+		rm.notify(msgptr, *it);
+	}
+}
+
+//! Make room in the cache: first the expired entries, then any not pending
+void Resolver::Data::evict(const TimeSpec &_rnow){
+	for(CacheMapT::iterator it(cachemap.begin()); it != cachemap.end() && cachemap.size() > cachecp;){
+		if(!it->second.pending && it->second.expire <= _rnow){
+			cachemap.erase(it++);
+		}else{
+			++it;
+		}
+	}
+	for(CacheMapT::iterator it(cachemap.begin()); it != cachemap.end() && cachemap.size() > cachecp;){
+		if(!it->second.pending){
+			cachemap.erase(it++);
+		}else{
+			++it;
+		}
+	}
+}
+
+//--------------------------------------------------------------------
+Resolver::Resolver(
+	Manager &_rm,
+	const size_t _wkrcnt,
+	const uint32 _ttl,
+	const uint32 _negttl,
+	const size_t _cachecp,
+	LookupFunctionT _pflookup
+):d(*(new Data(_rm, _wkrcnt, _ttl, _negttl, _cachecp, _pflookup))){
+	d.wp.start();
+}
+
+Resolver::~Resolver(){
+	stop();
+	delete &d;
+}
+
+void Resolver::stop(){
+	d.wp.stop(true);
+}
+
+void Resolver::resolve(
+	const ObjectUidT &_ruid,
+	const char *_node,
+	const char *_service,
+	int _flags,
+	int _family,
+	int _type,
+	int _proto
+){
+	const Data::Key		key(_node, _service, _flags, _family, _type, _proto);
+	const TimeSpec		now(TimeSpec::createMonotonic());
+	ResolveData			rd;
+	{
+		Locker<Mutex>							lock(d.mtx);
+		std::pair<Data::CacheMapT::iterator, bool>	rv(d.cachemap.insert(Data::CacheMapT::value_type(key, Data::Entry())));
+		Data::Entry								&re(rv.first->second);
+
+		if(rv.second){
+			//a new entry, pending
+			if(d.cachemap.size() > d.cachecp){
+				d.evict(now);
+			}
+			re.waitvec.push_back(_ruid);
+			d.wp.push(&rv.first->first);
+			return;
+		}
+		if(re.pending){
+			//share the running resolve
+			re.waitvec.push_back(_ruid);
+			return;
+		}
+		if(re.expire <= now){
+			re.pending = true;
+			re.waitvec.push_back(_ruid);
+			d.wp.push(&rv.first->first);
+			return;
+		}
+		rd = re.data;
+	}
+	vdbgx(Debug::frame, "cached "<<key.node<<':'<<key.service);
+	d.notify(Data::UidVectorT(1, _ruid), key, rd, true);
+}
+
+void Resolver::resolve(
+	const ObjectUidT &_ruid,
+	const char *_node,
+	int _port,
+	int _flags,
+	int _family,
+	int _type,
+	int _proto
+){
+	char buf[12];
+	sprintf(buf, "%u", _port);
+	resolve(_ruid, _node, buf, _flags, _family, _type, _proto);
+}
+
+void Resolver::clear(){
+	Locker<Mutex>	lock(d.mtx);
+	for(Data::CacheMapT::iterator it(d.cachemap.begin()); it != d.cachemap.end();){
+		if(!it->second.pending){
+			d.cachemap.erase(it++);
+		}else{
+			++it;
+		}
+	}
+}
+
+}//namespace frame
+}//namespace solid
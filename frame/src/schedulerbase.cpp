@@ -11,11 +11,16 @@
 #include "frame/selectorbase.hpp"
 #include "frame/manager.hpp"
 #include "utility/list.hpp"
+#include "system/debug.hpp"
+#include "system/mutex.hpp"
 
 namespace solid{
 namespace frame{
 
 struct SchedulerBase::Data{
+	enum{
+		InvalidSlot = 0xffff
+	};
 	Data():crtidx(0){}
 	typedef List<uint16>				UInt16ListT;
 	typedef std::pair<
@@ -23,48 +28,186 @@ struct SchedulerBase::Data{
 		UInt16ListT::iterator
 		>								SelectorPairT;
 	typedef std::vector<SelectorPairT>	SelectorPairVectorT;
+	typedef std::vector<Thread::ProcessorVectorT>	ProcessorSetVectorT;
+	typedef std::vector<uint16>			UInt16VectorT;
+	typedef std::vector<bool>			BoolVectorT;
+	typedef std::vector<ulong>			ULongVectorT;
 	
+	size_t acquireSlot();
+	
+	Mutex					mtx;//guards the selector pointers from selvec for balancing
 	SelectorPairVectorT		selvec;
 	UInt16ListT				idxlst;
 	uint16					crtidx;
+	ProcessorSetVectorT		cpusetvec;//one processor set for every placement slot
+	BoolVectorT				slotvec;//the placement slots in use
+	UInt16VectorT			selslotvec;//the placement slot of every selector
+	ULongVectorT			loadvec;//the load of every not full selector
 };
 
+//the selector running the current thread
+static const unsigned selectorSpecificPosition(){
+	static const unsigned	thrspecpos = Thread::specificId();
+	return thrspecpos;
+}
+
+size_t SchedulerBase::Data::acquireSlot(){
+	size_t i(0);
+	for(; i < slotvec.size() && slotvec[i]; ++i){
+	}
+	if(i == slotvec.size()){
+		slotvec.push_back(true);
+	}else{
+		slotvec[i] = true;
+	}
+	return i;
+}
+
 
 SchedulerBase::SchedulerBase(
 	Manager &_rm,
 	uint16 _startwkrcnt,
 	uint16 _maxwkrcnt,
 	const IndexT &_selcap
-):rm(_rm), d(*(new Data)), startwkrcnt(_startwkrcnt), maxwkrcnt(_maxwkrcnt), crtwkrcnt(0), selcap(_selcap){
+):rm(_rm), d(*(new Data)), startwkrcnt(_startwkrcnt), maxwkrcnt(_maxwkrcnt), crtwkrcnt(0), selcap(_selcap), idlemsec(0), balmsec(0), balload(0), persistreg(false), zcthreshold(0), phspool(NULL){
 	if(maxwkrcnt == 0) maxwkrcnt = 1;
+	for(uint i = 0; i < PriorityCount; ++i){
+		budgetcnt[i] = 0;
+		budgetusec[i] = 0;
+	}
 }
 /*virtual*/ SchedulerBase::~SchedulerBase(){
 	delete &d;
 }
+void SchedulerBase::affinity(const Affinity _aff, const Thread::ProcessorVectorT &_rvec){
+	d.cpusetvec.clear();
+	switch(_aff){
+		case AffinityNone:
+			break;
+		case AffinityProcessors:
+			for(Thread::ProcessorVectorT::const_iterator it(_rvec.begin()); it != _rvec.end(); ++it){
+				d.cpusetvec.push_back(Thread::ProcessorVectorT(1, *it));
+			}
+			break;
+		case AffinityNumaNodes:
+			for(Thread::ProcessorVectorT::const_iterator it(_rvec.begin()); it != _rvec.end(); ++it){
+				d.cpusetvec.push_back(Thread::ProcessorVectorT());
+				if(!Thread::numaNodeProcessors(*it, d.cpusetvec.back())){
+					wdbgx(Debug::frame, "unknown NUMA node "<<*it);
+					d.cpusetvec.pop_back();
+				}
+			}
+			break;
+		case AffinitySpread:{
+			std::vector<Thread::ProcessorVectorT>	nodevec(Thread::numaNodeCount());
+			size_t									maxsz(0);
+			for(size_t i = 0; i < nodevec.size(); ++i){
+				Thread::numaNodeProcessors(i, nodevec[i]);
+				if(nodevec[i].size() > maxsz) maxsz = nodevec[i].size();
+			}
+			for(size_t j = 0; j < maxsz; ++j){
+				for(size_t i = 0; i < nodevec.size(); ++i){
+					if(j < nodevec[i].size()){
+						d.cpusetvec.push_back(Thread::ProcessorVectorT(1, nodevec[i][j]));
+					}
+				}
+			}
+		}break;
+	}
+}
+void SchedulerBase::workerIdleTimeout(const ulong _msec){
+	idlemsec = _msec;
+}
+void SchedulerBase::loadBalancing(const ulong _msec, const ulong _highload){
+	balmsec = _msec;
+	balload = _highload;
+}
+void SchedulerBase::executionBudget(const PriorityE _prio, const ulong _cnt, const ulong _usec){
+	cassert(_prio < PriorityCount);
+	budgetcnt[_prio] = _cnt;
+	budgetusec[_prio] = _usec;
+}
+void SchedulerBase::persistentRegistration(const bool _enable){
+	persistreg = _enable;
+}
+void SchedulerBase::zeroCopyThreshold(const uint32 _size){
+	zcthreshold = _size;
+}
+void SchedulerBase::handshakePool(aio::HandshakePool *_php){
+	phspool = _php;
+}
 bool SchedulerBase::prepareThread(SelectorBase *_ps){
+	size_t slot(Data::InvalidSlot);
+	if(_ps && d.cpusetvec.size()){
+		slot = d.acquireSlot();
+		//bind before the manager prepares the thread specific caches
+		if(!Thread::affinity(d.cpusetvec[slot % d.cpusetvec.size()])){
+			wdbgx(Debug::frame, "could not set the affinity for slot "<<slot);
+		}
+	}
 	if(rm.prepareThread(_ps)){
 		if(_ps){
+			Locker<Mutex>	lock(d.mtx);
+			_ps->psch = this;
+			_ps->load(0);
 			safe_at(d.selvec, _ps->id()) = Data::SelectorPairT(_ps, d.idxlst.insert(d.idxlst.end(), _ps->id()));
+			safe_at(d.selslotvec, _ps->id()) = slot;
+			safe_at(d.loadvec, _ps->id()) = 0;
+			Thread::specific(selectorSpecificPosition(), _ps);
 		}
 		return true;
 	}else{
+		if(slot != Data::InvalidSlot){
+			d.slotvec[slot] = false;
+		}
 		return false;
 	}
 }
 void SchedulerBase::unprepareThread(SelectorBase *_ps){
 	if(_ps){
-		d.selvec[_ps->id()].first = NULL;
-		d.selvec[_ps->id()].second = d.idxlst.end();
+		Thread::specific(selectorSpecificPosition(), NULL);
+		markSelectorFull(*_ps);
+		{
+			Locker<Mutex>	lock(d.mtx);
+			d.selvec[_ps->id()].first = NULL;
+		}
+		const size_t slot(d.selslotvec[_ps->id()]);
+		if(slot != Data::InvalidSlot){
+			d.slotvec[slot] = false;
+		}
 	}
 	rm.unprepareThread(_ps);
 }
+SelectorBase* SchedulerBase::currentSelector()const{
+	SelectorBase	*ps(reinterpret_cast<SelectorBase*>(Thread::specific(selectorSpecificPosition())));
+	if(ps && ps->psch == this){
+		return ps;
+	}
+	return NULL;
+}
 bool SchedulerBase::tryRaiseOneSelector()const{
 	if(d.idxlst.size()){
-		d.selvec[d.idxlst.back()].first->raise();
+		//favour the busiest selector so that the load consolidates
+		uint16 idx(d.idxlst.back());
+		for(Data::UInt16ListT::iterator it(d.idxlst.begin()); it != d.idxlst.end(); ++it){
+			if(d.loadvec[*it] > d.loadvec[idx]){
+				idx = *it;
+			}
+		}
+		d.selvec[idx].first->raise();
 		return true;
 	}
 	return false;
 }
+bool SchedulerBase::hasBusierSelector(const SelectorBase &_rs)const{
+	const ulong load(d.selvec[_rs.id()].second != d.idxlst.end() ? d.loadvec[_rs.id()] : 0);
+	for(Data::UInt16ListT::iterator it(d.idxlst.begin()); it != d.idxlst.end(); ++it){
+		if(*it != _rs.id() && (d.loadvec[*it] > load || (d.loadvec[*it] == load && *it > _rs.id()))){
+			return true;
+		}
+	}
+	return false;
+}
 void SchedulerBase::raiseOneSelector(){
 	if(d.selvec.empty()) return;
 	uint cnt(d.selvec.size());
@@ -84,10 +227,24 @@ void SchedulerBase::markSelectorFull(SelectorBase &_rs){
 		d.selvec[_rs.id()].second = d.idxlst.end();
 	}
 }
-void SchedulerBase::markSelectorNotFull(SelectorBase &_rs){
+void SchedulerBase::markSelectorNotFull(SelectorBase &_rs, const ulong _load){
 	if(d.selvec[_rs.id()].second == d.idxlst.end()){
 		d.selvec[_rs.id()].second = d.idxlst.insert(d.idxlst.end(), _rs.id());
 	}
+	d.loadvec[_rs.id()] = _load;
+}
+void SchedulerBase::doBalance(SelectorBase &_rs){
+	Locker<Mutex>	lock(d.mtx);
+	SelectorBase	*ps(NULL);
+	for(Data::SelectorPairVectorT::const_iterator it(d.selvec.begin()); it != d.selvec.end(); ++it){
+		if(it->first && it->first != &_rs && (!ps || it->first->load() < ps->load())){
+			ps = it->first;
+		}
+	}
+	if(ps && ps->load() < _rs.load()){
+		vdbgx(Debug::frame, "balance selector "<<_rs.id()<<" load "<<_rs.load()<<" to "<<ps->id()<<" load "<<ps->load());
+		_rs.migrate(*ps);
+	}
 }
 void SchedulerBase::doStop(){
 	for(Data::SelectorPairVectorT::const_iterator it(d.selvec.begin()); it != d.selvec.end(); ++it){
@@ -97,5 +254,33 @@ void SchedulerBase::doStop(){
 	}
 }
 
+//=====================================================================
+ulong SelectorBase::balancePeriod()const{
+	return psch ? psch->balmsec : 0;
+}
+ulong SelectorBase::balanceLoad()const{
+	return psch ? psch->balload : 0;
+}
+ulong SelectorBase::budgetCount(const PriorityE _prio)const{
+	return psch ? psch->budgetcnt[_prio] : 0;
+}
+ulong SelectorBase::budgetTime(const PriorityE _prio)const{
+	return psch ? psch->budgetusec[_prio] : 0;
+}
+bool SelectorBase::persistentRegistration()const{
+	return psch ? psch->persistreg : false;
+}
+uint32 SelectorBase::zeroCopyThreshold()const{
+	return psch ? psch->zcthreshold : 0;
+}
+aio::HandshakePool* SelectorBase::handshakePool()const{
+	return psch ? psch->phspool : NULL;
+}
+void SelectorBase::balance(){
+	if(psch){
+		psch->doBalance(*this);
+	}
+}
+
 }//namespace frame
 }//namespace solid
@@ -48,49 +48,16 @@ ObjectUidT Service::registerObject(Object &_robj){
 	}
 }
 
-namespace{
-
-struct SignalNotifier{
-	SignalNotifier(Manager &_rm, ulong _sm):rm(_rm), sm(_sm){}
-	Manager	&rm;
-	ulong	sm;
-	
-	void operator()(Object &_robj){
-		if(_robj.notify(sm)){
-			rm.raise(_robj);
-		}
-	}
-};
-
-struct MessageNotifier{
-	MessageNotifier(Manager &_rm, MessageSharedPointerT &_rmsgptr):rm(_rm), rmsgptr(_rmsgptr){}
-	Manager					&rm;
-	MessageSharedPointerT	&rmsgptr;
-	
-	void operator()(Object &_robj){
-		MessagePointerT msgptr(rmsgptr);
-		if(_robj.notify(msgptr)){
-			rm.raise(_robj);
-		}
-	}
-};
-
-
-}//namespace
-
-
-bool Service::notifyAll(ulong _sm){
+bool Service::notifyAll(ulong _sm, const ObjectUidT &_rdoneuid, const ulong _donesm){
 	if(isRegistered()){
-		SignalNotifier	notifier(rm, _sm);
-		return rm.forEachServiceObject(*this, notifier);
+		return rm.doNotifyAll(idx.load(/*ATOMIC_NS::memory_order_seq_cst*/), _sm, NULL, _rdoneuid, _donesm);
 	}else{
 		return false;
 	}
 }
-bool Service::notifyAll(MessageSharedPointerT &_rmsgptr){
+bool Service::notifyAll(MessageSharedPointerT &_rmsgptr, const ObjectUidT &_rdoneuid, const ulong _donesm){
 	if(isRegistered()){
-		MessageNotifier notifier(rm, _rmsgptr);
-		return rm.forEachServiceObject(*this, notifier);
+		return rm.doNotifyAll(idx.load(/*ATOMIC_NS::memory_order_seq_cst*/), 0, &_rmsgptr, _rdoneuid, _donesm);
 	}else{
 		return false;
 	}
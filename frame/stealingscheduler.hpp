@@ -0,0 +1,410 @@
+// frame/stealingscheduler.hpp
+//
+// Copyright (c) 2014 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#ifndef SOLID_FRAME_STEALING_SCHEDULER_HPP
+#define SOLID_FRAME_STEALING_SCHEDULER_HPP
+
+#include <deque>
+#include <vector>
+
+#include "system/thread.hpp"
+#include "system/mutex.hpp"
+#include "system/condition.hpp"
+#include "system/atomic.hpp"
+
+#include "frame/manager.hpp"
+#include "frame/schedulerbase.hpp"
+
+namespace solid{
+namespace frame{
+
+//! A work-stealing variant of frame::Scheduler
+/*!
+	<b>Overview:</b><br>
+	Scheduler pushes every job through a single WorkPool queue, guarded
+	by a single mutex. With high rates of new objects (e.g. accepted
+	connections) that mutex becomes the contention point.
+
+	StealingScheduler keeps one job deque per selector worker, each with
+	its own mutex. A job is pushed on the deque of the next (round-robin)
+	worker whose selector is not full. A worker pops from the front of
+	its own deque and, when that is empty, steals half the jobs from the
+	back of another worker's deque (using tryLock so that it never waits
+	on a busy victim).
+
+	The selector contract is the same as for Scheduler (SelectorT::push,
+	full, capacity, size, empty, run, raise), so aio::Selector and
+	ObjectSelector work unchanged.
+
+	<b>Usage:</b><br>
+	Use it exactly as frame::Scheduler:
+	\code
+	typedef frame::StealingScheduler<frame::aio::Selector>	AioSchedulerT;
+	\endcode
+*/
+template <class S>
+class StealingScheduler: public SchedulerBase{
+	typedef S								SelectorT;
+	typedef StealingScheduler<S>			ThisT;
+public://definition
+	typedef typename S::JobT				JobT;
+	typedef typename S::ObjectT				ObjectT;
+	//! Constructor
+	/*!
+		\param _rm Reference to parent manager
+		\param _startthrcnt The number of threads to create at start
+		\param _maxthcnt The maximum count of threads that can be created
+		\param _selcap The capacity of a selector - the total number
+		of objects handled would be _maxthcnt * _selcap
+	*/
+	StealingScheduler(
+		Manager &_rm,
+		int16 _startthrcnt = 0,
+		uint16 _maxthrcnt = 2,
+		const IndexT &_selcap = 1024 * 64
+	):	SchedulerBase(_rm, _startthrcnt >= 0 ? _startthrcnt : -_startthrcnt, _maxthrcnt, _selcap),
+		pstubs(new WorkerStub[maxwkrcnt]), st(ATOMIC_VAR_INIT(Stopped)), wkrcnt(0), pushidx(ATOMIC_VAR_INIT(0)){
+		if(_startthrcnt >= 0){
+			start(_startthrcnt);
+		}
+	}
+
+	~StealingScheduler(){
+		stop(true);
+		delete []pstubs;
+	}
+
+	//! Schedule a job
+	/*!
+		Only the mutex of the chosen worker is locked.
+	*/
+	void schedule(const JobT &_rjb){
+		const size_t	pos = pushidx.fetch_add(1, ATOMIC_NS::memory_order_relaxed);
+		for(size_t i = 0; i < maxwkrcnt; ++i){
+			const size_t idx = (pos + i) % maxwkrcnt;
+			if(pstubs[idx].ready.load(ATOMIC_NS::memory_order_acquire)){
+				doPush(idx, _rjb);
+				return;
+			}
+		}
+		//slow path: no worker can accept the job right now
+		Locker<Mutex>	lock(mtx);
+		if(crtwkrcnt < maxwkrcnt && state() == Running){
+			const int idx = doCreateWorker();
+			if(idx >= 0){
+				doPush(idx, _rjb);
+				return;
+			}
+		}
+		//all selectors are full - leave the job on a deque
+		//it will be picked up when a selector frees a slot
+		doPush(pos % maxwkrcnt, _rjb);
+	}
+
+	//! Starts the scheduler
+	void start(ushort _startwkrcnt = 0){
+		Locker<Mutex>	lock(mtx);
+		if(state() == Running){
+			return;
+		}
+		if(state() != Stopped){
+			doStop(lock, true);
+		}
+		state(Running);
+		if(!_startwkrcnt){
+			_startwkrcnt = startwkrcnt;
+		}
+		for(ushort i(0); i < _startwkrcnt; ++i){
+			doCreateWorker();
+		}
+	}
+
+	//! Stops the scheduler
+	void stop(bool _wait = true){
+		Locker<Mutex>	lock(mtx);
+		doStop(lock, _wait);
+	}
+
+private:
+	enum States{
+		Stopped = 0,
+		Stopping,
+		Running
+	};
+	typedef std::deque<JobT>				JobDequeT;
+	typedef std::vector<JobT>				JobVectorT;
+	typedef ATOMIC_NS::atomic<size_t>		AtomicSizeT;
+	typedef ATOMIC_NS::atomic<bool>			AtomicBoolT;
+	typedef ATOMIC_NS::atomic<int>			AtomicIntT;
+
+	struct Worker: Thread{
+		Worker(ThisT &_rsch, const size_t _idx):rsch(_rsch), idx(_idx){}
+		void run(){
+			rsch.doRun(*this);
+		}
+		ThisT			&rsch;
+		const size_t	idx;
+		SelectorT		s;
+	};
+
+	struct WorkerStub{
+		WorkerStub():
+			jobcnt(ATOMIC_VAR_INIT(0)), ready(ATOMIC_VAR_INIT(false)),
+			pw(NULL), used(false), waiting(false), raised(false){}
+		Mutex			mtx;
+		Condition		cnd;
+		JobDequeT		jobdq;
+		AtomicSizeT		jobcnt;	//approximate jobdq size, read without lock by thieves
+		AtomicBoolT		ready;	//the worker runs and its selector is not full
+		Worker			*pw;
+		bool			used;	//guarded by the scheduler mutex
+		bool			waiting;//the worker waits on cnd
+		bool			raised;	//the selector was already raised for pending jobs
+	};
+
+	int state()const{
+		return st.load(ATOMIC_NS::memory_order_acquire);
+	}
+	void state(int _st){
+		st.store(_st, ATOMIC_NS::memory_order_release);
+	}
+
+	void doPush(const size_t _idx, const JobT &_rjb){
+		WorkerStub		&rs(pstubs[_idx]);
+		Locker<Mutex>	lock(rs.mtx);
+		rs.jobdq.push_back(_rjb);
+		rs.jobcnt.store(rs.jobdq.size(), ATOMIC_NS::memory_order_relaxed);
+		doWake(rs);
+	}
+	//! Wake a worker - must be called with rs.mtx locked
+	/*!
+		A burst of pushes on the same worker results in a single
+		selector raise.
+	*/
+	void doWake(WorkerStub &_rs){
+		if(_rs.waiting){
+			_rs.cnd.signal();
+		}else if(_rs.pw && !_rs.raised){
+			_rs.raised = true;
+			_rs.pw->s.raise(0);
+		}
+	}
+	//! Wake a ready worker other than _idx so it can steal
+	void doWakeThief(const size_t _idx){
+		for(size_t i = 1; i < maxwkrcnt; ++i){
+			WorkerStub &rs(pstubs[(_idx + i) % maxwkrcnt]);
+			if(rs.ready.load(ATOMIC_NS::memory_order_acquire)){
+				Locker<Mutex>	lock(rs.mtx);
+				doWake(rs);
+				return;
+			}
+		}
+	}
+
+	//! Called with mtx locked
+	int doCreateWorker(){
+		for(size_t i = 0; i < maxwkrcnt; ++i){
+			WorkerStub &rs(pstubs[i]);
+			if(!rs.used){
+				rs.used = true;
+				++crtwkrcnt;
+				++wkrcnt;
+				Worker *pw = new Worker(*this, i);
+				if(!pw->start()){
+					delete pw;
+					rs.used = false;
+					--crtwkrcnt;
+					--wkrcnt;
+					thrcnd.broadcast();
+					return -1;
+				}
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	void doStop(Locker<Mutex> &_rlock, bool _wait){
+		if(state() == Stopped) return;
+		state(Stopping);
+		for(size_t i = 0; i < maxwkrcnt; ++i){
+			WorkerStub		&rs(pstubs[i]);
+			Locker<Mutex>	lock(rs.mtx);
+			rs.raised = false;
+			doWake(rs);
+		}
+		this->SchedulerBase::doStop();
+		if(!_wait) return;
+		while(wkrcnt){
+			thrcnd.wait(_rlock);
+		}
+		state(Stopped);
+	}
+
+	bool doEnterWorker(Worker &_rw){
+		Locker<Mutex>	lock(mtx);
+		if(prepareThread(&_rw.s)){
+			_rw.s.prepare();
+			if(_rw.s.init(selcap)){
+				WorkerStub		&rs(pstubs[_rw.idx]);
+				Locker<Mutex>	lock2(rs.mtx);
+				rs.pw = &_rw;
+				rs.raised = false;
+				rs.ready.store(true, ATOMIC_NS::memory_order_release);
+				return true;
+			}
+			unprepareThread(&_rw.s);
+			_rw.s.unprepare();
+		}
+		pstubs[_rw.idx].used = false;
+		--crtwkrcnt;
+		--wkrcnt;
+		thrcnd.broadcast();
+		return false;
+	}
+
+	void doExitWorker(Worker &_rw){
+		Locker<Mutex>	lock(mtx);
+		WorkerStub		&rs(pstubs[_rw.idx]);
+		{
+			Locker<Mutex>	lock2(rs.mtx);
+			rs.ready.store(false, ATOMIC_NS::memory_order_release);
+			rs.pw = NULL;
+		}
+		unprepareThread(&_rw.s);
+		_rw.s.unprepare();
+		rs.used = false;
+		--crtwkrcnt;
+		--wkrcnt;
+		thrcnd.broadcast();
+	}
+
+	void doRun(Worker &_rw){
+		if(!doEnterWorker(_rw)){
+			return;
+		}
+		JobVectorT	jobvec;
+		while(doPop(_rw, jobvec)){
+			for(typename JobVectorT::iterator it(jobvec.begin()); it != jobvec.end(); ++it){
+				if(!_rw.s.push(*it)){
+					schedule(*it);
+				}
+			}
+			jobvec.clear();
+			pstubs[_rw.idx].ready.store(!_rw.s.full() && state() == Running, ATOMIC_NS::memory_order_release);
+			_rw.s.run();
+		}
+		doExitWorker(_rw);
+	}
+
+	void doMoveFront(WorkerStub &_rs, JobVectorT &_rjobvec, size_t _cnt){
+		while(_cnt-- && _rs.jobdq.size()){
+			_rjobvec.push_back(_rs.jobdq.front());
+			_rs.jobdq.pop_front();
+		}
+		_rs.jobcnt.store(_rs.jobdq.size(), ATOMIC_NS::memory_order_relaxed);
+	}
+
+	bool doSteal(const size_t _idx, JobVectorT &_rjobvec, const size_t _cap){
+		for(size_t i = 1; i < maxwkrcnt; ++i){
+			WorkerStub &rs(pstubs[(_idx + i) % maxwkrcnt]);
+			if(rs.jobcnt.load(ATOMIC_NS::memory_order_relaxed) == 0){
+				continue;
+			}
+			if(!rs.mtx.tryLock()){
+				continue;
+			}
+			size_t cnt = (rs.jobdq.size() + 1) / 2;
+			if(cnt > _cap){
+				cnt = _cap;
+			}
+			while(cnt--){
+				_rjobvec.push_back(rs.jobdq.back());
+				rs.jobdq.pop_back();
+			}
+			rs.jobcnt.store(rs.jobdq.size(), ATOMIC_NS::memory_order_relaxed);
+			rs.mtx.unlock();
+			if(_rjobvec.size()){
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//! Fetch the next jobs for a worker
+	/*!
+		Returns false when the worker must exit.
+		An empty _rjobvec with true, means that the worker should
+		get back running its selector.
+	*/
+	bool doPop(Worker &_rw, JobVectorT &_rjobvec){
+		WorkerStub		&rs(pstubs[_rw.idx]);
+		const bool		running = state() == Running;
+
+		if(_rw.s.full()){
+			rs.ready.store(false, ATOMIC_NS::memory_order_release);
+			bool havejobs;
+			{
+				Locker<Mutex>	lock(rs.mtx);
+				rs.raised = false;
+				havejobs = !rs.jobdq.empty();
+			}
+			if(havejobs && running){
+				doWakeThief(_rw.idx);
+			}
+			return true;
+		}
+
+		rs.ready.store(running, ATOMIC_NS::memory_order_release);
+
+		const size_t	cap = _rw.s.capacity() - _rw.s.size();
+		{
+			Locker<Mutex>	lock(rs.mtx);
+			rs.raised = false;
+			if(rs.jobdq.size()){
+				doMoveFront(rs, _rjobvec, cap);
+				return true;
+			}
+		}
+
+		if(running && doSteal(_rw.idx, _rjobvec, cap)){
+			return true;
+		}
+
+		if(!_rw.s.empty()){
+			return true;
+		}
+
+		Locker<Mutex>	lock(rs.mtx);
+		while(rs.jobdq.empty() && state() == Running){
+			rs.waiting = true;
+			rs.cnd.wait(lock);
+		}
+		rs.waiting = false;
+		if(rs.jobdq.empty()){
+			rs.ready.store(false, ATOMIC_NS::memory_order_release);
+			return false;
+		}
+		doMoveFront(rs, _rjobvec, cap);
+		return true;
+	}
+private:
+	WorkerStub		*pstubs;
+	AtomicIntT		st;
+	int				wkrcnt;
+	AtomicSizeT		pushidx;
+	Mutex			mtx;
+	Condition		thrcnd;
+};
+
+}//namespace frame
+}//namespace solid
+
+#endif
+
@@ -20,6 +20,9 @@ namespace binary{
 template <class Msg, class MsgCtx, class Ctl = BasicController>
 class AioSession: public binary::Session<Msg, MsgCtx, Ctl>{
 	typedef binary::Session<Msg, MsgCtx, Ctl>	BaseT;
+	enum{
+		MaxSendBufferCount = 8//see BasicBufferController SendCnt
+	};
 public:
 	AioSession(){}
 	
@@ -27,6 +30,12 @@ public:
 	AioSession(T &_rt):BaseT(_rt){
 		
 	}
+	//! Consume the received data and start a new receive
+	/*!
+		With _canrecv false only the completed receive is consumed, no new
+		receive is started - e.g. while a consumer of the received messages
+		asks for flow control (see frame::aio::SendWatermarkMessage).
+	*/
 	template <class ConCtx, class Des, class BufCtl, class Com> 
 	AsyncE executeRecv(
 		frame::aio::SingleObject &_raioobj,
@@ -34,8 +43,8 @@ public:
 		ConCtx &_rconctx,
 		Des &_rdes,
 		BufCtl &_rbufctl,
-		Com &_rcom
-		
+		Com &_rcom,
+		const bool _canrecv = true
 	){
 		typedef BufCtl BufCtlT;
 		if(_evs & frame::EventDoneError){
@@ -51,7 +60,7 @@ public:
 			}
 		}
 		bool reenter = false;
-		if(!_raioobj.socketHasPendingRecv()){
+		if(_canrecv && !_raioobj.socketHasPendingRecv()){
 			switch(_raioobj.socketRecv(BaseT::recvBufferOffset(_rbufctl.recvBuffer()), BaseT::recvBufferCapacity(_rbufctl.recvCapacity()))){
 				case frame::aio::AsyncSuccess:{
 					char	tmpbuf[BufCtlT::DataCapacity];
@@ -83,19 +92,30 @@ public:
 	){
 		typedef BufCtl BufCtlT;
 		bool reenter = false;
+		cassert(_rbufctl.sendBufferCount() <= MaxSendBufferCount);
 		if(!_raioobj.socketHasPendingSend()){
 			int		cnt = 8;
 			char	tmpbuf[BufCtlT::DataCapacity];
 			while((cnt--) > 0){
-				int rv = BaseT::fill(_rser, _rconctx, _rbufctl.sendBuffer(), _rbufctl.sendCapacity(), _rcom, tmpbuf, BufCtlT::DataCapacity);
-				if(rv < 0) return done();
-				if(rv == 0){
-					_rbufctl.clearSend();//release the buffer as we have nothing to send
+				//fill all the send buffers we have data for, then send them at once
+				size_t	bufcnt = 0;
+				size_t	sndsz = 0;
+				while(bufcnt < _rbufctl.sendBufferCount()){
+					char	*pbuf = _rbufctl.sendBuffer(bufcnt);
+					int 	rv = BaseT::fill(_rser, _rconctx, pbuf, _rbufctl.sendCapacity(), _rcom, tmpbuf, BufCtlT::DataCapacity);
+					if(rv < 0) return done();
+					if(rv == 0) break;
+					sndiobufs[bufcnt] = frame::aio::IoBuffer(pbuf, rv);
+					sndsz += rv;
+					++bufcnt;
+				}
+				if(bufcnt == 0){
+					_rbufctl.clearSend();//release the buffers as we have nothing to send
 					break;
 				}
-				idbgx(Debug::proto_bin, "send data of size "<<rv);
-				this->ctl.onSend(_rconctx, rv);
-				switch(_raioobj.socketSend(_rbufctl.sendBuffer(), rv)){
+				idbgx(Debug::proto_bin, "send data of size "<<sndsz<<" from "<<bufcnt<<" buffers");
+				this->ctl.onSend(_rconctx, sndsz);
+				switch(_raioobj.socketSendv(sndiobufs, bufcnt)){
 					case frame::aio::AsyncWait:
 						cnt = 0;
 						break;
@@ -120,10 +140,10 @@ public:
 		Ser &_rser,
 		Des &_rdes,
 		BufCtl &_rbufctl,
-		Com &_rcom
-		
+		Com &_rcom,
+		const bool _canrecv = true
 	){
-		const AsyncE rcvrv = executeRecv(_raioobj, _evs, _rconctx, _rdes, _rbufctl, _rcom);
+		const AsyncE rcvrv = executeRecv(_raioobj, _evs, _rconctx, _rdes, _rbufctl, _rcom, _canrecv);
 		if(rcvrv == AsyncError) return done();
 		const AsyncE sndrv = executeSend(_raioobj, _evs, _rconctx, _rser, _rbufctl, _rcom);
 		if(sndrv == AsyncError) return done();
@@ -134,6 +154,8 @@ private:
 	AsyncE done(){
 		return AsyncError;
 	}
+private:
+	frame::aio::IoBuffer	sndiobufs[MaxSendBufferCount];//must live until the send completes
 };
 
 }//namespace binary
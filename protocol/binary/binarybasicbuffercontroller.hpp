@@ -16,21 +16,30 @@ namespace solid{
 namespace protocol{
 namespace binary{
 
-template <uint16 DataCp, uint16 RecvCp = DataCp * 2, uint16 SendCp = DataCp * 2>
+//! Buffers embedded in the session
+/*!
+	With SendCnt > 1, AioSession fills several send buffers and
+	sends them with a single gather send.
+*/
+template <uint16 DataCp, uint16 RecvCp = DataCp * 2, uint16 SendCp = DataCp * 2, uint16 SendCnt = 1>
 struct BasicBufferController{
 	enum{
 		DataCapacity = DataCp,
 		RecvCapacity = RecvCp,
-		SendCapacity = SendCp
+		SendCapacity = SendCp,
+		SendBufferCount = SendCnt
 	};
 	size_t sendCapacity()const{
 		return SendCapacity;
 	}
+	size_t sendBufferCount()const{
+		return SendBufferCount;
+	}
 	size_t recvCapacity()const{
 		return RecvCapacity;
 	}
-	char *sendBuffer(){
-		return sndbuf;
+	char *sendBuffer(const size_t _idx = 0){
+		return sndbuf[_idx];
 	}
 	char *recvBuffer(){
 	
@@ -49,7 +58,7 @@ struct BasicBufferController{
 	}
 private:
 	char rcvbuf[RecvCapacity];
-	char sndbuf[SendCapacity];
+	char sndbuf[SendBufferCount][SendCapacity];
 };
 
 
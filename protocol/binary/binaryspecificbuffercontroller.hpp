@@ -18,40 +18,54 @@ namespace protocol{
 namespace binary{
 
 
-template <uint16 DataCp, uint16 RecvCp = DataCp * 2, uint16 SendCp = DataCp * 2>
+//! Buffers taken from the thread Specific cache while in use
+/*!
+	With SendCnt > 1, AioSession fills several send buffers and
+	sends them with a single gather send.
+*/
+template <uint16 DataCp, uint16 RecvCp = DataCp * 2, uint16 SendCp = DataCp * 2, uint16 SendCnt = 1>
 struct SpecificBufferController{
 	enum{
 		DataCapacity = DataCp,
 		RecvCapacity = RecvCp,
-		SendCapacity = SendCp
+		SendCapacity = SendCp,
+		SendBufferCount = SendCnt
 	};
 	static const int 	rcv_spec_id;
 	static const size_t rcv_spec_cp;
 	static const int 	snd_spec_id;
 	static const size_t snd_spec_cp;
 	
-	SpecificBufferController():rcvbuf(NULL), sndbuf(NULL){}
+	SpecificBufferController():rcvbuf(NULL){
+		for(size_t i = 0; i < SendBufferCount; ++i){
+			sndbuf[i] = NULL;
+		}
+	}
 	
 	~SpecificBufferController(){
 		clear();
 	}
 	void clearSend(){
-		if(sndbuf){
-			Specific::pushBuffer(sndbuf, snd_spec_id);
+		for(size_t i = 0; i < SendBufferCount; ++i){
+			if(sndbuf[i]){
+				Specific::pushBuffer(sndbuf[i], snd_spec_id);
+				sndbuf[i] = NULL;
+			}
 		}
 	}
 	void clearRecv(){
 		if(rcvbuf){
 			Specific::pushBuffer(rcvbuf, rcv_spec_id);
+			rcvbuf = NULL;
 		}
 	}
 	void clear(){
 		clearSend();
 		clearRecv();
 	}
-	void prepareSend(){
-		if(!sndbuf){
-			sndbuf = Specific::popBuffer(snd_spec_id);
+	void prepareSend(const size_t _idx = 0){
+		if(!sndbuf[_idx]){
+			sndbuf[_idx] = Specific::popBuffer(snd_spec_id);
 		}
 	}
 	void prepareRecv(){
@@ -63,12 +77,15 @@ struct SpecificBufferController{
 	size_t sendCapacity()const{
 		return snd_spec_cp;
 	}
+	size_t sendBufferCount()const{
+		return SendBufferCount;
+	}
 	size_t recvCapacity()const{
 		return rcv_spec_cp;
 	}
-	char *sendBuffer(){
-		prepareSend();
-		return sndbuf;
+	char *sendBuffer(const size_t _idx = 0){
+		prepareSend(_idx);
+		return sndbuf[_idx];
 	}
 	char *recvBuffer(){
 		prepareRecv();
@@ -77,16 +94,16 @@ struct SpecificBufferController{
 	
 private:
 	char *rcvbuf;
-	char *sndbuf;
+	char *sndbuf[SendBufferCount];
 };
-template <uint16 DataCp, uint16 RecvCp, uint16 SendCp>
-const int		SpecificBufferController<DataCp, RecvCp, SendCp>::rcv_spec_id = Specific::sizeToIndex(RecvCp);
-template <uint16 DataCp, uint16 RecvCp, uint16 SendCp>
-const size_t	SpecificBufferController<DataCp, RecvCp, SendCp>::rcv_spec_cp = Specific::indexToCapacity(rcv_spec_id);
-template <uint16 DataCp, uint16 RecvCp, uint16 SendCp>
-const int		SpecificBufferController<DataCp, RecvCp, SendCp>::snd_spec_id = Specific::sizeToIndex(SendCp);
-template <uint16 DataCp, uint16 RecvCp, uint16 SendCp>
-const size_t	SpecificBufferController<DataCp, RecvCp, SendCp>::snd_spec_cp = Specific::indexToCapacity(snd_spec_id);
+template <uint16 DataCp, uint16 RecvCp, uint16 SendCp, uint16 SendCnt>
+const int		SpecificBufferController<DataCp, RecvCp, SendCp, SendCnt>::rcv_spec_id = Specific::sizeToIndex(RecvCp);
+template <uint16 DataCp, uint16 RecvCp, uint16 SendCp, uint16 SendCnt>
+const size_t	SpecificBufferController<DataCp, RecvCp, SendCp, SendCnt>::rcv_spec_cp = Specific::indexToCapacity(rcv_spec_id);
+template <uint16 DataCp, uint16 RecvCp, uint16 SendCp, uint16 SendCnt>
+const int		SpecificBufferController<DataCp, RecvCp, SendCp, SendCnt>::snd_spec_id = Specific::sizeToIndex(SendCp);
+template <uint16 DataCp, uint16 RecvCp, uint16 SendCp, uint16 SendCnt>
+const size_t	SpecificBufferController<DataCp, RecvCp, SendCp, SendCnt>::snd_spec_cp = Specific::indexToCapacity(snd_spec_id);
 
 }//namespace binary
 }//namespace protocol
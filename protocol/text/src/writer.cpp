@@ -83,6 +83,18 @@ int Writer::flushAll(){
 	}
 	return rv;
 }
+
+int Writer::flushAll(char *_pb, uint32 _bl){
+	int rv = write(rpos, wpos - rpos, _pb, _bl);
+	if(dolog)
+		plog->outFlush();
+	if(rv == Success){
+		rpos = wpos = bh->pbeg;
+		return Success;
+	}
+	return rv;
+}
+
 void Writer::resize(uint32 _len){
 	if(_len < bh->capacity()) return;
 	const uint32 rlen(rpos - bh->pbeg);
@@ -399,15 +411,10 @@ bool read_stream_all(istream &_ris, char *_pb, size_t _sz){
 		if(rv){ _rw.fs.top().first = &Writer::doneFlush; return rv;}
 		return Success;
 	}
-	//we kinda need to do it the hard way
-	uint towrite = _rw.bh->pend - _rw.wpos;
-	if(towrite > _rp.b.u32) towrite = _rp.b.u32;
-	memcpy(_rw.wpos, _rp.a.p, towrite);
-	_rp.a.p = (char*)_rp.a.p + towrite;
-	_rp.b.u32 -= towrite;
-	_rw.fs.top().first = &Writer::putRawString;
-	_rw.push(flushAll);
-	return Continue;
+	//send the buffered data and the atom together, without copying the atom
+	int rv = _rw.flushAll((char*)_rp.a.p, _rp.b.u32);
+	if(rv == Wait) _rw.fs.top().first = &Writer::doneFlush;
+	return rv;
 }
 
 /*static*/ int Writer::putChar(Writer &_rw, Parameter &_rp){
@@ -213,9 +213,19 @@ protected:
 	//! Convenient callback used internaly
 	static int putStreamDone(Writer &_rw, Parameter &_rp);
 	int flush();
+	//! Flush the buffer together with _pb, in a single write
+	int flushAll(char *_pb, uint32 _bl);
 	void clear();
 	//! The writer will call this method when writing data
 	virtual int write(char *_pb, uint32 _bl) = 0;
+	//! The writer will call this method when writing two buffers at once
+	/*!
+		Used to send the buffered data together with a large atom.
+		Should be implemented with a gather send (e.g. aio socketSendv).
+		Both buffers must stay valid until the write completes. The first
+		buffer might be empty.
+	*/
+	virtual int write(char *_pb1, uint32 _bl1, char *_pb2, uint32 _bl2) = 0;
 	//! The writer will call this method on manage callback
 	virtual int doManage(int _mo);
 	void doPrepareBuffer(char *_newbeg, const char *_newend);
@@ -16,6 +16,27 @@
 
 namespace solid{
 
+//! A datagram of a batched receive - see SocketDevice::recv
+struct RecvDatagram{
+	RecvDatagram(char *_pb = NULL, const uint32 _bl = 0):pb(_pb), bl(_bl), sz(0){}
+	char			*pb;
+	uint32			bl;//the capacity of pb
+	uint32			sz;//the size received
+	SocketAddress	addr;//the sender
+};
+
+//! A datagram of a batched send - see SocketDevice::send
+struct SendDatagram{
+	SendDatagram(
+		const char *_pb = NULL,
+		const uint32 _bl = 0,
+		const SocketAddressStub &_rsas = SocketAddressStub()
+	):pb(_pb), bl(_bl), addr(_rsas){}
+	const char			*pb;
+	uint32				bl;
+	SocketAddressStub	addr;//the destination
+};
+
 //! A wrapper for berkeley sockets
 class SocketDevice: public Device{
 public:
@@ -55,6 +76,12 @@ public:
 	bool prepareAccept(const SocketAddressStub &_rsas, size_t _listencnt = 10);
 	//! Accept an incomming connection
 	AsyncE acceptNonBlocking(SocketDevice &_dev);
+	//! Accept an incomming connection, nonblocking and close-on-exec from the start if _nonblocking
+	/*!
+		Uses accept4 where available, saving the fcntl calls, and
+		skips the connections reset while waiting to be accepted.
+	*/
+	AsyncE acceptNonBlocking(SocketDevice &_dev, const bool _nonblocking);
 	bool accept(SocketDevice &_dev);
 	//! Make a connection blocking
 	/*!
@@ -74,6 +101,13 @@ public:
 	bool disableCork();
 	std::pair<bool, bool> hasCork()const;
 	
+	//! Let other sockets bind the same address - SO_REUSEPORT, call it before prepareAccept
+	/*!
+		The kernel spreads the incoming connections across the
+		listening sockets sharing the address.
+	*/
+	bool enableReusePort();
+	
 	bool sendBufferSize(size_t _sz);
 	bool recvBufferSize(size_t _sz);
 	std::pair<bool, size_t> sendBufferSize()const;
@@ -86,6 +120,18 @@ public:
 	int send(const char* _pb, size_t _ul, const SocketAddressStub &_sap);
 	//! Recv data from a socket
 	int recv(char *_pb, size_t _ul, SocketAddress &_rsa);
+	//! Send up to _cnt datagrams, with a single call where possible (sendmmsg)
+	/*!
+		\retval the number of datagrams sent, or -1 if none was sent.
+		An error after the first datagram is reported by the next call.
+	*/
+	int send(const SendDatagram *_pdgs, size_t _cnt);
+	//! Receive up to _cnt datagrams, with a single call where possible (recvmmsg)
+	/*!
+		Fills the size and the sender of the received datagrams.
+		\retval the number of datagrams received, or -1 if none was received.
+	*/
+	int recv(RecvDatagram *_pdgs, size_t _cnt);
 	//! Gets the remote address for a connected socket
 	bool remoteAddress(SocketAddress &_rsa)const;
 	//! Gets the local address for a socket
@@ -125,6 +125,10 @@ private:
 #endif
 public:
 	//! call this method to prepare the current thread for caching
+	/*!
+		If the thread is bound to the processors of a single NUMA node,
+		its memory will be preferably allocated from that node.
+	*/
 	static void prepareThread(SpecificCacheControl *_pscc = NULL);
 	//object caching
 	//! Uncache an object
@@ -14,6 +14,7 @@
 #define _FILE_OFFSET_BITS 64
 #include <unistd.h>
 #include <netinet/tcp.h>
+#include <sys/uio.h>
 #endif
 
 #include <cstdio>
@@ -722,6 +723,38 @@ AsyncE SocketDevice::acceptNonBlocking(SocketDevice &_dev){
 #endif
 }
 
+AsyncE SocketDevice::acceptNonBlocking(SocketDevice &_dev, const bool _nonblocking){
+	if(!_nonblocking){
+		return acceptNonBlocking(_dev);
+	}
+	specific_error_clear();
+#if defined(ON_LINUX)
+	int rv;
+	do{
+		//skip the connections reset while queued
+		rv = ::accept4(descriptor(), NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	}while(rv < 0 && (errno == ECONNABORTED || errno == EINTR));
+	if (rv < 0) {
+		if(errno == EAGAIN){
+			return AsyncWait;
+		}
+		SPECIFIC_ERROR_PUSH1(last_socket_error());
+		return AsyncError;
+	}
+	_dev.Device::descriptor(rv);
+	return AsyncSuccess;
+#else
+	const AsyncE rv = acceptNonBlocking(_dev);
+	if(rv == AsyncSuccess){
+		_dev.makeNonBlocking();
+#ifndef ON_WINDOWS
+		fcntl(_dev.descriptor(), F_SETFD, FD_CLOEXEC);
+#endif
+	}
+	return rv;
+#endif
+}
+
 bool SocketDevice::accept(SocketDevice &_dev){
 	specific_error_clear();
 #ifdef ON_WINDOWS
@@ -917,6 +950,107 @@ int SocketDevice::recv(char *_pb, size_t _ul, SocketAddress &_rsa){
 #endif
 }
 
+#if defined(ON_LINUX)
+namespace{
+enum{
+	MaxDatagramCount = 64//the datagrams given to a single sendmmsg/recvmmsg call
+};
+}//namespace
+#endif
+
+int SocketDevice::send(const SendDatagram *_pdgs, size_t _cnt){
+#ifdef ON_WINDOWS
+	return -1;
+#elif defined(ON_LINUX)
+	int		cnt(0);
+	while(_cnt){
+		struct mmsghdr	msgs[MaxDatagramCount];
+		struct iovec	iovs[MaxDatagramCount];
+		const size_t	sz(_cnt < MaxDatagramCount ? _cnt : MaxDatagramCount);
+		
+		memset(msgs, 0, sizeof(mmsghdr) * sz);
+		for(size_t i(0); i < sz; ++i){
+			iovs[i].iov_base = const_cast<char*>(_pdgs[i].pb);
+			iovs[i].iov_len = _pdgs[i].bl;
+			msgs[i].msg_hdr.msg_name = const_cast<sockaddr*>(_pdgs[i].addr.sockAddr());
+			msgs[i].msg_hdr.msg_namelen = _pdgs[i].addr.size();
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		const int rv = ::sendmmsg(descriptor(), msgs, sz, 0);
+		if(rv < 0){
+			return cnt ? cnt : -1;
+		}
+		cnt += rv;
+		if(static_cast<size_t>(rv) < sz){
+			break;
+		}
+		_pdgs += sz;
+		_cnt -= sz;
+	}
+	return cnt;
+#else
+	int		cnt(0);
+	for(; _cnt; --_cnt, ++_pdgs){
+		if(send(_pdgs->pb, _pdgs->bl, _pdgs->addr) < 0){
+			return cnt ? cnt : -1;
+		}
+		++cnt;
+	}
+	return cnt;
+#endif
+}
+
+int SocketDevice::recv(RecvDatagram *_pdgs, size_t _cnt){
+#ifdef ON_WINDOWS
+	return -1;
+#elif defined(ON_LINUX)
+	int		cnt(0);
+	while(_cnt){
+		struct mmsghdr	msgs[MaxDatagramCount];
+		struct iovec	iovs[MaxDatagramCount];
+		const size_t	sz(_cnt < MaxDatagramCount ? _cnt : MaxDatagramCount);
+		
+		memset(msgs, 0, sizeof(mmsghdr) * sz);
+		for(size_t i(0); i < sz; ++i){
+			_pdgs[i].addr.clear();
+			iovs[i].iov_base = _pdgs[i].pb;
+			iovs[i].iov_len = _pdgs[i].bl;
+			msgs[i].msg_hdr.msg_name = _pdgs[i].addr.sockAddr();
+			msgs[i].msg_hdr.msg_namelen = SocketAddress::Capacity;
+			msgs[i].msg_hdr.msg_iov = &iovs[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		const int rv = ::recvmmsg(descriptor(), msgs, sz, 0, NULL);
+		if(rv < 0){
+			return cnt ? cnt : -1;
+		}
+		for(int i(0); i < rv; ++i){
+			_pdgs[i].sz = msgs[i].msg_len;
+			_pdgs[i].addr.sz = msgs[i].msg_hdr.msg_namelen;
+		}
+		cnt += rv;
+		if(static_cast<size_t>(rv) < sz){
+			break;//drained
+		}
+		_pdgs += sz;
+		_cnt -= sz;
+	}
+	return cnt;
+#else
+	int		cnt(0);
+	for(; _cnt; --_cnt, ++_pdgs){
+		const int rv = recv(_pdgs->pb, _pdgs->bl, _pdgs->addr);
+		if(rv < 0){
+			return cnt ? cnt : -1;
+		}
+		_pdgs->sz = rv;
+		++cnt;
+	}
+	return cnt;
+#endif
+}
+
 bool SocketDevice::remoteAddress(SocketAddress &_rsa)const{
 	specific_error_clear();
 #ifdef ON_WINDOWS
@@ -1094,6 +1228,22 @@ pair<bool, bool> SocketDevice::hasCork()const{
 #endif
 }
 
+bool SocketDevice::enableReusePort(){
+	specific_error_clear();
+#if defined(ON_WINDOWS) || !defined(SO_REUSEPORT)
+	SPECIFIC_ERROR_PUSH1(solid::error_make(solid::ERROR_NOT_IMPLEMENTED));
+	return false;
+#else
+	int flag = 1;
+	int rv = setsockopt(descriptor(), SOL_SOCKET, SO_REUSEPORT, (char*)&flag, sizeof(flag));
+	if(rv == 0){
+		return true;
+	}
+	SPECIFIC_ERROR_PUSH1(last_socket_error());
+	return false;
+#endif
+}
+
 bool SocketDevice::sendBufferSize(size_t _sz){
 	specific_error_clear();
 #ifdef ON_WINDOWS
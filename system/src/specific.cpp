@@ -199,6 +199,13 @@ void destroy(void *_pv){
 }
 /*static*/ void Specific::prepareThread(SpecificCacheControl *_pcc){
 	if(!_pcc) _pcc = static_cast<SpecificCacheControl*>(&bcc);
+	if(Thread::numaNodeCount() > 1){
+		const int node(Thread::currentNumaNode());
+		if(node >= 0){
+			//the thread is kept on a NUMA node - have the cached buffers allocated from it
+			Thread::numaMemoryAffinity(node);
+		}
+	}
 	Thread::specific(specificPosition(), new SpecificData(_pcc), &destroy);
 }
 //----------------------------------------------------------------------------------------------------
@@ -47,6 +47,13 @@
 #include <mach/mach_time.h>
 #endif
 
+#if defined(ON_LINUX)
+#include <cstdio>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#endif
+
 
 #include <limits.h>
 
@@ -460,6 +467,144 @@ void Thread::dummySpecificDestroy(void*){
 #endif
 }
 //-------------------------------------------------------------------------
+#if defined(ON_LINUX)
+namespace{
+//! Parse a sysfs list like "0-3,8-11"
+bool read_processor_list(const char *_path, Thread::ProcessorVectorT &_rcpuvec){
+	FILE *pf = fopen(_path, "r");
+	if(!pf) return false;
+	unsigned	from;
+	unsigned	to;
+	int			c;
+	_rcpuvec.clear();
+	while(fscanf(pf, "%u", &from) == 1){
+		to = from;
+		c = fgetc(pf);
+		if(c == '-'){
+			if(fscanf(pf, "%u", &to) != 1) break;
+			c = fgetc(pf);
+		}
+		for(; from <= to; ++from){
+			_rcpuvec.push_back(from);
+		}
+		if(c != ',') break;
+	}
+	fclose(pf);
+	return !_rcpuvec.empty();
+}
+}//namespace
+#endif
+//-------------------------------------------------------------------------
+/*static*/ bool Thread::affinity(const ProcessorVectorT &_rcpuvec){
+#if		defined(ON_LINUX)
+	cpu_set_t	cpuset;
+	CPU_ZERO(&cpuset);
+	for(ProcessorVectorT::const_iterator it(_rcpuvec.begin()); it != _rcpuvec.end(); ++it){
+		if(*it < CPU_SETSIZE){
+			CPU_SET(*it, &cpuset);
+		}
+	}
+	if(CPU_COUNT(&cpuset) == 0) return false;
+	const int rv = pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+	if(rv){
+		edbgx(Debug::system, "pthread_setaffinity_np: "<<strerror(rv));
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+//-------------------------------------------------------------------------
+/*static*/ bool Thread::currentAffinity(ProcessorVectorT &_rcpuvec){
+	_rcpuvec.clear();
+#if		defined(ON_LINUX)
+	cpu_set_t	cpuset;
+	CPU_ZERO(&cpuset);
+	if(pthread_getaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)){
+		return false;
+	}
+	for(unsigned i = 0; i < CPU_SETSIZE; ++i){
+		if(CPU_ISSET(i, &cpuset)){
+			_rcpuvec.push_back(i);
+		}
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+//-------------------------------------------------------------------------
+/*static*/ unsigned Thread::numaNodeCount(){
+#if		defined(ON_LINUX)
+	ProcessorVectorT	nodevec;
+	if(read_processor_list("/sys/devices/system/node/online", nodevec)){
+		return nodevec.back() + 1;
+	}
+#endif
+	return 1;
+}
+//-------------------------------------------------------------------------
+/*static*/ bool Thread::numaNodeProcessors(unsigned _node, ProcessorVectorT &_rcpuvec){
+#if		defined(ON_LINUX)
+	char	path[128];
+	sprintf(path, "/sys/devices/system/node/node%u/cpulist", _node);
+	if(read_processor_list(path, _rcpuvec)){
+		return true;
+	}
+#endif
+	_rcpuvec.clear();
+	if(_node == 0){
+		//no NUMA information - a single node with all the processors
+		const unsigned cnt(processorCount());
+		for(unsigned i = 0; i < cnt; ++i){
+			_rcpuvec.push_back(i);
+		}
+		return true;
+	}
+	return false;
+}
+//-------------------------------------------------------------------------
+/*static*/ int Thread::currentNumaNode(){
+	ProcessorVectorT	crtvec;
+	ProcessorVectorT	nodevec;
+	if(!currentAffinity(crtvec)) return -1;
+	const unsigned		nodecnt(numaNodeCount());
+	for(unsigned node = 0; node < nodecnt; ++node){
+		if(!numaNodeProcessors(node, nodevec)) continue;
+		//both vectors are sorted
+		ProcessorVectorT::const_iterator nit(nodevec.begin());
+		ProcessorVectorT::const_iterator cit(crtvec.begin());
+		for(; cit != crtvec.end(); ++cit){
+			while(nit != nodevec.end() && *nit < *cit) ++nit;
+			if(nit == nodevec.end() || *nit != *cit) break;
+		}
+		if(cit == crtvec.end()){
+			return node;
+		}
+	}
+	return -1;
+}
+//-------------------------------------------------------------------------
+/*static*/ bool Thread::numaMemoryAffinity(unsigned _node){
+#if		defined(ON_LINUX) && defined(SYS_set_mempolicy)
+	enum{
+		BitsPerWord = sizeof(unsigned long) * 8,
+		MaxNodes = 1024,
+	};
+	unsigned long	mask[MaxNodes / BitsPerWord] = {0};
+	if(_node >= MaxNodes) return false;
+	mask[_node / BitsPerWord] = 1UL << (_node % BitsPerWord);
+	if(syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, (unsigned long)MaxNodes)){
+		edbgx(Debug::system, "set_mempolicy: "<<strerror(errno));
+		return false;
+	}
+	return true;
+#else
+	return false;
+#endif
+}
+//-------------------------------------------------------------------------
 bool Thread::join(){
 	specific_error_clear();
 #ifdef ON_WINDOWS
@@ -545,8 +690,12 @@ void Thread::specific(unsigned _pos, void *_psd, SpecificFncT _pf){
 // }
 //-------------------------------------------------------------------------
 void* Thread::specific(unsigned _pos){
-	cassert(_pos < current().specvec.size());
-	return current().specvec[_pos].first;
+	Thread &rct = current();
+	//the slot might have never been set on this thread
+	if(_pos < rct.specvec.size()){
+		return rct.specvec[_pos].first;
+	}
+	return NULL;
 }
 Mutex& Thread::gmutex(){
 	return threadData().gmut;
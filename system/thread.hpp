@@ -42,6 +42,7 @@ class Thread{
 public:
 	typedef void RunParamT;
 	typedef void (*SpecificFncT)(void *_ptr);
+	typedef std::vector<unsigned>	ProcessorVectorT;
 	
 	static void dummySpecificDestroy(void*);
 	
@@ -51,6 +52,18 @@ public:
 	static void sleep(ulong _msec);
 	//! Returns the number of processors on the running machine
 	static unsigned processorCount();
+	//! Bind the current thread to the given processors
+	static bool affinity(const ProcessorVectorT &_rcpuvec);
+	//! Get the processors the current thread is allowed to run on
+	static bool currentAffinity(ProcessorVectorT &_rcpuvec);
+	//! Returns the number of NUMA nodes - 1 if NUMA is not available
+	static unsigned numaNodeCount();
+	//! Get the processors of a NUMA node
+	static bool numaNodeProcessors(unsigned _node, ProcessorVectorT &_rcpuvec);
+	//! Returns the NUMA node the current thread is bound to or -1 if it spans more nodes
+	static int currentNumaNode();
+	//! Prefer allocating memory for the current thread from the given NUMA node
+	static bool numaMemoryAffinity(unsigned _node);
 	
 	static long processId();
 	static void waitAll();
@@ -62,7 +75,7 @@ public:
 	static long currentId();
 	//! Returns a new id for use with specific objects
 	static size_t specificId();
-	//! Returns the data for a specific id
+	//! Returns the data for a specific id, NULL if it was not set on the current thread
 	static void* specific(unsigned _pos);
 	//! Sets the data for a specific id, allong with a pointer to a destructor function
 	static void specific(unsigned _pos, void *_psd, SpecificFncT _pfnc = &dummySpecificDestroy);
@@ -0,0 +1,456 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "system/thread.hpp"
+#include "system/mutex.hpp"
+#include "system/condition.hpp"
+#include "system/timespec.hpp"
+#include "system/error.hpp"
+#include "frame/manager.hpp"
+#include "frame/scheduler.hpp"
+#include "frame/objectselector.hpp"
+#include "frame/aio/aioselector.hpp"
+#include "frame/aio/aiosingleobject.hpp"
+#include "frame/aio/openssl/opensslsocket.hpp"
+#include "frame/file/filestore.hpp"
+
+#include "testcommon.hpp"
+
+using namespace std;
+using namespace solid;
+
+#define TEST_CHECK(x) if(!(x)){cout<<__FILE__<<':'<<__LINE__<<" failed: "#x<<endl; return -1;}
+
+namespace{
+
+typedef frame::Scheduler<frame::aio::Selector>		AioSchedulerT;
+typedef frame::Scheduler<frame::ObjectSelector>		SchedulerT;
+typedef frame::file::Store<>						FileStoreT;
+typedef DynamicSharedPointer<FileStoreT>			FileStorePointerT;
+
+enum{
+	DataSize = 1024 * 1024 + 333,
+	FileOffset = 777,//the data starts here in the test files
+	BufferSize = 64 * 1024,//the socket buffers - much less than the data, so the sends are short
+};
+
+string	data;
+
+void init_data(){
+	data.resize(DataSize);
+	for(size_t i = 0; i < DataSize; ++i){
+		data[i] = 'a' + (i * 7 + i / 1021) % 26;
+	}
+}
+
+//! What a Stream reports on destruction
+struct Result{
+	Result():done(false), ok(false), cnt(0){}
+	void set(const bool _ok, const uint64 _cnt, const string &_rdata){
+		Locker<Mutex>	lock(mtx);
+		done = true;
+		ok = _ok;
+		cnt = _cnt;
+		rcvdata = _rdata;
+		cnd.signal();
+	}
+	//! Wait at most 30 seconds for the Stream
+	bool wait(){
+		TimeSpec		ts(TimeSpec::createRealTime());
+		ts += 30 * 1000;
+		Locker<Mutex>	lock(mtx);
+		while(!done){
+			if(!cnd.wait(lock, ts)){
+				return false;
+			}
+		}
+		return true;
+	}
+	Mutex		mtx;
+	Condition	cnd;
+	bool		done;
+	bool		ok;
+	uint64		cnt;
+	string		rcvdata;
+};
+
+//! Sends the data with one socketSendv or socketSendFile, or receives it with socketRecvv
+/*!
+	The send list mixes empty, tiny and big buffers and is longer
+	than what a single writev takes.
+*/
+class Stream: public Dynamic<Stream, frame::aio::SingleObject>{
+public:
+	enum Kind{
+		SendvE,
+		SendFileE,
+		RecvvE,
+	};
+	Stream(
+		const SocketDevice &_rsd, Result &_rres, const Kind _kind,
+		frame::aio::openssl::Context *_pctx, frame::file::FilePointerT &_rfilptr
+	);
+	~Stream();
+private:
+	/*virtual*/ void execute(ExecuteContext &_rexectx);
+	void doConsume(const uint32 _sz);
+private:
+	enum{
+		AcceptE,
+		RunE,
+		SendWaitE,
+		RecvWaitE,
+	};
+	typedef std::vector<frame::aio::IoBuffer>	IoBufferVectorT;
+
+	Result						&rres;
+	const Kind					kind;
+	int							state;
+	bool						ok;
+	frame::file::FilePointerT	filptr;
+	IoBufferVectorT				bufvec;
+	char						rcvbuf[6483];
+	string						rcvdata;
+};
+
+Stream::Stream(
+	const SocketDevice &_rsd, Result &_rres, const Kind _kind,
+	frame::aio::openssl::Context *_pctx, frame::file::FilePointerT &_rfilptr
+):BaseT(_rsd), rres(_rres), kind(_kind), state(_pctx ? AcceptE : RunE), ok(false), filptr(_rfilptr){
+	if(_pctx){
+		socketSecureSocket(_pctx->createSocket());
+	}
+	if(kind == SendvE){
+		const uint32	sizes[] = {1, 0, 13, 700, 3, 4096, 20000, 5, 17 * 1024, 90, 1, 65 * 1024 + 5, 2, 300};
+		size_t			off = 0;
+		for(size_t i = 0; off < DataSize; ++i){
+			uint32	sz = sizes[i % (sizeof(sizes)/sizeof(uint32))];
+			if(sz > DataSize - off) sz = DataSize - off;
+			bufvec.push_back(frame::aio::IoBuffer(data.data() + off, sz));
+			off += sz;
+		}
+	}else if(kind == RecvvE){
+		const uint32	sizes[] = {1, 0, 333, 2048, 5, 4096};
+		char			*pb = rcvbuf;
+		for(size_t i = 0; i < sizeof(sizes)/sizeof(uint32); ++i){
+			bufvec.push_back(frame::aio::IoBuffer(pb, sizes[i]));
+			pb += sizes[i];
+		}
+	}
+}
+
+Stream::~Stream(){
+	filptr.clear();
+	rres.set(ok, kind == RecvvE ? socketRecvCount() : socketSendCount(), rcvdata);
+}
+
+//! Collect the _sz received bytes, in the order of the list
+void Stream::doConsume(const uint32 _sz){
+	uint32	sz = _sz;
+	for(IoBufferVectorT::const_iterator it(bufvec.begin()); sz && it != bufvec.end(); ++it){
+		const uint32	len = it->bl < sz ? it->bl : sz;
+		rcvdata.append(it->pb, len);
+		sz -= len;
+	}
+}
+
+/*virtual*/ void Stream::execute(ExecuteContext &_rexectx){
+	if(_rexectx.eventMask() & (frame::EventTimeout | frame::EventDoneError | frame::EventTimeoutRecv | frame::EventTimeoutSend)){
+		_rexectx.close();
+		return;
+	}
+	const uint32 sevs(socketEventsGrab());
+	if(sevs & frame::EventDoneError){
+		_rexectx.close();
+		return;
+	}
+	switch(state){
+		case AcceptE:
+			state = RunE;
+			switch(socketSecureAccept()){
+				case frame::aio::AsyncSuccess:
+					_rexectx.reschedule();
+				case frame::aio::AsyncWait:
+					break;
+				case frame::aio::AsyncError:
+					_rexectx.close();
+			}
+			return;
+		case RunE:
+			if(kind == RecvvE) break;
+			switch(kind == SendvE ? socketSendv(&bufvec.front(), bufvec.size()) : socketSendFile(filptr, FileOffset, DataSize)){
+				case frame::aio::AsyncError:
+					_rexectx.close();
+					return;
+				case frame::aio::AsyncSuccess: break;
+				case frame::aio::AsyncWait:
+					state = SendWaitE;
+					socketTimeoutSend(30);
+					return;
+			}
+		case SendWaitE:
+			//the send completes only when all was sent
+			ok = socketSendCount() == DataSize;
+			_rexectx.close();
+			return;
+		case RecvWaitE:
+			doConsume(socketRecvSize());
+			break;
+	}
+	while(rcvdata.size() < DataSize){
+		switch(socketRecvv(&bufvec.front(), bufvec.size())){
+			case frame::aio::AsyncError:
+				_rexectx.close();
+				return;
+			case frame::aio::AsyncSuccess:
+				doConsume(socketRecvSize());
+				break;
+			case frame::aio::AsyncWait:
+				state = RecvWaitE;
+				socketTimeoutRecv(30);
+				return;
+		}
+	}
+	ok = socketRecvCount() == DataSize;
+	_rexectx.close();
+}
+
+//! The test end of a connection: a blocking socket, plain or under a client SSL
+struct Peer{
+	Peer():pssl(NULL){}
+	~Peer(){
+		if(pssl) SSL_free(pssl);
+	}
+	bool connect(SSL_CTX *_pcctx){
+		pssl = SSL_new(_pcctx);
+		SSL_set_fd(pssl, sd.descriptor());
+		SSL_set_tlsext_host_name(pssl, "localhost");
+		SSL_set1_host(pssl, "localhost");
+		return SSL_connect(pssl) == 1;
+	}
+	//! Read _sz bytes, in small pieces
+	bool read(string &_rs, const size_t _sz){
+		char	buf[1000];
+		while(_rs.size() < _sz){
+			const int rv = pssl ? SSL_read(pssl, buf, sizeof(buf)) : sd.recv(buf, sizeof(buf));
+			if(rv <= 0) return false;
+			_rs.append(buf, rv);
+		}
+		return true;
+	}
+	//! Write _rs in bursts, so the Stream has to wait for the data
+	bool write(const string &_rs){
+		for(size_t off = 0, i = 0; off < _rs.size(); ++i){
+			const int	sz = _rs.size() - off < 3000 ? _rs.size() - off : 3000;
+			const int	rv = pssl ? SSL_write(pssl, _rs.data() + off, sz) : sd.send(_rs.data() + off, sz);
+			if(rv <= 0) return false;
+			off += rv;
+			if(i % 10 == 9){
+				Thread::sleep(1);
+			}
+		}
+		return true;
+	}
+	SocketDevice	sd;
+	SSL				*pssl;
+};
+
+//! Waits for the file store to open a file
+struct OpenWait{
+	OpenWait():done(false){}
+	void set(frame::file::FilePointerT &_rptr, ERROR_NS::error_code _err){
+		Locker<Mutex>	lock(mtx);
+		if(!_err){
+			filptr = _rptr;
+		}
+		done = true;
+		cnd.signal();
+	}
+	bool wait(){
+		Locker<Mutex>	lock(mtx);
+		while(!done){
+			cnd.wait(lock);
+		}
+		return !filptr.empty();
+	}
+	Mutex						mtx;
+	Condition					cnd;
+	bool						done;
+	frame::file::FilePointerT	filptr;
+};
+
+struct OpenCbk{
+	OpenCbk(OpenWait &_rw):pw(&_rw){}
+	void operator()(FileStoreT &, frame::file::FilePointerT &_rptr, ERROR_NS::error_code _err){
+		pw->set(_rptr, _err);
+	}
+	OpenWait	*pw;
+};
+
+//! The manager, the schedulers and the file store of a test
+struct Environment{
+	Environment(const bool _persistent, TestCertificates &_rtc):aiosch(m, -1, 2), sch(m), pctx(NULL), pcctx(NULL){
+		aiosch.persistentRegistration(_persistent);
+		aiosch.start(1);
+
+		frame::file::Utf8Configuration	utf8cfg;
+		frame::file::TempConfiguration	tempcfg;
+
+		utf8cfg.storagevec.push_back(frame::file::Utf8Configuration::Storage("/", "/tmp/"));
+
+		tempcfg.storagevec.push_back(frame::file::TempConfiguration::Storage());
+		tempcfg.storagevec.back().level = frame::file::MemoryLevelFlag;
+		tempcfg.storagevec.back().capacity = 4 * DataSize;
+		tempcfg.storagevec.back().maxsize = 2 * DataSize;
+
+		filestoreptr = new FileStoreT(m, utf8cfg, tempcfg);
+		m.registerObject(*filestoreptr);
+		sch.schedule(filestoreptr);
+
+		char	buf[64];
+		sprintf(buf, "/solid_test_stream_%u.dat", (unsigned)getpid());
+		path = buf;
+
+		pctx = create_server_context(_rtc);
+		pcctx = create_client_context(_rtc);
+	}
+	~Environment(){
+		m.stop();
+		unlink(("/tmp" + path).c_str());
+		SSL_CTX_free(pcctx);
+		delete pctx;
+	}
+	//! A file holding the data at FileOffset: on disk or in memory
+	bool openFile(frame::file::FilePointerT &_rfilptr, const bool _memory){
+		const string	prefix(FileOffset, '#');
+		OpenWait		ow;
+		if(_memory){
+			filestoreptr->requestCreateTemp(OpenCbk(ow), FileOffset + DataSize, frame::file::MemoryLevelFlag);
+			if(!ow.wait()) return false;
+			if(
+				ow.filptr->write(prefix.data(), FileOffset, 0) != FileOffset ||
+				ow.filptr->write(data.data(), DataSize, FileOffset) != DataSize
+			){
+				return false;
+			}
+		}else{
+			FILE	*pf = fopen(("/tmp" + path).c_str(), "w");
+			if(!pf) return false;
+			const bool	ok = fwrite(prefix.data(), 1, FileOffset, pf) == FileOffset && fwrite(data.data(), 1, DataSize, pf) == DataSize;
+			fclose(pf);
+			if(!ok) return false;
+			filestoreptr->requestOpenFile(OpenCbk(ow), path);
+			if(!ow.wait()) return false;
+		}
+		_rfilptr = ow.filptr;
+		return true;
+	}
+	frame::Manager					m;
+	AioSchedulerT					aiosch;
+	SchedulerT						sch;
+	FileStorePointerT				filestoreptr;
+	string							path;
+	frame::aio::openssl::Context	*pctx;
+	SSL_CTX							*pcctx;
+};
+
+//! One transfer of the data between a Stream and a Peer
+int run(Environment &_renv, const Stream::Kind _kind, const bool _secure, frame::file::FilePointerT &_rfilptr){
+	Peer			peer;
+	SocketDevice	sd;
+	Result			res;
+	TEST_CHECK(connect_pair(sd, peer.sd));
+	TEST_CHECK(peer.sd.makeBlocking(30 * 1000));
+	//small socket buffers on both ends, so the Stream waits for the Peer
+	TEST_CHECK(sd.sendBufferSize(BufferSize) && sd.recvBufferSize(BufferSize));
+	TEST_CHECK(peer.sd.sendBufferSize(BufferSize) && peer.sd.recvBufferSize(BufferSize));
+
+	DynamicPointer<Stream>	strptr(new Stream(sd, res, _kind, _secure ? _renv.pctx : NULL, _rfilptr));
+	_renv.m.registerObject(*strptr);
+	_renv.aiosch.schedule(strptr);
+
+	if(_secure){
+		TEST_CHECK(peer.connect(_renv.pcctx));
+	}
+	if(_kind == Stream::RecvvE){
+		TEST_CHECK(peer.write(data));
+		TEST_CHECK(res.wait());
+		TEST_CHECK(res.ok);
+		TEST_CHECK(res.rcvdata == data);
+	}else{
+		string	rcvdata;
+		TEST_CHECK(peer.read(rcvdata, DataSize));
+		TEST_CHECK(rcvdata == data);
+		TEST_CHECK(res.wait());
+		TEST_CHECK(res.ok);
+	}
+	TEST_CHECK(res.cnt == DataSize);
+	return 0;
+}
+
+int test_stream(const char *_which, const bool _persistent, TestCertificates &_rtc){
+	Environment	env(_persistent, _rtc);
+	int			rv = 0;
+	TEST_CHECK(env.pctx && env.pcctx);
+
+	if(!*_which || !strcmp(_which, "sendv")){
+		frame::file::FilePointerT	filptr;
+		rv = run(env, Stream::SendvE, false, filptr);
+	}
+	if(!rv && (!*_which || !strcmp(_which, "recvv"))){
+		frame::file::FilePointerT	filptr;
+		rv = run(env, Stream::RecvvE, false, filptr);
+	}
+	if(!rv && (!*_which || !strcmp(_which, "sendfile"))){
+		//sendfile from disk, buffered from memory
+		frame::file::FilePointerT	filptr;
+		TEST_CHECK(env.openFile(filptr, false));
+		TEST_CHECK(filptr->descriptor() >= 0);
+		rv = run(env, Stream::SendFileE, false, filptr);
+		if(!rv){
+			TEST_CHECK(env.openFile(filptr, true));
+			TEST_CHECK(filptr->descriptor() < 0);
+			rv = run(env, Stream::SendFileE, false, filptr);
+		}
+	}
+	if(!rv && (!*_which || !strcmp(_which, "secure"))){
+		frame::file::FilePointerT	filptr;
+		rv = run(env, Stream::SendvE, true, filptr);
+		if(!rv){
+			rv = run(env, Stream::RecvvE, true, filptr);
+		}
+		if(!rv){
+			TEST_CHECK(env.openFile(filptr, false));
+			rv = run(env, Stream::SendFileE, true, filptr);
+		}
+	}
+	return rv;
+}
+
+}//namespace
+
+//! Partial sends and receives of the aio stream sockets over loopback
+/*!
+	Every case runs with and without the persistent registration.
+*/
+int test_aiostream(int argc, char **argv){
+	Thread::init();
+	const char *which = argc > 1 ? argv[1] : "";
+	//create initializes the library
+	delete frame::aio::openssl::Context::create();
+	init_data();
+
+	TestCertificates	tc;
+	TEST_CHECK(tc.create());
+	int			rv = test_stream(which, false, tc);
+	if(!rv){
+		rv = test_stream(which, true, tc);
+	}
+	Thread::waitAll();
+	cout<<"test_aiostream "<<which<<" rv = "<<rv<<endl;
+	return rv;
+}
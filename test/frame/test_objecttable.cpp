@@ -0,0 +1,236 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include "system/thread.hpp"
+#include "system/mutex.hpp"
+#include "system/atomic.hpp"
+#include "frame/manager.hpp"
+#include "frame/object.hpp"
+#include "frame/message.hpp"
+
+using namespace std;
+using namespace solid;
+
+#define TEST_CHECK(x) if(!(x)){cout<<__FILE__<<':'<<__LINE__<<" failed: "#x<<endl; return -1;}
+
+namespace{
+
+enum{
+	SlotCount = 1024,//enough to grow the table while the notifiers run
+	ChurnerCount = 2,
+	NotifierCount = 2,
+	ReplaceCount = 20000//per churner
+};
+
+//! Carries the serial of the object it is meant for
+struct ProbeMessage: Dynamic<ProbeMessage, frame::Message>{
+	ProbeMessage(const uint32 _serial):serial(_serial){}
+	const uint32	serial;
+};
+
+struct Stats{
+	Stats(){
+		hitcnt.store(0);
+		wrongcnt.store(0);
+	}
+	ATOMIC_NS::atomic<size_t>	hitcnt;
+	ATOMIC_NS::atomic<size_t>	wrongcnt;//a dead or a different object was reached
+};
+
+//! Checks it is alive and that the message was meant for it
+struct Probe: frame::Object{
+	enum{
+		Alive = 0x600df00d,
+		Dead = 0xdeadbeef
+	};
+	Probe(Stats &_rst, const uint32 _serial):rst(_rst), serial(_serial){
+		magic.store(Alive);
+	}
+	~Probe(){
+		//unregister before the object is torn down, so no lookup still uses it
+		unregister();
+		magic.store(Dead);
+	}
+	/*virtual*/ bool notify(DynamicPointer<frame::Message> &_rmsgptr){
+		const ProbeMessage	&rmsg = static_cast<const ProbeMessage&>(*_rmsgptr);
+		if(magic.load() != Alive || rmsg.serial != serial){
+			++rst.wrongcnt;
+		}else{
+			++rst.hitcnt;
+		}
+		//widen the window in which the stub stays pinned
+		Thread::yield();
+		//an erased object might already be reallocated for a new one
+		if(magic.load() != Alive || rmsg.serial != serial){
+			++rst.wrongcnt;
+		}
+		return false;
+	}
+	Stats						&rst;
+	const uint32				serial;
+	ATOMIC_NS::atomic<uint32>	magic;
+};
+
+//! The uid of the object living in a slot, with its serial
+struct Slot{
+	Slot():serial(0), pobj(NULL){}
+	Mutex				mtx;
+	frame::ObjectUidT	uid;
+	uint32				serial;
+	Probe				*pobj;
+};
+
+typedef std::vector<Slot>	SlotVectorT;
+
+//! The slot the churners are replacing right now
+ATOMIC_NS::atomic<size_t>	hotpos;
+
+//! Replaces the objects in its slots: erase the old one, register a new one
+struct Churner: Thread{
+	Churner(frame::Manager &_rm, Stats &_rst, SlotVectorT &_rslotvec, const size_t _idx):
+		Thread(false), rm(_rm), rst(_rst), rslotvec(_rslotvec), idx(_idx), stalecnt(0){}
+	void run(){
+		rm.prepareThread();
+		uint32	serial = idx << 24;
+		//fill the slots, the table grows meanwhile
+		for(size_t i = idx; i < rslotvec.size(); i += ChurnerCount){
+			publish(rslotvec[i], ++serial);
+		}
+		for(size_t n = 0; n < ReplaceCount; ++n){
+			const size_t		pos = (n * 7 * ChurnerCount + idx) % rslotvec.size();
+			Slot				&rs = rslotvec[pos];
+			Probe				*pobj;
+			frame::ObjectUidT	uid;
+			{
+				Locker<Mutex>	lock(rs.mtx);
+				pobj = rs.pobj;
+				uid = rs.uid;
+				rs.pobj = NULL;
+			}
+			hotpos.store(pos);
+			//waits for the notifiers which pinned it
+			delete pobj;
+			//the new object most likely reuses the freed stub
+			publish(rs, ++serial);
+			//the stale uid must miss
+			DynamicPointer<frame::Message>	msgptr(new ProbeMessage(0));
+			if(rm.notify(msgptr, uid)){
+				++stalecnt;
+			}
+			//let the notifiers run, even on a single cpu
+			Thread::yield();
+		}
+		rm.unprepareThread();
+	}
+	void publish(Slot &_rs, const uint32 _serial){
+		Probe				*pobj = new Probe(rst, _serial);
+		frame::ObjectUidT	uid = rm.registerObject(*pobj);
+		Locker<Mutex>		lock(_rs.mtx);
+		_rs.pobj = pobj;
+		_rs.uid = uid;
+		_rs.serial = _serial;
+	}
+	frame::Manager	&rm;
+	Stats			&rst;
+	SlotVectorT		&rslotvec;
+	const size_t	idx;
+	size_t			stalecnt;
+};
+
+//! Notifies the objects from random slots until stopped
+struct Notifier: Thread{
+	Notifier(frame::Manager &_rm, SlotVectorT &_rslotvec, const size_t _idx, ATOMIC_NS::atomic<bool> &_rstop):
+		Thread(false), rm(_rm), rslotvec(_rslotvec), idx(_idx), rstop(_rstop), sendcnt(0), misscnt(0){}
+	void run(){
+		size_t	pos = idx;
+		bool	hot = false;
+		while(!rstop.load()){
+			//every other notify goes to the slot being replaced
+			pos = (pos * 1103515245 + 12345) & 0x7fffffff;
+			hot = !hot;
+			Slot				&rs = rslotvec[(hot ? hotpos.load() : pos) % rslotvec.size()];
+			frame::ObjectUidT	uid;
+			uint32				serial;
+			{
+				Locker<Mutex>	lock(rs.mtx);
+				if(!rs.serial) continue;
+				uid = rs.uid;
+				serial = rs.serial;
+			}
+			//the object may be erased right now
+			DynamicPointer<frame::Message>	msgptr(new ProbeMessage(serial));
+			if(!rm.notify(msgptr, uid)){
+				++misscnt;
+			}
+			++sendcnt;
+		}
+	}
+	frame::Manager				&rm;
+	SlotVectorT					&rslotvec;
+	const size_t				idx;
+	ATOMIC_NS::atomic<bool>		&rstop;
+	size_t						sendcnt;
+	size_t						misscnt;
+};
+
+}//namespace
+
+//! Objects are erased and registered while others notify them
+/*!
+	A notify either reaches the live object it was meant for, or
+	misses - it never reaches an erased object or the object which
+	reused its stub.
+*/
+int test_objecttable(int argc, char **argv){
+	Thread::init();
+
+	Stats					st;
+	SlotVectorT				slotvec(SlotCount);
+	ATOMIC_NS::atomic<bool>	stop;
+	size_t					stalecnt = 0;
+	size_t					sendcnt = 0;
+	size_t					misscnt = 0;
+
+	stop.store(false);
+	hotpos.store(0);
+	{
+		frame::Manager			m;
+		std::vector<Churner*>	chvec;
+		std::vector<Notifier*>	ntvec;
+
+		for(size_t i = 0; i < NotifierCount; ++i){
+			ntvec.push_back(new Notifier(m, slotvec, i, stop));
+			TEST_CHECK(ntvec.back()->start(true, false));
+		}
+		for(size_t i = 0; i < ChurnerCount; ++i){
+			chvec.push_back(new Churner(m, st, slotvec, i));
+			TEST_CHECK(chvec.back()->start(true, false));
+		}
+		for(size_t i = 0; i < ChurnerCount; ++i){
+			chvec[i]->join();
+			stalecnt += chvec[i]->stalecnt;
+			delete chvec[i];
+		}
+		stop.store(true);
+		for(size_t i = 0; i < NotifierCount; ++i){
+			ntvec[i]->join();
+			sendcnt += ntvec[i]->sendcnt;
+			misscnt += ntvec[i]->misscnt;
+			delete ntvec[i];
+		}
+		//erase the remaining objects, then every uid misses
+		for(size_t i = 0; i < SlotCount; ++i){
+			delete slotvec[i].pobj;
+			slotvec[i].pobj = NULL;
+			DynamicPointer<frame::Message>	msgptr(new ProbeMessage(0));
+			TEST_CHECK(!m.notify(msgptr, slotvec[i].uid));
+		}
+		m.stop();
+	}
+	TEST_CHECK(st.wrongcnt == 0);
+	TEST_CHECK(stalecnt == 0);
+	TEST_CHECK(sendcnt == st.hitcnt + misscnt);
+	TEST_CHECK(st.hitcnt > 0);
+	cout<<"test_objecttable: "<<sendcnt<<" notifies, "<<st.hitcnt<<" hits, "<<misscnt<<" misses"<<endl;
+	return 0;
+}
@@ -0,0 +1,267 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include "system/common.hpp"
+#include "system/socketdevice.hpp"
+#include "system/socketaddress.hpp"
+#include "system/thread.hpp"
+#include "frame/aio/openssl/opensslsocket.hpp"
+
+#include "openssl/ssl.h"
+#include "openssl/x509v3.h"
+#include "openssl/pem.h"
+#include "openssl/evp.h"
+#include "openssl/ec.h"
+#include "openssl/bio.h"
+
+#include "testcommon.hpp"
+
+#ifdef ON_LINUX
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+using namespace std;
+using namespace solid;
+
+#define TEST_CHECK(x) if(!(x)){cout<<__FILE__<<':'<<__LINE__<<" failed: "#x<<endl; return -1;}
+
+namespace{
+
+//! True if the kernel takes the "tls" upper layer protocol
+bool kernel_has_tls(){
+#if defined(ON_LINUX) && defined(TCP_ULP)
+	SocketDevice	srv;
+	SocketDevice	cli;
+	if(!connect_pair(srv, cli)) return false;
+	return setsockopt(cli.descriptor(), SOL_TCP, TCP_ULP, "tls", sizeof("tls")) == 0;
+#else
+	return false;
+#endif
+}
+
+//! A loopback connection: an openssl::Socket server and a plain OpenSSL client
+struct TestConnection{
+	TestConnection():psrv(NULL), pcli(NULL){}
+	~TestConnection(){
+		if(pcli) SSL_free(pcli);
+		delete psrv;
+	}
+	//! Hand-shake, resuming _presume if not NULL
+	int handshake(frame::aio::openssl::Context &_rctx, SSL_CTX *_pcctx, SSL_SESSION *_presume = NULL){
+		TEST_CHECK(connect_pair(srvdev, clidev));
+
+		psrv = _rctx.createSocket();
+		TEST_CHECK(psrv);
+		psrv->descriptor(srvdev);
+
+		pcli = SSL_new(_pcctx);
+		SSL_set_fd(pcli, clidev.descriptor());
+		SSL_set_tlsext_host_name(pcli, "localhost");
+		SSL_set1_host(pcli, "localhost");
+		if(_presume){
+			SSL_set_session(pcli, _presume);
+		}
+
+		bool	srvdone = false;
+		bool	clidone = false;
+		for(int i = 0; i < 1000 && !(srvdone && clidone); ++i){
+			if(!srvdone){
+				const frame::aio::AsyncE	rv = psrv->secureAccept();
+				TEST_CHECK(rv != frame::aio::AsyncError);
+				srvdone = (rv == frame::aio::AsyncSuccess);
+			}
+			if(!clidone){
+				const int	rv = SSL_connect(pcli);
+				if(rv == 1){
+					clidone = true;
+				}else{
+					const int	err = SSL_get_error(pcli, rv);
+					TEST_CHECK(err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE);
+				}
+			}
+			if(!(srvdone && clidone)){
+				Thread::sleep(1);
+			}
+		}
+		TEST_CHECK(srvdone && clidone);
+		TEST_CHECK(SSL_get_verify_result(pcli) == X509_V_OK);
+		return 0;
+	}
+	//! The client closes cleanly and the server reads the close notify
+	/*!
+		Only the sessions of the cleanly closed connections stay resumable.
+	*/
+	int close(){
+		SSL_shutdown(pcli);
+		char	buf[16];
+		int		rv = -1;
+		for(int i = 0; i < 1000 && rv != 0; ++i){
+			rv = psrv->recv(buf, sizeof(buf));
+			TEST_CHECK(rv <= 0);
+			if(rv){
+				Thread::sleep(1);
+			}
+		}
+		TEST_CHECK(rv == 0);
+		return 0;
+	}
+	SocketDevice				srvdev;
+	SocketDevice				clidev;
+	frame::aio::openssl::Socket	*psrv;
+	SSL							*pcli;
+};
+
+//! Hand-shake, then exchange a message each way
+int test_handshake(TestCertificates &_rtc, const int _ktls, const bool _kernelhastls){
+	frame::aio::openssl::Context	*pctx = create_server_context(_rtc);
+	TEST_CHECK(pctx);
+	//-1 keeps the default, which must be off
+	bool	ktlsbuilt = false;
+	if(_ktls >= 0){
+		ktlsbuilt = pctx->kernelTls(_ktls == 1) && _ktls == 1;
+	}
+
+	SSL_CTX		*pcctx = create_client_context(_rtc);
+	TEST_CHECK(pcctx);
+
+	TestConnection	*pcon = new TestConnection;
+	TEST_CHECK(pcon->handshake(*pctx, pcctx) == 0);
+
+	frame::aio::openssl::Socket	*psrv = pcon->psrv;
+	SSL							*pcli = pcon->pcli;
+
+	cout<<"ktls "<<_ktls<<" built "<<ktlsbuilt<<" kernel "<<_kernelhastls<<" send offloaded "<<psrv->kernelSend()<<endl;
+	if(ktlsbuilt && _kernelhastls){
+		TEST_CHECK(psrv->kernelSend());
+	}else{
+		TEST_CHECK(!psrv->kernelSend());
+	}
+
+	const char	ping[] = "ping";
+	const char	pong[] = "pong";
+	char		buf[16];
+	int			rv = -1;
+
+	TEST_CHECK(psrv->send(ping, sizeof(ping)) == sizeof(ping));
+	for(int i = 0; i < 1000 && rv <= 0; ++i){
+		rv = SSL_read(pcli, buf, sizeof(buf));
+		if(rv <= 0){
+			TEST_CHECK(SSL_get_error(pcli, rv) == SSL_ERROR_WANT_READ);
+			Thread::sleep(1);
+		}
+	}
+	TEST_CHECK(rv == sizeof(ping) && memcmp(buf, ping, sizeof(ping)) == 0);
+
+	TEST_CHECK(SSL_write(pcli, pong, sizeof(pong)) == sizeof(pong));
+	rv = -1;
+	for(int i = 0; i < 1000 && rv <= 0; ++i){
+		rv = psrv->recv(buf, sizeof(buf));
+		if(rv <= 0){
+			TEST_CHECK(psrv->wantEvents() & frame::aio::SecureSocket::WANT_READ);
+			Thread::sleep(1);
+		}
+	}
+	TEST_CHECK(rv == sizeof(pong) && memcmp(buf, pong, sizeof(pong)) == 0);
+
+	delete pcon;
+	SSL_CTX_free(pcctx);
+	delete pctx;
+	return 0;
+}
+
+//! The session cache keeps at most its capacity, evicting the oldest sessions
+int test_cache(TestCertificates &_rtc){
+	enum{
+		Capacity = 4,
+		Count = 3 * Capacity
+	};
+	frame::aio::openssl::Context	*pctx = create_server_context(_rtc);
+	TEST_CHECK(pctx);
+	TEST_CHECK(pctx->sessionCache(1, Capacity, 300));
+
+	SSL_CTX		*pcctx = create_client_context(_rtc);
+	TEST_CHECK(pcctx);
+	//resume by session id, not by ticket
+	SSL_CTX_set_options(pcctx, SSL_OP_NO_TICKET);
+
+	SSL_SESSION							*psessarr[Count];
+	frame::aio::openssl::Context::Statistics	st;
+
+	for(size_t i = 0; i < Count; ++i){
+		TestConnection	*pcon = new TestConnection;
+		TEST_CHECK(pcon->handshake(*pctx, pcctx) == 0);
+		TEST_CHECK(!SSL_session_reused(pcon->pcli));
+		TEST_CHECK(pcon->close() == 0);
+		psessarr[i] = SSL_get1_session(pcon->pcli);
+		TEST_CHECK(psessarr[i]);
+		delete pcon;
+		pctx->statistics(st);
+		TEST_CHECK(st.cachesize == (i < Capacity ? i + 1 : Capacity));
+	}
+
+	//the newest sessions are resumed, twice - the sessions are kept
+	for(size_t j = 0; j < 2; ++j){
+		for(size_t i = Count - Capacity; i < Count; ++i){
+			TestConnection	*pcon = new TestConnection;
+			TEST_CHECK(pcon->handshake(*pctx, pcctx, psessarr[i]) == 0);
+			TEST_CHECK(SSL_session_reused(pcon->pcli));
+			TEST_CHECK(pcon->close() == 0);
+			delete pcon;
+		}
+	}
+	pctx->statistics(st);
+	TEST_CHECK(st.cachehitcnt == 2 * Capacity);
+	TEST_CHECK(st.cachesize == Capacity);
+
+	//the oldest were evicted
+	{
+		TestConnection	*pcon = new TestConnection;
+		TEST_CHECK(pcon->handshake(*pctx, pcctx, psessarr[0]) == 0);
+		TEST_CHECK(!SSL_session_reused(pcon->pcli));
+		TEST_CHECK(pcon->close() == 0);
+		delete pcon;
+	}
+	pctx->statistics(st);
+	TEST_CHECK(st.cachemisscnt == 1);
+	TEST_CHECK(st.cachesize == Capacity);
+	cout<<"handshakes "<<st.handshakecnt<<" resumed "<<st.resumedcnt<<" cache size "<<st.cachesize<<endl;
+
+	for(size_t i = 0; i < Count; ++i){
+		SSL_SESSION_free(psessarr[i]);
+	}
+	SSL_CTX_free(pcctx);
+	delete pctx;
+	return 0;
+}
+
+}//namespace
+
+int test_openssl(int argc, char **argv){
+	Thread::init();
+	const char *which = argc > 1 ? argv[1] : "";
+	//create initializes the library
+	delete frame::aio::openssl::Context::create();
+
+	TestCertificates	tc;
+	TEST_CHECK(tc.create());
+	const bool	kernelhastls = kernel_has_tls();
+	int			rv = 0;
+	if(!*which || !strcmp(which, "default")){
+		rv = test_handshake(tc, -1, kernelhastls);
+	}
+	if(!rv && (!*which || !strcmp(which, "plain"))){
+		rv = test_handshake(tc, 0, kernelhastls);
+	}
+	if(!rv && (!*which || !strcmp(which, "ktls"))){
+		rv = test_handshake(tc, 1, kernelhastls);
+	}
+	if(!rv && (!*which || !strcmp(which, "cache"))){
+		rv = test_cache(tc);
+	}
+	cout<<"test_openssl "<<which<<" rv = "<<rv<<endl;
+	return rv;
+}
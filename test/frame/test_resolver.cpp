@@ -0,0 +1,199 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include "system/thread.hpp"
+#include "system/mutex.hpp"
+#include "system/condition.hpp"
+#include "system/timespec.hpp"
+#include "system/socketaddress.hpp"
+#include "system/atomic.hpp"
+#include "frame/manager.hpp"
+#include "frame/object.hpp"
+#include "frame/resolver.hpp"
+
+using namespace std;
+using namespace solid;
+
+#define TEST_CHECK(x) if(!(x)){cout<<__FILE__<<':'<<__LINE__<<" failed: "#x<<endl; return -1;}
+
+namespace{
+
+//! Collects the ResolveMessages - it is not scheduled
+struct Collector: frame::Object{
+	typedef DynamicPointer<frame::ResolveMessage>	ResolveMessagePointerT;
+	typedef std::vector<ResolveMessagePointerT>		ResolveMessageVectorT;
+
+	~Collector(){
+		unregister();
+	}
+	/*virtual*/ bool notify(DynamicPointer<frame::Message> &_rmsgptr){
+		if(_rmsgptr->isTypeDynamic(frame::ResolveMessage::staticTypeId())){
+			Locker<Mutex>	lock(mtx);
+			msgvec.push_back(ResolveMessagePointerT(_rmsgptr));
+			cnd.signal();
+		}
+		return false;
+	}
+	//! Wait at most 10 seconds for _cnt messages
+	bool wait(const size_t _cnt){
+		TimeSpec		ts(TimeSpec::createRealTime());
+		ts += 10 * 1000;
+		Locker<Mutex>	lock(mtx);
+		while(msgvec.size() < _cnt){
+			if(!cnd.wait(lock, ts)){
+				return false;
+			}
+		}
+		return true;
+	}
+	size_t size(){
+		Locker<Mutex>	lock(mtx);
+		return msgvec.size();
+	}
+	//the message stays put when the vector grows
+	const frame::ResolveMessage& at(const size_t _idx){
+		Locker<Mutex>	lock(mtx);
+		return *msgvec[_idx];
+	}
+	Mutex					mtx;
+	Condition				cnd;
+	ResolveMessageVectorT	msgvec;
+};
+
+//! A stub lookup: "*.good" resolves to the loopback, anything else fails
+/*!
+	It counts the calls and is slow enough for the concurrent
+	requests to find the lookup pending.
+*/
+ATOMIC_NS::atomic<size_t>	lookupcnt(0);
+
+ResolveData stub_lookup(
+	const char *_node, const char *_service,
+	int _flags, int _family, int _type, int _proto
+){
+	++lookupcnt;
+	Thread::sleep(300);
+	const size_t	len = _node ? strlen(_node) : 0;
+	if(len > 5 && strcmp(_node + len - 5, ".good") == 0){
+		return synchronous_resolve(
+			"127.0.0.1", _service,
+			ResolveData::NumericHost | ResolveData::NumericService,
+			_family, _type, _proto
+		);
+	}
+	return ResolveData();
+}
+
+bool is_loopback(const ResolveData &_rrd){
+	if(_rrd.empty()){
+		return false;
+	}
+	SocketAddressInet4	sa(_rrd.begin());
+	char				host[SocketInfo::HostStringCapacity];
+	char				service[SocketInfo::ServiceStringCapacity];
+	sa.toString(host, SocketInfo::HostStringCapacity, service, SocketInfo::ServiceStringCapacity, SocketInfo::NumericHost | SocketInfo::NumericService);
+	return strncmp(host, "127.", 4) == 0;
+}
+
+//! localhost comes from /etc/hosts
+int test_hosts(){
+	frame::Manager		m;
+	frame::Resolver		r(m);
+	Collector			c;
+	frame::ObjectUidT	uid = m.registerObject(c);
+
+	r.resolve(uid, "localhost", 80, 0, SocketInfo::Inet4, SocketInfo::Stream);
+	TEST_CHECK(c.wait(1));
+	TEST_CHECK(c.at(0).node == "localhost");
+	TEST_CHECK(c.at(0).service == "80");
+	TEST_CHECK(!c.at(0).cached);
+	TEST_CHECK(is_loopback(c.at(0).data));
+
+	r.resolve(uid, "localhost", 80, 0, SocketInfo::Inet4, SocketInfo::Stream);
+	TEST_CHECK(c.wait(2));
+	TEST_CHECK(c.at(1).cached);
+	TEST_CHECK(is_loopback(c.at(1).data));
+	r.stop();
+	return 0;
+}
+
+int test_cache(){
+	frame::Manager		m;
+	//60s time to live, 1s negative time to live
+	frame::Resolver		r(m, 4, 60, 1, 16, &stub_lookup);
+	Collector			c1;
+	Collector			c2;
+	frame::ObjectUidT	uid1 = m.registerObject(c1);
+	frame::ObjectUidT	uid2 = m.registerObject(c2);
+
+	//the concurrent requests share the pending lookup
+	r.resolve(uid1, "host.good", "1000", 0, SocketInfo::Inet4, SocketInfo::Stream);
+	r.resolve(uid2, "host.good", "1000", 0, SocketInfo::Inet4, SocketInfo::Stream);
+	TEST_CHECK(c1.wait(1));
+	TEST_CHECK(c2.wait(1));
+	TEST_CHECK(lookupcnt == 1);
+	TEST_CHECK(!c1.at(0).cached && !c2.at(0).cached);
+	TEST_CHECK(is_loopback(c1.at(0).data) && is_loopback(c2.at(0).data));
+
+	//a cache hit is notified right away
+	r.resolve(uid1, "host.good", "1000", 0, SocketInfo::Inet4, SocketInfo::Stream);
+	TEST_CHECK(c1.size() == 2);
+	TEST_CHECK(c1.at(1).cached);
+	TEST_CHECK(is_loopback(c1.at(1).data));
+	TEST_CHECK(lookupcnt == 1);
+
+	//another service is another entry
+	r.resolve(uid1, "host.good", "2000", 0, SocketInfo::Inet4, SocketInfo::Stream);
+	TEST_CHECK(c1.wait(3));
+	TEST_CHECK(!c1.at(2).cached);
+	TEST_CHECK(lookupcnt == 2);
+
+	//the failures are cached for the negative time to live
+	r.resolve(uid2, "host.bad", "1000", 0, SocketInfo::Inet4, SocketInfo::Stream);
+	TEST_CHECK(c2.wait(2));
+	TEST_CHECK(!c2.at(1).cached && c2.at(1).data.empty());
+	TEST_CHECK(lookupcnt == 3);
+
+	r.resolve(uid2, "host.bad", "1000", 0, SocketInfo::Inet4, SocketInfo::Stream);
+	TEST_CHECK(c2.size() == 3);
+	TEST_CHECK(c2.at(2).cached && c2.at(2).data.empty());
+	TEST_CHECK(lookupcnt == 3);
+
+	Thread::sleep(1200);
+
+	//the failure expired, while the success did not
+	r.resolve(uid2, "host.bad", "1000", 0, SocketInfo::Inet4, SocketInfo::Stream);
+	TEST_CHECK(c2.wait(4));
+	TEST_CHECK(!c2.at(3).cached && c2.at(3).data.empty());
+	TEST_CHECK(lookupcnt == 4);
+
+	r.resolve(uid2, "host.good", "1000", 0, SocketInfo::Inet4, SocketInfo::Stream);
+	TEST_CHECK(c2.size() == 5);
+	TEST_CHECK(c2.at(4).cached);
+	TEST_CHECK(lookupcnt == 4);
+
+	//clear drops the cached results
+	r.clear();
+	r.resolve(uid2, "host.good", "1000", 0, SocketInfo::Inet4, SocketInfo::Stream);
+	TEST_CHECK(c2.wait(6));
+	TEST_CHECK(!c2.at(5).cached);
+	TEST_CHECK(lookupcnt == 5);
+	r.stop();
+	return 0;
+}
+
+}//namespace
+
+int test_resolver(int argc, char **argv){
+	Thread::init();
+	const char *which = argc > 1 ? argv[1] : "";
+	int rv = 0;
+	if(!*which || !strcmp(which, "hosts")){
+		rv = test_hosts();
+	}
+	if(!rv && (!*which || !strcmp(which, "cache"))){
+		rv = test_cache();
+	}
+	cout<<"test_resolver "<<which<<" rv = "<<rv<<endl;
+	return rv;
+}
@@ -0,0 +1,308 @@
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include "system/thread.hpp"
+#include "system/mutex.hpp"
+#include "system/condition.hpp"
+#include "system/timespec.hpp"
+#include "system/atomic.hpp"
+#include "frame/manager.hpp"
+#include "frame/object.hpp"
+#include "frame/objectselector.hpp"
+#include "frame/scheduler.hpp"
+#include "frame/stealingscheduler.hpp"
+
+using namespace std;
+using namespace solid;
+
+#define TEST_CHECK(x) if(!(x)){cout<<__FILE__<<':'<<__LINE__<<" failed: "#x<<endl; return -1;}
+
+namespace{
+
+typedef frame::Scheduler<frame::ObjectSelector>			SchedulerT;
+typedef frame::StealingScheduler<frame::ObjectSelector>	StealingSchedulerT;
+
+//! Counts the finished jobs
+struct Counter{
+	Counter():cnt(0), wrongcnt(0){}
+	void done(const bool _ok){
+		Locker<Mutex>	lock(mtx);
+		++cnt;
+		if(!_ok) ++wrongcnt;
+		if(cnt == expectcnt){
+			cnd.signal();
+		}
+	}
+	//! Wait at most 30 seconds for all the jobs
+	bool wait(){
+		TimeSpec		ts(TimeSpec::createRealTime());
+		ts += 30 * 1000;
+		Locker<Mutex>	lock(mtx);
+		while(cnt < expectcnt){
+			if(!cnd.wait(lock, ts)){
+				return false;
+			}
+		}
+		return true;
+	}
+	Mutex		mtx;
+	Condition	cnd;
+	size_t		cnt;
+	size_t		wrongcnt;
+	size_t		expectcnt;
+};
+
+//! Reschedules itself a few times, then closes
+/*!
+	Some of the jobs are much heavier than the others, so the
+	selectors get unbalanced backlogs.
+*/
+struct Job: frame::Object{
+	Job(Counter &_rcnt, const size_t _stepcnt, const size_t _load):
+		rcnt(_rcnt), stepcnt(_stepcnt), crtstep(0), load(_load), sum(0){}
+	~Job(){
+		rcnt.done(crtstep == stepcnt);
+	}
+	/*virtual*/ void execute(ExecuteContext &_rexectx){
+		for(size_t i = 0; i < load; ++i){
+			sum += i * crtstep;
+		}
+		if(++crtstep < stepcnt){
+			_rexectx.reschedule();
+		}else{
+			_rexectx.close();
+		}
+	}
+	Counter			&rcnt;
+	const size_t	stepcnt;
+	size_t			crtstep;
+	const size_t	load;
+	volatile size_t	sum;
+};
+
+//! Schedules its share of jobs from its own thread
+template <class Sch>
+struct Producer: Thread{
+	Producer(
+		frame::Manager &_rm, Sch &_rsch, Counter &_rcnt,
+		const size_t _cnt, const size_t _idx, const size_t _stepcnt, const size_t _heavyload
+	):	Thread(false), rm(_rm), rsch(_rsch), rcnt(_rcnt), cnt(_cnt), idx(_idx),
+		stepcnt(_stepcnt), heavyload(_heavyload){}
+	void run(){
+		for(size_t i = 0; i < cnt; ++i){
+			//one job in 16 is heavy
+			DynamicPointer<Job>	jobptr(new Job(rcnt, stepcnt, ((i + idx) % 16) ? 0 : heavyload));
+			rm.registerObject(*jobptr);
+			rsch.schedule(jobptr);
+		}
+	}
+	frame::Manager	&rm;
+	Sch				&rsch;
+	Counter			&rcnt;
+	const size_t	cnt;
+	const size_t	idx;
+	const size_t	stepcnt;
+	const size_t	heavyload;
+};
+
+struct Params{
+	const char	*name;
+	size_t		prodcnt;
+	size_t		jobcnt;//per producer
+	size_t		stepcnt;//executions per job
+	size_t		heavyload;//the load of one job in 16, the others have none
+	size_t		wkrcnt;
+	size_t		selcap;
+};
+
+//! Schedule _rp.prodcnt * _rp.jobcnt jobs on _rp.wkrcnt selectors
+/*!
+	Returns the milliseconds until the last job finished, or -1.
+*/
+template <class Sch>
+int run(const Params &_rp){
+	Counter		cnt;
+	cnt.expectcnt = _rp.prodcnt * _rp.jobcnt;
+
+	TimeSpec	start;
+	TimeSpec	stop;
+	{
+		frame::Manager	m;
+		Sch				sch(m, _rp.wkrcnt, _rp.wkrcnt, _rp.selcap);
+
+		std::vector<Producer<Sch>*>	prodvec;
+
+		start.currentMonotonic();
+		for(size_t i = 0; i < _rp.prodcnt; ++i){
+			prodvec.push_back(new Producer<Sch>(m, sch, cnt, _rp.jobcnt, i, _rp.stepcnt, _rp.heavyload));
+			prodvec.back()->start(true, false);
+		}
+		const bool	ok = cnt.wait();
+		stop.currentMonotonic();
+		for(size_t i = 0; i < _rp.prodcnt; ++i){
+			prodvec[i]->join();
+			delete prodvec[i];
+		}
+		m.stop();
+		TEST_CHECK(ok);
+	}
+	TEST_CHECK(cnt.cnt == cnt.expectcnt);
+	TEST_CHECK(cnt.wrongcnt == 0);
+	stop -= start;
+	return stop.seconds() * 1000 + stop.nanoSeconds() / 1000000;
+}
+
+//! Run the same jobs on both schedulers
+int test_jobs(const Params &_rp){
+	const int	msec = run<SchedulerT>(_rp);
+	TEST_CHECK(msec >= 0);
+	const int	stealmsec = run<StealingSchedulerT>(_rp);
+	TEST_CHECK(stealmsec >= 0);
+	cout<<_rp.name<<": "<<_rp.prodcnt<<" producers x "<<_rp.jobcnt<<" jobs on "<<_rp.wkrcnt<<" selectors of "<<_rp.selcap;
+	cout<<": Scheduler "<<msec<<" msec, StealingScheduler "<<stealmsec<<" msec"<<endl;
+	return 0;
+}
+
+const Params	params[] = {
+	//many short lived jobs - the scheduling itself
+	{"light", 8, 50000, 1, 0, 4, 1024},
+	//a few heavy jobs unbalance the selectors
+	{"jobs", 4, 20000, 4, 20000, 4, 1024},
+	//the selectors are too small, the jobs wait for free slots
+	{"full", 4, 5000, 4, 20000, 4, 16},
+};
+
+//! Runs till it gets S_KILL, then closes
+/*!
+	It keeps rescheduling itself, so it might see S_KILL and close
+	before the notifyMany which set it raised the selector.
+*/
+struct Waiter: frame::Object{
+	Waiter(Counter &_rstartcnt, Counter &_rcnt):rstartcnt(_rstartcnt), rcnt(_rcnt), started(false){}
+	~Waiter(){
+		rcnt.done(true);
+	}
+	/*virtual*/ void execute(ExecuteContext &_rexectx){
+		if(!started){
+			started = true;
+			rstartcnt.done(true);
+		}
+		if(grabSignalMask() & frame::S_KILL){
+			_rexectx.close();
+			return;
+		}
+		_rexectx.reschedule();
+	}
+	Counter		&rstartcnt;
+	Counter		&rcnt;
+	bool		started;
+};
+
+typedef std::vector<frame::ObjectUidT>	ObjectUidVectorT;
+
+//! Kills the objects with notifyMany until they are all gone
+struct Killer: Thread{
+	Killer(frame::Manager &_rm, Counter &_rcnt, const ObjectUidVectorT &_ruidvec):
+		Thread(false), rm(_rm), rcnt(_rcnt), ruidvec(_ruidvec), notifycnt(0){}
+	void run(){
+		while(true){
+			{
+				Locker<Mutex>	lock(rcnt.mtx);
+				if(rcnt.cnt == rcnt.expectcnt) break;
+			}
+			notifycnt += rm.notifyMany(frame::S_KILL | frame::S_RAISE, &ruidvec.front(), ruidvec.size());
+		}
+	}
+	frame::Manager			&rm;
+	Counter					&rcnt;
+	const ObjectUidVectorT	&ruidvec;
+	size_t					notifycnt;
+};
+
+//! notifyMany while the objects close and the idle selectors retire
+/*!
+	The raised objects must stay pinned till their selector is raised,
+	else the selector might be gone by then.
+*/
+int test_notifymany(){
+	enum{
+		RoundCount = 100,
+		ObjectCount = 32,
+		KillerCount = 2
+	};
+	frame::Manager	m;
+	SchedulerT		sch(m, -1, 4, ObjectCount / 4);
+	size_t			notifycnt = 0;
+	
+	sch.workerIdleTimeout(1);
+	sch.start();
+	
+	for(size_t r = 0; r < RoundCount; ++r){
+		Counter				startcnt;
+		Counter				cnt;
+		ObjectUidVectorT	uidvec;
+		startcnt.expectcnt = ObjectCount;
+		cnt.expectcnt = ObjectCount;
+		//fill all the selectors, so workers are created
+		for(size_t i = 0; i < ObjectCount; ++i){
+			DynamicPointer<Waiter>	objptr(new Waiter(startcnt, cnt));
+			uidvec.push_back(m.registerObject(*objptr));
+			sch.schedule(objptr);
+		}
+		//only raise the objects which are on a selector
+		TEST_CHECK(startcnt.wait());
+		std::vector<Killer*>	kilvec;
+		for(size_t i = 0; i < KillerCount; ++i){
+			kilvec.push_back(new Killer(m, cnt, uidvec));
+			TEST_CHECK(kilvec.back()->start(true, false));
+		}
+		const bool	ok = cnt.wait();
+		for(size_t i = 0; i < KillerCount; ++i){
+			kilvec[i]->join();
+			notifycnt += kilvec[i]->notifycnt;
+			delete kilvec[i];
+		}
+		TEST_CHECK(ok);
+		TEST_CHECK(cnt.wrongcnt == 0);
+		//every object is gone - all the uids miss
+		TEST_CHECK(m.notifyMany(frame::S_KILL | frame::S_RAISE, &uidvec.front(), uidvec.size()) == 0);
+		//let the empty selectors retire
+		Thread::sleep(r % 3);
+	}
+	m.stop();
+	TEST_CHECK(notifycnt >= RoundCount * ObjectCount);
+	cout<<"notifymany: "<<RoundCount<<" rounds of "<<ObjectCount<<" objects, "<<notifycnt<<" notified"<<endl;
+	return 0;
+}
+
+}//namespace
+
+//! Every scheduled job runs to completion on both schedulers
+/*!
+	"bench [count]" repeats all the job cases, count times.
+	"notifymany" checks notifyMany against the retiring selectors.
+*/
+int test_scheduler(int argc, char **argv){
+	Thread::init();
+	const char	*which = argc > 1 ? argv[1] : "";
+	size_t		repeatcnt = 1;
+	int			rv = 0;
+	if(!strcmp(which, "bench")){
+		repeatcnt = argc > 2 ? atoi(argv[2]) : 3;
+		which = "";
+	}
+	for(size_t i = 0; i < repeatcnt && !rv; ++i){
+		for(size_t j = 0; j < sizeof(params)/sizeof(Params) && !rv; ++j){
+			if(!*which || !strcmp(which, params[j].name)){
+				rv = test_jobs(params[j]);
+			}
+		}
+	}
+	if(!rv && repeatcnt == 1 && (!*which || !strcmp(which, "notifymany"))){
+		rv = test_notifymany();
+	}
+	Thread::waitAll();
+	cout<<"test_scheduler "<<which<<" rv = "<<rv<<endl;
+	return rv;
+}
@@ -0,0 +1,156 @@
+// test/frame/testcommon.hpp
+//
+// The loopback connections and the certificates of the frame tests
+//
+#ifndef SOLID_TEST_FRAME_COMMON_HPP
+#define SOLID_TEST_FRAME_COMMON_HPP
+
+#include <cstdio>
+#include <unistd.h>
+#include "system/common.hpp"
+#include "system/socketdevice.hpp"
+#include "system/socketaddress.hpp"
+#include "frame/aio/openssl/opensslsocket.hpp"
+
+#include "openssl/ssl.h"
+#include "openssl/x509v3.h"
+#include "openssl/pem.h"
+#include "openssl/evp.h"
+#include "openssl/ec.h"
+
+namespace{
+
+EVP_PKEY* create_key(){
+	EVP_PKEY		*pkey = NULL;
+	EVP_PKEY_CTX	*pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, NULL);
+	if(
+		!pctx ||
+		EVP_PKEY_keygen_init(pctx) <= 0 ||
+		EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, NID_X9_62_prime256v1) <= 0 ||
+		EVP_PKEY_keygen(pctx, &pkey) <= 0
+	){
+		pkey = NULL;
+	}
+	EVP_PKEY_CTX_free(pctx);
+	return pkey;
+}
+
+//! A certificate for _pkey, signed by _pcakey - self signed if _pcacert is NULL
+X509* create_certificate(
+	EVP_PKEY *_pkey, const char *_cn, const long _serial,
+	X509 *_pcacert, EVP_PKEY *_pcakey
+){
+	X509	*pcert = X509_new();
+	X509_set_version(pcert, 2);
+	ASN1_INTEGER_set(X509_get_serialNumber(pcert), _serial);
+	X509_gmtime_adj(X509_get_notBefore(pcert), -60);
+	X509_gmtime_adj(X509_get_notAfter(pcert), 24 * 3600);
+	X509_set_pubkey(pcert, _pkey);
+
+	X509_NAME	*pname = X509_get_subject_name(pcert);
+	X509_NAME_add_entry_by_txt(pname, "CN", MBSTRING_ASC, (const unsigned char*)_cn, -1, -1, 0);
+	X509_set_issuer_name(pcert, _pcacert ? X509_get_subject_name(_pcacert) : pname);
+
+	X509V3_CTX	ctx;
+	X509V3_set_ctx_nodb(&ctx);
+	X509V3_set_ctx(&ctx, _pcacert ? _pcacert : pcert, pcert, NULL, NULL, 0);
+	X509_EXTENSION	*pext;
+	if(_pcacert){
+		pext = X509V3_EXT_conf_nid(NULL, &ctx, NID_subject_alt_name, (char*)"DNS:localhost");
+	}else{
+		pext = X509V3_EXT_conf_nid(NULL, &ctx, NID_basic_constraints, (char*)"critical,CA:TRUE");
+	}
+	X509_add_ext(pcert, pext, -1);
+	X509_EXTENSION_free(pext);
+
+	if(!X509_sign(pcert, _pcakey ? _pcakey : _pkey, EVP_sha256())){
+		X509_free(pcert);
+		return NULL;
+	}
+	return pcert;
+}
+
+//! The test CA, the server certificate it signed and their files
+struct TestCertificates{
+	TestCertificates():pcakey(NULL), pcacert(NULL), pkey(NULL), pcert(NULL){
+		sprintf(certpath, "/tmp/solid_test_cert_%u.pem", (unsigned)getpid());
+		sprintf(keypath, "/tmp/solid_test_key_%u.pem", (unsigned)getpid());
+	}
+	~TestCertificates(){
+		unlink(certpath);
+		unlink(keypath);
+		X509_free(pcert);
+		EVP_PKEY_free(pkey);
+		X509_free(pcacert);
+		EVP_PKEY_free(pcakey);
+	}
+	bool create(){
+		pcakey = create_key();
+		pkey = create_key();
+		if(!pcakey || !pkey) return false;
+		pcacert = create_certificate(pcakey, "solid test ca", 1, NULL, NULL);
+		if(!pcacert) return false;
+		pcert = create_certificate(pkey, "localhost", 2, pcacert, pcakey);
+		if(!pcert) return false;
+
+		FILE	*pf = fopen(certpath, "w");
+		if(!pf) return false;
+		const bool	certok = PEM_write_X509(pf, pcert) == 1;
+		fclose(pf);
+		pf = fopen(keypath, "w");
+		if(!pf) return false;
+		const bool	keyok = PEM_write_PrivateKey(pf, pkey, NULL, NULL, 0, NULL, NULL) == 1;
+		fclose(pf);
+		return certok && keyok;
+	}
+	EVP_PKEY	*pcakey;
+	X509		*pcacert;
+	EVP_PKEY	*pkey;
+	X509		*pcert;
+	char		certpath[64];
+	char		keypath[64];
+};
+
+//! A connected loopback tcp pair, both ends nonblocking
+bool connect_pair(solid::SocketDevice &_rsrv, solid::SocketDevice &_rcli){
+	solid::ResolveData		rd = solid::synchronous_resolve("127.0.0.1", 0, 0, solid::SocketInfo::Inet4, solid::SocketInfo::Stream);
+	solid::SocketDevice		lsn;
+	solid::SocketAddress	addr;
+	if(rd.empty()) return false;
+	if(!lsn.create(rd.begin()) || !lsn.prepareAccept(rd.begin()) || !lsn.localAddress(addr)){
+		return false;
+	}
+	if(!_rcli.create(rd.begin()) || !_rcli.connect(addr)){
+		return false;
+	}
+	if(!lsn.accept(_rsrv)){
+		return false;
+	}
+	return _rsrv.makeNonBlocking() && _rcli.makeNonBlocking();
+}
+
+solid::frame::aio::openssl::Context* create_server_context(TestCertificates &_rtc){
+	solid::frame::aio::openssl::Context	*pctx = solid::frame::aio::openssl::Context::create();
+	//the load methods return false on success
+	if(pctx && (pctx->loadCertificateFile(_rtc.certpath) || pctx->loadPrivateKeyFile(_rtc.keypath))){
+		delete pctx;
+		pctx = NULL;
+	}
+	return pctx;
+}
+
+//! A client context trusting only the test CA
+SSL_CTX* create_client_context(TestCertificates &_rtc){
+	SSL_CTX		*pcctx = SSL_CTX_new(SSLv23_client_method());
+	if(!pcctx) return NULL;
+	X509_STORE_add_cert(SSL_CTX_get_cert_store(pcctx), _rtc.pcacert);
+	SSL_CTX_set_verify(pcctx, SSL_VERIFY_PEER, NULL);
+	//a cipher the kernel TLS offloads
+	SSL_CTX_set_max_proto_version(pcctx, TLS1_2_VERSION);
+	SSL_CTX_set_cipher_list(pcctx, "ECDHE-ECDSA-AES128-GCM-SHA256");
+	return pcctx;
+}
+
+}//namespace
+
+#endif
@@ -0,0 +1,98 @@
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "system/socketdevice.hpp"
+#include "system/socketaddress.hpp"
+#include "system/thread.hpp"
+
+using namespace std;
+using namespace solid;
+
+#define TEST_CHECK(x) if(!(x)){cout<<__FILE__<<':'<<__LINE__<<" failed: "#x<<endl; return -1;}
+
+//! Send then receive a batch of datagrams over a loopback udp pair
+/*!
+	The batch is larger than what a single sendmmsg/recvmmsg call takes.
+*/
+int test_datagram(int argc, char **argv){
+	enum{
+		Count = 150,
+		Capacity = 64
+	};
+	ResolveData		rd = synchronous_resolve("127.0.0.1", 0, 0, SocketInfo::Inet4, SocketInfo::Datagram);
+	TEST_CHECK(!rd.empty());
+
+	SocketDevice	snd;
+	SocketDevice	rcv;
+	SocketAddress	sndaddr;
+	SocketAddress	rcvaddr;
+
+	TEST_CHECK(snd.create(rd.begin()));
+	TEST_CHECK(rcv.create(rd.begin()));
+	TEST_CHECK(snd.bind(rd.begin()));
+	TEST_CHECK(rcv.bind(rd.begin()));
+	TEST_CHECK(snd.localAddress(sndaddr));
+	TEST_CHECK(rcv.localAddress(rcvaddr));
+	TEST_CHECK(rcv.makeNonBlocking());
+
+	//nothing to receive
+	{
+		char			buf[Capacity];
+		RecvDatagram	dg(buf, Capacity);
+		TEST_CHECK(rcv.recv(&dg, 1) == -1);
+	}
+
+	vector<string>			strvec(Count);
+	vector<SendDatagram>	snddgvec(Count);
+
+	for(size_t i = 0; i < Count; ++i){
+		char	buf[Capacity];
+		sprintf(buf, "datagram %u", (unsigned)i);
+		strvec[i].assign(buf, strlen(buf) + i % 16);//different sizes
+		snddgvec[i] = SendDatagram(strvec[i].data(), strvec[i].size(), rcvaddr);
+	}
+
+	size_t	sndcnt = 0;
+	while(sndcnt < Count){
+		const int rv = snd.send(&snddgvec[sndcnt], Count - sndcnt);
+		TEST_CHECK(rv > 0);
+		sndcnt += rv;
+	}
+
+	vector<char>			bufvec(Count * Capacity);
+	vector<RecvDatagram>	rcvdgvec(Count);
+
+	for(size_t i = 0; i < Count; ++i){
+		rcvdgvec[i] = RecvDatagram(&bufvec[i * Capacity], Capacity);
+	}
+
+	size_t	rcvcnt = 0;
+	size_t	retrycnt = 0;
+	while(rcvcnt < Count && retrycnt < 100){
+		const int rv = rcv.recv(&rcvdgvec[rcvcnt], Count - rcvcnt);
+		if(rv < 0){
+			++retrycnt;
+			Thread::sleep(10);
+			continue;
+		}
+		rcvcnt += rv;
+	}
+	TEST_CHECK(rcvcnt == Count);
+
+	//loopback keeps the order
+	for(size_t i = 0; i < Count; ++i){
+		TEST_CHECK(rcvdgvec[i].sz == strvec[i].size());
+		TEST_CHECK(memcmp(rcvdgvec[i].pb, strvec[i].data(), strvec[i].size()) == 0);
+		TEST_CHECK(rcvdgvec[i].addr.port() == sndaddr.port());
+	}
+
+	//the receive buffer is drained
+	{
+		char			buf[Capacity];
+		RecvDatagram	dg(buf, Capacity);
+		TEST_CHECK(rcv.recv(&dg, 1) == -1);
+	}
+	cout<<"test_datagram sent and received "<<Count<<" datagrams"<<endl;
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include "system/thread.hpp"
+#include "system/atomic.hpp"
+#include "utility/mpscring.hpp"
+
+using namespace std;
+using namespace solid;
+
+#define TEST_CHECK(x) if(!(x)){cout<<__FILE__<<':'<<__LINE__<<" failed: "#x<<endl; return -1;}
+
+namespace{
+
+typedef MpscRing<uint64>	RingT;
+
+//! Single threaded: full, empty and many wraps around the ring
+int test_wrap(){
+	RingT	ring;
+	ring.reserve(5);
+	TEST_CHECK(ring.capacity() == 8);
+
+	uint64	v;
+	TEST_CHECK(!ring.pop(v));
+
+	uint64	pushval = 0;
+	uint64	popval = 0;
+	for(size_t r = 0; r < 1000; ++r){
+		//fill it, with a different phase every round
+		const size_t	cnt = 1 + r % ring.capacity();
+		for(size_t i = 0; i < cnt; ++i){
+			TEST_CHECK(ring.push(pushval));
+			++pushval;
+		}
+		if(cnt == ring.capacity()){
+			TEST_CHECK(!ring.push(pushval));
+		}
+		for(size_t i = 0; i < cnt; ++i){
+			TEST_CHECK(ring.pop(v));
+			TEST_CHECK(v == popval);
+			++popval;
+		}
+		TEST_CHECK(!ring.pop(v));
+	}
+	return 0;
+}
+
+//! Pushes (producer index, sequence) values, retrying while the ring is full
+struct Producer: Thread{
+	Producer(RingT &_rring, const uint64 _idx, const uint64 _cnt):
+		Thread(false), rring(_rring), idx(_idx), cnt(_cnt), fullcnt(0){}
+	void run(){
+		for(uint64 i = 0; i < cnt; ++i){
+			while(!rring.push((idx << 32) | i)){
+				++fullcnt;
+				Thread::yield();
+			}
+		}
+	}
+	RingT			&rring;
+	const uint64	idx;
+	const uint64	cnt;
+	size_t			fullcnt;
+};
+
+//! Several producers on a small ring: nothing lost or duplicated, order kept per producer
+int test_producers(){
+	enum{
+		ProducerCount = 4,
+		Count = 200000
+	};
+	RingT	ring;
+	ring.reserve(16);
+
+	std::vector<Producer*>	prodvec;
+	for(size_t i = 0; i < ProducerCount; ++i){
+		prodvec.push_back(new Producer(ring, i, Count));
+	}
+	for(size_t i = 0; i < ProducerCount; ++i){
+		TEST_CHECK(prodvec[i]->start(true, false));
+	}
+
+	std::vector<uint64>	nextvec(ProducerCount, 0);
+	size_t				popcnt = 0;
+	size_t				emptycnt = 0;
+	uint64				v;
+	while(popcnt < ProducerCount * Count && emptycnt < 100000000){
+		if(!ring.pop(v)){
+			++emptycnt;
+			Thread::yield();
+			continue;
+		}
+		const size_t	idx = v >> 32;
+		TEST_CHECK(idx < ProducerCount);
+		TEST_CHECK((v & 0xffffffff) == nextvec[idx]);
+		++nextvec[idx];
+		++popcnt;
+	}
+	size_t	fullcnt = 0;
+	for(size_t i = 0; i < ProducerCount; ++i){
+		prodvec[i]->join();
+		fullcnt += prodvec[i]->fullcnt;
+		delete prodvec[i];
+	}
+	TEST_CHECK(popcnt == ProducerCount * Count);
+	for(size_t i = 0; i < ProducerCount; ++i){
+		TEST_CHECK(nextvec[i] == Count);
+	}
+	TEST_CHECK(!ring.pop(v));
+	cout<<"test_producers popped "<<popcnt<<" values, the ring was full "<<fullcnt<<" times"<<endl;
+	return 0;
+}
+
+}//namespace
+
+int test_mpscring(int argc, char **argv){
+	Thread::init();
+	const char *which = argc > 1 ? argv[1] : "";
+	int rv = 0;
+	if(!*which || !strcmp(which, "wrap")){
+		rv = test_wrap();
+	}
+	if(!rv && (!*which || !strcmp(which, "producers"))){
+		rv = test_producers();
+	}
+	cout<<"test_mpscring "<<which<<" rv = "<<rv<<endl;
+	return rv;
+}
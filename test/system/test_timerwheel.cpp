@@ -0,0 +1,197 @@
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <map>
+#include "utility/timerwheel.hpp"
+
+using namespace std;
+using namespace solid;
+
+#define TEST_CHECK(x) if(!(x)){cout<<__FILE__<<':'<<__LINE__<<" failed: "#x<<endl; return -1;}
+
+namespace{
+
+typedef std::vector<size_t>		SizeVectorT;
+typedef std::vector<uint64>		Uint64VectorT;
+
+//! Records the fired timers together with the tick they fired on
+struct Recorder{
+	Recorder(TimerWheel &_rtw):rtw(_rtw){}
+	void operator()(const size_t _idx){
+		idxvec.push_back(_idx);
+		tickvec.push_back(rtw.currentTick());
+	}
+	void clear(){
+		idxvec.clear();
+		tickvec.clear();
+	}
+	TimerWheel		&rtw;
+	SizeVectorT		idxvec;
+	Uint64VectorT	tickvec;
+};
+
+//! The timers fire in order, on their tick, across all the levels
+int test_order(){
+	//one timer on every level, some on the level boundaries
+	const uint64	ticks[] = {
+		1, 2, 255, 256, 257, 300, 1000, 16383, 16384, 16385,
+		100000, (1ULL << 20) - 1, (1ULL << 20), (1ULL << 20) + 1, 5000000,
+		(1ULL << 26) + 7, 100000000
+	};
+	const size_t	cnt = sizeof(ticks)/sizeof(uint64);
+	TimerWheel		tw;
+	Recorder		rec(tw);
+
+	tw.reserve(cnt);
+	//schedule in reverse, so the order does not come from the insertion
+	for(size_t i = cnt; i > 0; --i){
+		tw.schedule(i - 1, ticks[i - 1]);
+	}
+	TEST_CHECK(tw.size() == cnt);
+	TEST_CHECK(tw.nextTick() == 1);
+
+	//advance in uneven steps, growing past the farthest timer
+	uint64	crt = 0;
+	size_t	step = 1;
+	for(size_t n = 0; n < 32 && !tw.empty(); ++n){
+		const uint64	nxt = tw.nextTick();
+		TEST_CHECK(nxt != TimerWheel::invalidTick() && nxt > crt);
+		crt += step;
+		step = step * 3 + 1;
+		tw.advance(crt, rec);
+		TEST_CHECK(tw.currentTick() == crt);
+	}
+	TEST_CHECK(tw.empty());
+	TEST_CHECK(tw.nextTick() == TimerWheel::invalidTick());
+	TEST_CHECK(rec.idxvec.size() == cnt);
+	for(size_t i = 0; i < cnt; ++i){
+		TEST_CHECK(rec.idxvec[i] == i);
+		TEST_CHECK(rec.tickvec[i] == ticks[i]);
+	}
+	return 0;
+}
+
+//! Random timers, rescheduled and canceled, checked against a multimap
+int test_random(){
+	typedef std::multimap<uint64, size_t>	TimeMapT;
+	enum{
+		Count = 5000,
+		Rounds = 200
+	};
+	TimerWheel		tw;
+	Recorder		rec(tw);
+	Uint64VectorT	tickvec(Count, TimerWheel::invalidTick());
+	size_t			firecnt = 0;
+
+	srand(1);
+	tw.reserve(Count);
+
+	for(size_t r = 0; r < Rounds; ++r){
+		//schedule, reschedule or cancel a few hundred timers
+		for(size_t i = 0; i < 300; ++i){
+			const size_t idx = rand() % Count;
+			if(rand() % 8 == 0){
+				tw.cancel(idx);
+				tickvec[idx] = TimerWheel::invalidTick();
+				continue;
+			}
+			//mostly near, sometimes far, on any level
+			uint64	delta;
+			switch(rand() % 4){
+				case 0: delta = rand() % 256; break;
+				case 1: delta = rand() % 16384; break;
+				case 2: delta = rand() % (1 << 20); break;
+				default: delta = ((uint64)rand() << 4) % (1ULL << 28); break;
+			}
+			tickvec[idx] = tw.currentTick() + (delta ? delta : 1);
+			tw.schedule(idx, tickvec[idx]);
+		}
+		TimeMapT	tm;
+		for(size_t i = 0; i < Count; ++i){
+			if(tickvec[i] != TimerWheel::invalidTick()){
+				TEST_CHECK(tw.isScheduled(i));
+				tm.insert(TimeMapT::value_type(tickvec[i], i));
+			}else{
+				TEST_CHECK(!tw.isScheduled(i));
+			}
+		}
+		TEST_CHECK(tw.size() == tm.size());
+		//nextTick is a lower bound of the earliest timer
+		TEST_CHECK(tm.empty() || tw.nextTick() <= tm.begin()->first);
+
+		const uint64	to = tw.currentTick() + 1 + rand() % (1 << (r % 24));
+		rec.clear();
+		tw.advance(to, rec);
+
+		//exactly the due timers fired, in order and on their tick
+		size_t	i = 0;
+		for(TimeMapT::const_iterator it(tm.begin()); it != tm.end() && it->first <= to; ++it, ++i){
+			TEST_CHECK(i < rec.idxvec.size());
+			TEST_CHECK(rec.tickvec[i] == it->first);
+			TEST_CHECK(tickvec[rec.idxvec[i]] == it->first);
+			TEST_CHECK(i == 0 || rec.tickvec[i - 1] <= rec.tickvec[i]);
+		}
+		TEST_CHECK(i == rec.idxvec.size());
+		for(i = 0; i < rec.idxvec.size(); ++i){
+			TEST_CHECK(!tw.isScheduled(rec.idxvec[i]));
+			tickvec[rec.idxvec[i]] = TimerWheel::invalidTick();
+		}
+		firecnt += rec.idxvec.size();
+	}
+	cout<<"test_random fired "<<firecnt<<" timers"<<endl;
+	return 0;
+}
+
+//! A timer rescheduled from its own callback fires again
+struct Periodic{
+	Periodic(TimerWheel &_rtw, const uint64 _period):rtw(_rtw), period(_period), cnt(0), ok(true){}
+	void operator()(const size_t _idx){
+		if(rtw.currentTick() != (cnt + 1) * period){
+			ok = false;
+		}
+		++cnt;
+		rtw.schedule(_idx, rtw.currentTick() + period);
+	}
+	TimerWheel		&rtw;
+	const uint64	period;
+	size_t			cnt;
+	bool			ok;
+};
+
+int test_periodic(){
+	TimerWheel	tw;
+	Periodic	per(tw, 1000);//crosses a cascade point every few periods
+	tw.reserve(1);
+	tw.schedule(0, 1000);
+	tw.advance(1000 * 100 + 500, per);
+	TEST_CHECK(per.ok);
+	TEST_CHECK(per.cnt == 100);
+	TEST_CHECK(tw.isScheduled(0));
+	TEST_CHECK(tw.nextTick() <= 1000 * 101);
+	//far timeouts are clamped to the maximum span
+	tw.schedule(0, tw.currentTick() + TimerWheel::maximumSpan() * 2);
+	TEST_CHECK(tw.isScheduled(0));
+	tw.cancel(0);
+	TEST_CHECK(tw.empty());
+	TEST_CHECK(tw.nextTick() == TimerWheel::invalidTick());
+	return 0;
+}
+
+}//namespace
+
+int test_timerwheel(int argc, char **argv){
+	const char *which = argc > 1 ? argv[1] : "";
+	int rv = 0;
+	if(!*which || !strcmp(which, "order")){
+		rv = test_order();
+	}
+	if(!rv && (!*which || !strcmp(which, "random"))){
+		rv = test_random();
+	}
+	if(!rv && (!*which || !strcmp(which, "periodic"))){
+		rv = test_periodic();
+	}
+	cout<<"test_timerwheel "<<which<<" rv = "<<rv<<endl;
+	return rv;
+}
@@ -0,0 +1,121 @@
+// utility/mpscring.hpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#ifndef UTILITY_MPSCRING_HPP
+#define UTILITY_MPSCRING_HPP
+
+#include "system/common.hpp"
+#include "system/cassert.hpp"
+#include "system/atomic.hpp"
+
+namespace solid{
+
+//! A bounded, lock-free, multi producer single consumer ring
+/*!
+	Every slot carries a sequence number telling whether it is free for
+	the producer of a given position or filled for the consumer, so
+	producers only contend on the tail index and the consumer never
+	writes shared state other than the slot sequence.
+
+	NOTE: push fails when the ring is full - the caller must have
+	a fallback. pop must only be called from a single thread.
+*/
+template <class T>
+class MpscRing{
+	typedef ATOMIC_NS::atomic<size_t>	AtomicSizeT;
+	struct Slot{
+		AtomicSizeT		seq;
+		T				val;
+	};
+	enum{
+		CacheLineSize = 64
+	};
+public:
+	MpscRing():pslots(NULL), mask(0), head(0){
+		tail.store(0);
+	}
+
+	~MpscRing(){
+		delete []pslots;
+	}
+
+	//! Allocate the ring - capacity is rounded up to a power of 2
+	/*!
+		Must be called before using the ring.
+	*/
+	void reserve(size_t _cp){
+		cassert(pslots == NULL);
+		size_t cp(2);
+		while(cp < _cp){
+			cp <<= 1;
+		}
+		pslots = new Slot[cp];
+		mask = cp - 1;
+		for(size_t i = 0; i < cp; ++i){
+			pslots[i].seq.store(i, ATOMIC_NS::memory_order_relaxed);
+		}
+		tail.store(0);
+		head = 0;
+	}
+
+	size_t capacity()const{
+		return mask + 1;
+	}
+
+	//! Called by any thread - returns false if the ring is full
+	bool push(const T &_rv){
+		size_t pos(tail.load(ATOMIC_NS::memory_order_relaxed));
+		while(true){
+			Slot			&rs(pslots[pos & mask]);
+			const size_t	seq(rs.seq.load(ATOMIC_NS::memory_order_acquire));
+			if(seq == pos){
+				if(tail.compare_exchange_weak(pos, pos + 1, ATOMIC_NS::memory_order_relaxed)){
+					rs.val = _rv;
+					rs.seq.store(pos + 1, ATOMIC_NS::memory_order_release);
+					return true;
+				}
+				//pos was updated by compare_exchange_weak
+			}else if(seq < pos){
+				return false;
+			}else{
+				pos = tail.load(ATOMIC_NS::memory_order_relaxed);
+			}
+		}
+	}
+
+	//! Called only by the consumer - returns false if the ring is empty
+	/*!
+		It also returns false when the next value is reserved but
+		not yet published by its producer.
+	*/
+	bool pop(T &_rv){
+		Slot &rs(pslots[head & mask]);
+		if(rs.seq.load(ATOMIC_NS::memory_order_acquire) != (head + 1)){
+			return false;
+		}
+		_rv = rs.val;
+		rs.seq.store(head + mask + 1, ATOMIC_NS::memory_order_release);
+		++head;
+		return true;
+	}
+private:
+	MpscRing(const MpscRing&);
+	MpscRing& operator=(const MpscRing&);
+private:
+	Slot			*pslots;
+	size_t			mask;
+	char			pad1[CacheLineSize];
+	AtomicSizeT		tail;//producers side
+	char			pad2[CacheLineSize];
+	size_t			head;//consumer side
+};
+
+}//namespace solid
+
+#endif
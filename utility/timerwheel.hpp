@@ -0,0 +1,335 @@
+// utility/timerwheel.hpp
+//
+// Copyright (c) 2013 Valentin Palade (vipalade @ gmail . com)
+//
+// This file is part of SolidFrame framework.
+//
+// Distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt.
+//
+#ifndef UTILITY_TIMERWHEEL_HPP
+#define UTILITY_TIMERWHEEL_HPP
+
+#include <vector>
+#include "system/common.hpp"
+
+namespace solid{
+
+//! A hierarchical timing wheel keyed by a dense index
+/*!
+	Timers are identified by a small integer (e.g. a selector stub position)
+	and are kept on intrusive lists, so schedule, reschedule and cancel
+	are O(1). The first level has 256 one tick slots, the next four levels
+	have 64 slots each, covering 2^32 ticks; farther timeouts are clamped.
+	Advancing the wheel only touches the slots passed over and the
+	entries that are due, plus cascading from the upper levels.
+
+	NOTE: an index can only have one timer scheduled at a time.
+*/
+class TimerWheel{
+	enum{
+		L0Bits = 8,
+		LNBits = 6,
+		L0Size = 1 << L0Bits,
+		LNSize = 1 << LNBits,
+		L0Mask = L0Size - 1,
+		LNMask = LNSize - 1,
+		LevelCount = 5,
+		SlotCount = L0Size + (LevelCount - 1) * LNSize,
+		L0Words = L0Size / 64,
+		WordCount = L0Words + LevelCount - 1,
+	};
+	static const uint32 InvalidIndex = 0xffffffff;
+	static const uint16 InvalidSlot = 0xffff;
+
+	struct Node{
+		Node():next(InvalidIndex), prev(InvalidIndex), slot(InvalidSlot), tick(0){}
+		uint32	next;
+		uint32	prev;
+		uint16	slot;
+		uint64	tick;
+	};
+	typedef std::vector<Node>	NodeVectorT;
+public:
+	static uint64 invalidTick(){
+		return (uint64)-1;
+	}
+	static uint64 maximumSpan(){
+		return (1ULL << (L0Bits + (LevelCount - 1) * LNBits)) - 1;
+	}
+
+	TimerWheel(const uint64 _crttick = 0):crttick(_crttick), nexttick(invalidTick()), sz(0){
+		for(size_t i = 0; i < SlotCount; ++i){
+			slots[i] = InvalidIndex;
+		}
+		for(size_t i = 0; i < WordCount; ++i){
+			bits[i] = 0;
+		}
+	}
+
+	//! Make room for indexes in [0, _sz)
+	void reserve(const size_t _sz){
+		if(_sz > nodes.size()){
+			nodes.resize(_sz);
+		}
+	}
+
+	size_t size()const{
+		return sz;
+	}
+	bool empty()const{
+		return sz == 0;
+	}
+	uint64 currentTick()const{
+		return crttick;
+	}
+
+	//! The tick the wheel must be advanced to for progress
+	/*!
+		It is exact for timers on the first level and a lower bound
+		(the cascade point) for the others. Returns invalidTick() if empty.
+	*/
+	uint64 nextTick()const{
+		return nexttick;
+	}
+
+	bool isScheduled(const size_t _idx)const{
+		return _idx < nodes.size() && nodes[_idx].slot != InvalidSlot;
+	}
+
+	//! Schedule, or reschedule, the timer of _idx to expire at _tick
+	/*!
+		Ticks not in the future are fired on the next advance.
+	*/
+	void schedule(const size_t _idx, uint64 _tick){
+		Node &rn(nodes[_idx]);
+		if(_tick <= crttick){
+			_tick = crttick + 1;
+		}else if(_tick - crttick > maximumSpan()){
+			_tick = crttick + maximumSpan();
+		}
+		if(rn.slot != InvalidSlot){
+			if(rn.tick == _tick) return;
+			unlink(_idx);
+		}else{
+			++sz;
+		}
+		rn.tick = _tick;
+		link(_idx);
+		if(_tick < nexttick){
+			nexttick = _tick;
+		}
+	}
+
+	void cancel(const size_t _idx){
+		if(isScheduled(_idx)){
+			unlink(_idx);
+			--sz;
+			if(sz == 0){
+				nexttick = invalidTick();
+			}
+		}
+	}
+
+	//! Advance the wheel up to _tick calling _rf(index) for every due timer
+	/*!
+		The timer is no longer scheduled when _rf is called, so it can be
+		rescheduled from within the call.
+		Returns the number of fired timers.
+	*/
+	template <class F>
+	size_t advance(const uint64 _tick, F &_rf){
+		size_t	cnt(0);
+		while(crttick < _tick){
+			if(sz == 0){
+				crttick = _tick;
+				break;
+			}
+			//jump to the next non empty first level slot or cascade point
+			uint64			nxt((crttick | L0Mask) + 1);
+			const size_t	dist(nextSlotDistance());
+			if(dist && (crttick + dist) < nxt){
+				nxt = crttick + dist;
+			}
+			if(nxt > _tick){
+				crttick = _tick;
+				break;
+			}
+			crttick = nxt;
+			const size_t idx(crttick & L0Mask);
+			if(idx == 0){
+				cascade(1);
+			}
+			cnt += fire(idx, _rf);
+		}
+		computeNextTick();
+		return cnt;
+	}
+private:
+	static size_t levelShift(const size_t _lvl){
+		return L0Bits + (_lvl - 1) * LNBits;
+	}
+	static size_t levelOffset(const size_t _lvl){
+		return L0Size + (_lvl - 1) * LNSize;
+	}
+	static size_t firstBit(uint64 _v){
+#ifdef __GNUC__
+		return __builtin_ctzll(_v);
+#else
+		size_t rv(0);
+		while(!(_v & 1)){
+			_v >>= 1;
+			++rv;
+		}
+		return rv;
+#endif
+	}
+	//! Smallest distance d in [1, 64] so that bit (_pos + d) % 64 is set
+	static size_t nextBitDistance(const uint64 _v, const size_t _pos){
+		const size_t	rot((_pos + 1) & 63);
+		const uint64	v(rot ? ((_v >> rot) | (_v << (64 - rot))) : _v);
+		return firstBit(v) + 1;
+	}
+
+	void link(const size_t _idx){
+		Node			&rn(nodes[_idx]);
+		const uint64	delta(rn.tick - crttick);
+		size_t			slot;
+		if(delta < L0Size){
+			slot = rn.tick & L0Mask;
+			bits[slot >> 6] |= (1ULL << (slot & 63));
+		}else{
+			size_t lvl(1);
+			while(lvl < (LevelCount - 1) && delta >= (1ULL << levelShift(lvl + 1))){
+				++lvl;
+			}
+			const size_t lidx((rn.tick >> levelShift(lvl)) & LNMask);
+			slot = levelOffset(lvl) + lidx;
+			bits[L0Words + lvl - 1] |= (1ULL << lidx);
+		}
+		rn.slot = slot;
+		rn.prev = InvalidIndex;
+		rn.next = slots[slot];
+		if(rn.next != InvalidIndex){
+			nodes[rn.next].prev = _idx;
+		}
+		slots[slot] = _idx;
+	}
+
+	void unlink(const size_t _idx){
+		Node &rn(nodes[_idx]);
+		if(rn.prev != InvalidIndex){
+			nodes[rn.prev].next = rn.next;
+		}else{
+			slots[rn.slot] = rn.next;
+			if(rn.next == InvalidIndex){
+				clearBit(rn.slot);
+			}
+		}
+		if(rn.next != InvalidIndex){
+			nodes[rn.next].prev = rn.prev;
+		}
+		rn.slot = InvalidSlot;
+		rn.next = rn.prev = InvalidIndex;
+	}
+
+	void clearBit(const size_t _slot){
+		if(_slot < L0Size){
+			bits[_slot >> 6] &= ~(1ULL << (_slot & 63));
+		}else{
+			const size_t lvl(((_slot - L0Size) >> LNBits) + 1);
+			bits[L0Words + lvl - 1] &= ~(1ULL << ((_slot - L0Size) & LNMask));
+		}
+	}
+
+	uint32 detach(const size_t _slot){
+		const uint32 head(slots[_slot]);
+		if(head != InvalidIndex){
+			slots[_slot] = InvalidIndex;
+			clearBit(_slot);
+		}
+		return head;
+	}
+
+	void cascade(const size_t _lvl){
+		const size_t lidx((crttick >> levelShift(_lvl)) & LNMask);
+		if(lidx == 0 && _lvl < (LevelCount - 1)){
+			cascade(_lvl + 1);
+		}
+		uint32 idx(detach(levelOffset(_lvl) + lidx));
+		while(idx != InvalidIndex){
+			Node &rn(nodes[idx]);
+			const uint32 nxt(rn.next);
+			link(idx);
+			idx = nxt;
+		}
+	}
+
+	template <class F>
+	size_t fire(const size_t _slot, F &_rf){
+		//pop one by one, as _rf might cancel other timers from the slot
+		size_t	cnt(0);
+		uint32	idx;
+		while((idx = slots[_slot]) != InvalidIndex){
+			unlink(idx);
+			--sz;
+			++cnt;
+			_rf(idx);
+		}
+		return cnt;
+	}
+
+	//! Distance to the next non empty first level slot before the cascade point, or 0
+	size_t nextSlotDistance()const{
+		const size_t	l0pos(crttick & L0Mask);
+		size_t			w(l0pos >> 6);
+		uint64			v((l0pos & 63) == 63 ? 0 : bits[w] & ~((2ULL << (l0pos & 63)) - 1));
+		while(!v && ++w < L0Words){
+			v = bits[w];
+		}
+		if(v){
+			return (w << 6) + firstBit(v) - l0pos;
+		}
+		return 0;
+	}
+
+	void computeNextTick(){
+		nexttick = invalidTick();
+		if(sz == 0) return;
+		const size_t dist(nextSlotDistance());
+		if(dist){
+			nexttick = crttick + dist;
+			return;
+		}
+		const size_t l0pos(crttick & L0Mask);
+		for(size_t w = 0; w <= (l0pos >> 6); ++w){
+			//first level slots past the cascade point
+			const uint64 v(w == (l0pos >> 6) ? bits[w] & ((2ULL << (l0pos & 63)) - 1) : bits[w]);
+			if(v){
+				nexttick = crttick + L0Size - l0pos + (w << 6) + firstBit(v);
+				break;
+			}
+		}
+		for(size_t lvl = 1; lvl < LevelCount; ++lvl){
+			const uint64 v(bits[L0Words + lvl - 1]);
+			if(v){
+				const uint64	crt(crttick >> levelShift(lvl));
+				const uint64	tck((crt + nextBitDistance(v, crt & LNMask)) << levelShift(lvl));
+				if(tck < nexttick){
+					nexttick = tck;
+				}
+			}
+		}
+	}
+private:
+	uint64		crttick;
+	uint64		nexttick;
+	size_t		sz;
+	uint32		slots[SlotCount];
+	uint64		bits[WordCount];
+	NodeVectorT	nodes;
+};
+
+}//namespace solid
+
+#endif
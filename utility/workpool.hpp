@@ -13,6 +13,7 @@
 #include "system/thread.hpp"
 #include "system/mutex.hpp"
 #include "system/condition.hpp"
+#include "system/timespec.hpp"
 
 #include "utility/common.hpp"
 #include "utility/queue.hpp"
@@ -71,6 +72,18 @@ struct WorkPoolControllerBase{
 	}
 	void onPopDone(WorkPoolBase &, WorkerBase &){
 	}
+	//! Return true to have the worker exit
+	/*!
+	 * Called before a worker pops jobs and when it was idle
+	 * for idleTimeout milliseconds.
+	 */
+	bool onPopRetire(WorkPoolBase &, WorkerBase &){
+		return false;
+	}
+	//! Milliseconds an idle worker waits for jobs before calling onPopRetire - zero for ever
+	ulong idleTimeout()const{
+		return 0;
+	}
 	void onStop(){
 	}
 };
@@ -223,11 +236,14 @@ private:
 	}
 	bool pop(WorkerT &_rw, JobVectorT &_rjobvec, ulong _maxcnt){
 		Locker<Mutex> lock(mtx);
+		if(ctrl.onPopRetire(*this, _rw)){
+			return false;
+		}
 		uint32 insertcount(ctrl.onPopStart(*this, _rw, _maxcnt));
 		if(!insertcount){
 			return true;
 		}
-		if(doWaitJob(lock)){
+		if(doWaitJob(lock, _rw)){
 			do{
 				_rjobvec.push_back(jobq.front());
 				jobq.pop();
@@ -240,11 +256,14 @@ private:
 	
 	bool pop(WorkerT &_rw, JobT &_rjob){
 		Locker<Mutex> lock(mtx);
+		if(ctrl.onPopRetire(*this, _rw)){
+			return false;
+		}
 		if(ctrl.onPopStart(*this, _rw, 1) == 0){
 			sigcnd.signal();
 			return false;
 		}
-		if(doWaitJob(lock)){
+		if(doWaitJob(lock, _rw)){
 			_rjob = jobq.front();
 			jobq.pop();
 			ctrl.onPopDone(*this, _rw);
@@ -253,9 +272,21 @@ private:
 		return false;
 	}
 	
-	ulong doWaitJob(Locker<Mutex> &_lock){
+	ulong doWaitJob(Locker<Mutex> &_lock, WorkerT &_rw){
+		const ulong		idlemsec(ctrl.idleTimeout());
+		if(!idlemsec){
+			while(jobq.empty() && isRunning()){
+				sigcnd.wait(_lock);
+			}
+			return jobq.size();
+		}
+		TimeSpec		ts;
 		while(jobq.empty() && isRunning()){
-			sigcnd.wait(_lock);
+			ts.currentRealTime();
+			ts += idlemsec;
+			if(!sigcnd.wait(_lock, ts) && jobq.empty() && isRunning() && ctrl.onPopRetire(*this, _rw)){
+				return 0;
+			}
 		}
 		return jobq.size();
 	}